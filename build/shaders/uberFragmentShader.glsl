@@ -8,11 +8,16 @@ in vec3 EyeDirection_cameraspace;
 in vec3 LightDirection_cameraspace;
 in vec4 ShadowCoord;
 in vec3 texDirection;
+//Light of the light volume
+flat in vec4 LightPositionRadius_cameraspace;
+flat in vec4 LightColorIntensity;
 
 // Ouput data
 layout(location = 0) out vec3 color;
 layout(location = 1) out vec3 positionOut;
 layout(location = 2) out vec3 normalOut;
+//Albedo and specular intensity of the compact G-Buffer. Sent to the RGBA8 diffuse attachment instead of color
+layout(location = 3) out vec4 albedoSpecularOut;
 
 // Values that stay constant for the whole mesh.
 uniform sampler2D textureSampler;
@@ -21,6 +26,8 @@ uniform sampler2D shadowMapSampler;
 uniform sampler2D diffuseSampler;
 uniform sampler2D positionSampler;
 uniform sampler2D normalsSampler;
+//Depth of the G-Buffer, the compact G-Buffer has no position texture
+uniform sampler2D depthSampler;
 //Skybox Sampler
 uniform samplerCube skyBoxSampler;
 
@@ -29,21 +36,147 @@ uniform vec3 LightColor;
 uniform float LightIntensity;
 uniform float maxLightRadius;
 
-uniform vec3 AmbientMaterial;
-uniform vec3 SpecularMaterial;
-uniform float Shininess;
+//Light lists of the tiled light pass. Each light is 2 texels, each tile is the offset and count of its lights in the light index list
+uniform samplerBuffer lightDataSampler;
+uniform usamplerBuffer tileDataSampler;
+uniform usamplerBuffer lightIndexSampler;
+//Size of the tiles in pixels and the amount of tiles in a row
+uniform int tileSize;
+uniform int tileCountX;
 
-//Used by Deferred Shading
-uniform vec2 screenSize;
-uniform mat4 viewMatrix;
+//Same blocks as in the vertex shader
+layout(std140, row_major) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightViewProjection;
+	//Used to rebuild the position from the depth of the compact G-Buffer
+	mat4 inverseProjection;
+	//Used by Deferred Shading
+	vec4 screenSize;
+};
 
-//Gaussian Blur screen size
+layout(std140, row_major) uniform ObjectBlock
+{
+	mat4 model;
+	vec4 AmbientMaterial;
+	//w is the shininess
+	vec4 SpecularMaterial;
+};
+
+//Gaussian Blur step between the taps in texture coordinates, along the direction of the pass
 uniform vec2 ScaleU;
+//Linear taps of the Gaussian, each fetches between two texels. The first is the center, the others are taken on both sides. MaxBlurTaps in ShadowMapFilter.h
+uniform float blurOffsets[9];
+uniform float blurWeights[9];
+uniform int blurTapCount;
+//Smallest variance of the moments, larger for the 16 bit formats
+uniform float shadowMinVariance;
 
-//Shader Mode
+//Shader Mode. Each variant of the program is compiled with MODE defined and only keeps the branch of its mode in main.
+//Without MODE the mode is a uniform and MODE 0 keeps every branch
+#ifdef MODE
+const int mode = MODE;
+#else
 uniform int mode;
+#define MODE 0
+#endif
+
+//Returns 1 or -1 for each component. 0 counts as positive
+vec2 signNotZero(vec2 v){
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Octahedral encoding. The unit normal is projected onto an octahedron which is unfolded into a square and mapped to 0..1
+vec2 encodeNormal(vec3 n){
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e){
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0){
+		n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	}
+	return normalize(n);
+}
+
+//Position in camera space of a pixel of the G-Buffer from its depth
+vec3 reconstructPosition(vec2 TexCoord, float depth){
+	vec4 position = inverseProjection * vec4(vec3(TexCoord, depth) * 2.0 - 1.0, 1.0);
+	return position.xyz / position.w;
+}
+
+//Reads the surface of a pixel from the G-Buffer. The full G-Buffer has no specular intensity, the specular material of the bound ObjectBlock is used instead
+void readGBuffer(bool isCompact, vec2 TexCoord, out vec3 MaterialDiffuseColor, out vec3 MaterialSpecularColor, out vec3 Normal, out vec3 vertexPosition_cameraspace){
+	if(isCompact){
+		vec4 albedoSpecular = texture(diffuseSampler, TexCoord);
+		MaterialDiffuseColor = albedoSpecular.rgb;
+		MaterialSpecularColor = vec3(albedoSpecular.a);
+		Normal = decodeNormal(texture(normalsSampler, TexCoord).xy);
+		vertexPosition_cameraspace = reconstructPosition(TexCoord, texture(depthSampler, TexCoord).x);
+	}
+	else{
+		MaterialDiffuseColor = texture(diffuseSampler, TexCoord).xyz;
+		vec3 WorldPos = texture(positionSampler, TexCoord).xyz;
+		Normal = texture(normalsSampler, TexCoord).xyz;
+		// Material properties
+		MaterialSpecularColor = SpecularMaterial.rgb;
+		vertexPosition_cameraspace = (view * vec4(WorldPos,1)).xyz;
+	}
+}
+
+//Diffuse and specular light of a point light on a pixel of the G-Buffer. Positions are in camera space
+vec3 pointLight(vec3 LightPosition_cameraspace, vec3 lightColor, float lightIntensity, float lightRadius, vec3 MaterialDiffuseColor, vec3 MaterialSpecularColor, vec3 Normal, vec3 vertexPosition_cameraspace){
+	// Distance to the light. The view matrix doesn't scale, so it is the same as in world space
+	float distance = length( LightPosition_cameraspace - vertexPosition_cameraspace ); //magnitude of the vector
+	
+	// Vector that goes from the vertex to the camera, in camera space.
+	// In camera space, the camera is at the origin (0,0,0).
+	vec3 cameraDirection_cameraspace = vec3(0,0,0) - vertexPosition_cameraspace;
+	// Vector that goes from the vertex to the light, in camera space. For easier calculations later no need to get the opposite vector by then
+	vec3 LightDir_cameraspace = LightPosition_cameraspace + cameraDirection_cameraspace;
+	
+	// Normal of the computed fragment, in camera space
+	vec3 n = normalize( Normal );
+	// Direction of the light (from the fragment to the light)
+	vec3 l = normalize( LightDir_cameraspace );
+		
+	// Cosine of the angle between the normal and the light direction, 
+	// clamped above 0
+	//  - light is at the vertical of the triangle -> 1
+	//  - light is perpendicular to the triangle -> 0
+	//  - light is behind the triangle -> 0
+	float cosTheta = clamp( dot( n,l ), 0,1 ); //clamp the value between 0 and 1. N dot L
+	
+	// Eye vector (towards the camera)
+	vec3 E = normalize(cameraDirection_cameraspace);
+	// Direction in which the triangle reflects the light
+	vec3 R = reflect(-l,n);
+	
+	//vec3 H = normalize(LightDirection_cameraspace+EyeDirection_cameraspace);	
+	// Cosine of the angle between the Eye vector and the Reflect vector,
+	// clamped to 0
+	//  - Looking into the reflection -> 1
+	//  - Looking elsewhere -> < 1
+	float cosAlpha = clamp( dot( E,R ), 0,1 );
+	
+	//Linear Attenuation, based on distance.
+	//Distance is divided by the radius of the light which must be <= scale of the light mesh
+	float attenuation = clamp((1.0f - distance/lightRadius),0.0,1.0); 
+	
+	return
+	// Diffuse : "color" of the object
+	(MaterialDiffuseColor * lightColor * lightIntensity * cosTheta +
+	// Specular : reflective highlight, like a mirror
+	MaterialSpecularColor * lightColor * lightIntensity * pow(cosAlpha, SpecularMaterial.w))*attenuation;
+}
 
 void main(){
+#if MODE == 0 || MODE == 1
 	if(mode == 1){ //Shadowmap Pass 1		
 		float moment1 = gl_FragCoord.z;
 		float moment2 = moment1*moment1;
@@ -55,11 +188,13 @@ void main(){
 		
 		color = vec3(moment1, moment2, 0);
 	}
-	else if(mode == 2){ //Shadowmap Pass 2
+#endif
+#if MODE == 0 || MODE == 2
+	if(mode == 2){ //Shadowmap Pass 2
 		// Material properties
 		vec3 MaterialDiffuseColor = texture(textureSampler, UV).rgb;
-		vec3 MaterialAmbientColor = AmbientMaterial * MaterialDiffuseColor;
-		vec3 MaterialSpecularColor = SpecularMaterial;
+		vec3 MaterialAmbientColor = AmbientMaterial.rgb * MaterialDiffuseColor;
+		vec3 MaterialSpecularColor = SpecularMaterial.rgb;
 
 		// Distance to the light
 		float distance = length( LightPosition_worldspace - Position_worldspace ); //magnitude of the vector
@@ -105,7 +240,7 @@ void main(){
 		if (moments.x < z){
 			float variance = moments.y - (moments.x*moments.x);
 			//Clamp the min value of variance
-			variance = max(variance,0.0000005);
+			variance = max(variance,shadowMinVariance);
 			float d = z - moments.x;
 			//Smoothstep to correct lightbleed.
 			//If pMax<=edge0 return 0, if pMax>=edge1 return 0, else return interpolated value
@@ -124,103 +259,106 @@ void main(){
 			// Diffuse : "color" of the object
 			pMax * MaterialDiffuseColor * LightColor * LightIntensity * cosTheta * attenuation +
 			// Specular : reflective highlight, like a mirror
-			pMax * MaterialSpecularColor * LightColor * LightIntensity * pow(cosAlpha, Shininess) * attenuation;
+			pMax * MaterialSpecularColor * LightColor * LightIntensity * pow(cosAlpha, SpecularMaterial.w) * attenuation;
 	}
-	else if(mode == 3){ //Render Shadowmap texture to fullscreen quad
+#endif
+#if MODE == 0 || MODE == 3
+	if(mode == 3){ //Render Shadowmap texture to fullscreen quad
 		float depthSample = pow(texture2D(shadowMapSampler, UV).x, 10);
 		color = vec3(depthSample,depthSample,depthSample);
 	}
-	else if(mode == 4){ //Gaussian blur
-		vec3 blur = vec3(0.0);
-		
-		blur += texture(shadowMapSampler, UV + vec2(-3.0*ScaleU.x, -3.0*ScaleU.y)).rgb * 0.015625;
-		blur += texture(shadowMapSampler, UV + vec2(-2.0*ScaleU.x, -2.0*ScaleU.y)).rgb * 0.09375;
-		blur += texture(shadowMapSampler, UV + vec2(-1.0*ScaleU.x, -1.0*ScaleU.y)).rgb * 0.234375;
-		blur += texture(shadowMapSampler, UV + vec2(0.0, 0.0)).rgb * 0.3125;
-		blur += texture(shadowMapSampler, UV + vec2(1.0*ScaleU.x,  1.0*ScaleU.y)).rgb * 0.234375;
-		blur += texture(shadowMapSampler, UV + vec2(2.0*ScaleU.x,  2.0*ScaleU.y)).rgb * 0.09375;
-		blur += texture(shadowMapSampler, UV + vec2(3.0*ScaleU.x, -3.0*ScaleU.y)).rgb * 0.015625;
-
+#endif
+#if MODE == 0 || MODE == 4
+	if(mode == 4){ //Gaussian blur
+		vec3 blur = texture(shadowMapSampler, UV).rgb * blurWeights[0];
+		for(int i = 1; i < blurTapCount; i++){
+			blur += texture(shadowMapSampler, UV + blurOffsets[i]*ScaleU).rgb * blurWeights[i];
+			blur += texture(shadowMapSampler, UV - blurOffsets[i]*ScaleU).rgb * blurWeights[i];
+		}
 		color = blur;
 	}
-	else if(mode == 5){ //Geometry Buffer Pass
+#endif
+#if MODE == 0 || MODE == 5
+	if(mode == 5){ //Geometry Buffer Pass
 		//Output to G-Buffer attachments
 		color = texture(textureSampler, UV).xyz;	
 		positionOut = Position_worldspace;
 		normalOut = normalize(Normal_cameraspace);				
 	}
-	else if(mode == 6){ //Light Pass
+#endif
+#if MODE == 0 || MODE == 14
+	if(mode == 14){ //Compact Geometry Buffer Pass
+		//Albedo with the specular intensity of the material in alpha. The position is not written, the light pass rebuilds it from the depth
+		albedoSpecularOut = vec4(texture(textureSampler, UV).rgb, max(max(SpecularMaterial.r, SpecularMaterial.g), SpecularMaterial.b));
+		//Only xy reach the RG16 attachment
+		normalOut = vec3(encodeNormal(normalize(Normal_cameraspace)), 0.0);
+	}
+#endif
+#if MODE == 0 || MODE == 6 || MODE == 15
+	if(mode == 6 || mode == 15){ //Light Pass. 15 reads the compact G-Buffer
 		//UVCoord in screenspace
-		vec2 TexCoord = gl_FragCoord.xy / screenSize;
-		vec3 MaterialDiffuseColor = texture(diffuseSampler, TexCoord).xyz;
-		vec3 WorldPos = texture(positionSampler, TexCoord).xyz;
-		vec3 Normal = texture(normalsSampler, TexCoord).xyz;
+		vec2 TexCoord = gl_FragCoord.xy / screenSize.xy;
+		//Pixels without geometry are not lit. Pixels with geometry in front of the volume get no light from the attenuation
+		if(texture(depthSampler, TexCoord).x == 1.0){
+			discard;
+		}
+		vec3 MaterialDiffuseColor;
+		vec3 MaterialSpecularColor;
+		vec3 Normal;
+		vec3 vertexPosition_cameraspace;
+		readGBuffer(mode == 15, TexCoord, MaterialDiffuseColor, MaterialSpecularColor, Normal, vertexPosition_cameraspace);
 
-		/////
-		// Material properties
-		vec3 MaterialSpecularColor = SpecularMaterial;
+		color = pointLight(LightPositionRadius_cameraspace.xyz, LightColorIntensity.rgb, LightColorIntensity.a, LightPositionRadius_cameraspace.w, MaterialDiffuseColor, MaterialSpecularColor, Normal, vertexPosition_cameraspace);
+	}
+#endif
+#if MODE == 0 || MODE == 16 || MODE == 17
+	if(mode == 16 || mode == 17){ //Tiled Light Pass. 17 reads the compact G-Buffer
+		//UVCoord in screenspace
+		vec2 TexCoord = gl_FragCoord.xy / screenSize.xy;
+		//Pixels without geometry are not lit, like the ones outside the stencil of the light volumes
+		if(texture(depthSampler, TexCoord).x == 1.0){
+			discard;
+		}
+		vec3 MaterialDiffuseColor;
+		vec3 MaterialSpecularColor;
+		vec3 Normal;
+		vec3 vertexPosition_cameraspace;
+		readGBuffer(mode == 17, TexCoord, MaterialDiffuseColor, MaterialSpecularColor, Normal, vertexPosition_cameraspace);
 
-		// Distance to the light
-		float distance = length( LightPosition_worldspace - WorldPos ); //magnitude of the vector
-		
-		// Vector that goes from the vertex to the camera, in camera space.
-		// In camera space, the camera is at the origin (0,0,0).
-		vec3 vertexPosition_cameraspace = (viewMatrix * vec4(WorldPos,1)).xyz;
-		vec3 cameraDirection_cameraspace = vec3(0,0,0) - vertexPosition_cameraspace;
-		
-		// Vector that goes from the vertex to the light, in camera space. For easier calculations later no need to get the opposite vector by then
-		vec3 LightPosition_cameraspace = ( viewMatrix * vec4(LightPosition_worldspace,1)).xyz;
-		vec3 LightDir_cameraspace = LightPosition_cameraspace + cameraDirection_cameraspace;
-		
-		// Normal of the computed fragment, in camera space
-		vec3 n = normalize( Normal );
-		// Direction of the light (from the fragment to the light)
-		vec3 l = normalize( LightDir_cameraspace );
-			
-		// Cosine of the angle between the normal and the light direction, 
-		// clamped above 0
-		//  - light is at the vertical of the triangle -> 1
-		//  - light is perpendicular to the triangle -> 0
-		//  - light is behind the triangle -> 0
-		float cosTheta = clamp( dot( n,l ), 0,1 ); //clamp the value between 0 and 1. N dot L
-		
-		// Eye vector (towards the camera)
-		vec3 E = normalize(cameraDirection_cameraspace);
-		// Direction in which the triangle reflects the light
-		vec3 R = reflect(-l,n);
-		
-		//vec3 H = normalize(LightDirection_cameraspace+EyeDirection_cameraspace);	
-		// Cosine of the angle between the Eye vector and the Reflect vector,
-		// clamped to 0
-		//  - Looking into the reflection -> 1
-		//  - Looking elsewhere -> < 1
-		float cosAlpha = clamp( dot( E,R ), 0,1 );
-		
-		//Linear Attenuation, based on distance.
-		//Distance is divided by the max radius of the light which must be <= scale of the light mesh
-		float attenuation = clamp((1.0f - distance/maxLightRadius),0.0,1.0); 
-		
-		color = 
-		// Diffuse : "color" of the object
-		(MaterialDiffuseColor * LightColor * LightIntensity * cosTheta +
-		// Specular : reflective highlight, like a mirror
-		MaterialSpecularColor * LightColor * LightIntensity * pow(cosAlpha, Shininess))*attenuation;
-		// color = vec3(1,0,0);
-		////
+		//Offset and count of the tile's lights in the light index list
+		ivec2 tile = ivec2(gl_FragCoord.xy) / tileSize;
+		uvec2 tileLights = texelFetch(tileDataSampler, tile.y * tileCountX + tile.x).xy;
+
+		color = vec3(0,0,0);
+		for(uint i = 0u; i < tileLights.y; i++){
+			int light = int(texelFetch(lightIndexSampler, int(tileLights.x + i)).x);
+			//Position in camera space and radius, then color and intensity
+			vec4 positionRadius = texelFetch(lightDataSampler, light * 2);
+			vec4 colorIntensity = texelFetch(lightDataSampler, light * 2 + 1);
+			color += pointLight(positionRadius.xyz, colorIntensity.rgb, colorIntensity.a, positionRadius.w, MaterialDiffuseColor, MaterialSpecularColor, Normal, vertexPosition_cameraspace);
+		}
 	}
-	else if(mode == 7){ //Render diffuse color texture with ambient light to fullscreen quad
-		color = AmbientMaterial*texture(diffuseSampler, UV).xyz;
+#endif
+#if MODE == 0 || MODE == 7
+	if(mode == 7){ //Render diffuse color texture with ambient light to fullscreen quad
+		color = AmbientMaterial.rgb*texture(diffuseSampler, UV).xyz;
 	}
-	else if(mode == 8){ //Render G-Buffer textures to fullscreen quad
+#endif
+#if MODE == 0 || MODE == 8
+	if(mode == 8){ //Render G-Buffer textures to fullscreen quad
 		color = texture2D(shadowMapSampler, UV).xyz;
 	}
-	else if(mode == 9){ //Stencil Pass
+#endif
+#if MODE == 0 || MODE == 9
+	if(mode == 9){ //Stencil Pass
 	}
-	else if(mode == 10){ //Point Light forward rendering
+#endif
+#if MODE == 0 || MODE == 10
+	if(mode == 10){ //Point Light forward rendering
 		// Material properties
 		vec3 MaterialDiffuseColor = texture(textureSampler, UV).rgb;
-		vec3 MaterialAmbientColor = AmbientMaterial * MaterialDiffuseColor;
-		vec3 MaterialSpecularColor = SpecularMaterial;
+		vec3 MaterialAmbientColor = AmbientMaterial.rgb * MaterialDiffuseColor;
+		vec3 MaterialSpecularColor = SpecularMaterial.rgb;
 
 		// Distance to the light
 		float distance = length( LightPosition_worldspace - Position_worldspace ); //magnitude of the vector
@@ -259,15 +397,22 @@ void main(){
 		// Diffuse : "color" of the object
 		(MaterialDiffuseColor * LightColor * LightIntensity * cosTheta +
 		// Specular : reflective highlight, like a mirror
-		MaterialSpecularColor * LightColor * LightIntensity * pow(cosAlpha, Shininess))*attenuation;
+		MaterialSpecularColor * LightColor * LightIntensity * pow(cosAlpha, SpecularMaterial.w))*attenuation;
 	}
-	else if(mode == 11){ //Skybox
+#endif
+#if MODE == 0 || MODE == 11
+	if(mode == 11){ //Skybox
 		color = texture(skyBoxSampler, texDirection).rgb;
 	}
-	else if(mode == 12){ //Wireframe
+#endif
+#if MODE == 0 || MODE == 12
+	if(mode == 12){ //Wireframe
 		color = vec3(0.0, 0.3, 0.0);
 	}
-	else if(mode == 13){ //No Light
-		 color = AmbientMaterial * texture(textureSampler, UV).rgb;
+#endif
+#if MODE == 0 || MODE == 13
+	if(mode == 13){ //No Light
+		 color = AmbientMaterial.rgb * texture(textureSampler, UV).rgb;
 	}
+#endif
 }
\ No newline at end of file
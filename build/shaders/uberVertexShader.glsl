@@ -4,6 +4,13 @@
 layout(location = 0) in vec3 vertexPosition_modelspace;
 layout(location = 1) in vec2 vertexUV;
 layout(location = 2) in vec3 vertexNormal_modelspace;
+//Model matrix of the instance. Only used by instanced draws, takes the locations 3 to 6
+layout(location = 3) in mat4 instanceModel;
+//Light of the instance. Only used by the light volume batch of the light pass
+layout(location = 7) in vec4 instanceLightPositionRadius;
+layout(location = 8) in vec4 instanceLightColorIntensity;
+//Screen rectangle of the instance's light in normalized device coordinates, min x and y then max x and y. Only used by the light quads
+layout(location = 9) in vec4 instanceLightRect;
 
 // Output data ; will be interpolated for each fragment.
 out vec2 UV;
@@ -15,32 +22,74 @@ out vec3 LightDirection_cameraspace;
 out vec4 ShadowCoord;
 //UV for skybox
 out vec3 texDirection;
+//Light of the light volume, the same for the whole instance
+flat out vec4 LightPositionRadius_cameraspace;
+flat out vec4 LightColorIntensity;
+
+// Values that stay constant for the whole pass. Uploaded once per pass
+layout(std140, row_major) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightViewProjection;
+	mat4 inverseProjection;
+	vec4 screenSize;
+};
+
+// Values that stay constant for the whole mesh. Each draw binds its range of the ring buffer
+layout(std140, row_major) uniform ObjectBlock
+{
+	mat4 model;
+	vec4 AmbientMaterial;
+	//w is the shininess
+	vec4 SpecularMaterial;
+};
 
-// Values that stay constant for the whole mesh.
-uniform mat4 mvp;
-uniform mat4 depthMVP;
-uniform mat4 view;
-uniform mat4 model;
-uniform mat4 modelView;
 uniform vec3 LightPosition_worldspace;
 
+//Shader Mode. Each variant of the program is compiled with MODE defined and only keeps the branch of its mode in main.
+//Without MODE the mode is a uniform and MODE 0 keeps every branch
+#ifdef MODE
+const int mode = MODE;
+#else
 uniform int mode;
+#define MODE 0
+#endif
+//Set by instanced draws. The model matrix of the ObjectBlock is then ignored and instanceModel is used instead
+uniform bool isInstanced;
+//Set by the light volume batch for the lights drawn as a quad over their screen rectangle instead of a sphere
+uniform bool isLightQuad;
+
+//Corners of the light quad, 2 triangles picked with gl_VertexID since the quad has no vertex buffer
+const vec2 quadCorners[6] = vec2[6](vec2(0,0), vec2(1,0), vec2(1,1), vec2(0,0), vec2(1,1), vec2(0,1));
 
 void main(){
+	mat4 modelMatrix = model;
+	if(isInstanced){
+		modelMatrix = instanceModel;
+	}
+	mat4 mvpMatrix = viewProjection * modelMatrix;
+	mat4 depthMVPMatrix = lightViewProjection * modelMatrix;
+	mat4 modelViewMatrix = view * modelMatrix;
+
+#if MODE == 0 || MODE == 1
 	if(mode == 1){ //Shadowmap Pass 1
-		gl_Position = depthMVP * vec4(vertexPosition_modelspace,1);	
+		gl_Position = depthMVPMatrix * vec4(vertexPosition_modelspace,1);	
 	}
-	else if(mode == 2){ //Shadowmap Pass 2
+#endif
+#if MODE == 0 || MODE == 2
+	if(mode == 2){ //Shadowmap Pass 2
 		// Output position of the vertex, in clip space : MVP * position
-		gl_Position =  mvp * vec4(vertexPosition_modelspace,1);
-		ShadowCoord = depthMVP * vec4(vertexPosition_modelspace,1);
+		gl_Position =  mvpMatrix * vec4(vertexPosition_modelspace,1);
+		ShadowCoord = depthMVPMatrix * vec4(vertexPosition_modelspace,1);
 		
 		// Position of the vertex, in worldspace : M * position
-		Position_worldspace = (model * vec4(vertexPosition_modelspace,1)).xyz;
+		Position_worldspace = (modelMatrix * vec4(vertexPosition_modelspace,1)).xyz;
 		
 		// Vector that goes from the vertex to the camera, in camera space.
 		// In camera space, the camera is at the origin (0,0,0).
-		vec3 vertexPosition_cameraspace = (modelView * vec4(vertexPosition_modelspace,1)).xyz;
+		vec3 vertexPosition_cameraspace = (modelViewMatrix * vec4(vertexPosition_modelspace,1)).xyz;
 		EyeDirection_cameraspace = vec3(0,0,0) - vertexPosition_cameraspace;
 		
 		// Vector that goes from the vertex to the light, in camera space. For easier calculations later no need to get the opposite vector by then
@@ -48,51 +97,83 @@ void main(){
 		LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
 		
 		// Normal of the the vertex, in camera space
-		Normal_cameraspace = (modelView * vec4(vertexNormal_modelspace,0)).xyz; // Only correct if ModelMatrix does not scale the model ! Use its inverse transpose if not.
+		Normal_cameraspace = (modelViewMatrix * vec4(vertexNormal_modelspace,0)).xyz; // Only correct if ModelMatrix does not scale the model ! Use its inverse transpose if not.
 		
 		// UV of the vertex. No special space for this one.
 		UV = vertexUV;
 	}
-	else if(mode == 3){ //Render Shadowmap texture to fullscreen quad
+#endif
+#if MODE == 0 || MODE == 3
+	if(mode == 3){ //Render Shadowmap texture to fullscreen quad
 		gl_Position =  vec4(vertexPosition_modelspace,1);
 		UV = (vertexPosition_modelspace.xy+vec2(1,1))/2.0;
 	}
-	else if(mode == 4){ //Gaussian blur		
+#endif
+#if MODE == 0 || MODE == 4
+	if(mode == 4){ //Gaussian blur		
 		gl_Position =  vec4(vertexPosition_modelspace,1);
 		UV = (vertexPosition_modelspace.xy+vec2(1,1))/2.0;
 	}
-	else if(mode == 5){ //Geometry Buffer Pass
-		gl_Position = mvp * vec4(vertexPosition_modelspace, 1.0);
+#endif
+#if MODE == 0 || MODE == 5 || MODE == 14
+	if(mode == 5 || mode == 14){ //Geometry Buffer Pass. 14 writes the compact G-Buffer
+		gl_Position = mvpMatrix * vec4(vertexPosition_modelspace, 1.0);
 		
 		//Output to G-Buffer attachments
 		UV = vertexUV;
-		Position_worldspace = (model * vec4(vertexPosition_modelspace,1)).xyz;
-		Normal_cameraspace = (modelView * vec4(vertexNormal_modelspace,0)).xyz;
+		if(mode == 5){
+			Position_worldspace = (modelMatrix * vec4(vertexPosition_modelspace,1)).xyz;
+		}
+		Normal_cameraspace = (modelViewMatrix * vec4(vertexNormal_modelspace,0)).xyz;
+	}
+#endif
+#if MODE == 0 || MODE == 6 || MODE == 15
+	if(mode == 6 || mode == 15){ //Light Pass. 15 reads the compact G-Buffer
+		if(isLightQuad){
+			//Small lights and lights around the camera cover their screen rectangle instead of the triangles of a sphere
+			gl_Position = vec4(mix(instanceLightRect.xy, instanceLightRect.zw, quadCorners[gl_VertexID]), 0.0, 1.0);
+		}
+		else{
+			//The unit sphere is scaled by the radius of the instance's light and moved to its position
+			gl_Position = viewProjection * vec4(vertexPosition_modelspace * instanceLightPositionRadius.w + instanceLightPositionRadius.xyz, 1.0);
+		}
+		LightPositionRadius_cameraspace = vec4((view * vec4(instanceLightPositionRadius.xyz, 1)).xyz, instanceLightPositionRadius.w);
+		LightColorIntensity = instanceLightColorIntensity;
 	}
-	else if(mode == 6){ //Light Pass
-		gl_Position = mvp * vec4(vertexPosition_modelspace, 1.0);
+#endif
+#if MODE == 0 || MODE == 16 || MODE == 17
+	if(mode == 16 || mode == 17){ //Tiled Light Pass. Fullscreen quad, the lights are read in the fragment shader
+		gl_Position =  vec4(vertexPosition_modelspace,1);
 	}
-	else if(mode == 7){ //Render diffuse color texture with ambient light to fullscreen quad
+#endif
+#if MODE == 0 || MODE == 7
+	if(mode == 7){ //Render diffuse color texture with ambient light to fullscreen quad
 		gl_Position =  vec4(vertexPosition_modelspace,1);
 		UV = (vertexPosition_modelspace.xy+vec2(1,1))/2.0;
 	}
-	else if(mode == 8){ //Render G-Buffer textures to fullscreen quad
+#endif
+#if MODE == 0 || MODE == 8
+	if(mode == 8){ //Render G-Buffer textures to fullscreen quad
 		gl_Position =  vec4(vertexPosition_modelspace,1);
 		UV = (vertexPosition_modelspace.xy+vec2(1,1))/2.0;
 	}
-	else if(mode == 9){ //Stencil Pass
-		gl_Position = mvp * vec4(vertexPosition_modelspace,1);	
+#endif
+#if MODE == 0 || MODE == 9
+	if(mode == 9){ //Stencil Pass
+		gl_Position = mvpMatrix * vec4(vertexPosition_modelspace,1);	
 	}
-	else if(mode == 10){ //Point Light forward rendering
+#endif
+#if MODE == 0 || MODE == 10
+	if(mode == 10){ //Point Light forward rendering
 		//Output position of vertex in clip space
-		gl_Position = mvp * vec4(vertexPosition_modelspace, 1);
+		gl_Position = mvpMatrix * vec4(vertexPosition_modelspace, 1);
 
 		// Position of the vertex, in worldspace : model * position
-		Position_worldspace = (model * vec4(vertexPosition_modelspace,1)).xyz;
+		Position_worldspace = (modelMatrix * vec4(vertexPosition_modelspace,1)).xyz;
 		
 		// Vector that goes from the vertex to the camera, in camera space.
 		// In camera space, the camera is at the origin (0,0,0).
-		vec3 vertexPosition_cameraspace = ( modelView * vec4(vertexPosition_modelspace,1)).xyz;
+		vec3 vertexPosition_cameraspace = ( modelViewMatrix * vec4(vertexPosition_modelspace,1)).xyz;
 		EyeDirection_cameraspace = vec3(0,0,0) - vertexPosition_cameraspace;
 
 		// Vector that goes from the vertex to the light, in camera space. For easier calculations later no need to get the opposite vector by then
@@ -100,13 +181,15 @@ void main(){
 		LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
 
 		// Normal of the the vertex, in camera space
-		Normal_cameraspace = ( modelView * vec4(vertexNormal_modelspace,0)).xyz; // Only correct if ModelMatrix does not scale the model non-uniformly! If so then use its inverse transpose.
+		Normal_cameraspace = ( modelViewMatrix * vec4(vertexNormal_modelspace,0)).xyz; // Only correct if ModelMatrix does not scale the model non-uniformly! If so then use its inverse transpose.
 
 		//UVs are sent to the fragment shader
 		UV = vertexUV;
 	}
-	else if(mode == 11){ //Skybox
-	    vec4 mvpPos = mvp * vec4(vertexPosition_modelspace,1);   
+#endif
+#if MODE == 0 || MODE == 11
+	if(mode == 11){ //Skybox
+	    vec4 mvpPos = mvpMatrix * vec4(vertexPosition_modelspace,1);   
 		//Supply w as z to make sure z is always 1 so that the skybox will always fail the depth test
 		//The skybox will then only be rendered wherer there are no models. As long as the skybox is rendered last
 		gl_Position = mvpPos.xyww;  
@@ -114,12 +197,17 @@ void main(){
 		//Cube sampler will decide which face to sample from based on the highest value component
 		texDirection = vertexPosition_modelspace;
 	}
-	else if(mode == 12){ //Wireframe
-		gl_Position = mvp * vec4(vertexPosition_modelspace,1);
+#endif
+#if MODE == 0 || MODE == 12
+	if(mode == 12){ //Wireframe
+		gl_Position = mvpMatrix * vec4(vertexPosition_modelspace,1);
 	}
-	else if(mode == 13){ //No Light
-	    gl_Position = mvp * vec4(vertexPosition_modelspace,1);
+#endif
+#if MODE == 0 || MODE == 13
+	if(mode == 13){ //No Light
+	    gl_Position = mvpMatrix * vec4(vertexPosition_modelspace,1);
 		//UVs are sent to the fragment shader
 		UV = vertexUV;
 	}
+#endif
 }
\ No newline at end of file
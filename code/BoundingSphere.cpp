@@ -0,0 +1,110 @@
+#include "BoundingSphere.h"
+
+BoundingSphere::BoundingSphere()
+{
+	clear();
+}
+
+BoundingSphere::~BoundingSphere()
+{
+}
+
+void BoundingSphere::clear()
+{
+	m_center.Insert(0, 0, 0);
+	m_radius = 0;
+	m_isEmpty = true;
+	m_isInfinite = false;
+	m_meshCount = 0;
+}
+
+void BoundingSphere::setInfinite()
+{
+	m_isInfinite = true;
+}
+
+void BoundingSphere::merge(Vector3 center, float radius)
+{
+	if (m_isEmpty){
+		m_center = center;
+		m_radius = radius;
+		m_isEmpty = false;
+		return;
+	}
+
+	Vector3 offset = center - m_center;
+	float distance = offset.Magnitude();
+
+	//The other sphere is already inside this one
+	if (distance + radius <= m_radius){
+		return;
+	}
+	//This sphere is inside the other one
+	if (distance + m_radius <= radius){
+		m_center = center;
+		m_radius = radius;
+		return;
+	}
+
+	//The new sphere touches the far sides of both spheres. Its center is moved from this center towards the other one
+	float newRadius = (distance + m_radius + radius) * 0.5f;
+	m_center = m_center + offset * ((newRadius - m_radius) / distance);
+	m_radius = newRadius;
+}
+
+void BoundingSphere::merge(const BoundingSphere& sphere)
+{
+	m_meshCount += sphere.m_meshCount;
+	if (sphere.m_isInfinite){
+		m_isInfinite = true;
+	}
+	if (!sphere.m_isEmpty){
+		merge(sphere.m_center, sphere.m_radius);
+	}
+}
+
+void BoundingSphere::addMeshes(unsigned int count)
+{
+	m_meshCount += count;
+}
+
+bool BoundingSphere::isEmpty() const
+{
+	return m_isEmpty;
+}
+
+bool BoundingSphere::isInfinite() const
+{
+	return m_isInfinite;
+}
+
+Vector3 BoundingSphere::getCenter() const
+{
+	return m_center;
+}
+
+float BoundingSphere::getRadius() const
+{
+	return m_radius;
+}
+
+unsigned int BoundingSphere::getMeshCount() const
+{
+	return m_meshCount;
+}
+
+float BoundingSphere::maxScale(const Matrix44& model)
+{
+	//Length of each axis is the length of a column in the upper 3x3
+	float maxLengthSquared = 0;
+	for (int column = 0; column < 3; column++){
+		float x = model.GetElement(0, column);
+		float y = model.GetElement(1, column);
+		float z = model.GetElement(2, column);
+		float lengthSquared = x * x + y * y + z * z;
+		if (lengthSquared > maxLengthSquared){
+			maxLengthSquared = lengthSquared;
+		}
+	}
+	return sqrt(maxLengthSquared);
+}
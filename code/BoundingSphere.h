@@ -0,0 +1,70 @@
+#ifndef BoundingSphere_h__
+#define BoundingSphere_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+/// <remarks>
+///World space bounding sphere of a subtree in the scenegraph. Spheres of children are merged into it.
+///Also counts the meshes inside it, so the counter of rendered objects can be updated when the whole subtree is culled
+/// </remarks>
+class BoundingSphere
+{
+public:
+	/// <summary>Constructor. The sphere is empty</summary>
+	/// <returns></returns>
+	BoundingSphere();
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~BoundingSphere();
+
+	/// <summary>Makes the sphere empty</summary>
+	/// <returns>void</returns>
+	void clear();
+	/// <summary>Marks the sphere as infinite. Used for geometry which should never be culled, like the skybox</summary>
+	/// <returns>void</returns>
+	void setInfinite();
+	/// <summary>Grows the sphere so it also encloses another sphere</summary>
+	/// <param name="center">Center of the other sphere in world space</param>
+	/// <param name="radius">Radius of the other sphere</param>
+	/// <returns>void</returns>
+	void merge(Vector3 center, float radius);
+	/// <summary>Grows the sphere so it also encloses another bounding sphere and adds its meshes</summary>
+	/// <param name="sphere">The other bounding sphere</param>
+	/// <returns>void</returns>
+	void merge(const BoundingSphere& sphere);
+	/// <summary>Adds to the amount of meshes inside the sphere</summary>
+	/// <param name="count">Amount of meshes</param>
+	/// <returns>void</returns>
+	void addMeshes(unsigned int count);
+
+	/// <summary>Returns true if nothing has been merged into the sphere</summary>
+	/// <returns>bool</returns>
+	bool isEmpty() const;
+	/// <summary>Returns true if the sphere encloses geometry which is never culled</summary>
+	/// <returns>bool</returns>
+	bool isInfinite() const;
+	/// <summary>Returns the center point in world space</summary>
+	/// <returns>Vector3</returns>
+	Vector3 getCenter() const;
+	/// <summary>Returns the radius</summary>
+	/// <returns>float</returns>
+	float getRadius() const;
+	/// <summary>Returns amount of meshes inside the sphere</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getMeshCount() const;
+
+	/// <summary>Returns the largest scale of the x, y and z axes of a matrix. A model space radius times this encloses the transformed sphere</summary>
+	/// <param name="model">a model matrix</param>
+	/// <returns>float</returns>
+	static float maxScale(const Matrix44& model);
+
+private:
+	Vector3 m_center;
+	float m_radius;
+	bool m_isEmpty;
+	bool m_isInfinite;
+	unsigned int m_meshCount;
+};
+
+#endif // BoundingSphere_h__
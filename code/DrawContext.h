@@ -0,0 +1,49 @@
+#ifndef DrawContext_h__
+#define DrawContext_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+//NULL
+#include <stddef.h>
+
+//Tested after the frustum by the meshes if it is set
+class OcclusionBuffer;
+//Latest hardware occlusion query results of the meshes if it is set
+class OcclusionQueries;
+//Meshes add packets to it instead of drawing if it is set
+class RenderQueue;
+//Meshes send their model matrix and material with it
+class UniformBuffers;
+
+/// <remarks>
+///State of the pass being drawn which the nodes need besides the view frustum. The window sets it up before each pass and passes it down the scene graph
+///next to the ViewFrustumCheck, which only does the culling against the planes
+/// </remarks>
+struct DrawContext
+{
+	/// <summary>Constructor. Everything is off until the window sets it</summary>
+	/// <returns></returns>
+	DrawContext()
+	{
+		occlusionBuffer = NULL;
+		occlusionQueries = NULL;
+		queryId = 0;
+		renderQueue = NULL;
+		uniformBuffers = NULL;
+	}
+
+	//Occlusion buffer meshes inside the frustum are tested against, seen from the same camera as the frustum. NULL turns occlusion culling off. Not owned
+	OcclusionBuffer* occlusionBuffer;
+	//Occlusion queries meshes inside the frustum use to skip their draw. NULL turns the queries off. Not owned
+	OcclusionQueries* occlusionQueries;
+	//Query id of the next mesh drawn. Each transform sets it to the id of the child it draws and the mesh receives a new id if it didn't have one
+	unsigned int queryId;
+	//projection * view of the pass. Set once per pass with the occlusion queries so the meshes don't multiply it per object
+	Matrix44 viewProjection;
+	//Render queue the meshes add their draws to, submitted after the pass. NULL makes the meshes draw right away. Not owned
+	RenderQueue* renderQueue;
+	//Uniform buffers the meshes send their ObjectBlock with. Has to be set before anything is drawn. Not owned
+	UniformBuffers* uniformBuffers;
+};
+
+#endif // DrawContext_h__
@@ -1,12 +0,0 @@
-#include "Face.h"
-
-
-Face::Face()
-{
-	edge = 0;
-}
-
-
-Face::~Face()
-{
-}
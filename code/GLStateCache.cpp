@@ -0,0 +1,495 @@
+#include "GLStateCache.h"
+
+//For comparing uniform values bit by bit
+#include <string.h>
+
+//Value of the shadow copy when the state isn't known
+const GLuint Unknown = ~0u;
+
+GLStateCache::GLStateCache()
+{
+	m_programUniforms = NULL;
+	invalidate();
+	resetCounters();
+}
+
+GLStateCache::~GLStateCache()
+{
+	m_uniforms.clear();
+	m_programUniforms = NULL;
+}
+
+void GLStateCache::invalidate()
+{
+	m_program = Unknown;
+	m_programUniforms = NULL;
+	m_vertexArray = Unknown;
+	m_buffers[0] = Unknown;
+	m_buffers[1] = Unknown;
+	m_drawFramebuffer = Unknown;
+	m_readFramebuffer = Unknown;
+	m_activeTexture = Unknown;
+	for (unsigned int i = 0; i < CachedTextureUnits; i++){
+		m_textures[i][0] = Unknown;
+		m_textures[i][1] = Unknown;
+	}
+
+	for (int i = 0; i < 5; i++){
+		m_capabilities[i] = -1;
+	}
+	m_depthFunc = Unknown;
+	m_depthMask = -1;
+	m_colorMask = -1;
+	m_cullFace = Unknown;
+	m_frontFace = Unknown;
+	m_polygonMode = Unknown;
+	m_blendFunc[0] = Unknown;
+	m_blendFunc[1] = Unknown;
+	m_blendEquation = Unknown;
+	m_stencilFunc = Unknown;
+	m_stencilRef = -1;
+	m_stencilMask = Unknown;
+	for (int i = 0; i < 2; i++){
+		for (int j = 0; j < 3; j++){
+			m_stencilOp[i][j] = Unknown;
+		}
+	}
+	for (int i = 0; i < 4; i++){
+		m_viewport[i] = -1;
+		m_scissor[i] = -1;
+	}
+}
+
+unsigned int GLStateCache::getIssuedCount() const
+{
+	return m_issuedCount;
+}
+
+unsigned int GLStateCache::getFilteredCount() const
+{
+	return m_filteredCount;
+}
+
+void GLStateCache::resetCounters()
+{
+	m_issuedCount = 0;
+	m_filteredCount = 0;
+}
+
+bool GLStateCache::issue(bool isChanged)
+{
+	if (isChanged){
+		m_issuedCount++;
+	}
+	else{
+		m_filteredCount++;
+	}
+	return isChanged;
+}
+
+int GLStateCache::capabilityIndex(GLenum cap) const
+{
+	switch (cap){
+	case GL_BLEND: return 0;
+	case GL_CULL_FACE: return 1;
+	case GL_DEPTH_TEST: return 2;
+	case GL_STENCIL_TEST: return 3;
+	case GL_SCISSOR_TEST: return 4;
+	default: return -1;
+	}
+}
+
+int GLStateCache::textureTargetIndex(GLenum target) const
+{
+	switch (target){
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_CUBE_MAP: return 1;
+	default: return -1;
+	}
+}
+
+int GLStateCache::bufferTargetIndex(GLenum target) const
+{
+	switch (target){
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_UNIFORM_BUFFER: return 1;
+	default: return -1;
+	}
+}
+
+void GLStateCache::glUseProgram(GLuint program)
+{
+	if (issue(program != m_program)){
+		QOpenGLFunctions_3_3_Core::glUseProgram(program);
+		m_program = program;
+		m_programUniforms = &m_uniforms[program];
+	}
+}
+
+void GLStateCache::glLinkProgram(GLuint program)
+{
+	//Linking resets the uniforms to their defaults
+	QOpenGLFunctions_3_3_Core::glLinkProgram(program);
+	m_uniforms[program].clear();
+}
+
+void GLStateCache::glDeleteProgram(GLuint program)
+{
+	QOpenGLFunctions_3_3_Core::glDeleteProgram(program);
+	if (program == m_program){
+		m_program = Unknown;
+		m_programUniforms = NULL;
+	}
+	m_uniforms.erase(program);
+}
+
+void GLStateCache::glBindVertexArray(GLuint array)
+{
+	if (issue(array != m_vertexArray)){
+		QOpenGLFunctions_3_3_Core::glBindVertexArray(array);
+		m_vertexArray = array;
+	}
+}
+
+void GLStateCache::glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	//Deleting a bound object reverts the binding to 0
+	QOpenGLFunctions_3_3_Core::glDeleteVertexArrays(n, arrays);
+	for (GLsizei i = 0; i < n; i++){
+		if (arrays[i] == m_vertexArray){
+			m_vertexArray = 0;
+		}
+	}
+}
+
+void GLStateCache::glBindBuffer(GLenum target, GLuint buffer)
+{
+	int index = bufferTargetIndex(target);
+	if (index < 0){
+		QOpenGLFunctions_3_3_Core::glBindBuffer(target, buffer);
+		return;
+	}
+	if (issue(buffer != m_buffers[index])){
+		QOpenGLFunctions_3_3_Core::glBindBuffer(target, buffer);
+		m_buffers[index] = buffer;
+	}
+}
+
+void GLStateCache::glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	//Also binds the buffer to the generic binding point of the target
+	QOpenGLFunctions_3_3_Core::glBindBufferBase(target, index, buffer);
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0){
+		m_buffers[targetIndex] = buffer;
+	}
+}
+
+void GLStateCache::glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	QOpenGLFunctions_3_3_Core::glBindBufferRange(target, index, buffer, offset, size);
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0){
+		m_buffers[targetIndex] = buffer;
+	}
+}
+
+void GLStateCache::glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	QOpenGLFunctions_3_3_Core::glDeleteBuffers(n, buffers);
+	for (GLsizei i = 0; i < n; i++){
+		for (int j = 0; j < 2; j++){
+			if (buffers[i] == m_buffers[j]){
+				m_buffers[j] = 0;
+			}
+		}
+	}
+}
+
+void GLStateCache::glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool isChanged;
+	if (target == GL_DRAW_FRAMEBUFFER){
+		isChanged = framebuffer != m_drawFramebuffer;
+	}
+	else if (target == GL_READ_FRAMEBUFFER){
+		isChanged = framebuffer != m_readFramebuffer;
+	}
+	else{
+		isChanged = framebuffer != m_drawFramebuffer || framebuffer != m_readFramebuffer;
+	}
+
+	if (issue(isChanged)){
+		QOpenGLFunctions_3_3_Core::glBindFramebuffer(target, framebuffer);
+		if (target != GL_READ_FRAMEBUFFER){
+			m_drawFramebuffer = framebuffer;
+		}
+		if (target != GL_DRAW_FRAMEBUFFER){
+			m_readFramebuffer = framebuffer;
+		}
+	}
+}
+
+void GLStateCache::glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+	QOpenGLFunctions_3_3_Core::glDeleteFramebuffers(n, framebuffers);
+	for (GLsizei i = 0; i < n; i++){
+		if (framebuffers[i] == m_drawFramebuffer){
+			m_drawFramebuffer = 0;
+		}
+		if (framebuffers[i] == m_readFramebuffer){
+			m_readFramebuffer = 0;
+		}
+	}
+}
+
+void GLStateCache::glActiveTexture(GLenum texture)
+{
+	if (issue(texture != m_activeTexture)){
+		QOpenGLFunctions_3_3_Core::glActiveTexture(texture);
+		m_activeTexture = texture;
+	}
+}
+
+void GLStateCache::glBindTexture(GLenum target, GLuint texture)
+{
+	int index = textureTargetIndex(target);
+	unsigned int unit = m_activeTexture - GL_TEXTURE0;
+	if (index < 0 || m_activeTexture == Unknown || unit >= CachedTextureUnits){
+		QOpenGLFunctions_3_3_Core::glBindTexture(target, texture);
+		return;
+	}
+	if (issue(texture != m_textures[unit][index])){
+		QOpenGLFunctions_3_3_Core::glBindTexture(target, texture);
+		m_textures[unit][index] = texture;
+	}
+}
+
+void GLStateCache::glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+	QOpenGLFunctions_3_3_Core::glDeleteTextures(n, textures);
+	for (GLsizei i = 0; i < n; i++){
+		for (unsigned int unit = 0; unit < CachedTextureUnits; unit++){
+			for (int j = 0; j < 2; j++){
+				if (textures[i] == m_textures[unit][j]){
+					m_textures[unit][j] = 0;
+				}
+			}
+		}
+	}
+}
+
+void GLStateCache::glEnable(GLenum cap)
+{
+	int index = capabilityIndex(cap);
+	if (index < 0){
+		QOpenGLFunctions_3_3_Core::glEnable(cap);
+		return;
+	}
+	if (issue(m_capabilities[index] != 1)){
+		QOpenGLFunctions_3_3_Core::glEnable(cap);
+		m_capabilities[index] = 1;
+	}
+}
+
+void GLStateCache::glDisable(GLenum cap)
+{
+	int index = capabilityIndex(cap);
+	if (index < 0){
+		QOpenGLFunctions_3_3_Core::glDisable(cap);
+		return;
+	}
+	if (issue(m_capabilities[index] != 0)){
+		QOpenGLFunctions_3_3_Core::glDisable(cap);
+		m_capabilities[index] = 0;
+	}
+}
+
+void GLStateCache::glDepthFunc(GLenum func)
+{
+	if (issue(func != m_depthFunc)){
+		QOpenGLFunctions_3_3_Core::glDepthFunc(func);
+		m_depthFunc = func;
+	}
+}
+
+void GLStateCache::glDepthMask(GLboolean flag)
+{
+	int mask = flag ? 1 : 0;
+	if (issue(mask != m_depthMask)){
+		QOpenGLFunctions_3_3_Core::glDepthMask(flag);
+		m_depthMask = mask;
+	}
+}
+
+void GLStateCache::glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	int mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+	if (issue(mask != m_colorMask)){
+		QOpenGLFunctions_3_3_Core::glColorMask(red, green, blue, alpha);
+		m_colorMask = mask;
+	}
+}
+
+void GLStateCache::glCullFace(GLenum mode)
+{
+	if (issue(mode != m_cullFace)){
+		QOpenGLFunctions_3_3_Core::glCullFace(mode);
+		m_cullFace = mode;
+	}
+}
+
+void GLStateCache::glFrontFace(GLenum mode)
+{
+	if (issue(mode != m_frontFace)){
+		QOpenGLFunctions_3_3_Core::glFrontFace(mode);
+		m_frontFace = mode;
+	}
+}
+
+void GLStateCache::glPolygonMode(GLenum face, GLenum mode)
+{
+	//Core profile only accepts GL_FRONT_AND_BACK
+	if (issue(mode != m_polygonMode)){
+		QOpenGLFunctions_3_3_Core::glPolygonMode(face, mode);
+		m_polygonMode = mode;
+	}
+}
+
+void GLStateCache::glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	if (issue(sfactor != m_blendFunc[0] || dfactor != m_blendFunc[1])){
+		QOpenGLFunctions_3_3_Core::glBlendFunc(sfactor, dfactor);
+		m_blendFunc[0] = sfactor;
+		m_blendFunc[1] = dfactor;
+	}
+}
+
+void GLStateCache::glBlendEquation(GLenum mode)
+{
+	if (issue(mode != m_blendEquation)){
+		QOpenGLFunctions_3_3_Core::glBlendEquation(mode);
+		m_blendEquation = mode;
+	}
+}
+
+void GLStateCache::glStencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	if (issue(func != m_stencilFunc || ref != m_stencilRef || mask != m_stencilMask)){
+		QOpenGLFunctions_3_3_Core::glStencilFunc(func, ref, mask);
+		m_stencilFunc = func;
+		m_stencilRef = ref;
+		m_stencilMask = mask;
+	}
+}
+
+void GLStateCache::glStencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+	bool isChanged = false;
+	for (int i = 0; i < 2; i++){
+		bool isFace = (i == 0 && face != GL_BACK) || (i == 1 && face != GL_FRONT);
+		if (isFace && (sfail != m_stencilOp[i][0] || dpfail != m_stencilOp[i][1] || dppass != m_stencilOp[i][2])){
+			isChanged = true;
+		}
+	}
+
+	if (issue(isChanged)){
+		QOpenGLFunctions_3_3_Core::glStencilOpSeparate(face, sfail, dpfail, dppass);
+		for (int i = 0; i < 2; i++){
+			bool isFace = (i == 0 && face != GL_BACK) || (i == 1 && face != GL_FRONT);
+			if (isFace){
+				m_stencilOp[i][0] = sfail;
+				m_stencilOp[i][1] = dpfail;
+				m_stencilOp[i][2] = dppass;
+			}
+		}
+	}
+}
+
+void GLStateCache::glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (issue(x != m_viewport[0] || y != m_viewport[1] || width != m_viewport[2] || height != m_viewport[3])){
+		QOpenGLFunctions_3_3_Core::glViewport(x, y, width, height);
+		m_viewport[0] = x;
+		m_viewport[1] = y;
+		m_viewport[2] = width;
+		m_viewport[3] = height;
+	}
+}
+
+void GLStateCache::glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (issue(x != m_scissor[0] || y != m_scissor[1] || width != m_scissor[2] || height != m_scissor[3])){
+		QOpenGLFunctions_3_3_Core::glScissor(x, y, width, height);
+		m_scissor[0] = x;
+		m_scissor[1] = y;
+		m_scissor[2] = width;
+		m_scissor[3] = height;
+	}
+}
+
+bool GLStateCache::setUniform(GLint location, const GLuint bits[3])
+{
+	//Locations of removed uniforms and unknown programs aren't cached
+	if (location < 0 || m_programUniforms == NULL){
+		return true;
+	}
+
+	std::vector<UniformValue>& values = *m_programUniforms;
+	if (values.size() <= (unsigned int)location){
+		UniformValue unset;
+		memset(&unset, 0, sizeof(unset));
+		values.resize(location + 1, unset);
+	}
+
+	UniformValue& value = values[location];
+	if (value.isSet && memcmp(value.bits, bits, sizeof(value.bits)) == 0){
+		return false;
+	}
+	memcpy(value.bits, bits, sizeof(value.bits));
+	value.isSet = true;
+	return true;
+}
+
+void GLStateCache::glUniform1i(GLint location, GLint v0)
+{
+	GLuint bits[3] = { 0, 0, 0 };
+	memcpy(&bits[0], &v0, sizeof(v0));
+	if (issue(setUniform(location, bits))){
+		QOpenGLFunctions_3_3_Core::glUniform1i(location, v0);
+	}
+}
+
+void GLStateCache::glUniform1f(GLint location, GLfloat v0)
+{
+	GLuint bits[3] = { 0, 0, 0 };
+	memcpy(&bits[0], &v0, sizeof(v0));
+	if (issue(setUniform(location, bits))){
+		QOpenGLFunctions_3_3_Core::glUniform1f(location, v0);
+	}
+}
+
+void GLStateCache::glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	GLuint bits[3] = { 0, 0, 0 };
+	memcpy(&bits[0], &v0, sizeof(v0));
+	memcpy(&bits[1], &v1, sizeof(v1));
+	if (issue(setUniform(location, bits))){
+		QOpenGLFunctions_3_3_Core::glUniform2f(location, v0, v1);
+	}
+}
+
+void GLStateCache::glUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	//Arrays aren't cached
+	if (count != 1){
+		QOpenGLFunctions_3_3_Core::glUniform3fv(location, count, value);
+		return;
+	}
+
+	GLuint bits[3];
+	memcpy(bits, value, sizeof(bits));
+	if (issue(setUniform(location, bits))){
+		QOpenGLFunctions_3_3_Core::glUniform3fv(location, count, value);
+	}
+}
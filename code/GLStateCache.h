@@ -0,0 +1,152 @@
+#ifndef GLStateCache_h__
+#define GLStateCache_h__
+
+//OpenGL Functions
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <vector>
+#include <map>
+
+//Texture units whose bindings are tracked. Binds to higher units are always issued
+const unsigned int CachedTextureUnits = 8;
+
+/// <remarks>
+///The openGL functions with a shadow copy of the state in front of them. The functions which change state hide the ones of QOpenGLFunctions_3_3_Core
+///and only call the driver if the value differs from the one already set, so the classes keep calling m_glFunctions-> like before.
+///Tracks the program, VAO, buffers, framebuffers, textures per unit, enabled capabilities, depth, stencil, blend, cull, polygon mode, viewport and
+///the values of the uniforms set with glUniform1i, 1f, 2f and 3fv per program.
+///Every state change has to go through this class, otherwise the shadow copy is wrong and a needed call could be filtered
+/// </remarks>
+class GLStateCache : public QOpenGLFunctions_3_3_Core
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <returns></returns>
+	GLStateCache();
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~GLStateCache();
+
+	/// <summary>Forgets the shadow copy, so the next call of every function reaches the driver. Call if something else may have changed the state</summary>
+	/// <returns>void</returns>
+	void invalidate();
+	/// <summary>Returns how many calls of the cached functions reached the driver since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getIssuedCount() const;
+	/// <summary>Returns how many calls of the cached functions were dropped because the state was already set since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getFilteredCount() const;
+	/// <summary>Sets the issued and filtered counters to 0</summary>
+	/// <returns>void</returns>
+	void resetCounters();
+
+	//Bindings
+	void glUseProgram(GLuint program);
+	void glLinkProgram(GLuint program);
+	void glDeleteProgram(GLuint program);
+	void glBindVertexArray(GLuint array);
+	void glDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+	void glBindBuffer(GLenum target, GLuint buffer);
+	void glBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void glDeleteBuffers(GLsizei n, const GLuint* buffers);
+	void glBindFramebuffer(GLenum target, GLuint framebuffer);
+	void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+	void glActiveTexture(GLenum texture);
+	void glBindTexture(GLenum target, GLuint texture);
+	void glDeleteTextures(GLsizei n, const GLuint* textures);
+
+	//Fixed function state
+	void glEnable(GLenum cap);
+	void glDisable(GLenum cap);
+	void glDepthFunc(GLenum func);
+	void glDepthMask(GLboolean flag);
+	void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	void glCullFace(GLenum mode);
+	void glFrontFace(GLenum mode);
+	void glPolygonMode(GLenum face, GLenum mode);
+	void glBlendFunc(GLenum sfactor, GLenum dfactor);
+	void glBlendEquation(GLenum mode);
+	void glStencilFunc(GLenum func, GLint ref, GLuint mask);
+	void glStencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass);
+	void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	//Uniforms of the program in use
+	void glUniform1i(GLint location, GLint v0);
+	void glUniform1f(GLint location, GLfloat v0);
+	void glUniform2f(GLint location, GLfloat v0, GLfloat v1);
+	void glUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+
+private:
+	/// <remarks>
+	///Last value sent to a uniform location. The values are compared bit by bit
+	/// </remarks>
+	struct UniformValue
+	{
+		GLuint bits[3];
+		bool isSet;
+	};
+
+	/// <summary>Counts a call and returns true if it has to be issued</summary>
+	/// <param name="isChanged">True if the call changes the state</param>
+	/// <returns>bool</returns>
+	bool issue(bool isChanged);
+	/// <summary>Returns the index of a capability in m_capabilities or -1 if it isn't tracked</summary>
+	/// <param name="cap">Capability of glEnable</param>
+	/// <returns>int</returns>
+	int capabilityIndex(GLenum cap) const;
+	/// <summary>Returns the index of a texture target in m_textures or -1 if it isn't tracked</summary>
+	/// <param name="target">Target of glBindTexture</param>
+	/// <returns>int</returns>
+	int textureTargetIndex(GLenum target) const;
+	/// <summary>Returns the index of a buffer target in m_buffers or -1 if it isn't tracked</summary>
+	/// <param name="target">Target of glBindBuffer</param>
+	/// <returns>int</returns>
+	int bufferTargetIndex(GLenum target) const;
+	/// <summary>Compares a uniform value with the one sent before and stores it</summary>
+	/// <param name="location">Uniform location in the program in use</param>
+	/// <param name="bits">Value as 3 words. Unused words are 0</param>
+	/// <returns>True if the value differs and has to be sent</returns>
+	bool setUniform(GLint location, const GLuint bits[3]);
+
+	//Counters
+	unsigned int m_issuedCount;
+	unsigned int m_filteredCount;
+
+	//Bindings. ~0 is unknown
+	GLuint m_program;
+	GLuint m_vertexArray;
+	//GL_ARRAY_BUFFER and GL_UNIFORM_BUFFER. The element array buffer belongs to the VAO and isn't tracked
+	GLuint m_buffers[2];
+	GLuint m_drawFramebuffer;
+	GLuint m_readFramebuffer;
+	GLenum m_activeTexture;
+	//GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP of each unit
+	GLuint m_textures[CachedTextureUnits][2];
+
+	//Fixed function state. ~0 or -1 is unknown
+	int m_capabilities[5];
+	GLenum m_depthFunc;
+	int m_depthMask;
+	int m_colorMask;
+	GLenum m_cullFace;
+	GLenum m_frontFace;
+	GLenum m_polygonMode;
+	GLenum m_blendFunc[2];
+	GLenum m_blendEquation;
+	GLenum m_stencilFunc;
+	GLint m_stencilRef;
+	GLuint m_stencilMask;
+	//sfail, dpfail and dppass of the front and the back faces
+	GLenum m_stencilOp[2][3];
+	GLint m_viewport[4];
+	GLint m_scissor[4];
+
+	//Uniform values of each program, indexed by location. Kept by invalidate since only the program itself changes them
+	std::map<GLuint, std::vector<UniformValue> > m_uniforms;
+	//Values of the program in use. NULL if the program is unknown
+	std::vector<UniformValue>* m_programUniforms;
+};
+
+#endif // GLStateCache_h__
@@ -1,16 +0,0 @@
-#include "HalfEdge.h"
-
-
-HalfEdge::HalfEdge()
-{
-	origin = 0;
-	pair = 0;
-	next = 0;
-	midpoint = 0;
-	face = 0;
-}
-
-
-HalfEdge::~HalfEdge()
-{
-}
@@ -0,0 +1,105 @@
+#include "HalfEdgeData.h"
+
+HalfEdgeData::HalfEdgeData()
+{
+}
+
+HalfEdgeData::~HalfEdgeData()
+{
+}
+
+unsigned int HalfEdgeData::addVertex()
+{
+	vertexPos.push_back(Vector3());
+	vertexUv.push_back(Vector2());
+	vertexNormal.push_back(Vector3());
+	vertexNewPos.push_back(Vector3());
+	vertexEdge.push_back(NullIndex);
+
+	return vertexEdge.size() - 1;
+}
+
+unsigned int HalfEdgeData::addHalfEdge()
+{
+	edgeOrigin.push_back(NullIndex);
+	edgePair.push_back(NullIndex);
+	edgeNext.push_back(NullIndex);
+	edgeMidpoint.push_back(NullIndex);
+	edgeFace.push_back(NullIndex);
+
+	return edgeOrigin.size() - 1;
+}
+
+unsigned int HalfEdgeData::addFace()
+{
+	faceEdge.push_back(NullIndex);
+
+	return faceEdge.size() - 1;
+}
+
+void HalfEdgeData::reserve(unsigned int vertexCount, unsigned int halfEdgeCount, unsigned int faceCount)
+{
+	vertexPos.reserve(vertexCount);
+	vertexUv.reserve(vertexCount);
+	vertexNormal.reserve(vertexCount);
+	vertexNewPos.reserve(vertexCount);
+	vertexEdge.reserve(vertexCount);
+
+	edgeOrigin.reserve(halfEdgeCount);
+	edgePair.reserve(halfEdgeCount);
+	edgeNext.reserve(halfEdgeCount);
+	edgeMidpoint.reserve(halfEdgeCount);
+	edgeFace.reserve(halfEdgeCount);
+
+	faceEdge.reserve(faceCount);
+}
+
+void HalfEdgeData::resize(unsigned int vertexCount, unsigned int halfEdgeCount, unsigned int faceCount)
+{
+	vertexPos.resize(vertexCount);
+	vertexUv.resize(vertexCount);
+	vertexNormal.resize(vertexCount);
+	vertexNewPos.resize(vertexCount);
+	vertexEdge.resize(vertexCount, NullIndex);
+
+	edgeOrigin.resize(halfEdgeCount, NullIndex);
+	edgePair.resize(halfEdgeCount, NullIndex);
+	edgeNext.resize(halfEdgeCount, NullIndex);
+	edgeMidpoint.resize(halfEdgeCount, NullIndex);
+	edgeFace.resize(halfEdgeCount, NullIndex);
+
+	faceEdge.resize(faceCount, NullIndex);
+}
+
+void HalfEdgeData::clear()
+{
+	//Swap with empty lists to release the memory as well
+	std::vector<Vector3>().swap(vertexPos);
+	std::vector<Vector2>().swap(vertexUv);
+	std::vector<Vector3>().swap(vertexNormal);
+	std::vector<Vector3>().swap(vertexNewPos);
+	std::vector<unsigned int>().swap(vertexEdge);
+
+	std::vector<unsigned int>().swap(edgeOrigin);
+	std::vector<unsigned int>().swap(edgePair);
+	std::vector<unsigned int>().swap(edgeNext);
+	std::vector<unsigned int>().swap(edgeMidpoint);
+	std::vector<unsigned int>().swap(edgeFace);
+
+	std::vector<unsigned int>().swap(faceEdge);
+}
+
+unsigned int HalfEdgeData::vertexCount() const
+{
+	return vertexEdge.size();
+}
+
+unsigned int HalfEdgeData::halfEdgeCount() const
+{
+	return edgeOrigin.size();
+}
+
+unsigned int HalfEdgeData::faceCount() const
+{
+	return faceEdge.size();
+}
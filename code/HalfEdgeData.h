@@ -0,0 +1,90 @@
+#ifndef HalfEdgeData_h__
+#define HalfEdgeData_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+//Index used when an element doesn't refer to anything (Index version of a NULL pointer)
+const unsigned int NullIndex = 0xFFFFFFFF;
+
+/// <remarks>
+///Half-Edge mesh data structure stored as structure-of-arrays pools.
+///Vertices, half-edges and faces are identified by their index in the pools and refer to each other with 32-bit indices instead of pointers.
+///Keeps the data contiguous in memory so traversing the mesh doesn't have to chase pointers to separately allocated objects
+/// </remarks>
+class HalfEdgeData
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <returns></returns>
+	HalfEdgeData();
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~HalfEdgeData();
+
+	/// <summary>Adds a vertex with default values to the vertex pool</summary>
+	/// <returns>Index of the new vertex</returns>
+	unsigned int addVertex();
+	/// <summary>Adds a half-edge which doesn't refer to anything to the half-edge pool</summary>
+	/// <returns>Index of the new half-edge</returns>
+	unsigned int addHalfEdge();
+	/// <summary>Adds a face which doesn't refer to anything to the face pool</summary>
+	/// <returns>Index of the new face</returns>
+	unsigned int addFace();
+
+	/// <summary>Reserves memory in the pools so they can grow to the specified sizes without reallocating</summary>
+	/// <param name="vertexCount">Amount of vertices the vertex pool should hold</param>
+	/// <param name="halfEdgeCount">Amount of half-edges the half-edge pool should hold</param>
+	/// <param name="faceCount">Amount of faces the face pool should hold</param>
+	/// <returns>void</returns>
+	void reserve(unsigned int vertexCount, unsigned int halfEdgeCount, unsigned int faceCount);
+	/// <summary>Resizes the pools. New elements get default values and don't refer to anything.
+	///Used when the indices of new elements are known up front so they can be written in any order</summary>
+	/// <param name="vertexCount">Amount of vertices in the vertex pool</param>
+	/// <param name="halfEdgeCount">Amount of half-edges in the half-edge pool</param>
+	/// <param name="faceCount">Amount of faces in the face pool</param>
+	/// <returns>void</returns>
+	void resize(unsigned int vertexCount, unsigned int halfEdgeCount, unsigned int faceCount);
+	/// <summary>Removes all elements and frees the memory used by the pools</summary>
+	/// <returns>void</returns>
+	void clear();
+
+	/// <summary>Returns amount of vertices in the vertex pool</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int vertexCount() const;
+	/// <summary>Returns amount of half-edges in the half-edge pool</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int halfEdgeCount() const;
+	/// <summary>Returns amount of faces in the face pool</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int faceCount() const;
+
+	//Vertex pool
+	std::vector<Vector3> vertexPos;
+	std::vector<Vector2> vertexUv;
+	std::vector<Vector3> vertexNormal;
+	//New calculated position for old vertex
+	std::vector<Vector3> vertexNewPos;
+	//An edge which has the vertex as starting point
+	std::vector<unsigned int> vertexEdge;
+
+	//Half-edge pool
+	//The vertex the half-edge starts from
+	std::vector<unsigned int> edgeOrigin;
+	//The half-edge going in the opposite direction
+	std::vector<unsigned int> edgePair;
+	//The next half-edge of the face
+	std::vector<unsigned int> edgeNext;
+	//The new vertex representing the midpoint where the half-edge should split
+	std::vector<unsigned int> edgeMidpoint;
+	//Face that the half-edge belongs to
+	std::vector<unsigned int> edgeFace;
+
+	//Face pool
+	//Can refer to any half-edge which belongs to the face
+	std::vector<unsigned int> faceEdge;
+};
+
+#endif // HalfEdgeData_h__
@@ -1,6 +1,13 @@
 #include "HalfEdgeMesh.h"
+//min
+#include <algorithm>
 
-HalfEdgeMesh::HalfEdgeMesh(QOpenGLFunctions_3_3_Core* functions)
+//Amount of half-edges per block when ranking the edge owners
+const unsigned int EdgeRankBlockSize = 16384;
+//Vertices per block when the bounding sphere is calculated
+const unsigned int BoundsBlockSize = 16384;
+
+HalfEdgeMesh::HalfEdgeMesh(GLStateCache* functions)
 {
 	m_glFunctions = functions;
 	m_textureID = NULL;
@@ -14,38 +21,26 @@ HalfEdgeMesh::HalfEdgeMesh(QOpenGLFunctions_3_3_Core* functions)
 	m_isWireframe = false;
 
 	m_isFrustumCulling = true;
+	m_isBoundsChanged = false;
 	m_isWireframeBV = false;
 	m_isSkybox = false;
 	m_isWireFrameOriginalMesh = false;
+	m_isParallelSubdivision = true;
 
 	m_radiusBV = 0;
+	m_weldEpsilon = 0;
 }
 
 HalfEdgeMesh::~HalfEdgeMesh(void)
 {
-	if (!m_vertexData.empty()){
-		for (int i = 0; i < m_vertexData.size(); i++){
-			delete m_vertexData[i];
-		}
-	}
-	if (!m_halfEdges.empty()){
-		for (int i = 0; i < m_halfEdges.size(); i++){
-			delete m_halfEdges[i];
-		}
-	}
-	if (!m_faces.empty()){
-		for (int i = 0; i < m_faces.size(); i++){
-			delete m_faces[i];
-		}
-	}
+	//Free the half-edge mesh pools
+	m_halfEdgeData.clear();
 
 	releaseWireframeBoundingSphere();
  	releaseWireframeOriginalMesh();
 
 	//Delete VBOs
-	m_glFunctions->glDeleteBuffers(1, &m_halfEdgeVerticesVBO);
-	m_glFunctions->glDeleteBuffers(1, &m_halfEdgeUvsVBO);
-	m_glFunctions->glDeleteBuffers(1, &m_halfEdgeNormalsVBO);
+	m_glFunctions->glDeleteBuffers(1, &m_halfEdgeVBO);
 	m_glFunctions->glDeleteBuffers(1, &m_halfEdgeIndicesEBO);
 
 	//Delete VAO
@@ -56,8 +51,12 @@ HalfEdgeMesh::~HalfEdgeMesh(void)
 	m_children.clear();
 }
 
-void HalfEdgeMesh::update(Matrix44& view, const Matrix44& model)
+void HalfEdgeMesh::update(Matrix44& view, const Matrix44& model, bool isParentChanged)
 {
+	//The children have the same parent model matrix as this
+	isParentChanged = isParentChanged || m_isParentChanged;
+	m_isParentChanged = false;
+
 	//Calls the childrens' update
 	if (!m_children.empty())
 	{
@@ -65,13 +64,40 @@ void HalfEdgeMesh::update(Matrix44& view, const Matrix44& model)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->update(view, model);
+				m_children[i]->update(view, model, isParentChanged);
 			}
 		}
 	}
 }
 
-void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
+void HalfEdgeMesh::getBounds(const Matrix44& model, BoundingSphere& bounds)
+{
+	//The skybox is around the camera and is never culled
+	if (m_isSkybox){
+		bounds.setInfinite();
+	}
+	else{
+		//World space bounding sphere. The radius is scaled with the largest scale of the model matrix so it still encloses the mesh
+		Vector4 centerPointBV_VEC4(m_centerPointBV[0], m_centerPointBV[1], m_centerPointBV[2], 1);
+		Vector4 worldSpaceCenterPointBV_VEC4 = model * centerPointBV_VEC4;
+		Vector3 worldSpaceCenterPointBV(worldSpaceCenterPointBV_VEC4[0], worldSpaceCenterPointBV_VEC4[1], worldSpaceCenterPointBV_VEC4[2]);
+		bounds.merge(worldSpaceCenterPointBV, m_radiusBV * BoundingSphere::maxScale(model));
+	}
+	bounds.addMeshes(1);
+
+	//Merges the childrens' bounds
+	Node::getBounds(model, bounds);
+}
+
+bool HalfEdgeMesh::boundsChanged()
+{
+	//The mesh has one parent, so the flag is cleared once the parent has seen it
+	bool isChanged = m_isBoundsChanged;
+	m_isBoundsChanged = false;
+	return isChanged || Node::boundsChanged();
+}
+
+void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
 {
 	bool isInsideFrustum;
 	Vector3 worldSpaceCenterPointBV;
@@ -91,6 +117,11 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 
 		//Test sphere to plane intersection with worldspace centerpoint of bounding sphere and the scaled radius
 		isInsideFrustum = frustumCheck.bSphereInFrustum(worldSpaceCenterPointBV, scaledRadius);
+
+		//Skip the draw if the box was hidden in the latest finished query. Queues a new query of the box either way
+		if (isInsideFrustum && drawContext.occlusionQueries != NULL){
+			isInsideFrustum = drawContext.occlusionQueries->isVisible(drawContext.queryId, drawContext.viewProjection, model, m_centerPointBV, m_radiusBV);
+		}
 		if (!isInsideFrustum && shaderBranch != -1){
 			frustumCheck.shapesRendered--;
 		}
@@ -104,7 +135,7 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 		if (m_isWireframe && !m_isSkybox && shaderBranch != -1){
 			m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 			//Render with wireframe shader branch
-			m_glFunctions->glUniform1i(m_shaderModeLocation, 12);
+			m_shaderProgram->useMode(WireframeMode);
 		}
 		//Standard non wireframe mode
 		else if (!m_isWireframe){
@@ -114,7 +145,6 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 				//Cubemap for skybox
 				m_glFunctions->glActiveTexture(GL_TEXTURE0);
 				m_glFunctions->glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
-				m_glFunctions->glUniform1i(m_skyBoxSamplerLocation, 0);
 
 				//We are inside the skybox so we cull the front face instead
 				m_glFunctions->glCullFace(GL_FRONT);
@@ -126,27 +156,11 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 				//Texture
 				m_glFunctions->glActiveTexture(GL_TEXTURE0);
 				m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_textureID);
-				m_glFunctions->glUniform1i(m_textureSamplerLocation, 0);
 			}
 		}
 
-		//Send the material properties to shader program
-		m_glFunctions->glUniform3fv(m_ambientMaterialLocation, 1, &m_ambientMaterial[0]);
-		m_glFunctions->glUniform3fv(m_specularMaterialLocation, 1, &m_specularMaterial[0]);
-		m_glFunctions->glUniform1f(m_shininessLocation, m_shininess);
-
-		//Form the mvp matrix from matrices supplies with draw function
-		Matrix44 mvp = projection * view * model;
-
-		Matrix44 modelMatrix = model;
-		Matrix44 viewMatrix = view;
-		Matrix44 modelViewMatrix = view * model;
-
-		//Send matrices to shader uniforms
-		m_glFunctions->glUniformMatrix4fv(m_modelLocation, 1, GL_TRUE, &modelMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_viewLocation, 1, GL_TRUE, &viewMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_modelViewLocation, 1, GL_TRUE, &modelViewMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_mvpLocation, 1, GL_TRUE, &mvp[0][0]);
+		//Send the model matrix and material. The shader multiplies the model matrix with the matrices of the FrameBlock
+		drawContext.uniformBuffers->setObject(model, m_ambientMaterial, m_specularMaterial, m_shininess);
 
 		//Bind this mesh VAO
 		m_glFunctions->glBindVertexArray(m_halfEdgeVAO);
@@ -168,16 +182,18 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 		m_glFunctions->glBindVertexArray(0);
 
 		if (m_isWireFrameOriginalMesh){
+			//The pass may not have given a shader branch, so the variant in use is kept
+			int mode = m_shaderProgram->getMode();
 			//Draw wireframe original mesh
-			drawWireframeOriginalMesh(model, view, projection);
+			drawWireframeOriginalMesh(*drawContext.uniformBuffers, model);
 			//Revert back to shader branch previously used before rendering the wireframe
-			m_glFunctions->glUniform1i(m_shaderModeLocation, shaderBranch);
+			m_shaderProgram->useMode(mode);
 		}
 		//Draw wireframe BV sphere
 		if (!m_isPlayer && !m_isWireframe && m_isWireframeBV && m_isFrustumCulling && !m_isSkybox && shaderBranch != -1){
-			drawWireframeBoundingSphere(view, projection, worldSpaceCenterPointBV, scaledRadius);
+			drawWireframeBoundingSphere(*drawContext.uniformBuffers, worldSpaceCenterPointBV, scaledRadius);
 			//Revert back to shader branch previously used before rendering the wireframe
-			m_glFunctions->glUniform1i(m_shaderModeLocation, shaderBranch);
+			m_shaderProgram->useMode(shaderBranch);
 		}
 	}
 
@@ -188,27 +204,16 @@ void HalfEdgeMesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projecti
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->draw(frustumCheck, projection, view, shaderBranch, lightView, model, bvScaleFactor);
+				m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, model, bvScaleFactor);
 			}
 		}
 	}
 }
 
-void HalfEdgeMesh::useShaderProgram(GLuint shaderProgram)
+void HalfEdgeMesh::useShaderProgram(ShaderProgram* shaderProgram)
 {
+	//The samplers are associated to their texture units once by the window
 	m_shaderProgram = shaderProgram;
-
-	//Get handles for shader uniforms
-	m_shaderModeLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "mode");
-	m_skyBoxSamplerLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "skyBoxSampler");
-	m_textureSamplerLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "textureSampler");
-	m_ambientMaterialLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "AmbientMaterial");
-	m_specularMaterialLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "SpecularMaterial");
-	m_shininessLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "Shininess");
-	m_mvpLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "mvp");
-	m_modelLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "model");
-	m_viewLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "view");
-	m_modelViewLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "modelView");
 }
 
 void HalfEdgeMesh::useTexture(GLuint textureID)
@@ -218,112 +223,21 @@ void HalfEdgeMesh::useTexture(GLuint textureID)
 
 void HalfEdgeMesh::loadOBJ(const char* path)
 {
-	//Lists to store the data read from obj file
-	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-	std::vector<Vector3> temp_vertices;
-	std::vector<Vector2> temp_uvs;
-	std::vector<Vector3> temp_normals;
+	//Parse the obj file. Faces with more than 3 corners are already split into triangles
+	ObjLoader obj;
+	if (!obj.load(path)){
+		return;
+	}
 
 	//Lists with sorted data according the the indices specified in obj file
 	std::vector<Vector3> sorted_vertices;
 	std::vector<Vector2> sorted_uvs;
 	std::vector<Vector3> sorted_normals;
-	
-	//Open the file in read only mode
-	FILE* file = fopen(path, "r");
-	if (file == NULL){
-	 	printf("Impossible to open the file !\n");
-	 	return;
-	}
-	 
-	//Handle the data in the file
-	while (true){
-	 	//Read the first word of the line and store it in lineHeader
-	 	char lineHeader[128];
-	 	//Read the first word of the line as a string and store it in lineHeader
-	 	int res = fscanf(file, "%s", lineHeader);
-	 
-	 	//If it's the end of the file then break the loop
-	 	if (res == EOF){
-	 		break; // EOF = End Of File. Quit the loop.
-	 	}
-	 
-	 	//Read the stored data and check if it's a "v"
-	 	if (strcmp(lineHeader, "v") == 0){ //Returns 0 if the strings are equal
-	 		Vector3 vertex;
-	 		//Read the data as floats and put them in the vector
-			fscanf(file, "%f %f %f\n", &vertex[0], &vertex[1], &vertex[2]);
-	 		temp_vertices.push_back(vertex);
-	 	}
-	 	//Read the stored data and check if it's a "vt"
-	 	else if (strcmp(lineHeader, "vt") == 0){ //Returns 0 if the strings are equal
-	 		Vector2 uv;
-	 		//Read the data as floats and put them in the vector
-	 		fscanf(file, "%f %f\n", &uv[0], &uv[1]);
-	 		//uv[1] = -uv[1]; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-	 		temp_uvs.push_back(uv);
-	 	}
-	 	//Read the stored data and check if it's a "vn"
-	 	else if (strcmp(lineHeader, "vn") == 0){ //Returns 0 if the strings are equal
-	 		Vector3 normal;
-	 		//Read the data as floats and put them in the vector
-	 		fscanf(file, "%f %f %f\n", &normal[0], &normal[1], &normal[2]);
-	 		temp_normals.push_back(normal);
-	 	}
-	 	//Read the stored data and check if it's a "f"
-	 	else if (strcmp(lineHeader, "f") == 0){ //Returns 0 if the strings are equal
-	 		unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-	 		//Read the data as integers and put them in the arrays
-	 		int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-	 		//If the indices in the obj files are not 9 then we can't handle it
-	 		if (matches != 9){
-	 			printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-	 			fclose(file);
-	 			return;
-	 		}
-	 
-	 		//Add the indices of vertex data to their respective lists
-	 		vertexIndices.push_back(vertexIndex[0]);
-	 		vertexIndices.push_back(vertexIndex[1]);
-	 		vertexIndices.push_back(vertexIndex[2]);
-	 		uvIndices.push_back(uvIndex[0]);
-	 		uvIndices.push_back(uvIndex[1]);
-	 		uvIndices.push_back(uvIndex[2]);
-	 		normalIndices.push_back(normalIndex[0]);
-	 		normalIndices.push_back(normalIndex[1]);
-	 		normalIndices.push_back(normalIndex[2]);
-	 	}
-	 	else{
-	 		//The data we don't need is put into this buffer just so we can move the reader forward
-	 		//fgets reads the whole line. We don't want to loop multiple times if we already know the data is not something we need
-	 		char stupidBuffer[1000];
-	 		fgets(stupidBuffer, 1000, file);
-	 	}
-	}
-	//Closes the file now that we are done with it
-	fclose(file);
-	 
+
 	//The obj file indices specifies which 3 vertices are needed to form a triangle
-	//This loop will create lists of sorted vertex data according to the obj file
-	for (int i = 0; i < vertexIndices.size(); i++){
-	 
-	 	//Get the indices.
-	 	unsigned int vertexIndex = vertexIndices[i];
-	 	unsigned int uvIndex = uvIndices[i];
-	 	unsigned int normalIndex = normalIndices[i];
-	 
-	 	//Get the vertex data with the index extracted from the obj file
-	 	//Indices start at 1 in obj files but in programming it's off by 1
-	 	Vector3 vertex = temp_vertices[vertexIndex - 1];
-	 	Vector2 uv = temp_uvs[uvIndex - 1];
-	 	Vector3 normal = temp_normals[normalIndex - 1];
-	 
-	 	//Put the vertex data in their respective lists
-	 	//Will now be sorted according to how the obj file indices specifies
-		sorted_vertices.push_back(vertex);
-		sorted_uvs.push_back(uv);
-		sorted_normals.push_back(normal);
-	}
+	//This will create lists of sorted vertex data according to the obj file
+	obj.getTriangleCorners(sorted_vertices, sorted_uvs, sorted_normals);
+
 	//Vertex indexing. The lists in the class will store the indexed vertex data. Which will not have duplicates.
 	//Newly generated indices list will tell which vertices are needed to form a triangle
 	indexVBO(sorted_vertices, sorted_uvs, sorted_normals, m_verticesOriginal, m_uvsOriginal, m_normalsOriginal, m_indicesOriginal);
@@ -344,87 +258,85 @@ void HalfEdgeMesh::loadOBJ(const char* path)
 	
 	*/
 
-	//Used to check if there is a Twin half-edge
-	std::map<std::pair<const Vertex*, const Vertex*>, HalfEdge*> edgeMap;
+	//Used to check if there is a Twin half-edge. Key is the indices of the origin and end vertex of a half-edge
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> edgeMap;
 
-	//Load the vertex list used by half edge mesh with vertex data from the original vertex list. This list does not have duplicate vertices and is dependant on the indices list.
-	for (int i = 0; i < temp_vertices.size(); i++){
-		Vertex* vertexData = new Vertex;
-		vertexData->pos = temp_vertices[i];
-		m_vertexData.push_back(vertexData);
+	//All faces are triangles. Reserve the memory in the pools up front
+	unsigned int faceCount = obj.vertexIndices.size() / 3;
+	m_halfEdgeData.reserve(obj.vertices.size(), faceCount * 3, faceCount);
+
+	//Load the vertex pool used by half edge mesh with vertex data from the original vertex list. This list does not have duplicate vertices and is dependant on the indices list.
+	for (int i = 0; i < obj.vertices.size(); i++){
+		unsigned int vertex = m_halfEdgeData.addVertex();
+		m_halfEdgeData.vertexPos[vertex] = obj.vertices[i];
 	}
 
 
 	//Create the faces and half-edges. Getting the right index for the data using the indices list.
-	for (int i = 0; i < vertexIndices.size(); i += 3){
-		Face* f = new Face;
-		HalfEdge* he1 = new HalfEdge;
-		HalfEdge* he2 = new HalfEdge;
-		HalfEdge* he3 = new HalfEdge;
+	for (int i = 0; i < obj.vertexIndices.size(); i += 3){
+		unsigned int f = m_halfEdgeData.addFace();
+		unsigned int he1 = m_halfEdgeData.addHalfEdge();
+		unsigned int he2 = m_halfEdgeData.addHalfEdge();
+		unsigned int he3 = m_halfEdgeData.addHalfEdge();
 
 		//Associate the half-edges to a face
-		he1->face = f;
-		he2->face = f;
-		he3->face = f;
+		m_halfEdgeData.edgeFace[he1] = f;
+		m_halfEdgeData.edgeFace[he2] = f;
+		m_halfEdgeData.edgeFace[he3] = f;
 
 		//Get the UVs and Normals for vertices(Overwriting an UV if it's the same vertex)
-		m_vertexData[vertexIndices[i] - 1]->uv = temp_uvs[uvIndices[i] - 1];
-		m_vertexData[vertexIndices[i] - 1]->normal = temp_normals[normalIndices[i] - 1];
+		m_halfEdgeData.vertexUv[obj.vertexIndices[i]] = sorted_uvs[i];
+		m_halfEdgeData.vertexNormal[obj.vertexIndices[i]] = sorted_normals[i];
 
-		m_vertexData[vertexIndices[i + 1] - 1]->uv = temp_uvs[uvIndices[i + 1] - 1];
-		m_vertexData[vertexIndices[i + 1] - 1]->normal = temp_normals[normalIndices[i + 1] - 1];
+		m_halfEdgeData.vertexUv[obj.vertexIndices[i + 1]] = sorted_uvs[i + 1];
+		m_halfEdgeData.vertexNormal[obj.vertexIndices[i + 1]] = sorted_normals[i + 1];
 
-		m_vertexData[vertexIndices[i + 2] - 1]->uv = temp_uvs[uvIndices[i + 2] - 1];
-		m_vertexData[vertexIndices[i + 2] - 1]->normal = temp_normals[normalIndices[i + 2] - 1];
+		m_halfEdgeData.vertexUv[obj.vertexIndices[i + 2]] = sorted_uvs[i + 2];
+		m_halfEdgeData.vertexNormal[obj.vertexIndices[i + 2]] = sorted_normals[i + 2];
 
 
 		//Point origin vertex for half edges to right vertex according to indices list
-		he1->origin = m_vertexData[vertexIndices[i]-1];
-		he2->origin = m_vertexData[vertexIndices[i + 1]-1];
-		he3->origin = m_vertexData[vertexIndices[i + 2]-1];
+		m_halfEdgeData.edgeOrigin[he1] = obj.vertexIndices[i];
+		m_halfEdgeData.edgeOrigin[he2] = obj.vertexIndices[i + 1];
+		m_halfEdgeData.edgeOrigin[he3] = obj.vertexIndices[i + 2];
 
 		//Assign half-edge for vertex which has the vertex as origin
-		he1->origin->edge = he1;
-		he2->origin->edge = he2;
-		he3->origin->edge = he3;
+		m_halfEdgeData.vertexEdge[m_halfEdgeData.edgeOrigin[he1]] = he1;
+		m_halfEdgeData.vertexEdge[m_halfEdgeData.edgeOrigin[he2]] = he2;
+		m_halfEdgeData.vertexEdge[m_halfEdgeData.edgeOrigin[he3]] = he3;
 
-		//Assign next edge pointers
-		he1->next = he2;
-		he2->next = he3;
-		he3->next = he1;
+		//Assign next edge indices
+		m_halfEdgeData.edgeNext[he1] = he2;
+		m_halfEdgeData.edgeNext[he2] = he3;
+		m_halfEdgeData.edgeNext[he3] = he1;
 
 		//Assign an half-edge to face
-		f->edge = he1;
-
-		m_halfEdges.push_back(he1);
-		m_halfEdges.push_back(he2);
-		m_halfEdges.push_back(he3);
-		m_faces.push_back(f);
+		m_halfEdgeData.faceEdge[f] = he1;
 
 		/*
 		Make 3 pairs here. To later look up in edgeMap to find the pairs.
 		*/
-		edgeMap[std::make_pair(he1->origin, he1->next->origin)] = he1;
-		edgeMap[std::make_pair(he2->origin, he2->next->origin)] = he2;
-		edgeMap[std::make_pair(he3->origin, he3->next->origin)] = he3;
+		edgeMap[std::make_pair(m_halfEdgeData.edgeOrigin[he1], m_halfEdgeData.edgeOrigin[he2])] = he1;
+		edgeMap[std::make_pair(m_halfEdgeData.edgeOrigin[he2], m_halfEdgeData.edgeOrigin[he3])] = he2;
+		edgeMap[std::make_pair(m_halfEdgeData.edgeOrigin[he3], m_halfEdgeData.edgeOrigin[he1])] = he3;
 
 	}
 
 	//Find Pairs
 	unsigned int twinCounter = 0;
-	for (int i = 0; i < m_halfEdges.size(); i++){
+	for (unsigned int i = 0; i < m_halfEdgeData.halfEdgeCount(); i++){
 		//Origin vertex for half-edge that we try to find a twin half-edge for
-		Vertex* v1 = m_halfEdges[i]->origin;
+		unsigned int v1 = m_halfEdgeData.edgeOrigin[i];
 		//End vertex for half-edge that we try to find a twin half-edge for
-		Vertex* v2 = m_halfEdges[i]->next->origin;
+		unsigned int v2 = m_halfEdgeData.edgeOrigin[m_halfEdgeData.edgeNext[i]];
 
-		//Search for a pair with opposite vertices which is a pair. If found update pair pointers
-		std::map<std::pair<const Vertex*, const Vertex*>, HalfEdge*>::iterator itr = edgeMap.find(std::make_pair(v2, v1));
+		//Search for a pair with opposite vertices which is a pair. If found update pair indices
+		std::map<std::pair<unsigned int, unsigned int>, unsigned int>::iterator itr = edgeMap.find(std::make_pair(v2, v1));
 		if (itr != edgeMap.end())
 		{
-			HalfEdge* twinEdge = itr->second;
-			m_halfEdges[i]->pair = twinEdge;
-			twinEdge->pair = m_halfEdges[i];
+			unsigned int twinEdge = itr->second;
+			m_halfEdgeData.edgePair[i] = twinEdge;
+			m_halfEdgeData.edgePair[twinEdge] = i;
 			twinCounter++;
 		}
 	}
@@ -453,7 +365,7 @@ void HalfEdgeMesh::loadOBJ(const char* path)
 // 		}
 // 	}
 
-	qDebug() << temp_vertices.size() << "Unique Vertices" << m_halfEdges.size() << "Half-Edges" << m_faces.size() << "Faces" << twinCounter << "Twin-Edges";
+	qDebug() << obj.vertices.size() << "Unique Vertices" << m_halfEdgeData.halfEdgeCount() << "Half-Edges" << m_halfEdgeData.faceCount() << "Faces" << twinCounter << "Twin-Edges";
 	//Create lists with vertices, uvs, normals and indices which will be used in VBOs for rendering
 	updateHalfEdgeMesh();
 
@@ -464,55 +376,23 @@ void HalfEdgeMesh::loadOBJ(const char* path)
 	m_glFunctions->glBindVertexArray(m_halfEdgeVAO);
 
 	//////////////////////////////////////////////////////////////////////////
-	//Vertex VBO
+	//Vertex VBO. Position, uv and normal are interleaved in the layout of m_vertexFormat
 	//Create VBO on the GPU to store the vertex data
-	m_glFunctions->glGenBuffers(1, &m_halfEdgeVerticesVBO);
+	m_glFunctions->glGenBuffers(1, &m_halfEdgeVBO);
 	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeVerticesVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_verticesHE.size() * sizeof(Vector3), &m_verticesHE[0], GL_STATIC_DRAW);
-
-	//Sets up which shader attribute will received the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(0);
-
-	//////////////////////////////////////////////////////////////////////////
-	//UV VBO
-	//Create VBO on the GPU to store the vertex data
-	m_glFunctions->glGenBuffers(1, &m_halfEdgeUvsVBO);
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeUvsVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_uvsHE.size() * sizeof(Vector2), &m_uvsHE[0], GL_STATIC_DRAW);
-	 
-	//Sets up which shader attribute will receive the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(1);
-
-	//////////////////////////////////////////////////////////////////////////
-	//Normal VBO
-	//Create VBO on the GPU to store the vertex data
-	m_glFunctions->glGenBuffers(1, &m_halfEdgeNormalsVBO);
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeNormalsVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_normalsHE.size() * sizeof(Vector3), &m_normalsHE[0], GL_STATIC_DRAW);
-	 
-	//Sets up which shader attribute will receive the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(2);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeVBO);
+	//Position, uv and normal attributes for the interleaved VBO
+	m_vertexFormat.setupAttributes(m_glFunctions);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Indices EBO
 	//Create EBO on the GPU to store the vertex data
 	m_glFunctions->glGenBuffers(1, &m_halfEdgeIndicesEBO);
-	//Bind EBO to make it current
+	//Bind EBO to make it current. The VAO remembers it
 	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_halfEdgeIndicesEBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indicesHE.size() * sizeof(unsigned int), &m_indicesHE[0], GL_STATIC_DRAW);
+
+	//Send the vertex data and indices to the GPU
+	uploadHalfEdgeMesh();
 
 	//////////////////////////////////////////////////////////////////////////
 	//Unbind the VAO now that the VBOs have been set up
@@ -521,21 +401,6 @@ void HalfEdgeMesh::loadOBJ(const char* path)
 	calculateBoundingSphere();
 }
 
-bool HalfEdgeMesh::getSimilarVertexIndex(PackedVertex& packed, std::map<PackedVertex, unsigned int>& VertexToOutIndex, unsigned int& result)
-{
-	//Iterator to find a PackedVertex in map that is equal to packed
-	std::map<PackedVertex, unsigned int>::iterator it = VertexToOutIndex.find(packed);
-	//Return false if nothing is found
-	if (it == VertexToOutIndex.end()){
-		return false;
-	}
-	else{
-		//Returns the value the key is paired to
-		result = it->second;
-		return true;
-	}
-}
-
 void HalfEdgeMesh::indexVBO(
 	std::vector<Vector3>& in_vertices, std::vector<Vector2>& in_uvs, std::vector<Vector3>& in_normals,
 	std::vector<Vector3>& out_vertices, std::vector<Vector2>& out_uvs, std::vector<Vector3>& out_normals, std::vector<unsigned int>& out_indices)
@@ -546,8 +411,10 @@ void HalfEdgeMesh::indexVBO(
 	out_normals.clear();
 	out_indices.clear();
 
-	//Stores unique vertex data paired with the index
-	std::map<PackedVertex, unsigned int> VertexToOutIndex;
+	//Stores unique vertex data paired with the index. Smooth meshes share a vertex between about 6 corners, the table grows if there are more unique vertices
+	VertexWelder welder(in_vertices.size() / 4, m_weldEpsilon);
+	//One index per input vertex
+	out_indices.reserve(in_vertices.size());
 
 	// For each input vertex
 	for (int i = 0; i < in_vertices.size(); i++){
@@ -559,11 +426,11 @@ void HalfEdgeMesh::indexVBO(
 		packed.normal = in_normals[i];
 
 
-		//Will store the index of the vertex found in the map
+		//Will store the index of the vertex found in the welder
 		unsigned int index;
-		//Try to find a PackedVertex in the VertexToOutIndex map that is the same as packed
-		//If one is found save the index of it
-		bool found = getSimilarVertexIndex(packed, VertexToOutIndex, index);
+		//Try to find a vertex in the welder that is the same as packed
+		//If one is found save the index of it. Otherwise packed is added to the welder and index is the index it will get in the lists
+		bool found = welder.findOrAdd(packed, index);
 
 		//Push the found index to our indices vector
 		if (found){ // A similar vertex is already in the VBO, use it instead !
@@ -571,39 +438,66 @@ void HalfEdgeMesh::indexVBO(
 		}
 		//If not found then add the vertex data to our vertex arrays.
 		//Also add the the index of the newly added vertex data to indices array. Which will be the last element.
-		//Add the vertex data to the map and associate it with the index.
+		//The welder already associated the vertex data with the index.
 		//So we can iterate next time and check for same vertex data and use the index
 		else{ // If not, it needs to be added in the output data.
 			out_vertices.push_back(in_vertices[i]);
 			out_uvs.push_back(in_uvs[i]);
 			out_normals.push_back(in_normals[i]);
-			unsigned int newindex = (unsigned int)out_vertices.size() - 1;
-			out_indices.push_back(newindex);
-			VertexToOutIndex[packed] = newindex;
+			out_indices.push_back(index);
 		}
 	}
 }
 
 void HalfEdgeMesh::calculateBoundingSphere(){
+	//The parent transform has to merge the new sphere
+	m_isBoundsChanged = true;
 	m_centerPointBV.Insert(0, 0, 0);
 	m_radiusBV = 0;
+	if (m_verticesHE.empty()){
+		return;
+	}
+
+	//The vertices are split into blocks. Each block is handled by one thread and the results of the blocks are merged
+	unsigned int blockCount = (m_verticesHE.size() + BoundsBlockSize - 1) / BoundsBlockSize;
+	m_blockBounds.assign(blockCount, PointBounds());
+	m_blockRadii.resize(blockCount);
 
 	//Calculate the center point by getting the mean value of vertices
-	for (int i = 0; i < m_verticesHE.size(); i++){
-		m_centerPointBV += m_verticesHE[i];
+	runSubdivisionPhase(blockCount, &HalfEdgeMesh::calculateBlockBounds, 1);
+	PointBounds bounds;
+	for (unsigned int i = 0; i < blockCount; i++){
+		bounds.Merge(m_blockBounds[i]);
 	}
-	m_centerPointBV /= m_verticesHE.size();
+	m_centerPointBV = bounds.GetCentroid();
 
-	//Find the farthest distance from the center point by iterating all vertices all calculating the distance
-	for (int i = 0; i < m_verticesHE.size(); i++){
-		Vector3 pos = m_verticesHE[i] - m_centerPointBV;
-		float distance = pos.Magnitude();
-		if (distance > m_radiusBV){
-			m_radiusBV = distance;
+	//Find the farthest distance from the center point
+	runSubdivisionPhase(blockCount, &HalfEdgeMesh::calculateBlockRadii, 1);
+	for (unsigned int i = 0; i < blockCount; i++){
+		if (m_blockRadii[i] > m_radiusBV){
+			m_radiusBV = m_blockRadii[i];
 		}
 	}
 }
 
+void HalfEdgeMesh::calculateBlockBounds(unsigned int begin, unsigned int end)
+{
+	for (unsigned int block = begin; block < end; block++){
+		unsigned int first = block * BoundsBlockSize;
+		unsigned int count = m_verticesHE.size() - first < BoundsBlockSize ? m_verticesHE.size() - first : BoundsBlockSize;
+		m_blockBounds[block].AddPackedPoints(&m_verticesHE[first][0], count);
+	}
+}
+
+void HalfEdgeMesh::calculateBlockRadii(unsigned int begin, unsigned int end)
+{
+	for (unsigned int block = begin; block < end; block++){
+		unsigned int first = block * BoundsBlockSize;
+		unsigned int count = m_verticesHE.size() - first < BoundsBlockSize ? m_verticesHE.size() - first : BoundsBlockSize;
+		m_blockRadii[block] = PointBounds::MaxDistancePacked(&m_verticesHE[first][0], count, m_centerPointBV);
+	}
+}
+
 void HalfEdgeMesh::setAmbientMaterial(float r, float g, float b)
 {
 	m_ambientMaterial.Insert(r, g, b);
@@ -615,22 +509,21 @@ void HalfEdgeMesh::setSpecularMaterial(float r, float g, float b, float shinines
 	m_shininess = shininess;
 }
 
-void HalfEdgeMesh::drawWireframeBoundingSphere(const Matrix44& view, const Matrix44& projection, Vector3 position, float radius)
+void HalfEdgeMesh::drawWireframeBoundingSphere(UniformBuffers& uniforms, Vector3 position, float radius)
 {
 	//Sphere triangles were created clockwise so we tell opengl to treat clockwise as front face
 	m_glFunctions->glFrontFace(GL_CW);
 	m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//Bind the shaders to be used
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 12);
+	m_shaderProgram->useMode(WireframeMode);
 
 	//Model Matrix
 	Matrix44 mymodel;
 	mymodel.Translate(position); //translate to centerpoint of bounding sphere
 	mymodel.Scale(radius); //scale to the radius of the bounding sphere
-	Matrix44 mvp = projection * view * mymodel;
 
-	//Send the mvp matrix to the vertex shader
-	m_glFunctions->glUniformMatrix4fv(m_mvpLocation, 1, GL_TRUE, &mvp[0][0]);
+	//Send the model matrix to the vertex shader
+	uniforms.setObject(mymodel);
 
 	//Bind this mesh VAO
 	m_glFunctions->glBindVertexArray(m_wireframeBvVAO);
@@ -671,6 +564,16 @@ void HalfEdgeMesh::setWireframeBV(bool flag)
 	m_isWireframeBV = flag;
 }
 
+void HalfEdgeMesh::setWeldEpsilon(float epsilon)
+{
+	m_weldEpsilon = epsilon;
+}
+
+void HalfEdgeMesh::setVertexFormat(unsigned int flags)
+{
+	m_vertexFormat = VertexFormat(flags);
+}
+
 void HalfEdgeMesh::setWireframeOriginalMeshHE(bool flag)
 {
 	m_isWireFrameOriginalMesh = flag;
@@ -756,60 +659,122 @@ void HalfEdgeMesh::subdivide()
 {
 	m_subdivisionTimer.start();
 
+	//Decide where everything the subdivision creates is stored and resize the pools once to the exact size
+	assignSubdivisionIndices();
 	//Calculate new position for existing vertices
-	calculateOldVerticesPosition();
-	//Create a new vertex for each halfedge and calculate its position
-	calculateMidpointPosition();
-	//Split each halfedge into two by updating the existing halfedge's pointer and creating a new one. Linking them together
-	splitHalfEdges();
+	runSubdivisionPhase(m_oldVertexCount, &HalfEdgeMesh::calculateOldVerticesPosition);
+	//Create a new vertex for each edge and calculate its position
+	runSubdivisionPhase(m_oldHalfEdgeCount, &HalfEdgeMesh::calculateMidpointPosition);
+	//Split each halfedge into two by updating the existing halfedge and creating a new one. Linking them together
+	runSubdivisionPhase(m_oldHalfEdgeCount, &HalfEdgeMesh::splitHalfEdges);
 	//Create the inner edges and the new faces. And linking them all together
-	updateConnectivity();
+	runSubdivisionPhase(m_oldFaceCount, &HalfEdgeMesh::updateConnectivity);
 	//Sets all vertices position = new postion
-	updateVertexPositions();
+	runSubdivisionPhase(m_halfEdgeData.vertexCount(), &HalfEdgeMesh::updateVertexPositions);
 	//Calculate normals for mesh
-	calculateNormals();
+	runSubdivisionPhase(m_halfEdgeData.vertexCount(), &HalfEdgeMesh::calculateNormals);
 
 	//Update lists for rendering and vbos
 	updateHalfEdgeMesh();
 	//Update the bounding sphere
 	calculateBoundingSphere();
 
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeVerticesVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_verticesHE.size() * sizeof(Vector3), &m_verticesHE[0], GL_STATIC_DRAW);
+	//Send the new vertex data and indices to the GPU
+	uploadHalfEdgeMesh();
 
-	//////////////////////////////////////////////////////////////////////////
-	//UV VBO
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeUvsVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_uvsHE.size() * sizeof(Vector2), &m_uvsHE[0], GL_STATIC_DRAW);
+	qDebug() << m_subdivisionTimer.elapsed() << "ms" << (m_isParallelSubdivision ? "(Parallel)" : "(Serial)");
+}
 
-	//////////////////////////////////////////////////////////////////////////
-	//Normal VBO
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeNormalsVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_normalsHE.size() * sizeof(Vector3), &m_normalsHE[0], GL_STATIC_DRAW);
+void HalfEdgeMesh::setParallelSubdivision(bool flag)
+{
+	m_isParallelSubdivision = flag;
+}
 
-	//////////////////////////////////////////////////////////////////////////
-	//Indices EBO
-	//Bind EBO to make it current
-	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_halfEdgeIndicesEBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indicesHE.size() * sizeof(unsigned int), &m_indicesHE[0], GL_STATIC_DRAW);
+void HalfEdgeMesh::runSubdivisionPhase(unsigned int count, RangeKernel<HalfEdgeMesh>::Function phase, unsigned int minRangeSize)
+{
+	if (m_isParallelSubdivision){
+		parallelFor(count, RangeKernel<HalfEdgeMesh>(this, phase), minRangeSize);
+	}
+	else{
+		(this->*phase)(0, count);
+	}
+}
 
-	qDebug() << m_subdivisionTimer.elapsed() << "ms";
+void HalfEdgeMesh::assignSubdivisionIndices()
+{
+	m_oldVertexCount = m_halfEdgeData.vertexCount();
+	m_oldHalfEdgeCount = m_halfEdgeData.halfEdgeCount();
+	m_oldFaceCount = m_halfEdgeData.faceCount();
+
+	//Rank the edge owners in blocks. Count the owners of each block, prefix sum the counts and then rank within each block.
+	//The ranks are the same no matter how the blocks are split across threads
+	unsigned int blockCount = (m_oldHalfEdgeCount + EdgeRankBlockSize - 1) / EdgeRankBlockSize;
+	m_edgeRanks.resize(m_oldHalfEdgeCount);
+	m_blockEdgeCounts.resize(blockCount);
+
+	runSubdivisionPhase(blockCount, &HalfEdgeMesh::countEdgeOwners, 1);
+
+	//Exclusive prefix sum. Each block now holds the rank its first owner gets
+	unsigned int edgeCount = 0;
+	for (unsigned int i = 0; i < blockCount; i++){
+		unsigned int blockEdgeCount = m_blockEdgeCounts[i];
+		m_blockEdgeCounts[i] = edgeCount;
+		edgeCount += blockEdgeCount;
+	}
+
+	runSubdivisionPhase(blockCount, &HalfEdgeMesh::rankEdgeOwners, 1);
+	m_oldEdgeCount = edgeCount;
+
+	//A new vertex is created for each edge. Every half-edge is split into 2 and each face gets 6 inner half-edges (2 per old half-edge).
+	//Each face is split into 4 faces
+	m_halfEdgeData.resize(m_oldVertexCount + edgeCount, m_oldHalfEdgeCount * 4, m_oldFaceCount * 4);
+}
+
+bool HalfEdgeMesh::isEdgeOwner(unsigned int halfEdge) const
+{
+	//The rank only increases after an owner
+	unsigned int nextRank = halfEdge + 1 < m_oldHalfEdgeCount ? m_edgeRanks[halfEdge + 1] : m_oldEdgeCount;
+	return nextRank != m_edgeRanks[halfEdge];
 }
 
-void HalfEdgeMesh::calculateOldVerticesPosition()
+void HalfEdgeMesh::countEdgeOwners(unsigned int begin, unsigned int end)
 {
-	for (int i = 0; i < m_vertexData.size(); i++){
-		//Get the vertex to which we will calculate its new position
-		Vertex* vertex = m_vertexData[i];
+	for (unsigned int block = begin; block < end; block++){
+		unsigned int first = block * EdgeRankBlockSize;
+		unsigned int last = std::min(first + EdgeRankBlockSize, m_oldHalfEdgeCount);
+
+		unsigned int count = 0;
+		for (unsigned int i = first; i < last; i++){
+			//The half-edge with the lowest index of the pair owns the edge
+			if (m_halfEdgeData.edgePair[i] > i){
+				count++;
+			}
+		}
+		m_blockEdgeCounts[block] = count;
+	}
+}
+
+void HalfEdgeMesh::rankEdgeOwners(unsigned int begin, unsigned int end)
+{
+	for (unsigned int block = begin; block < end; block++){
+		unsigned int first = block * EdgeRankBlockSize;
+		unsigned int last = std::min(first + EdgeRankBlockSize, m_oldHalfEdgeCount);
+
+		unsigned int rank = m_blockEdgeCounts[block];
+		for (unsigned int i = first; i < last; i++){
+			m_edgeRanks[i] = rank;
+			if (m_halfEdgeData.edgePair[i] > i){
+				rank++;
+			}
+		}
+	}
+}
+
+void HalfEdgeMesh::calculateOldVerticesPosition(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++){
 		//Get the half-edge of the vertex we are working on
-		HalfEdge* halfedge = m_vertexData[i]->edge;
+		unsigned int halfedge = m_halfEdgeData.vertexEdge[i];
 
 		//All neighbors added together
 		Vector3 pSum;
@@ -817,266 +782,253 @@ void HalfEdgeMesh::calculateOldVerticesPosition()
 		float n = 0;
 
 		//Traverser, traversing all neighbors of the vertex
-		HalfEdge* traverser = halfedge->next;
+		unsigned int start = m_halfEdgeData.edgeNext[halfedge];
+		unsigned int traverser = start;
 		
 		//Do until halfedge is same as start halfedge
 		do 
 		{
 			//Handle current neighbor vertex
-			pSum += traverser->origin->pos;
+			pSum += m_halfEdgeData.vertexPos[m_halfEdgeData.edgeOrigin[traverser]];
 			n++;
 
-			//Update traverse pointer to next neighbor
-			traverser = traverser->next->pair->next;
-		} while (traverser != halfedge->next);
+			//Update traverser to next neighbor
+			traverser = m_halfEdgeData.edgeNext[m_halfEdgeData.edgePair[m_halfEdgeData.edgeNext[traverser]]];
+		} while (traverser != start);
 
 		//Calculate b which is a function used by the equation which calculates the new position
 		//Using  Warren and Weimer's equation which doesnt have expensive trigonometrix functions
 		float b = 3.0 / (n*(n + 2.0));
 
-		vertex->newPos = (1.0 - n*b)*vertex->pos + b*pSum;
+		m_halfEdgeData.vertexNewPos[i] = (1.0 - n*b)*m_halfEdgeData.vertexPos[i] + b*pSum;
 	}
 }
 
-void HalfEdgeMesh::calculateMidpointPosition()
+void HalfEdgeMesh::calculateMidpointPosition(unsigned int begin, unsigned int end)
 {
 	/*
 	Iterate edges calculate the midpoint vertex
 	*/
 
-	for (int i = 0; i < m_halfEdges.size(); i++){
-		//Get the halfedge to which we will calculate midpoint position of the new vertex
-		HalfEdge* halfedge = m_halfEdges[i];
+	for (unsigned int i = begin; i < end; i++){
+		//Only the owner of the edge creates the midpoint and points the pair's midpoint to the same vertex, aka no duplicates.
+		if (isEdgeOwner(i)){
+			unsigned int pair = m_halfEdgeData.edgePair[i];
+			unsigned int next = m_halfEdgeData.edgeNext[i];
 
-		//We want to point the pair's midpoint to the same vertex, aka no duplicates.
-		//So for each iteration we point the pair's midpoint pointer as well.
-		//If later in the loop we come across the halfedge which was the pair the midpoint won't be NULL
-		if (halfedge->midpoint == NULL){
-			Vertex* p1 = halfedge->origin;
-			Vertex* p2 = halfedge->next->origin;
-			Vertex* p3 = halfedge->next->next->origin;
-			Vertex* p4 = halfedge->pair->next->next->origin;
+			unsigned int p1 = m_halfEdgeData.edgeOrigin[i];
+			unsigned int p2 = m_halfEdgeData.edgeOrigin[next];
+			unsigned int p3 = m_halfEdgeData.edgeOrigin[m_halfEdgeData.edgeNext[next]];
+			unsigned int p4 = m_halfEdgeData.edgeOrigin[m_halfEdgeData.edgeNext[m_halfEdgeData.edgeNext[pair]]];
 
-			Vector3 pAll = 3 * p1->pos + 3 * p2->pos + p3->pos + p4->pos;
+			Vector3 pAll = 3 * m_halfEdgeData.vertexPos[p1] + 3 * m_halfEdgeData.vertexPos[p2] + m_halfEdgeData.vertexPos[p3] + m_halfEdgeData.vertexPos[p4];
 
 
-			Vertex* midpoint = new Vertex;
+			//The midpoint vertices are placed after the old vertices in the order of their owners
+			unsigned int midpoint = m_oldVertexCount + m_edgeRanks[i];
 			Vector3 calculatedPosition = pAll / 8.0;
-			midpoint->pos = calculatedPosition;
+			m_halfEdgeData.vertexPos[midpoint] = calculatedPosition;
 			//The uv is an interpolation between two existing ones
-			midpoint->uv = (p1->uv + p2->uv) / 2.0;
-			midpoint->newPos = calculatedPosition;
-			halfedge->midpoint = midpoint;
-			halfedge->pair->midpoint = midpoint;
-
-
-			m_vertexData.push_back(midpoint);
+			m_halfEdgeData.vertexUv[midpoint] = (m_halfEdgeData.vertexUv[p1] + m_halfEdgeData.vertexUv[p2]) / 2.0;
+			m_halfEdgeData.vertexNewPos[midpoint] = calculatedPosition;
+			m_halfEdgeData.edgeMidpoint[i] = midpoint;
+			m_halfEdgeData.edgeMidpoint[pair] = midpoint;
 		}
 	}
 }
 
-void HalfEdgeMesh::splitHalfEdges()
+void HalfEdgeMesh::splitHalfEdges(unsigned int begin, unsigned int end)
 {
-	//Split edges and link twins
-	unsigned int halfEdgeListSize = m_halfEdges.size();
-	//Split halfedges into two by iterating the halfedges and split also linking their pairs pointers
-	for (int i = 0; i < halfEdgeListSize; i++){
-		//Checks if the half edge has already been split
-		if (m_halfEdges[i]->next->origin != m_halfEdges[i]->midpoint){
-			//Create new half-edge
-			HalfEdge* newHalfEdge1 = new HalfEdge;
+	//Split halfedges into two by iterating the halfedges and split also linking their pairs
+	for (unsigned int i = begin; i < end; i++){
+		//The owner splits both half-edges of the edge. The pair is only read by its owner since the owner changes it
+		if (isEdgeOwner(i)){
+			unsigned int pair = m_halfEdgeData.edgePair[i];
+
+			//The two new half-edges of an edge are placed after the old half-edges in the order of their owners
+			unsigned int newHalfEdge1 = m_oldHalfEdgeCount + 2 * m_edgeRanks[i];
+			unsigned int newHalfEdge2 = newHalfEdge1 + 1;
+
 			//New halfedge starts at the midpoint of the existing half edge
-			newHalfEdge1->origin = m_halfEdges[i]->midpoint;
-			//Update the vertex edge pointer
-			newHalfEdge1->origin->edge = newHalfEdge1;
-			//Connect the next pointer to the existing halfedge's next
-			newHalfEdge1->next = m_halfEdges[i]->next;
+			m_halfEdgeData.edgeOrigin[newHalfEdge1] = m_halfEdgeData.edgeMidpoint[i];
+			//Update the vertex edge
+			m_halfEdgeData.vertexEdge[m_halfEdgeData.edgeOrigin[newHalfEdge1]] = newHalfEdge1;
+			//Connect the next to the existing halfedge's next
+			m_halfEdgeData.edgeNext[newHalfEdge1] = m_halfEdgeData.edgeNext[i];
 			//Associate with the existing halfedge's face
-			newHalfEdge1->face = m_halfEdges[i]->face;
+			m_halfEdgeData.edgeFace[newHalfEdge1] = m_halfEdgeData.edgeFace[i];
 
-			//Create new half-edge for the pair of the halfedge we are currently in progress of splitting
-			HalfEdge* newHalfEdge2 = new HalfEdge;
+			//New halfedge for the pair of the halfedge we are currently in progress of splitting
 			//New halfedge starts at the midpoint of the existing half edge's pair
-			newHalfEdge2->origin = m_halfEdges[i]->pair->midpoint;
-			//Update the vertex edge pointer
-			newHalfEdge2->origin->edge = newHalfEdge2;
-			//Connect the next pointer to the existing halfedge's pair's next
-			newHalfEdge2->next = m_halfEdges[i]->pair->next;
+			m_halfEdgeData.edgeOrigin[newHalfEdge2] = m_halfEdgeData.edgeMidpoint[pair];
+			//Update the vertex edge
+			m_halfEdgeData.vertexEdge[m_halfEdgeData.edgeOrigin[newHalfEdge2]] = newHalfEdge2;
+			//Connect the next to the existing halfedge's pair's next
+			m_halfEdgeData.edgeNext[newHalfEdge2] = m_halfEdgeData.edgeNext[pair];
 			//Associate with the existing halfedge's pair's face
-			newHalfEdge2->face = m_halfEdges[i]->pair->face;
-
+			m_halfEdgeData.edgeFace[newHalfEdge2] = m_halfEdgeData.edgeFace[pair];
 
-			//We can now update the existing halfedges next and pair pointers
-			m_halfEdges[i]->next = newHalfEdge1;
-			m_halfEdges[i]->pair->next = newHalfEdge2;
 
-			m_halfEdges[i]->pair->pair = newHalfEdge1;
-			newHalfEdge1->pair = m_halfEdges[i]->pair;
+			//We can now update the existing halfedges next and pair
+			m_halfEdgeData.edgeNext[i] = newHalfEdge1;
+			m_halfEdgeData.edgeNext[pair] = newHalfEdge2;
 
-			m_halfEdges[i]->pair = newHalfEdge2;
-			newHalfEdge2->pair = m_halfEdges[i];
+			m_halfEdgeData.edgePair[pair] = newHalfEdge1;
+			m_halfEdgeData.edgePair[newHalfEdge1] = pair;
 
-
-			m_halfEdges.push_back(newHalfEdge1);
-			m_halfEdges.push_back(newHalfEdge2);
+			m_halfEdgeData.edgePair[i] = newHalfEdge2;
+			m_halfEdgeData.edgePair[newHalfEdge2] = i;
 		}
 	}
 }
 
-void HalfEdgeMesh::updateVertexPositions()
+void HalfEdgeMesh::updateVertexPositions(unsigned int begin, unsigned int end)
 {
-	for (int i = 0; i < m_vertexData.size(); i++){
-		m_vertexData[i]->pos = m_vertexData[i]->newPos;
+	for (unsigned int i = begin; i < end; i++){
+		m_halfEdgeData.vertexPos[i] = m_halfEdgeData.vertexNewPos[i];
 	}
 }
 
-void HalfEdgeMesh::updateConnectivity()
+void HalfEdgeMesh::updateConnectivity(unsigned int begin, unsigned int end)
 {
-	unsigned int faceListSize = m_faces.size();
-	for (int i = 0; i < faceListSize; i++){
+	for (unsigned int i = begin; i < end; i++){
 
-		Face* leftFace = m_faces[i];
-		Face* topFace = new Face;
-		Face* rightFace = new Face;
-		Face* middleFace = new Face;
+		//The 3 new faces and 6 inner half-edges of a face are placed by the index of the face
+		unsigned int leftFace = i;
+		unsigned int topFace = m_oldFaceCount + 3 * i;
+		unsigned int rightFace = topFace + 1;
+		unsigned int middleFace = topFace + 2;
 
-		HalfEdge* innerLeftEdge = new HalfEdge;
-		HalfEdge* innerTopEdge = new HalfEdge;
-		HalfEdge* innerRightEdge = new HalfEdge;
+		unsigned int innerLeftEdge = 2 * m_oldHalfEdgeCount + 6 * i;
+		unsigned int innerTopEdge = innerLeftEdge + 1;
+		unsigned int innerRightEdge = innerLeftEdge + 2;
 
 		//New triangle, middle
-		HalfEdge* innerMidEdge1 = new HalfEdge;
-		HalfEdge* innerMidEdge2 = new HalfEdge;
-		HalfEdge* innerMidEdge3 = new HalfEdge;
+		unsigned int innerMidEdge1 = innerLeftEdge + 3;
+		unsigned int innerMidEdge2 = innerLeftEdge + 4;
+		unsigned int innerMidEdge3 = innerLeftEdge + 5;
 
-		//Saves the existing outer edges before we update their pointers
-		HalfEdge* oldLeftEdge1 = m_faces[i]->edge;
-		HalfEdge* oldTopEdge1 = m_faces[i]->edge->next;
-		HalfEdge* oldTopEdge2 = m_faces[i]->edge->next->next;
-		HalfEdge* oldRightEdge1 = m_faces[i]->edge->next->next->next;
-		HalfEdge* oldRightEdge2 = m_faces[i]->edge->next->next->next->next;
-		HalfEdge* oldLeftEdge2 = m_faces[i]->edge->next->next->next->next->next;
+		//Saves the existing outer edges before we update their next indices
+		unsigned int oldLeftEdge1 = m_halfEdgeData.faceEdge[i];
+		unsigned int oldTopEdge1 = m_halfEdgeData.edgeNext[oldLeftEdge1];
+		unsigned int oldTopEdge2 = m_halfEdgeData.edgeNext[oldTopEdge1];
+		unsigned int oldRightEdge1 = m_halfEdgeData.edgeNext[oldTopEdge2];
+		unsigned int oldRightEdge2 = m_halfEdgeData.edgeNext[oldRightEdge1];
+		unsigned int oldLeftEdge2 = m_halfEdgeData.edgeNext[oldRightEdge2];
 
 
 		/*
-			Gets the right vertex as start point for the the new inner edges and link them to the right other edges and update their pair pointer.
-			Update the outer edges next pointers and associate a face to an edge which forms a triangle
+			Gets the right vertex as start point for the the new inner edges and link them to the right other edges and update their pair.
+			Update the outer edges next and associate a face to an edge which forms a triangle.
+			The vertex edges are left as they are. Every vertex already has a half-edge starting from it after splitting
+			and a midpoint is shared by two faces which could be handled by different threads
 		*/
 		//Connectivity for inner edges
 		//Bottom left face
-		innerLeftEdge->origin = oldTopEdge1->origin;  //vertex to vertex
-		innerLeftEdge->origin->edge = innerLeftEdge; //associate halfedge to vertex
+		m_halfEdgeData.edgeOrigin[innerLeftEdge] = m_halfEdgeData.edgeOrigin[oldTopEdge1];  //vertex to vertex
 
 		//connectivity
-		innerLeftEdge->next = oldLeftEdge2;
-		oldLeftEdge1->next = innerLeftEdge;
+		m_halfEdgeData.edgeNext[innerLeftEdge] = oldLeftEdge2;
+		m_halfEdgeData.edgeNext[oldLeftEdge1] = innerLeftEdge;
 
-		innerLeftEdge->face = leftFace;
+		m_halfEdgeData.edgeFace[innerLeftEdge] = leftFace;
 
-		innerLeftEdge->pair = innerMidEdge2;
-		innerMidEdge2->pair = innerLeftEdge;
+		m_halfEdgeData.edgePair[innerLeftEdge] = innerMidEdge2;
+		m_halfEdgeData.edgePair[innerMidEdge2] = innerLeftEdge;
 
 		//Top face
-		topFace->edge = oldTopEdge1;
-		innerTopEdge->origin = oldRightEdge1->origin;
-		innerTopEdge->origin->edge = innerTopEdge;
+		m_halfEdgeData.faceEdge[topFace] = oldTopEdge1;
+		m_halfEdgeData.edgeOrigin[innerTopEdge] = m_halfEdgeData.edgeOrigin[oldRightEdge1];
 
 		//connectivity
-		innerTopEdge->next = oldTopEdge1;
-		oldTopEdge2->next = innerTopEdge;
+		m_halfEdgeData.edgeNext[innerTopEdge] = oldTopEdge1;
+		m_halfEdgeData.edgeNext[oldTopEdge2] = innerTopEdge;
 
-		oldTopEdge1->face = topFace;
-		oldTopEdge2->face = topFace;
-		innerTopEdge->face = topFace;
+		m_halfEdgeData.edgeFace[oldTopEdge1] = topFace;
+		m_halfEdgeData.edgeFace[oldTopEdge2] = topFace;
+		m_halfEdgeData.edgeFace[innerTopEdge] = topFace;
 
-		innerTopEdge->pair = innerMidEdge3;
-		innerMidEdge3->pair = innerTopEdge;
+		m_halfEdgeData.edgePair[innerTopEdge] = innerMidEdge3;
+		m_halfEdgeData.edgePair[innerMidEdge3] = innerTopEdge;
 
 		//Bottom right face
-		rightFace->edge = innerRightEdge;
-		innerRightEdge->origin = oldLeftEdge2->origin;
-		innerRightEdge->origin->edge = innerRightEdge;
+		m_halfEdgeData.faceEdge[rightFace] = innerRightEdge;
+		m_halfEdgeData.edgeOrigin[innerRightEdge] = m_halfEdgeData.edgeOrigin[oldLeftEdge2];
 
 		//inner->oldright1->oldright2->inner
-		innerRightEdge->next = oldRightEdge1;
-		oldRightEdge2->next = innerRightEdge;
+		m_halfEdgeData.edgeNext[innerRightEdge] = oldRightEdge1;
+		m_halfEdgeData.edgeNext[oldRightEdge2] = innerRightEdge;
 
-		oldRightEdge1->face = rightFace;
-		oldRightEdge2->face = rightFace;
-		innerRightEdge->face = rightFace;
+		m_halfEdgeData.edgeFace[oldRightEdge1] = rightFace;
+		m_halfEdgeData.edgeFace[oldRightEdge2] = rightFace;
+		m_halfEdgeData.edgeFace[innerRightEdge] = rightFace;
 
-		innerRightEdge->pair = innerMidEdge1;
-		innerMidEdge1->pair = innerRightEdge;
+		m_halfEdgeData.edgePair[innerRightEdge] = innerMidEdge1;
+		m_halfEdgeData.edgePair[innerMidEdge1] = innerRightEdge;
 
 		//Middle face
-		middleFace->edge = innerMidEdge1;
-		innerMidEdge1->origin = oldRightEdge1->origin;
-		innerMidEdge1->origin->edge = innerMidEdge1;
-		innerMidEdge1->next = innerMidEdge2;
+		m_halfEdgeData.faceEdge[middleFace] = innerMidEdge1;
+		m_halfEdgeData.edgeOrigin[innerMidEdge1] = m_halfEdgeData.edgeOrigin[oldRightEdge1];
+		m_halfEdgeData.edgeNext[innerMidEdge1] = innerMidEdge2;
+
+		m_halfEdgeData.edgeOrigin[innerMidEdge2] = m_halfEdgeData.edgeOrigin[oldLeftEdge2];
+		m_halfEdgeData.edgeNext[innerMidEdge2] = innerMidEdge3;
 
-		innerMidEdge2->origin = oldLeftEdge2->origin;
-		innerMidEdge2->origin->edge = innerMidEdge2;
-		innerMidEdge2->next = innerMidEdge3;
+		m_halfEdgeData.edgeOrigin[innerMidEdge3] = m_halfEdgeData.edgeOrigin[oldTopEdge1];
+		m_halfEdgeData.edgeNext[innerMidEdge3] = innerMidEdge1;
 
-		innerMidEdge3->origin = oldTopEdge1->origin;
-		innerMidEdge3->origin->edge = innerMidEdge3;
-		innerMidEdge3->next = innerMidEdge1;
+		m_halfEdgeData.edgeFace[innerMidEdge1] = middleFace;
+		m_halfEdgeData.edgeFace[innerMidEdge2] = middleFace;
+		m_halfEdgeData.edgeFace[innerMidEdge3] = middleFace;
+	}
+}
+
+void HalfEdgeMesh::updateHalfEdgeMesh()
+{
+	//Vertices are identified by their index in the pool so the vertex lists can be copied straight to the rendering lists
+	m_verticesHE = m_halfEdgeData.vertexPos;
+	m_uvsHE = m_halfEdgeData.vertexUv;
+	m_normalsHE = m_halfEdgeData.vertexNormal;
+
+	//Three indices per face. Each face writes its own part of the list
+	m_indicesHE.resize(m_halfEdgeData.faceCount() * 3);
+	runSubdivisionPhase(m_halfEdgeData.faceCount(), &HalfEdgeMesh::updateTriangleIndices);
+}
 
-		innerMidEdge1->face = middleFace;
-		innerMidEdge2->face = middleFace;
-		innerMidEdge3->face = middleFace;
+void HalfEdgeMesh::uploadHalfEdgeMesh()
+{
+	//Interleave the vertex data so the whole vertex is sent with one call
+	m_vertexFormat.pack(m_verticesHE, m_uvsHE, m_normalsHE, m_packedVerticesHE);
 
+	//Bind the VAO so the EBO binding below doesn't change another VAO
+	m_glFunctions->glBindVertexArray(m_halfEdgeVAO);
 
+	//Bind VBO to make it current
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_halfEdgeVBO);
+	//Set the usage type, allocate VRAM and send the vertex data to the GPU
+	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_packedVerticesHE.size(), &m_packedVerticesHE[0], GL_STATIC_DRAW);
 
-		m_faces.push_back(topFace);
-		m_faces.push_back(rightFace);
-		m_faces.push_back(middleFace);
+	//Bind EBO to make it current
+	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_halfEdgeIndicesEBO);
+	//Set the usage type, allocate VRAM and send the vertex data to the GPU
+	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indicesHE.size() * sizeof(unsigned int), &m_indicesHE[0], GL_STATIC_DRAW);
 
-		m_halfEdges.push_back(innerLeftEdge);
-		m_halfEdges.push_back(innerTopEdge);
-		m_halfEdges.push_back(innerRightEdge);
-		m_halfEdges.push_back(innerMidEdge1);
-		m_halfEdges.push_back(innerMidEdge2);
-		m_halfEdges.push_back(innerMidEdge3);
-	}
+	m_glFunctions->glBindVertexArray(0);
 }
 
-void HalfEdgeMesh::updateHalfEdgeMesh()
+void HalfEdgeMesh::updateTriangleIndices(unsigned int begin, unsigned int end)
 {
-	//Clears the lists of any vertices
-	m_verticesHE.clear();
-	m_uvsHE.clear();
-	m_normalsHE.clear();
-	m_indicesHE.clear();
-
-	//Using map to speed up the generation of index list
-	std::map<const Vertex*, unsigned int> indexMap;
-
-	//Puts data from halfedge vertex list into rendering lists.
-	//Puts vertex into the map associated with an index
-	for (int i = 0; i < m_vertexData.size();i++){
-		m_verticesHE.push_back(m_vertexData[i]->pos);
-		m_uvsHE.push_back(m_vertexData[i]->uv);
-		m_normalsHE.push_back(m_vertexData[i]->normal);
-
-		indexMap[m_vertexData[i]] = i;
-	}
-	//Iterating faces to find which three vertices form a triangle. Checks in the map for the vertex to find the index.
+	//Iterating faces to find which three vertices form a triangle. The origin of a half-edge is already the index of the vertex.
 	//This will create indices list for rendering
-	for (int i = 0; i < m_faces.size(); i++){
-		unsigned int index;
-		std::map<const Vertex*, unsigned int>::iterator it;
-		it = indexMap.find(m_faces[i]->edge->origin);
-		index = it->second;
-		m_indicesHE.push_back(index);
-
-		it = indexMap.find(m_faces[i]->edge->next->origin);
-		index = it->second;
-		m_indicesHE.push_back(index);
-
-		it = indexMap.find(m_faces[i]->edge->next->next->origin);
-		index = it->second;
-		m_indicesHE.push_back(index);
+	for (unsigned int i = begin; i < end; i++){
+		unsigned int edge = m_halfEdgeData.faceEdge[i];
+		m_indicesHE[3 * i] = m_halfEdgeData.edgeOrigin[edge];
+
+		edge = m_halfEdgeData.edgeNext[edge];
+		m_indicesHE[3 * i + 1] = m_halfEdgeData.edgeOrigin[edge];
+
+		edge = m_halfEdgeData.edgeNext[edge];
+		m_indicesHE[3 * i + 2] = m_halfEdgeData.edgeOrigin[edge];
 	}
 }
 
@@ -1125,17 +1077,14 @@ void HalfEdgeMesh::releaseWireframeOriginalMesh()
 	m_glFunctions->glDeleteBuffers(1, &m_originalVAO);
 }
 
-void HalfEdgeMesh::drawWireframeOriginalMesh(const Matrix44& model, const Matrix44& view, const Matrix44& projection)
+void HalfEdgeMesh::drawWireframeOriginalMesh(UniformBuffers& uniforms, const Matrix44& model)
 {
 	m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//Bind the shaders to be used
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 12);
+	m_shaderProgram->useMode(WireframeMode);
 
-	//Mvp
-	Matrix44 mvp = projection * view * model;
-
-	//Send the mvp matrix to the vertex shader
-	m_glFunctions->glUniformMatrix4fv(m_mvpLocation, 1, GL_TRUE, &mvp[0][0]);
+	//Send the model matrix to the vertex shader
+	uniforms.setObject(model);
 
 	//Bind this mesh VAO
 	m_glFunctions->glBindVertexArray(m_originalVAO);
@@ -1148,29 +1097,30 @@ void HalfEdgeMesh::drawWireframeOriginalMesh(const Matrix44& model, const Matrix
 	m_glFunctions->glBindVertexArray(0);
 }
 
-void HalfEdgeMesh::calculateNormals()
+void HalfEdgeMesh::calculateNormals(unsigned int begin, unsigned int end)
 {
+	//Will store all the neighbors found. Reused for every vertex in the range to not allocate a list per vertex
+	std::vector<unsigned int> neighbors;
+
 	//Limit Normals
-	for (int i = 0; i < m_vertexData.size(); i++){
-		//Get the vertex to which we will calculate its new position
-		Vertex* vertex = m_vertexData[i];
+	for (unsigned int i = begin; i < end; i++){
 		//Get the half-edge of the vertex we are working on
-		HalfEdge* halfedge = m_vertexData[i]->edge;
+		unsigned int halfedge = m_halfEdgeData.vertexEdge[i];
 
-		//Will store all the neighbors found
-		std::vector<Vertex*> neighbors;
+		neighbors.clear();
 		//Traverser, traversing all neighbors of the vertex
-		HalfEdge* traverser = halfedge->next;
+		unsigned int start = m_halfEdgeData.edgeNext[halfedge];
+		unsigned int traverser = start;
 
 		//Do until halfedge is same as start halfedge
 		do
 		{
 			//Handle current neighbor vertex
-			neighbors.push_back(traverser->origin);
+			neighbors.push_back(m_halfEdgeData.edgeOrigin[traverser]);
 
-			//Update traverse pointer to next neighbor
-			traverser = traverser->next->pair->next;
-		} while (traverser != halfedge->next);
+			//Update traverser to next neighbor
+			traverser = m_halfEdgeData.edgeNext[m_halfEdgeData.edgePair[m_halfEdgeData.edgeNext[traverser]]];
+		} while (traverser != start);
 
 		//Amount of neighbors around the vertex
 		float n = neighbors.size();
@@ -1180,12 +1130,12 @@ void HalfEdgeMesh::calculateNormals()
 		//Tangent vector 2
 		Vector3 t2;
 
-		for (int i = 0; i < neighbors.size(); i++){
-			t1 += cos((2.0 * MyPersonalMathLibraryConstants::PI*i) / n) * neighbors[i]->pos;
-			t2 += sin((2.0 * MyPersonalMathLibraryConstants::PI*i) / n) * neighbors[i]->pos;
+		for (int j = 0; j < neighbors.size(); j++){
+			t1 += cos((2.0 * MyPersonalMathLibraryConstants::PI*j) / n) * m_halfEdgeData.vertexPos[neighbors[j]];
+			t2 += sin((2.0 * MyPersonalMathLibraryConstants::PI*j) / n) * m_halfEdgeData.vertexPos[neighbors[j]];
 		}
 		//Limit normal using cross product
-		vertex->normal = t1.Cross(t2);
+		m_halfEdgeData.vertexNormal[i] = t1.Cross(t2);
 	}
 }
 
@@ -6,6 +6,18 @@
 #include "Transform.h"
 //For class representing key for map in the vertex indexing algorithm
 #include "PackedVertex.h"
+//Finds duplicate vertices in the vertex indexing algorithm
+#include "VertexWelder.h"
+//Parses the obj files
+#include "ObjLoader.h"
+//Interleaved layout of the vertices in the VBO
+#include "VertexFormat.h"
+//Hardware occlusion queries of the boxes around the meshes
+#include "OcclusionQueries.h"
+//The model matrix and material are sent in the ObjectBlock
+#include "UniformBuffers.h"
+//Variants of the uber-shader, one per shader branch
+#include "ShaderProgram.h"
 
 //For opening files
 #include <stdio.h>
@@ -13,9 +25,9 @@
 
 
 //Half-Edge Data Structure
-#include "Face.h"
-#include "HalfEdge.h"
-#include "Vertex.h"
+#include "HalfEdgeData.h"
+//Used to split the subdivision across threads
+#include "ParallelFor.h"
 
 #include <QTime>
 //Used to save mesh to file
@@ -41,7 +53,7 @@ public:
 	/// <summary>Constructor</summary>
 	/// <param name="functions">Enables the class to call openGL functions</param>
 	/// <returns></returns>
-	HalfEdgeMesh(QOpenGLFunctions_3_3_Core* functions);
+	HalfEdgeMesh(GLStateCache* functions);
 	/// <summary>Destructor</summary>
 	/// <returns></returns>
 	~HalfEdgeMesh();
@@ -49,10 +61,12 @@ public:
 	/// <summary>Does nothing with this class. Just calls its childrens' update</summary>
 	/// <param name="view">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="model">Is not handled in this class, just forwards it to its children</param>
+	/// <param name="isParentChanged">Is not handled in this class, just forwards it to its children</param>
 	/// <returns>void</returns>
-	void update(Matrix44& view, const Matrix44& model = Matrix44());
+	void update(Matrix44& view, const Matrix44& model = Matrix44(), bool isParentChanged = true);
 	/// <summary>Check the bounding sphere of the mesh if it's inside the view frustum. Draw the mesh if it's inside. And then calls the childrens' draw</summary>
 	/// <param name="frustumCheck">Has the view frustum planes and function to check if bounding sphere is inside of the frustum</param>
+	/// <param name="drawContext">State of the pass being drawn, like the occlusion queries the mesh is tested with</param>
 	/// <param name="projection">a projection matrix</param>
 	/// <param name="view">a view matrix</param>
 	/// <param name="shaderBranch">Will have the ID of current shader branch. If value is -1 draw call will not draw wireframes.
@@ -61,11 +75,19 @@ public:
 	/// <param name="model">a model matrix</param>
 	/// <param name="bvScaleFactor">Scale factor used to scale the bounding sphere's radius</param>
 	/// <returns>void</returns>
-	void draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program to be used to render the object with</summary>
-	/// <summary>Specify which ID of shader program to use</summary>
-	/// <param name="shaderProgram">ID of a shader program</param>
+	void draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program to be used to render the object with</summary>
+	/// <summary>Merges the world space bounding sphere of the mesh into bounds</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="bounds">Sphere the bounding sphere is merged into</param>
+	/// <returns>void</returns>
+	void getBounds(const Matrix44& model, BoundingSphere& bounds);
+	/// <summary>Returns true once after the bounding sphere has been recalculated by loading or subdividing the mesh</summary>
+	/// <returns>bool</returns>
+	bool boundsChanged();
+	/// <summary>Specify which shader program to use</summary>
+	/// <param name="shaderProgram">a shader program with a variant per shader branch</param>
 	/// <returns>void</returns>
-	void useShaderProgram(GLuint shaderProgram);
+	void useShaderProgram(ShaderProgram* shaderProgram);
 	/// <summary>Assign a texture to be used to render the object with</summary>
 	/// <param name="textureID">ID of a shader program</param>
 	/// <returns>void</returns>
@@ -106,6 +128,14 @@ public:
 	/// <param name="flag">On or Off</param>
 	/// <returns>void</returns>
 	void setWireframeBV(bool flag);
+	/// <summary>Sets how close vertex data has to be for indexVBO to merge two vertices. Has to be set before the obj file is loaded</summary>
+	/// <param name="epsilon">Cell size the vertex data is quantized to. 0 only merges vertices which are exactly the same</param>
+	/// <returns>void</returns>
+	void setWeldEpsilon(float epsilon);
+	/// <summary>Sets how the vertex attributes are stored in the VBO. Has to be set before the obj file is loaded</summary>
+	/// <param name="flags">VertexFormatFlags combined with |</param>
+	/// <returns>void</returns>
+	void setVertexFormat(unsigned int flags);
 	/// <summary>Sets a flag if wireframe for original mesh should be rendered</summary>
 	/// <param name="flag">On or Off</param>
 	/// <returns>void</returns>
@@ -127,27 +157,34 @@ public:
 	/// <summary>Subdivides the mesh, calculats the new normals and bounding sphere. Update the lists for rendering</summary>
 	/// <returns>void</returns>
 	void subdivide();
+	/// <summary>Sets a flag if the subdivision phases should be split across the thread pool. Result is the same either way</summary>
+	/// <param name="flag">On or Off</param>
+	/// <returns>void</returns>
+	void setParallelSubdivision(bool flag);
 	/// <summary>Saves the mesh as obj file to computer</summary>
 	/// <param name="renderWindow">The GUI QT widget which called the function</param>
 	/// <returns>void</returns>
 	void saveMeshToFile(QWidget* renderWindow);
 
 private:
-	//Handles for shader uniforms
-	GLuint m_shaderModeLocation; //Uniform to select a shader branch from the uber-shader
-	GLuint m_skyBoxSamplerLocation;
-	GLuint m_textureSamplerLocation;
-	GLuint m_ambientMaterialLocation;
-	GLuint m_specularMaterialLocation;
-	GLuint m_shininessLocation;
-
-	GLuint m_mvpLocation;
-	GLuint m_modelLocation;
-	GLuint m_viewLocation;
-	GLuint m_modelViewLocation;
-
 	//Subdivision Timer
 	QTime m_subdivisionTimer; //Timer to check how long it takes to subdivide
+	//Flag if the subdivision phases are run on the thread pool
+	bool m_isParallelSubdivision;
+
+	//Amount of vertices, half-edges and faces before the subdivision in progress
+	unsigned int m_oldVertexCount;
+	unsigned int m_oldHalfEdgeCount;
+	unsigned int m_oldFaceCount;
+	//Amount of edges before the subdivision in progress. Same as the amount of new vertices
+	unsigned int m_oldEdgeCount;
+	//For each half-edge, the amount of edges owned by the half-edges before it. Decides the index of the midpoint vertex and the split half-edges
+	std::vector<unsigned int> m_edgeRanks;
+	//Amount of edges owned by the half-edges in each block. Prefix summed to get the rank the block starts at
+	std::vector<unsigned int> m_blockEdgeCounts;
+	//Bounds of the vertices in each block and their farthest distance from the center point. Merged to get the bounding sphere
+	std::vector<PointBounds> m_blockBounds;
+	std::vector<float> m_blockRadii;
 
 	//vertices, uvs, normals, indices for original mesh
 	std::vector<Vector3> m_verticesOriginal;
@@ -170,47 +207,49 @@ private:
 	//VBO Vertices bounding sphere
 	GLuint m_wireframeBvVBO;
 
-	//Half-Edge mesh data structure
-	std::vector<Vertex*> m_vertexData;
-	std::vector<HalfEdge*> m_halfEdges;
-	std::vector<Face*> m_faces;
+	//Half-Edge mesh data structure. Vertices, half-edges and faces are stored in pools and refer to each other by index
+	HalfEdgeData m_halfEdgeData;
 
 	//The lists to send to VRAM which are made from half-edge mesh. Updated each subdivision
 	std::vector<Vector3> m_verticesHE;
 	std::vector<Vector2> m_uvsHE;
 	std::vector<Vector3> m_normalsHE;
 	std::vector<unsigned int> m_indicesHE;
+	//m_verticesHE, m_uvsHE and m_normalsHE interleaved in the layout of m_vertexFormat
+	std::vector<unsigned char> m_packedVerticesHE;
+	//Layout of the interleaved vertices in the VBO
+	VertexFormat m_vertexFormat;
 
 	//VAO
 	GLuint m_halfEdgeVAO;
-	//VBO Vertices
-	GLuint m_halfEdgeVerticesVBO;
-	//VBO UVS
-	GLuint m_halfEdgeUvsVBO;
-	//VBO Normals
-	GLuint m_halfEdgeNormalsVBO;
+	//VBO Interleaved vertices
+	GLuint m_halfEdgeVBO;
 	//EBO Indices
 	GLuint m_halfEdgeIndicesEBO;
 
 
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
 	//Holds the texture that should be used by this mesh
 	GLuint m_textureID;
 
 	//Holds the shader program that should be used by this mesh
-	GLuint m_shaderProgram;
+	ShaderProgram* m_shaderProgram;
 
 	//Center Point of bounding sphere in model space
 	Vector3 m_centerPointBV;
 	//Radius of bounding sphere
 	float m_radiusBV;
+	//Cell size used by indexVBO to merge vertices which are almost the same. 0 only merges exact duplicates
+	float m_weldEpsilon;
 
 	//Flags for rendering different features
 	bool m_isWireframe;
 	bool m_isPlayer;
 	bool m_isFrustumCulling;
+	//Set when the bounding sphere is recalculated. Cleared when the parent transform asks for it
+	bool m_isBoundsChanged;
 	bool m_isWireframeBV;
 	bool m_isSkybox;
 	bool m_isWireFrameOriginalMesh;
@@ -221,12 +260,6 @@ private:
 	float m_shininess;
 
 
-	/// <summary>Used by indexVBO function to compare a vertex with vertices in a list. If one is found in the list. Function returns true and result parameter will hold the index of the vertex found in the list</summary>
-	/// <param name="packed">Holds vertex data for one vertex</param>
-	/// <param name="VertexToOutIndex">List of vertices as keys associated with their index as value</param>
-	/// <param name="result">Stores the index of vertex found in VertexToOutIndex list</param>
-	/// <returns>bool</returns>
-	bool getSimilarVertexIndex(PackedVertex& packed, std::map<PackedVertex, unsigned int>& VertexToOutIndex, unsigned int& result);
 	/// <summary>Vertex indexing. Generates lists of vertices with no duplicates. An indices list is also generated to tell which vertices should form a triangle.</summary>
 	/// <param name="in_vertices">list of vertices to index</param>
 	/// <param name="in_uvs">list of uvs to index</param>
@@ -238,40 +271,93 @@ private:
 	/// <summary>Calculates a center point for the mesh and calculates the radius from the centerpoint which will encapsulate the whole object</summary>
 	/// <returns>void</returns>
 	void calculateBoundingSphere();
+	/// <summary>Calculates the bounds of the vertices in a range of blocks. Called from worker threads</summary>
+	/// <param name="begin">First block</param>
+	/// <param name="end">One past the last block</param>
+	/// <returns>void</returns>
+	void calculateBlockBounds(unsigned int begin, unsigned int end);
+	/// <summary>Calculates the farthest distance from the center point of the vertices in a range of blocks. Called from worker threads</summary>
+	/// <param name="begin">First block</param>
+	/// <param name="end">One past the last block</param>
+	/// <returns>void</returns>
+	void calculateBlockRadii(unsigned int begin, unsigned int end);
 	/// <summary>Draws the wireframe bounding sphere for this mesh</summary>
-	/// <param name="view">a view matrix</param>
-	/// <param name="projection">a projection matrix</param>
+	/// <param name="uniforms">Buffers the model matrix of the sphere is sent with</param>
 	/// <param name="position">position of the bounding sphere</param>
 	/// <param name="radius">radius of the bounding sphere</param>
 	/// <returns>void</returns>
-	void drawWireframeBoundingSphere(const Matrix44& view, const Matrix44& projection, Vector3 position, float radius);
+	void drawWireframeBoundingSphere(UniformBuffers& uniforms, Vector3 position, float radius);
 	/// <summary>Draws the wireframe original mesh</summary>
+	/// <param name="uniforms">Buffers the model matrix is sent with</param>
 	/// <param name="model">model matrix</param>
-	/// <param name="view">view matrix</param>
-	/// <param name="projection">projection matrix</param>
 	/// <returns>void</returns>
-	void drawWireframeOriginalMesh(const Matrix44& model, const Matrix44& view, const Matrix44& projection);
+	void drawWireframeOriginalMesh(UniformBuffers& uniforms, const Matrix44& model);
 	
+	/// <summary>Runs a subdivision phase over all elements. Either on the calling thread or split across the thread pool</summary>
+	/// <param name="count">Amount of elements</param>
+	/// <param name="phase">Member function handling the elements in a range</param>
+	/// <param name="minRangeSize">Smallest range worth handing to a thread</param>
+	/// <returns>void</returns>
+	void runSubdivisionPhase(unsigned int count, RangeKernel<HalfEdgeMesh>::Function phase, unsigned int minRangeSize = 4096);
+	/// <summary>Decides the indices of all vertices, half-edges and faces the subdivision creates and resizes the pools to the exact size.
+	///Each edge is owned by the half-edge of the pair with the lowest index. The midpoint vertex and split half-edges of an edge are placed by the rank of its owner.
+	///Each face is split into 4 faces and gets 6 new inner half-edges, placed by the index of the face</summary>
+	/// <returns>void</returns>
+	void assignSubdivisionIndices();
+	/// <summary>Counts the edges owned by the half-edges in a range of blocks</summary>
+	/// <param name="begin">First block</param>
+	/// <param name="end">One past the last block</param>
+	/// <returns>void</returns>
+	void countEdgeOwners(unsigned int begin, unsigned int end);
+	/// <summary>Sets the rank of each half-edge in a range of blocks starting from the prefix summed block counts</summary>
+	/// <param name="begin">First block</param>
+	/// <param name="end">One past the last block</param>
+	/// <returns>void</returns>
+	void rankEdgeOwners(unsigned int begin, unsigned int end);
+	/// <summary>Checks if a half-edge owns its edge. Uses the ranks so it's still valid after the half-edges have been split</summary>
+	/// <param name="halfEdge">Index of an half-edge from before the subdivision</param>
+	/// <returns>bool</returns>
+	bool isEdgeOwner(unsigned int halfEdge) const;
 	/// <summary>Calculates new position for existing vertices and save it in the newPos field of the vertex</summary>
+	/// <param name="begin">First vertex</param>
+	/// <param name="end">One past the last vertex</param>
 	/// <returns>void</returns>
-	void calculateOldVerticesPosition();
-	/// <summary>Create a new vertex for each half-edge and calculates its position Saves it in a field for half edge</summary>
+	void calculateOldVerticesPosition(unsigned int begin, unsigned int end);
+	/// <summary>Calculates the position of the new midpoint vertex of each edge. Saves it in the midpoint field for both half-edges</summary>
+	/// <param name="begin">First half-edge</param>
+	/// <param name="end">One past the last half-edge</param>
 	/// <returns>void</returns>
-	void calculateMidpointPosition();
+	void calculateMidpointPosition(unsigned int begin, unsigned int end);
 	/// <summary>Split halfedges into two. The existing is updated and a new halfedge is created</summary>
+	/// <param name="begin">First half-edge</param>
+	/// <param name="end">One past the last half-edge</param>
 	/// <returns>void</returns>
-	void splitHalfEdges();
+	void splitHalfEdges(unsigned int begin, unsigned int end);
 	/// <summary>Updates all vertices position by setting the position = new position</summary>
+	/// <param name="begin">First vertex</param>
+	/// <param name="end">One past the last vertex</param>
 	/// <returns>void</returns>
-	void updateVertexPositions();
+	void updateVertexPositions(unsigned int begin, unsigned int end);
 	/// <summary>Create new faces and inner edges and connect everything</summary>
+	/// <param name="begin">First face</param>
+	/// <param name="end">One past the last face</param>
 	/// <returns>void</returns>
-	void updateConnectivity();
+	void updateConnectivity(unsigned int begin, unsigned int end);
 	/// <summary>Update lists for rendering and vbos</summary>
 	/// <returns>void</returns>
 	void updateHalfEdgeMesh();
+	/// <summary>Interleaves the lists made by updateHalfEdgeMesh and sends them to the VBO and EBO</summary>
+	/// <returns>void</returns>
+	void uploadHalfEdgeMesh();
+	/// <summary>Writes the three vertex indices of each face to the indices list for rendering</summary>
+	/// <param name="begin">First face</param>
+	/// <param name="end">One past the last face</param>
+	/// <returns>void</returns>
+	void updateTriangleIndices(unsigned int begin, unsigned int end);
 	/// <summary>Calculates normals for mesh</summary>
+	/// <param name="begin">First vertex</param>
+	/// <param name="end">One past the last vertex</param>
 	/// <returns>void</returns>
-	void calculateNormals();
+	void calculateNormals(unsigned int begin, unsigned int end);
 };
 #endif // HalfEdgeMesh_h__
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "Light.h"
 
-Light::Light(QOpenGLFunctions_3_3_Core* functions)
+Light::Light(GLStateCache* functions)
 {
 	m_glFunctions = functions;
 	//Set default Light properties
@@ -16,7 +16,7 @@ Light::~Light()
 	m_children.clear();
 }
 
-void Light::update(Matrix44& view, const Matrix44& model)
+void Light::update(Matrix44& view, const Matrix44& model, bool isParentChanged)
 {	
 	//Get parent's model matrix
 	Matrix44 parent_Transform = model;
@@ -26,6 +26,10 @@ void Light::update(Matrix44& view, const Matrix44& model)
 	Vector4 worldSpaceLightPosition = parent_Transform * lightPos;
 	m_lightPosition.Insert(worldSpaceLightPosition[0], worldSpaceLightPosition[1], worldSpaceLightPosition[2]);
 
+	//The children have the same parent model matrix as this
+	isParentChanged = isParentChanged || m_isParentChanged;
+	m_isParentChanged = false;
+
 	//Calls the childrens' update
 	if (!m_children.empty())
 	{
@@ -33,19 +37,19 @@ void Light::update(Matrix44& view, const Matrix44& model)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->update(view, model);
+				m_children[i]->update(view, model, isParentChanged);
 			}
 		}
 	}
 }
 
-void Light::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
+void Light::draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
 {
-	//Send Light properties to shader uniforms
-	m_glFunctions->glUniform3fv(m_lightPosLocation, 1, &m_lightPosition[0]);
-	m_glFunctions->glUniform3fv(m_lightColorLocation, 1, &m_lightColor[0]);
-	m_glFunctions->glUniform1f(m_lightIntensityLocation, m_lightIntensity);
-	m_glFunctions->glUniform1f(m_lightMaxRadiusLocation, m_maxLightRadius);
+	//Send Light properties to shader uniforms of the variant in use. Variants which don't use a property have -1 as location and ignore it
+	m_glFunctions->glUniform3fv(m_shaderProgram->getLocation(m_lightPosUniform), 1, &m_lightPosition[0]);
+	m_glFunctions->glUniform3fv(m_shaderProgram->getLocation(m_lightColorUniform), 1, &m_lightColor[0]);
+	m_glFunctions->glUniform1f(m_shaderProgram->getLocation(m_lightIntensityUniform), m_lightIntensity);
+	m_glFunctions->glUniform1f(m_shaderProgram->getLocation(m_lightMaxRadiusUniform), m_maxLightRadius);
 
 	//Calls the childrens' draw
 	if (!m_children.empty())
@@ -54,21 +58,21 @@ void Light::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, con
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->draw(frustumCheck, projection, view, shaderBranch, lightView, model, bvScaleFactor);
+				m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, model, bvScaleFactor);
 			}
 		}
 	}
 }
 
-void Light::useShaderProgram(GLuint shaderProgram)
+void Light::useShaderProgram(ShaderProgram* shaderProgram)
 {
 	m_shaderProgram = shaderProgram;
 
 	//Get handles for shader uniforms
-	m_lightPosLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "LightPosition_worldspace");
-	m_lightColorLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "LightColor");
-	m_lightIntensityLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "LightIntensity");
-	m_lightMaxRadiusLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "maxLightRadius");
+	m_lightPosUniform = m_shaderProgram->addUniform("LightPosition_worldspace");
+	m_lightColorUniform = m_shaderProgram->addUniform("LightColor");
+	m_lightIntensityUniform = m_shaderProgram->addUniform("LightIntensity");
+	m_lightMaxRadiusUniform = m_shaderProgram->addUniform("maxLightRadius");
 }
 
 void Light::setLightColor(float r, float g, float b)
@@ -85,3 +89,23 @@ void Light::setMaxLightRadius(float scaleFactor)
 {
 	m_maxLightRadius = scaleFactor;
 }
+
+Vector3 Light::getLightPosition() const
+{
+	return m_lightPosition;
+}
+
+Vector3 Light::getLightColor() const
+{
+	return m_lightColor;
+}
+
+float Light::getLightIntensity() const
+{
+	return m_lightIntensity;
+}
+
+float Light::getMaxLightRadius() const
+{
+	return m_maxLightRadius;
+}
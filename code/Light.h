@@ -3,6 +3,8 @@
 
 #include "Node.h"
 #include "Transform.h"
+//The light properties are set on the variant of the uber-shader in use
+#include "ShaderProgram.h"
 
 /// <remarks>
 ///Represents a Light
@@ -13,7 +15,7 @@ public:
 	/// <summary>Constructor</summary>
 	/// <param name="functions">Enables the class to call openGL functions</param>
 	/// <returns></returns>
-	Light(QOpenGLFunctions_3_3_Core* functions);
+	Light(GLStateCache* functions);
 	/// <summary>Destructor</summary>
 	/// <returns></returns>
 	~Light();
@@ -21,10 +23,12 @@ public:
 	/// <summary>Updates the Light's world position and store it. And then call its children</summary>
 	/// <param name="view">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="model">Multiplies this with its position vector, and forwards it to its children</param>
+	/// <param name="isParentChanged">Is not handled in this class, just forwards it to its children</param>
 	/// <returns>void</returns>
-	void update(Matrix44& view, const Matrix44& model = Matrix44());
+	void update(Matrix44& view, const Matrix44& model = Matrix44(), bool isParentChanged = true);
 	/// <summary>Sends Light Properties(Postion, Color, Intensity, Max radius of light) to shader uniforms. And then calls the childrens' draw</summary>
 	/// <param name="frustumCheck">Is not handled in this class, just forwards it to its children</param>
+	/// <param name="drawContext">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="projection">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="view">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="shaderBranch">Is not handled in this class, just forwards it to its children</param>
@@ -32,11 +36,11 @@ public:
 	/// <param name="model">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="bvScaleFactor">Is not handled in this class, just forwards it to its children</param>
 	/// <returns>void</returns>
-	void draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program the light should use to send the light position</summary>
-	/// <summary>Specify which ID of shader program to use</summary>
-	/// <param name="shaderProgram">ID of a shader program</param>
+	void draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program the light should use to send the light position</summary>
+	/// <summary>Specify which shader program to use</summary>
+	/// <param name="shaderProgram">a shader program with a variant per shader branch</param>
 	/// <returns>void</returns>
-	void useShaderProgram(GLuint shaderProgram);
+	void useShaderProgram(ShaderProgram* shaderProgram);
 	/// <summary>Sets the Color of the light</summary>
 	/// <param name="r">red</param>
 	/// <param name="g">green</param>
@@ -51,13 +55,25 @@ public:
 	/// <param name="scaleFactor">Scale Factor</param>
 	/// <returns>void</returns>
 	void setMaxLightRadius(float scaleFactor);
+	/// <summary>Returns the Light's position in world space from the last update</summary>
+	/// <returns>Vector3</returns>
+	Vector3 getLightPosition() const;
+	/// <summary>Returns the Color of the light</summary>
+	/// <returns>Vector3</returns>
+	Vector3 getLightColor() const;
+	/// <summary>Returns the intensity of the light</summary>
+	/// <returns>float</returns>
+	float getLightIntensity() const;
+	/// <summary>Returns the Max radius of the point light</summary>
+	/// <returns>float</returns>
+	float getMaxLightRadius() const;
 
 private:
-	//Handles for shader uniforms
-	GLuint m_lightPosLocation;
-	GLuint m_lightColorLocation;
-	GLuint m_lightIntensityLocation;
-	GLuint m_lightMaxRadiusLocation;
+	//Handles for shader uniforms. The location depends on the variant in use
+	int m_lightPosUniform;
+	int m_lightColorUniform;
+	int m_lightIntensityUniform;
+	int m_lightMaxRadiusUniform;
 	
 
 	//Light position
@@ -67,10 +83,10 @@ private:
 	float m_maxLightRadius;
 
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
 	//Holds the shader program that should be used by this mesh
-	GLuint m_shaderProgram;
+	ShaderProgram* m_shaderProgram;
 };
 
 #endif // Light_h__
@@ -0,0 +1,308 @@
+#include "LightVolumeBatch.h"
+
+//min and max
+#include <algorithm>
+//For comparing the values of a light
+#include <string.h>
+
+//Floats per light in the instance VBO
+const unsigned int InstanceFloats = 8;
+//Locations of the per-instance attributes in the uber-shader. 3 to 6 are the model matrix of instanced meshes
+const GLuint LightPositionRadiusAttribute = 7;
+const GLuint LightColorIntensityAttribute = 8;
+const GLuint LightRectAttribute = 9;
+//Floats per quad in the quad VBO, the light and its rectangle
+const unsigned int QuadFloats = InstanceFloats + 4;
+//Lights covering fewer pixels are drawn as a quad over their rectangle, cheaper than the triangles of the sphere
+const int ScissorLightPixels = 32 * 32;
+
+LightVolumeBatch::LightVolumeBatch(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+	m_shaderProgram = NULL;
+	m_isLightQuadUniform = 0;
+	m_volumeMesh = NULL;
+
+	m_vao = 0;
+	m_instanceVBO = 0;
+	m_capacity = 0;
+	m_quadVAO = 0;
+	m_quadVBO = 0;
+
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+	m_culledCount = 0;
+	m_scissoredCount = 0;
+	m_fullscreenCount = 0;
+	m_drawCount = 0;
+	m_uploadedCount = 0;
+}
+
+LightVolumeBatch::~LightVolumeBatch()
+{
+	//Delete VBO
+	m_glFunctions->glDeleteBuffers(1, &m_instanceVBO);
+	m_glFunctions->glDeleteBuffers(1, &m_quadVBO);
+
+	//Delete VAO
+	m_glFunctions->glDeleteVertexArrays(1, &m_vao);
+	m_glFunctions->glDeleteVertexArrays(1, &m_quadVAO);
+	m_glFunctions = NULL;
+}
+
+void LightVolumeBatch::init(ShaderProgram* shaderProgram, Mesh* volumeMesh)
+{
+	m_shaderProgram = shaderProgram;
+	m_volumeMesh = volumeMesh;
+
+	//Get handle for shader uniform
+	m_isLightQuadUniform = m_shaderProgram->addUniform("isLightQuad");
+
+	//////////////////////////////////////////////////////////////////////////
+	//Create VAO
+	m_glFunctions->glGenVertexArrays(1, &m_vao);
+	//Bind VAO
+	m_glFunctions->glBindVertexArray(m_vao);
+
+	//Vertex VBO and EBO of the sphere
+	m_volumeMesh->attachVertexBuffers();
+
+	//Instance VBO. The divisor makes the attributes advance once per instance instead of once per vertex
+	m_glFunctions->glGenBuffers(1, &m_instanceVBO);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	m_glFunctions->glVertexAttribPointer(LightPositionRadiusAttribute, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(float), (void*)0);
+	m_glFunctions->glVertexAttribPointer(LightColorIntensityAttribute, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(float), (void*)(4 * sizeof(float)));
+	m_glFunctions->glEnableVertexAttribArray(LightPositionRadiusAttribute);
+	m_glFunctions->glEnableVertexAttribArray(LightColorIntensityAttribute);
+	m_glFunctions->glVertexAttribDivisor(LightPositionRadiusAttribute, 1);
+	m_glFunctions->glVertexAttribDivisor(LightColorIntensityAttribute, 1);
+
+	//////////////////////////////////////////////////////////////////////////
+	//Create the VAO of the quads. Only the per-instance attributes, each instance is the 6 corners of its quad
+	m_glFunctions->glGenVertexArrays(1, &m_quadVAO);
+	m_glFunctions->glBindVertexArray(m_quadVAO);
+
+	m_glFunctions->glGenBuffers(1, &m_quadVBO);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+	m_glFunctions->glVertexAttribPointer(LightPositionRadiusAttribute, 4, GL_FLOAT, GL_FALSE, QuadFloats * sizeof(float), (void*)0);
+	m_glFunctions->glVertexAttribPointer(LightColorIntensityAttribute, 4, GL_FLOAT, GL_FALSE, QuadFloats * sizeof(float), (void*)(4 * sizeof(float)));
+	m_glFunctions->glVertexAttribPointer(LightRectAttribute, 4, GL_FLOAT, GL_FALSE, QuadFloats * sizeof(float), (void*)(InstanceFloats * sizeof(float)));
+	m_glFunctions->glEnableVertexAttribArray(LightPositionRadiusAttribute);
+	m_glFunctions->glEnableVertexAttribArray(LightColorIntensityAttribute);
+	m_glFunctions->glEnableVertexAttribArray(LightRectAttribute);
+	m_glFunctions->glVertexAttribDivisor(LightPositionRadiusAttribute, 1);
+	m_glFunctions->glVertexAttribDivisor(LightColorIntensityAttribute, 1);
+	m_glFunctions->glVertexAttribDivisor(LightRectAttribute, 1);
+
+	//////////////////////////////////////////////////////////////////////////
+	//Unbind the VAOs now that the VBOs have been set up
+	m_glFunctions->glBindVertexArray(0);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+unsigned int LightVolumeBatch::addLight(const Vector3& position, const Vector3& color, float intensity, float radius)
+{
+	unsigned int light = m_instances.size() / InstanceFloats;
+	m_instances.resize(m_instances.size() + InstanceFloats);
+	setLight(light, position, color, intensity, radius);
+	//The buffer has to get the new light even if all its values are 0
+	markDirty(light);
+	return light;
+}
+
+void LightVolumeBatch::setLight(unsigned int light, const Vector3& position, const Vector3& color, float intensity, float radius)
+{
+	Vector3 lightPosition = position;
+	Vector3 lightColor = color;
+	float instance[InstanceFloats] = { lightPosition[0], lightPosition[1], lightPosition[2], radius, lightColor[0], lightColor[1], lightColor[2], intensity };
+
+	//Lights which didn't move or change aren't uploaded again
+	float* current = &m_instances[light * InstanceFloats];
+	if (memcmp(current, instance, sizeof(instance)) == 0){
+		return;
+	}
+	memcpy(current, instance, sizeof(instance));
+	markDirty(light);
+}
+
+void LightVolumeBatch::cullLights(ViewFrustumCheck& frustum, const Matrix44& view, const Matrix44& projection, float nearPlane, int width, int height)
+{
+	unsigned int lightCount = getLightCount();
+	m_volumeRuns.clear();
+	m_quadInstances.clear();
+	m_culledCount = 0;
+	m_scissoredCount = 0;
+	m_fullscreenCount = 0;
+
+	//Test all lights against the frustum at once
+	m_x.resize(lightCount);
+	m_y.resize(lightCount);
+	m_z.resize(lightCount);
+	m_radius.resize(lightCount);
+	for (unsigned int light = 0; light < lightCount; light++){
+		const float* instance = &m_instances[light * InstanceFloats];
+		m_x[light] = instance[0];
+		m_y[light] = instance[1];
+		m_z[light] = instance[2];
+		m_radius[light] = instance[3];
+	}
+	m_visible.assign((lightCount + 31) / 32, 0);
+	if (lightCount > 0){
+		//The lights are not below a transform of the scenegraph, so every plane is tested
+		unsigned int activePlanes = frustum.getActivePlanes();
+		frustum.setActivePlanes(AllFrustumPlanes);
+		frustum.spheresInFrustum(&m_x[0], &m_y[0], &m_z[0], &m_radius[0], lightCount, &m_visible[0]);
+		frustum.setActivePlanes(activePlanes);
+	}
+
+	Matrix44 viewMatrix = view;
+	for (unsigned int light = 0; light < lightCount; light++){
+		if (!isVisible(light)){
+			m_culledCount++;
+			continue;
+		}
+
+		const float* instance = &m_instances[light * InstanceFloats];
+		Vector4 position = viewMatrix * Vector4(instance[0], instance[1], instance[2], 1);
+		int rect[4];
+		bool isInFront = ViewFrustumCheck::sphereScreenRect(Vector3(position[0], position[1], position[2]), instance[3], projection, nearPlane, width, height, rect);
+
+		//The sphere touches the frustum but its box doesn't reach a pixel center
+		if (rect[0] > rect[2] || rect[1] > rect[3]){
+			m_culledCount++;
+			continue;
+		}
+
+		//Rectangle of the quad in normalized device coordinates
+		float quad[4] = { -1, -1, 1, 1 };
+		if (!isInFront){
+			//The camera can be inside the volume, whose triangles are then clipped by the near plane. A fullscreen quad covers every pixel it can light
+			m_fullscreenCount++;
+		}
+		else if ((rect[2] - rect[0] + 1) * (rect[3] - rect[1] + 1) < ScissorLightPixels){
+			//Only the pixels of the light's rectangle are shaded, like a scissor test but without a draw call for each light
+			quad[0] = rect[0] * 2.0f / width - 1;
+			quad[1] = rect[1] * 2.0f / height - 1;
+			quad[2] = (rect[2] + 1) * 2.0f / width - 1;
+			quad[3] = (rect[3] + 1) * 2.0f / height - 1;
+			m_scissoredCount++;
+		}
+		else{
+			//Consecutive lights drawn as volumes share a draw call
+			if (!m_volumeRuns.empty() && m_volumeRuns[m_volumeRuns.size() - 2] + m_volumeRuns.back() == light){
+				m_volumeRuns.back()++;
+			}
+			else{
+				m_volumeRuns.push_back(light);
+				m_volumeRuns.push_back(1);
+			}
+			continue;
+		}
+		m_quadInstances.insert(m_quadInstances.end(), instance, instance + InstanceFloats);
+		m_quadInstances.insert(m_quadInstances.end(), quad, quad + 4);
+	}
+}
+
+bool LightVolumeBatch::isVisible(unsigned int light) const
+{
+	return light / 32 < m_visible.size() && (m_visible[light / 32] & (1u << (light % 32))) != 0;
+}
+
+void LightVolumeBatch::draw()
+{
+	m_drawCount = 0;
+	unsigned int lightCount = getLightCount();
+	if (lightCount == 0){
+		return;
+	}
+
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	if (lightCount > m_capacity){
+		//Lights were added. Grow with room for more so adding lights one at a time doesn't reallocate every frame
+		m_capacity = std::max(lightCount, m_capacity * 2);
+		m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_capacity * InstanceFloats * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+		m_glFunctions->glBufferSubData(GL_ARRAY_BUFFER, 0, m_instances.size() * sizeof(float), &m_instances[0]);
+		m_uploadedCount += lightCount;
+	}
+	else if (m_dirtyBegin < m_dirtyEnd){
+		//Only the lights which changed are written into the buffer
+		m_glFunctions->glBufferSubData(GL_ARRAY_BUFFER, m_dirtyBegin * InstanceFloats * sizeof(float),
+			(m_dirtyEnd - m_dirtyBegin) * InstanceFloats * sizeof(float), &m_instances[m_dirtyBegin * InstanceFloats]);
+		m_uploadedCount += m_dirtyEnd - m_dirtyBegin;
+	}
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+
+	//One instanced draw for each run of volumes. The per-instance attributes are pointed at the first light of the run
+	m_glFunctions->glBindVertexArray(m_vao);
+	for (unsigned int run = 0; run < m_volumeRuns.size(); run += 2){
+		unsigned int first = m_volumeRuns[run];
+		m_glFunctions->glVertexAttribPointer(LightPositionRadiusAttribute, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(float), (void*)(first * InstanceFloats * sizeof(float)));
+		m_glFunctions->glVertexAttribPointer(LightColorIntensityAttribute, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(float), (void*)((first * InstanceFloats + 4) * sizeof(float)));
+		m_glFunctions->glDrawElementsInstanced(GL_TRIANGLES, m_volumeMesh->getIndexCount(), GL_UNSIGNED_INT, 0, m_volumeRuns[run + 1]);
+		m_drawCount++;
+	}
+
+	//All quads with one instanced draw. Their data changes with the camera, so the buffer is replaced each frame
+	if (!m_quadInstances.empty()){
+		m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+		m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_quadInstances.size() * sizeof(float), &m_quadInstances[0], GL_STREAM_DRAW);
+
+		//The quads face the camera
+		m_glFunctions->glCullFace(GL_BACK);
+		m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_isLightQuadUniform), 1);
+		m_glFunctions->glBindVertexArray(m_quadVAO);
+		m_glFunctions->glDrawArraysInstanced(GL_TRIANGLES, 0, 6, m_quadInstances.size() / QuadFloats);
+		m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_isLightQuadUniform), 0);
+		m_drawCount++;
+	}
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_glFunctions->glBindVertexArray(0);
+}
+
+unsigned int LightVolumeBatch::getLightCount() const
+{
+	return m_instances.size() / InstanceFloats;
+}
+
+unsigned int LightVolumeBatch::getCulledCount() const
+{
+	return m_culledCount;
+}
+
+unsigned int LightVolumeBatch::getScissoredCount() const
+{
+	return m_scissoredCount;
+}
+
+unsigned int LightVolumeBatch::getFullscreenCount() const
+{
+	return m_fullscreenCount;
+}
+
+unsigned int LightVolumeBatch::getDrawCount() const
+{
+	return m_drawCount;
+}
+
+unsigned int LightVolumeBatch::getUploadedCount() const
+{
+	return m_uploadedCount;
+}
+
+void LightVolumeBatch::resetCounters()
+{
+	m_uploadedCount = 0;
+}
+
+void LightVolumeBatch::markDirty(unsigned int light)
+{
+	if (m_dirtyBegin >= m_dirtyEnd){
+		m_dirtyBegin = light;
+		m_dirtyEnd = light + 1;
+	}
+	else{
+		m_dirtyBegin = std::min(m_dirtyBegin, light);
+		m_dirtyEnd = std::max(m_dirtyEnd, light + 1);
+	}
+}
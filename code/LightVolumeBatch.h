@@ -0,0 +1,149 @@
+#ifndef LightVolumeBatch_h__
+#define LightVolumeBatch_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+//The volumes are the triangles of the point light sphere mesh
+#include "Mesh.h"
+//The quad uniform is set on the light pass variants of the uber-shader
+#include "ShaderProgram.h"
+//Culls the lights and projects their spheres
+#include "ViewFrustumCheck.h"
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+/// <remarks>
+///Light volumes of the deferred shading point lights drawn with instanced draw calls. Each light is an instance of the sphere mesh with its position, radius,
+///color and intensity as per-instance attributes instead of uniforms. The instance VBO is only reallocated when lights are added,
+///otherwise the range of the lights which changed since the last draw is written in place.
+///Each frame the lights outside the frustum are culled. Lights covering only a few pixels and lights crossing the near plane are drawn as
+///instanced quads over their screen rectangle instead, the scissor rectangle of each light is the quad itself so they still share one draw call
+/// </remarks>
+class LightVolumeBatch
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	LightVolumeBatch(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~LightVolumeBatch();
+
+	/// <summary>Creates the VAOs of the volumes and the quads and their instance VBOs. Needs a current openGL context</summary>
+	/// <param name="shaderProgram">Uber-shader with the light pass variants</param>
+	/// <param name="volumeMesh">Unit sphere drawn for each light, scaled by the radius</param>
+	/// <returns>void</returns>
+	void init(ShaderProgram* shaderProgram, Mesh* volumeMesh);
+	/// <summary>Adds a light to the batch</summary>
+	/// <param name="position">Position in world space</param>
+	/// <param name="color">Color of the light</param>
+	/// <param name="intensity">Intensity of the light</param>
+	/// <param name="radius">Max radius of the light and radius of its volume</param>
+	/// <returns>Index of the light to pass to setLight</returns>
+	unsigned int addLight(const Vector3& position, const Vector3& color, float intensity, float radius);
+	/// <summary>Changes a light. Only marks it to be uploaded if a value differs</summary>
+	/// <param name="light">Index returned by addLight</param>
+	/// <param name="position">Position in world space</param>
+	/// <param name="color">Color of the light</param>
+	/// <param name="intensity">Intensity of the light</param>
+	/// <param name="radius">Max radius of the light and radius of its volume</param>
+	/// <returns>void</returns>
+	void setLight(unsigned int light, const Vector3& position, const Vector3& color, float intensity, float radius);
+	/// <summary>Culls the lights against the frustum and decides for each visible light if it is drawn as a volume, a scissored quad or a fullscreen quad</summary>
+	/// <param name="frustum">View frustum with the planes of the frame</param>
+	/// <param name="view">a view matrix</param>
+	/// <param name="projection">a projection matrix</param>
+	/// <param name="nearPlane">Distance to the near plane of the projection</param>
+	/// <param name="width">Width of the screen in pixels</param>
+	/// <param name="height">Height of the screen in pixels</param>
+	/// <returns>void</returns>
+	void cullLights(ViewFrustumCheck& frustum, const Matrix44& view, const Matrix44& projection, float nearPlane, int width, int height);
+	/// <summary>Returns if a light was inside the frustum in the last cullLights</summary>
+	/// <param name="light">Index returned by addLight</param>
+	/// <returns>bool</returns>
+	bool isVisible(unsigned int light) const;
+	/// <summary>Uploads the changed lights and draws the lights kept by the last cullLights. Uses the state and the variant of the uber-shader in use
+	/// with the front faces culled, the quads are drawn with the back faces culled and leave it that way</summary>
+	/// <returns>void</returns>
+	void draw();
+
+	/// <summary>Returns the amount of lights in the batch</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getLightCount() const;
+	/// <summary>Returns how many lights were outside the frustum in the last cullLights</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getCulledCount() const;
+	/// <summary>Returns how many lights were drawn as a quad over their screen rectangle in the last cullLights</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getScissoredCount() const;
+	/// <summary>Returns how many lights crossed the near plane and were drawn as a fullscreen quad in the last cullLights</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getFullscreenCount() const;
+	/// <summary>Returns how many draw calls the last draw issued</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getDrawCount() const;
+	/// <summary>Returns how many lights were uploaded since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getUploadedCount() const;
+	/// <summary>Sets the upload counter to 0</summary>
+	/// <returns>void</returns>
+	void resetCounters();
+
+private:
+	/// <summary>Adds a light to the range uploaded by the next draw</summary>
+	/// <param name="light">Index of the light</param>
+	/// <returns>void</returns>
+	void markDirty(unsigned int light);
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	//Uber-shader the quad uniform is set on
+	ShaderProgram* m_shaderProgram;
+	//Handle for shader uniform
+	int m_isLightQuadUniform;
+
+	//Mesh whose triangles are drawn for each light
+	Mesh* m_volumeMesh;
+
+	//VAO with the vertex buffers of the volume mesh and the instance VBO
+	GLuint m_vao;
+	//Position and radius, then color and intensity of each light
+	GLuint m_instanceVBO;
+	//Lights the instance VBO has room for
+	unsigned int m_capacity;
+	//VAO without vertex buffers, the quad corners come from gl_VertexID
+	GLuint m_quadVAO;
+	//Light and screen rectangle of each quad, replaced each frame
+	GLuint m_quadVBO;
+
+	//CPU copy of the instance VBO, 8 floats per light
+	std::vector<float> m_instances;
+	//Range of lights changed since the last draw. Empty if m_dirtyBegin >= m_dirtyEnd
+	unsigned int m_dirtyBegin;
+	unsigned int m_dirtyEnd;
+
+	//Centers and radii of the lights in world space for the frustum test
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_radius;
+	//Bit for each light inside the frustum
+	std::vector<unsigned int> m_visible;
+	//First light and count of each run of consecutive lights drawn as volumes
+	std::vector<unsigned int> m_volumeRuns;
+	//CPU copy of the quad VBO, the 8 floats of the light and its rectangle in normalized device coordinates
+	std::vector<float> m_quadInstances;
+
+	unsigned int m_culledCount;
+	unsigned int m_scissoredCount;
+	unsigned int m_fullscreenCount;
+	unsigned int m_drawCount;
+	unsigned int m_uploadedCount;
+};
+
+#endif // LightVolumeBatch_h__
@@ -1,9 +1,14 @@
 #include "Mesh.h"
 
-Mesh::Mesh(QOpenGLFunctions_3_3_Core* functions)
+//Material id of the next mesh created
+static unsigned int nextMaterialID = 0;
+
+Mesh::Mesh(GLStateCache* functions)
 {
 	m_glFunctions = functions;
 	m_textureID = NULL;
+	//Each mesh has its own material. The render queue sorts by this id instead of looking the mesh up
+	m_materialID = nextMaterialID++;
 
 	//Set default Material properties for mesh
 	m_ambientMaterial.Insert(0.2, 0.2, 0.2);
@@ -16,8 +21,13 @@ Mesh::Mesh(QOpenGLFunctions_3_3_Core* functions)
 	m_isFrustumCulling = true;
 	m_isWireframeBV = false;
 	m_isSkybox = false;
+	m_isOccluder = false;
+	m_isInstanced = false;
 
 	m_radiusBV = 0;
+	m_weldEpsilon = 0;
+	m_indexCount = 0;
+	m_instanceVBO = 0;
 }
 
 Mesh::~Mesh(void)
@@ -26,9 +36,10 @@ Mesh::~Mesh(void)
 
 	//Delete VBOs
 	m_glFunctions->glDeleteBuffers(1, &m_vertexVBO);
-	m_glFunctions->glDeleteBuffers(1, &m_uvVBO);
-	m_glFunctions->glDeleteBuffers(1, &m_normalVBO);
 	m_glFunctions->glDeleteBuffers(1, &m_indicesEBO);
+	if (m_instanceVBO != 0){
+		m_glFunctions->glDeleteBuffers(1, &m_instanceVBO);
+	}
 
 	//Delete VAO
 	m_glFunctions->glDeleteVertexArrays(1, &m_vao);
@@ -38,8 +49,12 @@ Mesh::~Mesh(void)
 	m_children.clear();
 }
 
-void Mesh::update(Matrix44& view, const Matrix44& model)
+void Mesh::update(Matrix44& view, const Matrix44& model, bool isParentChanged)
 {
+	//The children have the same parent model matrix as this
+	isParentChanged = isParentChanged || m_isParentChanged;
+	m_isParentChanged = false;
+
 	//Calls the childrens' update
 	if (!m_children.empty())
 	{
@@ -47,13 +62,32 @@ void Mesh::update(Matrix44& view, const Matrix44& model)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->update(view, model);
+				m_children[i]->update(view, model, isParentChanged);
 			}
 		}
 	}
 }
 
-void Mesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
+void Mesh::getBounds(const Matrix44& model, BoundingSphere& bounds)
+{
+	//The skybox is around the camera and is never culled
+	if (m_isSkybox){
+		bounds.setInfinite();
+	}
+	else{
+		//World space bounding sphere. The radius is scaled with the largest scale of the model matrix so it still encloses the mesh
+		Vector4 centerPointBV_VEC4(m_centerPointBV[0], m_centerPointBV[1], m_centerPointBV[2], 1);
+		Vector4 worldSpaceCenterPointBV_VEC4 = model * centerPointBV_VEC4;
+		Vector3 worldSpaceCenterPointBV(worldSpaceCenterPointBV_VEC4[0], worldSpaceCenterPointBV_VEC4[1], worldSpaceCenterPointBV_VEC4[2]);
+		bounds.merge(worldSpaceCenterPointBV, m_radiusBV * BoundingSphere::maxScale(model));
+	}
+	bounds.addMeshes(1);
+
+	//Merges the childrens' bounds
+	Node::getBounds(model, bounds);
+}
+
+void Mesh::draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
 {
 	bool isInsideFrustum;
 	Vector3 worldSpaceCenterPointBV;
@@ -73,6 +107,16 @@ void Mesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, cons
 
 		//Test sphere to plane intersection with worldspace centerpoint of bounding sphere and the scaled radius
 		isInsideFrustum = frustumCheck.bSphereInFrustum(worldSpaceCenterPointBV, scaledRadius);
+
+		//Test the box around the bounding sphere against the occluders. Occluders don't hide themselves
+		if (isInsideFrustum && !m_isOccluder && drawContext.occlusionBuffer != NULL){
+			Vector3 extent(m_radiusBV, m_radiusBV, m_radiusBV);
+			isInsideFrustum = drawContext.occlusionBuffer->isBoxVisible(model, m_centerPointBV - extent, m_centerPointBV + extent);
+		}
+		//Skip the draw if the box was hidden in the latest finished query. Queues a new query of the box either way
+		if (isInsideFrustum && !m_isOccluder && drawContext.occlusionQueries != NULL){
+			isInsideFrustum = drawContext.occlusionQueries->isVisible(drawContext.queryId, drawContext.viewProjection, model, m_centerPointBV, m_radiusBV);
+		}
 		if (!isInsideFrustum && shaderBranch != -1){
 			frustumCheck.shapesRendered--;
 		}
@@ -81,82 +125,44 @@ void Mesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, cons
 		isInsideFrustum = true;
 	}
 	if (isInsideFrustum){
-		//Wireframe mode. Dont render in wireframe if shaderBranch is -1.
-		//(To prevent wireframe rendering in multipass rendering)
-		if (m_isWireframe && !m_isSkybox && shaderBranch != -1){
-			m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			//Render with wireframe shader branch
-			m_glFunctions->glUniform1i(m_shaderModeLocation, 12);
-		}
-		//Standard non wireframe mode
-		else if (!m_isWireframe){
-			m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			//Skybox
-			if (m_isSkybox){
-				//Cubemap for skybox
-				m_glFunctions->glActiveTexture(GL_TEXTURE0);
-				m_glFunctions->glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
-				m_glFunctions->glUniform1i(m_skyBoxSamplerLocation, 0);
-
-				//We are inside the skybox so we cull the front face instead
-				m_glFunctions->glCullFace(GL_FRONT);
-				//Too make the skybox a part of the scene we need to change the depth comparison to LESS or Equal.
-				//Because we set the z value in shader to w to make sure it will be 1 after perspective division
-				m_glFunctions->glDepthFunc(GL_LEQUAL);
-			}
-			else{
-				//Texture
-				m_glFunctions->glActiveTexture(GL_TEXTURE0);
-				m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_textureID);
-				m_glFunctions->glUniform1i(m_textureSamplerLocation, 0);
+		//Instanced meshes only gather the model matrix. All occurrences are drawn together by drawInstances
+		if (m_isInstanced){
+			Matrix44 modelMatrix = model;
+			for (int column = 0; column < 4; column++){
+				for (int row = 0; row < 4; row++){
+					m_instanceModels.push_back(modelMatrix[row][column]);
+				}
 			}
 		}
+		//Add a packet to the render queue. It is drawn when the queue is submitted after the traversal
+		else if (drawContext.renderQueue != NULL && !m_isSkybox){
+			//Distance in front of the camera, used for front to back sorting
+			Vector4 centerPointBV_VEC4(m_centerPointBV[0], m_centerPointBV[1], m_centerPointBV[2], 1);
+			Vector4 viewSpaceCenterPointBV_VEC4 = view * (model * centerPointBV_VEC4);
+			drawContext.renderQueue->add(this, model, m_isWireframe && shaderBranch != -1, m_textureID, m_vao, m_materialID, -viewSpaceCenterPointBV_VEC4[2]);
+		}
+		else{
+			bindMaterial(shaderBranch);
 
-		//Send the material properties to shader program
-		m_glFunctions->glUniform3fv(m_ambientMaterialLocation, 1, &m_ambientMaterial[0]);
-		m_glFunctions->glUniform3fv(m_specularMaterialLocation, 1, &m_specularMaterial[0]);
-		m_glFunctions->glUniform1f(m_shininessLocation, m_shininess);
-
-		//Form the mvp matrix from matrices supplies with draw function
-		Matrix44 mvp = projection * view * model;
-		//MVP matrix for light(camera is attached to where the light is)
-		Matrix44 depthMVP = projection*lightView*model;
+			//Send the model matrix and material. The shader multiplies the model matrix with the matrices of the FrameBlock
+			drawContext.uniformBuffers->setObject(model, m_ambientMaterial, m_specularMaterial, m_shininess);
 
-		Matrix44 modelMatrix = model;
-		Matrix44 viewMatrix = view;
-		Matrix44 modelViewMatrix = view * model;
+			//Bind this mesh VAO
+			m_glFunctions->glBindVertexArray(m_vao);
+			//Draw the triangles using the index buffer(EBO)
+			m_glFunctions->glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
 
-		//Send matrices to shader uniforms
-		m_glFunctions->glUniformMatrix4fv(m_modelLocation, 1, GL_TRUE, &modelMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_viewLocation, 1, GL_TRUE, &viewMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_modelViewLocation, 1, GL_TRUE, &modelViewMatrix[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_depthMVPLocation, 1, GL_TRUE, &depthMVP[0][0]);
-		m_glFunctions->glUniformMatrix4fv(m_mvpLocation, 1, GL_TRUE, &mvp[0][0]);
+			unbindMaterial();
 
-		//Bind this mesh VAO
-		m_glFunctions->glBindVertexArray(m_vao);
-		//Draw the triangles using the index buffer(EBO)
-		m_glFunctions->glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
-
-		if (m_isSkybox){
-			//Unbind texture
-			m_glFunctions->glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-			m_glFunctions->glCullFace(GL_BACK);
-			m_glFunctions->glDepthFunc(GL_LESS);
+			//Unbind the VAO
+			m_glFunctions->glBindVertexArray(0);
 		}
-		else{
-			//Unbind texture
-			m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
-		}
-
-		//Unbind the VAO
-		m_glFunctions->glBindVertexArray(0);
 
 		//Draw wireframe BV sphere
 		if (!m_isPlayer && !m_isWireframe && m_isWireframeBV && m_isFrustumCulling && !m_isSkybox && shaderBranch != -1){
-			drawWireframeBoundingSphere(view, projection, worldSpaceCenterPointBV, scaledRadius);
+			drawWireframeBoundingSphere(*drawContext.uniformBuffers, worldSpaceCenterPointBV, scaledRadius);
 			//Revert back to shader branch previously used before rendering the wireframe
-			m_glFunctions->glUniform1i(m_shaderModeLocation, shaderBranch);
+			m_shaderProgram->useMode(shaderBranch);
 		}
 
 		//Calls the childrens' update
@@ -166,29 +172,133 @@ void Mesh::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, cons
 			{
 				if (m_children[i] != NULL)
 				{
-					m_children[i]->draw(frustumCheck, projection, view, shaderBranch, lightView, model, bvScaleFactor);
+					m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, model, bvScaleFactor);
 				}
 			}
 		}
 	}
 }
 
-void Mesh::useShaderProgram(GLuint shaderProgram)
+void Mesh::drawInstances(UniformBuffers& uniforms, int shaderBranch)
+{
+	if (!m_isInstanced || m_instanceModels.empty()){
+		return;
+	}
+	if (m_instanceVBO == 0){
+		initInstanceVBO();
+	}
+
+	bindMaterial(shaderBranch);
+
+	//The shader uses each instance's model matrix instead of the one in the ObjectBlock, so only the material is needed
+	uniforms.setObject(Matrix44(), m_ambientMaterial, m_specularMaterial, m_shininess);
+	m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_isInstancedUniform), 1);
+
+	//Bind this mesh VAO
+	m_glFunctions->glBindVertexArray(m_vao);
+
+	//Send the model matrices of this frame. A new buffer is allocated each time so the GPU can still read the last one
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_instanceModels.size() * sizeof(float), &m_instanceModels[0], GL_STREAM_DRAW);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//Draw every gathered occurrence with one draw call
+	m_glFunctions->glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0, m_instanceModels.size() / 16);
+
+	m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_isInstancedUniform), 0);
+	unbindMaterial();
+
+	//Unbind the VAO
+	m_glFunctions->glBindVertexArray(0);
+
+	m_instanceModels.clear();
+}
+
+unsigned int Mesh::addObjectBlock(UniformBuffers& uniforms, const Matrix44& model)
+{
+	return uniforms.addObject(model, m_ambientMaterial, m_specularMaterial, m_shininess);
+}
+
+void Mesh::drawPacket(UniformBuffers& uniforms, unsigned int object, int shaderMode, bool isWireframe, RenderState& state)
+{
+	//Wireframe packets are sorted after the solid ones, so the polygon mode only changes with the shader branch
+	if (state.shaderMode != shaderMode){
+		m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, isWireframe ? GL_LINE : GL_FILL);
+		m_shaderProgram->useMode(shaderMode);
+		state.shaderMode = shaderMode;
+		state.stateChanges += 2;
+	}
+	//The sampler is already associated to texture unit 0 and the queue made it active
+	if (!isWireframe && state.textureID != m_textureID){
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_textureID);
+		state.textureID = m_textureID;
+		state.stateChanges++;
+	}
+	if (state.vao != m_vao){
+		m_glFunctions->glBindVertexArray(m_vao);
+		state.vao = m_vao;
+		state.stateChanges++;
+	}
+
+	//The model matrix and material of the packet are already in the ring buffer, only its range is bound
+	uniforms.bindObject(object);
+
+	//Draw the triangles using the index buffer(EBO)
+	m_glFunctions->glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
+}
+
+void Mesh::bindMaterial(int shaderBranch)
+{
+	//Wireframe mode. Dont render in wireframe if shaderBranch is -1.
+	//(To prevent wireframe rendering in multipass rendering)
+	if (m_isWireframe && !m_isSkybox && shaderBranch != -1){
+		m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		//Render with wireframe shader branch
+		m_shaderProgram->useMode(WireframeMode);
+	}
+	//Standard non wireframe mode
+	else if (!m_isWireframe){
+		m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		//Skybox
+		if (m_isSkybox){
+			//Cubemap for skybox
+			m_glFunctions->glActiveTexture(GL_TEXTURE0);
+			m_glFunctions->glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
+
+			//We are inside the skybox so we cull the front face instead
+			m_glFunctions->glCullFace(GL_FRONT);
+			//Too make the skybox a part of the scene we need to change the depth comparison to LESS or Equal.
+			//Because we set the z value in shader to w to make sure it will be 1 after perspective division
+			m_glFunctions->glDepthFunc(GL_LEQUAL);
+		}
+		else{
+			//Texture
+			m_glFunctions->glActiveTexture(GL_TEXTURE0);
+			m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_textureID);
+		}
+	}
+}
+
+void Mesh::unbindMaterial()
+{
+	if (m_isSkybox){
+		//Unbind texture
+		m_glFunctions->glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		m_glFunctions->glCullFace(GL_BACK);
+		m_glFunctions->glDepthFunc(GL_LESS);
+	}
+	else{
+		//Unbind texture
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+void Mesh::useShaderProgram(ShaderProgram* shaderProgram)
 {
 	m_shaderProgram = shaderProgram;
 
-	//Get handles for shader uniforms
-	m_shaderModeLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "mode");
-	m_skyBoxSamplerLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "skyBoxSampler");
-	m_textureSamplerLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "textureSampler");
-	m_depthMVPLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "depthMVP");
-	m_ambientMaterialLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "AmbientMaterial");
-	m_specularMaterialLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "SpecularMaterial");
-	m_shininessLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "Shininess");
-	m_mvpLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "mvp");
-	m_modelLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "model");
-	m_viewLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "view");
-	m_modelViewLocation = m_glFunctions->glGetUniformLocation(m_shaderProgram, "modelView");
+	//Get handles for shader uniforms. The samplers are associated to their texture units once by the window
+	m_isInstancedUniform = m_shaderProgram->addUniform("isInstanced");
 }
 
 void Mesh::useTexture(GLuint textureID)
@@ -198,116 +308,62 @@ void Mesh::useTexture(GLuint textureID)
 
 void Mesh::loadOBJ(const char* path)
 {
-	//Lists to store the data read from obj file
-	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-	std::vector<Vector3> temp_vertices;
-	std::vector<Vector2> temp_uvs;
-	std::vector<Vector3> temp_normals;
+	//Use the binary cache of the obj file if there is one. The data is already indexed so it can be sent straight from the mapped file to the VRAM
+	MeshCache cache;
+	if (cache.open(path, m_weldEpsilon, m_vertexFormat)){
+		m_centerPointBV = cache.centerPoint();
+		m_radiusBV = cache.radius();
+
+		//Occluders need the positions on the CPU. They are read back from the interleaved vertices
+		if (m_isOccluder){
+			const unsigned char* vertexData = (const unsigned char*)cache.vertexData();
+			m_vertices.resize(cache.vertexCount());
+			for (unsigned int i = 0; i < cache.vertexCount(); i++){
+				Vector2 uv;
+				Vector3 normal;
+				m_vertexFormat.unpack(vertexData + i * m_vertexFormat.stride(), m_vertices[i], uv, normal);
+			}
+			m_indices.assign(cache.indexData(), cache.indexData() + cache.indexCount());
+		}
+		initVBOs(cache.vertexData(), cache.vertexCount(), cache.indexData(), cache.indexCount());
+		return;
+	}
+
+	//Parse the obj file. Faces with more than 3 corners are already split into triangles
+	ObjLoader obj;
+	if (!obj.load(path)){
+		return;
+	}
 
 	//Lists with sorted data according the the indices specified in obj file
 	std::vector<Vector3> sorted_vertices;
 	std::vector<Vector2> sorted_uvs;
 	std::vector<Vector3> sorted_normals;
-	
-	//Open the file in read only mode
-	FILE* file = fopen(path, "r");
-	if (file == NULL){
-	 	printf("Impossible to open the file !\n");
-	 	return;
-	}
-	 
-	//Handle the data in the file
-	while (true){
-	 	//Read the first word of the line and store it in lineHeader
-	 	char lineHeader[128];
-	 	//Read the first word of the line as a string and store it in lineHeader
-	 	int res = fscanf(file, "%s", lineHeader);
-	 
-	 	//If it's the end of the file then break the loop
-	 	if (res == EOF){
-	 		break; // EOF = End Of File. Quit the loop.
-	 	}
-	 
-	 	//Read the stored data and check if it's a "v"
-	 	if (strcmp(lineHeader, "v") == 0){ //Returns 0 if the strings are equal
-	 		Vector3 vertex;
-	 		//Read the data as floats and put them in the vector
-			fscanf(file, "%f %f %f\n", &vertex[0], &vertex[1], &vertex[2]);
-	 		temp_vertices.push_back(vertex);
-	 	}
-	 	//Read the stored data and check if it's a "vt"
-	 	else if (strcmp(lineHeader, "vt") == 0){ //Returns 0 if the strings are equal
-	 		Vector2 uv;
-	 		//Read the data as floats and put them in the vector
-	 		fscanf(file, "%f %f\n", &uv[0], &uv[1]);
-	 		//uv[1] = -uv[1]; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-	 		temp_uvs.push_back(uv);
-	 	}
-	 	//Read the stored data and check if it's a "vn"
-	 	else if (strcmp(lineHeader, "vn") == 0){ //Returns 0 if the strings are equal
-	 		Vector3 normal;
-	 		//Read the data as floats and put them in the vector
-	 		fscanf(file, "%f %f %f\n", &normal[0], &normal[1], &normal[2]);
-	 		temp_normals.push_back(normal);
-	 	}
-	 	//Read the stored data and check if it's a "f"
-	 	else if (strcmp(lineHeader, "f") == 0){ //Returns 0 if the strings are equal
-	 		unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-	 		//Read the data as integers and put them in the arrays
-	 		int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-	 		//If the indices in the obj files are not 9 then we can't handle it
-	 		if (matches != 9){
-	 			printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-	 			fclose(file);
-	 			return;
-	 		}
-	 
-	 		//Add the indices of vertex data to their respective lists
-	 		vertexIndices.push_back(vertexIndex[0]);
-	 		vertexIndices.push_back(vertexIndex[1]);
-	 		vertexIndices.push_back(vertexIndex[2]);
-	 		uvIndices.push_back(uvIndex[0]);
-	 		uvIndices.push_back(uvIndex[1]);
-	 		uvIndices.push_back(uvIndex[2]);
-	 		normalIndices.push_back(normalIndex[0]);
-	 		normalIndices.push_back(normalIndex[1]);
-	 		normalIndices.push_back(normalIndex[2]);
-	 	}
-	 	else{
-	 		//The data we don't need is put into this buffer just so we can move the reader forward
-	 		//fgets reads the whole line. We don't want to loop multiple times if we already know the data is not something we need
-	 		char stupidBuffer[1000];
-	 		fgets(stupidBuffer, 1000, file);
-	 	}
-	}
-	//Closes the file now that we are done with it
-	fclose(file);
-	 
+
 	//The obj file indices specifies which 3 vertices are needed to form a triangle
-	//This loop will create lists of sorted vertex data according to the obj file
-	for (int i = 0; i < vertexIndices.size(); i++){
-	 
-	 	//Get the indices.
-	 	unsigned int vertexIndex = vertexIndices[i];
-	 	unsigned int uvIndex = uvIndices[i];
-	 	unsigned int normalIndex = normalIndices[i];
-	 
-	 	//Get the vertex data with the index extracted from the obj file
-	 	//Indices start at 1 in obj files but in programming it's off by 1
-	 	Vector3 vertex = temp_vertices[vertexIndex - 1];
-	 	Vector2 uv = temp_uvs[uvIndex - 1];
-	 	Vector3 normal = temp_normals[normalIndex - 1];
-	 
-	 	//Put the vertex data in their respective lists
-	 	//Will now be sorted according to how the obj file indices specifies
-		sorted_vertices.push_back(vertex);
-		sorted_uvs.push_back(uv);
-		sorted_normals.push_back(normal);
-	}
+	//This will create lists of sorted vertex data according to the obj file
+	obj.getTriangleCorners(sorted_vertices, sorted_uvs, sorted_normals);
+
 	//Vertex indexing. The lists in the class will store the indexed vertex data. Which will not have duplicates.
 	//Newly generated indices list will tell which vertices are needed to form a triangle
 	indexVBO(sorted_vertices, sorted_uvs, sorted_normals);
 
+	calculateBoundingSphere();
+
+	//Interleave the vertex data so it can be put in one VBO
+	std::vector<unsigned char> packedVertices;
+	m_vertexFormat.pack(m_vertices, m_uvs, m_normals, packedVertices);
+
+	//Write the cache so the obj file doesn't have to be parsed next time
+	MeshCache::write(path, m_weldEpsilon, m_vertexFormat, packedVertices, m_indices, m_centerPointBV, m_radiusBV);
+
+	initVBOs(&packedVertices[0], m_vertices.size(), &m_indices[0], m_indices.size());
+}
+
+void Mesh::initVBOs(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	m_indexCount = indexCount;
+
 	//////////////////////////////////////////////////////////////////////////
 	//Create VAO
 	m_glFunctions->glGenVertexArrays(1, &m_vao);
@@ -315,46 +371,16 @@ void Mesh::loadOBJ(const char* path)
 	m_glFunctions->glBindVertexArray(m_vao);
 
 	//////////////////////////////////////////////////////////////////////////
-	//Vertex VBO
+	//Vertex VBO. Position, uv and normal are interleaved in the layout of m_vertexFormat
 	//Create VBO on the GPU to store the vertex data
 	m_glFunctions->glGenBuffers(1, &m_vertexVBO);
 	//Bind VBO to make it current
 	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
 	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vector3), &m_vertices[0], GL_STATIC_DRAW);
-
-	//Sets up which shader attribute will received the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(0);
-
-	//////////////////////////////////////////////////////////////////////////
-	//UV VBO
-	//Create VBO on the GPU to store the vertex data
-	m_glFunctions->glGenBuffers(1, &m_uvVBO);
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_uvVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_uvs.size() * sizeof(Vector2), &m_uvs[0], GL_STATIC_DRAW);
+	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, vertexCount * m_vertexFormat.stride(), vertices, GL_STATIC_DRAW);
 
-	//Sets up which shader attribute will receive the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(1);
-
-	//////////////////////////////////////////////////////////////////////////
-	//Normal VBO
-	//Create VBO on the GPU to store the vertex data
-	m_glFunctions->glGenBuffers(1, &m_normalVBO);
-	//Bind VBO to make it current
-	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
-	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, m_normals.size() * sizeof(Vector3), &m_normals[0], GL_STATIC_DRAW);
-
-	//Sets up which shader attribute will receive the data. How many elements will form a vertex, type etc
-	m_glFunctions->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	//Enable the shader attribute to receive data
-	m_glFunctions->glEnableVertexAttribArray(2);
+	//Position, uv and normal attributes for the interleaved VBO
+	m_vertexFormat.setupAttributes(m_glFunctions);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Indices EBO
@@ -363,34 +389,52 @@ void Mesh::loadOBJ(const char* path)
 	//Bind EBO to make it current
 	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indicesEBO);
 	//Set the usage type, allocate VRAM and send the vertex data to the GPU
-	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Unbind the VAO now that the VBOs have been set up
 	m_glFunctions->glBindVertexArray(0);
+}
 
-	calculateBoundingSphere();
+void Mesh::attachVertexBuffers()
+{
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+	m_vertexFormat.setupAttributes(m_glFunctions);
+	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indicesEBO);
 }
 
-bool Mesh::getSimilarVertexIndex(PackedVertex& packed, std::map<PackedVertex, unsigned int>& VertexToOutIndex, unsigned int& result)
+unsigned int Mesh::getIndexCount() const
 {
-	//Iterator to find a PackedVertex in map that is equal to packed
-	std::map<PackedVertex, unsigned int>::iterator it = VertexToOutIndex.find(packed);
-	//Return false if nothing is found
-	if (it == VertexToOutIndex.end()){
-		return false;
-	}
-	else{
-		//Returns the value the key is paired to
-		result = it->second;
-		return true;
+	return m_indexCount;
+}
+
+void Mesh::initInstanceVBO()
+{
+	//Bind VAO
+	m_glFunctions->glBindVertexArray(m_vao);
+
+	//Filled by each drawInstances
+	m_glFunctions->glGenBuffers(1, &m_instanceVBO);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+
+	//A mat4 attribute takes 4 locations, one per column. The divisor makes them advance once per instance instead of once per vertex
+	for (int column = 0; column < 4; column++){
+		m_glFunctions->glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(column * 4 * sizeof(float)));
+		m_glFunctions->glEnableVertexAttribArray(3 + column);
+		m_glFunctions->glVertexAttribDivisor(3 + column, 1);
 	}
+
+	//Unbind the VAO now that the VBO has been set up
+	m_glFunctions->glBindVertexArray(0);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void Mesh::indexVBO(std::vector<Vector3>& in_vertices, std::vector<Vector2>& in_uvs, std::vector<Vector3>& in_normals)
 {
-	//Stores unique vertex data paired with the index
-	std::map<PackedVertex, unsigned int> VertexToOutIndex;
+	//Stores unique vertex data paired with the index. Smooth meshes share a vertex between about 6 corners, the table grows if there are more unique vertices
+	VertexWelder welder(in_vertices.size() / 4, m_weldEpsilon);
+	//One index per input vertex
+	m_indices.reserve(m_indices.size() + in_vertices.size());
 
 	// For each input vertex
 	for (int i = 0; i < in_vertices.size(); i++){
@@ -402,11 +446,11 @@ void Mesh::indexVBO(std::vector<Vector3>& in_vertices, std::vector<Vector2>& in_
 		packed.normal = in_normals[i];
 
 
-		//Will store the index of the vertex found in the map
+		//Will store the index of the vertex found in the welder
 		unsigned int index;
-		//Try to find a PackedVertex in the VertexToOutIndex map that is the same as packed
-		//If one is found save the index of it
-		bool found = getSimilarVertexIndex(packed, VertexToOutIndex, index);
+		//Try to find a vertex in the welder that is the same as packed
+		//If one is found save the index of it. Otherwise packed is added to the welder and index is the index it will get in the lists
+		bool found = welder.findOrAdd(packed, index);
 
 		//Push the found index to our indices vector
 		if (found){ // A similar vertex is already in the VBO, use it instead !
@@ -414,36 +458,29 @@ void Mesh::indexVBO(std::vector<Vector3>& in_vertices, std::vector<Vector2>& in_
 		}
 		//If not found then add the vertex data to our vertex arrays.
 		//Also add the the index of the newly added vertex data to indices array. Which will be the last element.
-		//Add the vertex data to the map and associate it with the index.
+		//The welder already associated the vertex data with the index.
 		//So we can iterate next time and check for same vertex data and use the index
 		else{ // If not, it needs to be added in the output data.
 			m_vertices.push_back(in_vertices[i]);
 			m_uvs.push_back(in_uvs[i]);
 			m_normals.push_back(in_normals[i]);
-			unsigned int newindex = (unsigned int)m_vertices.size() - 1;
-			m_indices.push_back(newindex);
-			VertexToOutIndex[packed] = newindex;
+			m_indices.push_back(index);
 		}
 	}
 }
 
 void Mesh::calculateBoundingSphere(){
+	if (m_vertices.empty()){
+		return;
+	}
 
 	//Calculate the center point by getting the mean value of vertices
-	for (int i = 0; i < m_vertices.size(); i++){
-		m_centerPointBV += m_vertices[i];
-	}
-	m_centerPointBV /= m_vertices.size();
-
-	//Find the farthest distance from the center point by iterating all vertices all calculating the distance
-	for (int i = 0; i < m_vertices.size(); i++){
-		Vector3 pos = m_vertices[i] - m_centerPointBV;
-		float distance = pos.Magnitude();
-		if (distance > m_radiusBV){
-			m_radiusBV = distance;
-		}
-	}
+	PointBounds bounds;
+	bounds.AddPackedPoints(&m_vertices[0][0], m_vertices.size());
+	m_centerPointBV = bounds.GetCentroid();
 
+	//Find the farthest distance from the center point
+	m_radiusBV = PointBounds::MaxDistancePacked(&m_vertices[0][0], m_vertices.size(), m_centerPointBV);
 }
 
 void Mesh::setAmbientMaterial(float r, float g, float b)
@@ -457,22 +494,21 @@ void Mesh::setSpecularMaterial(float r, float g, float b, float shininess)
 	m_shininess = shininess;
 }
 
-void Mesh::drawWireframeBoundingSphere(const Matrix44& view, const Matrix44& projection, Vector3 position, float radius)
+void Mesh::drawWireframeBoundingSphere(UniformBuffers& uniforms, Vector3 position, float radius)
 {
 	//Sphere triangles were created clockwise so we tell opengl to treat clockwise as front face
 	m_glFunctions->glFrontFace(GL_CW);
 	m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//Bind the shaders to be used
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 12);
+	m_shaderProgram->useMode(WireframeMode);
 
 	//Model Matrix
 	Matrix44 mymodel;
 	mymodel.Translate(position); //translate to centerpoint of bounding sphere
 	mymodel.Scale(radius); //scale to the radius of the bounding sphere
-	Matrix44 mvp = projection * view * mymodel;
 
-	//Send the mvp matrix to the vertex shader
-	m_glFunctions->glUniformMatrix4fv(m_mvpLocation, 1, GL_TRUE, &mvp[0][0]);
+	//Send the model matrix to the vertex shader
+	uniforms.setObject(mymodel);
 
 	//Bind this mesh VAO
 	m_glFunctions->glBindVertexArray(m_wireframeBvVAO);
@@ -508,11 +544,49 @@ void Mesh::setFrustumCulling(bool flag)
 	m_isFrustumCulling = flag;
 }
 
+void Mesh::setOccluder(bool flag)
+{
+	m_isOccluder = flag;
+}
+
+bool Mesh::isOccluder() const
+{
+	return m_isOccluder;
+}
+
+void Mesh::addToOcclusionBuffer(OcclusionBuffer& occlusionBuffer, const Matrix44& model)
+{
+	if (!m_isOccluder || m_indices.empty()){
+		return;
+	}
+	occlusionBuffer.addOccluder(model, &m_vertices[0], m_vertices.size(), &m_indices[0], m_indices.size());
+}
+
+void Mesh::setInstanced(bool flag)
+{
+	m_isInstanced = flag;
+}
+
+bool Mesh::isInstanced() const
+{
+	return m_isInstanced;
+}
+
 void Mesh::setWireframeBV(bool flag)
 {
 	m_isWireframeBV = flag;
 }
 
+void Mesh::setWeldEpsilon(float epsilon)
+{
+	m_weldEpsilon = epsilon;
+}
+
+void Mesh::setVertexFormat(unsigned int flags)
+{
+	m_vertexFormat = VertexFormat(flags);
+}
+
 void Mesh::initWireframeBoundingSphere()
 {
 	const float degreeIncrement = 20;
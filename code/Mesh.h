@@ -6,6 +6,24 @@
 #include "Transform.h"
 //For class representing key for map in the vertex indexing algorithm
 #include "PackedVertex.h"
+//Finds duplicate vertices in the vertex indexing algorithm
+#include "VertexWelder.h"
+//Parses the obj files
+#include "ObjLoader.h"
+//Binary cache of the indexed obj files
+#include "MeshCache.h"
+//Interleaved layout of the vertices in the VBO
+#include "VertexFormat.h"
+//Occluders are rasterized into it and the other meshes tested against it
+#include "OcclusionBuffer.h"
+//Hardware occlusion queries of the boxes around the meshes
+#include "OcclusionQueries.h"
+//Draws are added to it as packets if it is set
+#include "RenderQueue.h"
+//The model matrix and material are sent in the ObjectBlock
+#include "UniformBuffers.h"
+//Variants of the uber-shader, one per shader branch
+#include "ShaderProgram.h"
 
 
 //For opening files
@@ -30,7 +48,7 @@ public:
 	/// <summary>Constructor</summary>
 	/// <param name="functions">Enables the class to call openGL functions</param>
 	/// <returns></returns>
-	Mesh(QOpenGLFunctions_3_3_Core* functions);
+	Mesh(GLStateCache* functions);
 	/// <summary>Destructor</summary>
 	/// <returns></returns>
 	~Mesh();
@@ -38,10 +56,12 @@ public:
 	/// <summary>Does nothing with this class. Just calls its childrens' update</summary>
 	/// <param name="view">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="model">Is not handled in this class, just forwards it to its children</param>
+	/// <param name="isParentChanged">Is not handled in this class, just forwards it to its children</param>
 	/// <returns>void</returns>
-	void update(Matrix44& view, const Matrix44& model = Matrix44());
+	void update(Matrix44& view, const Matrix44& model = Matrix44(), bool isParentChanged = true);
 	/// <summary>Check the bounding sphere of the mesh if it's inside the view frustum. Draw the mesh if it's inside. And then calls the childrens' draw</summary>
 	/// <param name="frustumCheck">Has the view frustum planes and function to check if bounding sphere is inside of the frustum</param>
+	/// <param name="drawContext">State of the pass being drawn, like the occlusion buffer the mesh is tested against</param>
 	/// <param name="projection">a projection matrix</param>
 	/// <param name="view">a view matrix</param>
 	/// <param name="shaderBranch">Will have the ID of current shader branch. If value is -1 draw call will not draw wireframes.
@@ -50,16 +70,48 @@ public:
 	/// <param name="model">a model matrix</param>
 	/// <param name="bvScaleFactor">Scale factor used to scale the bounding sphere's radius</param>
 	/// <returns>void</returns>
-	void draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program to be used to render the object with</summary>
-	/// <summary>Specify which ID of shader program to use</summary>
-	/// <param name="shaderProgram">ID of a shader program</param>
+	void draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);	/// <summary>Assign a shader program to be used to render the object with</summary>
+	/// <summary>Draws all occurrences gathered by draw since the last call with one instanced draw call. Does nothing if the mesh isn't instanced or nothing was gathered.
+	///The matrices of the pass are taken from the FrameBlock</summary>
+	/// <param name="uniforms">Buffers the material of the mesh is sent with</param>
+	/// <param name="shaderBranch">ID of the current shader branch. If value is -1 the mesh is not drawn in wireframe</param>
 	/// <returns>void</returns>
-	void useShaderProgram(GLuint shaderProgram);
+	void drawInstances(UniformBuffers& uniforms, int shaderBranch = -1);
+	/// <summary>Stages the ObjectBlock of a packet with the material of this mesh</summary>
+	/// <param name="uniforms">Buffers to stage the block in</param>
+	/// <param name="model">a model matrix</param>
+	/// <returns>Index of the object to draw the packet with</returns>
+	unsigned int addObjectBlock(UniformBuffers& uniforms, const Matrix44& model);
+	/// <summary>Draws a packet of the render queue. Only changes the state which differs from the packet drawn before</summary>
+	/// <param name="uniforms">Buffers the ObjectBlock of the packet was uploaded to</param>
+	/// <param name="object">Index returned by addObjectBlock</param>
+	/// <param name="shaderMode">Shader branch to draw with</param>
+	/// <param name="isWireframe">True if the mesh is drawn with the wireframe shader branch</param>
+	/// <param name="state">State left by the packet before. Receives the state this packet leaves</param>
+	/// <returns>void</returns>
+	void drawPacket(UniformBuffers& uniforms, unsigned int object, int shaderMode, bool isWireframe, RenderState& state);
+	/// <summary>Merges the world space bounding sphere of the mesh into bounds</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="bounds">Sphere the bounding sphere is merged into</param>
+	/// <returns>void</returns>
+	void getBounds(const Matrix44& model, BoundingSphere& bounds);
+	/// <summary>Attaches the vertex VBO and the EBO of the mesh to the VAO which is bound and sets up the position, uv and normal attributes.
+	///Lets another class draw the triangles of the mesh from its own VAO with its own per-instance attributes</summary>
+	/// <returns>void</returns>
+	void attachVertexBuffers();
+	/// <summary>Returns the amount of indices in the EBO</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getIndexCount() const;
+	/// <summary>Specify which shader program to use</summary>
+	/// <param name="shaderProgram">a shader program with a variant per shader branch</param>
+	/// <returns>void</returns>
+	void useShaderProgram(ShaderProgram* shaderProgram);
 	/// <summary>Assign a texture to be used to render the object with</summary>
 	/// <param name="textureID">ID of a shader program</param>
 	/// <returns>void</returns>
 	void useTexture(GLuint textureID);
-	/// <summary>Object Loader. Takes the path to the obj file. Reads the data and puts it into VBOs on the VRAM. Also generates the bounding sphere for the mesh</summary>
+	/// <summary>Object Loader. Takes the path to the obj file. Reads the data and puts it into VBOs on the VRAM. Also generates the bounding sphere for the mesh.
+	///Uses the binary cache of the obj file if it is up to date. Otherwise the cache is written after the obj file has been parsed</summary>
 	/// <param name="path">Path to obj file</param>
 	/// <returns>void</returns>
 	void loadOBJ(const char* path);
@@ -93,6 +145,35 @@ public:
 	/// <param name="flag">On or Off</param>
 	/// <returns>void</returns>
 	void setWireframeBV(bool flag);
+	/// <summary>Sets how close vertex data has to be for indexVBO to merge two vertices. Has to be set before the obj file is loaded</summary>
+	/// <param name="epsilon">Cell size the vertex data is quantized to. 0 only merges vertices which are exactly the same</param>
+	/// <returns>void</returns>
+	void setWeldEpsilon(float epsilon);
+	/// <summary>Sets how the vertex attributes are stored in the VBO. Has to be set before the obj file is loaded</summary>
+	/// <param name="flags">VertexFormatFlags combined with |</param>
+	/// <returns>void</returns>
+	void setVertexFormat(unsigned int flags);
+	/// <summary>Sets a flag if the mesh hides other meshes and should be rasterized into the occlusion buffer.
+	///Has to be set before the obj file is loaded, since only occluders keep their positions and indices after loading</summary>
+	/// <param name="flag">On or Off</param>
+	/// <returns>void</returns>
+	void setOccluder(bool flag);
+	/// <summary>Returns true if the mesh is an occluder</summary>
+	/// <returns>bool</returns>
+	bool isOccluder() const;
+	/// <summary>Adds the triangles of the mesh to the occlusion buffer. Does nothing if the mesh isn't an occluder</summary>
+	/// <param name="occlusionBuffer">Buffer to add the triangles to</param>
+	/// <param name="model">a model matrix</param>
+	/// <returns>void</returns>
+	void addToOcclusionBuffer(OcclusionBuffer& occlusionBuffer, const Matrix44& model);
+	/// <summary>Sets a flag if the occurrences of the mesh in the scenegraph are drawn together. draw then only gathers the model matrices of the visible occurrences
+	///and drawInstances has to be called after each pass the mesh is drawn in</summary>
+	/// <param name="flag">On or Off</param>
+	/// <returns>void</returns>
+	void setInstanced(bool flag);
+	/// <summary>Returns true if the occurrences of the mesh are drawn together by drawInstances</summary>
+	/// <returns>bool</returns>
+	bool isInstanced() const;
 	/// <summary>Initialize VBO for a sphere which represents the bounding sphere of this mesh</summary>
 	/// <returns>void</returns>
 	void initWireframeBoundingSphere();
@@ -101,19 +182,8 @@ public:
 	void releaseWireframeBoundingSphere();
 	
 private:
-	//Handles for shader uniforms
-	GLuint m_shaderModeLocation; //Uniform to select a shader branch from the uber-shader
-	GLuint m_skyBoxSamplerLocation;
-	GLuint m_textureSamplerLocation;
-	GLuint m_depthMVPLocation;
-	GLuint m_ambientMaterialLocation;
-	GLuint m_specularMaterialLocation;
-	GLuint m_shininessLocation;
-
-	GLuint m_mvpLocation;
-	GLuint m_modelLocation;
-	GLuint m_viewLocation;
-	GLuint m_modelViewLocation;
+	//Handle for shader uniforms. The location depends on the variant in use
+	int m_isInstancedUniform;
 
 	//vertices, uvs, normals, indices
 	std::vector<Vector3> m_vertices;
@@ -125,34 +195,44 @@ private:
 	Vector3 m_centerPointBV;
 	//Radius of bounding sphere
 	float m_radiusBV;
+	//Cell size used by indexVBO to merge vertices which are almost the same. 0 only merges exact duplicates
+	float m_weldEpsilon;
+	//Layout of the interleaved vertices in the VBO
+	VertexFormat m_vertexFormat;
 
 	bool m_isWireframe;
 	bool m_isPlayer;
 	bool m_isFrustumCulling;
 	bool m_isWireframeBV;
 	bool m_isSkybox;
+	bool m_isOccluder;
+	bool m_isInstanced;
 
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
 	//VAO
 	GLuint m_vao;
-	//VBO Vertices
+	//VBO Vertices, uvs and normals interleaved
 	GLuint m_vertexVBO;
-	//VBO UVS
-	GLuint m_uvVBO;
-	//VBO Normals
-	GLuint m_normalVBO;
 	//EBO Indices
 	GLuint m_indicesEBO;
+	//Amount of indices in the EBO
+	unsigned int m_indexCount;
+	//VBO with a model matrix per instance. Created by the first drawInstances
+	GLuint m_instanceVBO;
+	//Model matrices of the occurrences gathered since the last drawInstances, 16 floats each in column order like the shader reads them
+	std::vector<float> m_instanceModels;
 
 	//Holds the texture that should be used by this mesh
 	GLuint m_textureID;
 
 	//Holds the shader program that should be used by this mesh
-	GLuint m_shaderProgram;
+	ShaderProgram* m_shaderProgram;
 
 	//Material Properties
+	//Small id of the material given when the mesh is created. Part of the render queue key
+	unsigned int m_materialID;
 	Vector3 m_ambientMaterial;
 	Vector3 m_specularMaterial;
 	float m_shininess;
@@ -166,28 +246,38 @@ private:
 	//VBO Vertices bounding sphere
 	GLuint m_wireframeBvVBO;
 
-	/// <summary>Used by indexVBO function to compare a vertex with vertices in a list. If one is found in the list. Function returns true and result parameter will hold the index of the vertex found in the list</summary>
-	/// <param name="packed">Holds vertex data for one vertex</param>
-	/// <param name="VertexToOutIndex">List of vertices as keys associated with their index as value</param>
-	/// <param name="result">Stores the index of vertex found in VertexToOutIndex list</param>
-	/// <returns>bool</returns>
-	bool getSimilarVertexIndex(PackedVertex& packed, std::map<PackedVertex, unsigned int>& VertexToOutIndex, unsigned int& result);
 	/// <summary>Vertex indexing. Generates lists of vertices with no duplicates. An indices list is also generated to tell which vertices should form a triangle.</summary>
 	/// <param name="in_vertices">list of vertices to index</param>
 	/// <param name="in_uvs">list of uvs to index</param>
 	/// <param name="in_normals">list of normals to index</param>
 	/// <returns>void</returns>
 	void indexVBO(std::vector<Vector3>& in_vertices, std::vector<Vector2>& in_uvs, std::vector<Vector3>& in_normals);
+	/// <summary>Creates the VAO and sends the indexed mesh to the VRAM</summary>
+	/// <param name="vertices">Interleaved vertices in the layout of m_vertexFormat</param>
+	/// <param name="vertexCount">Amount of vertices</param>
+	/// <param name="indices">Indices of the triangles</param>
+	/// <param name="indexCount">Amount of indices</param>
+	/// <returns>void</returns>
+	void initVBOs(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	/// <summary>Creates the VBO with the model matrix of each instance and adds it to the VAO as 4 attributes which advance once per instance</summary>
+	/// <returns>void</returns>
+	void initInstanceVBO();
+	/// <summary>Sets the polygon mode and texture of the mesh before it is drawn</summary>
+	/// <param name="shaderBranch">ID of the current shader branch. If value is -1 the mesh is not drawn in wireframe</param>
+	/// <returns>void</returns>
+	void bindMaterial(int shaderBranch);
+	/// <summary>Unbinds the texture and restores the state the skybox changes</summary>
+	/// <returns>void</returns>
+	void unbindMaterial();
 	/// <summary>Calculates a center point for the mesh and calculates the radius from the centerpoint which will encapsulate the whole object</summary>
 	/// <returns>void</returns>
 	void calculateBoundingSphere();
 	/// <summary>Draws the wireframe bounding sphere for this mesh</summary>
-	/// <param name="view">a view matrix</param>
-	/// <param name="projection">a projection matrix</param>
+	/// <param name="uniforms">Buffers the model matrix of the sphere is sent with</param>
 	/// <param name="position">position of the bounding sphere</param>
 	/// <param name="radius">radius of the bounding sphere</param>
 	/// <returns>void</returns>
-	void drawWireframeBoundingSphere(const Matrix44& view, const Matrix44& projection, Vector3 position, float radius);
+	void drawWireframeBoundingSphere(UniformBuffers& uniforms, Vector3 position, float radius);
 };
 
 #endif // Mesh_h__
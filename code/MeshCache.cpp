@@ -0,0 +1,195 @@
+#include "MeshCache.h"
+//memcmp, memcpy, memset
+#include <string.h>
+
+//Identifies a mesh cache file
+const char CacheMagic[4] = { 'M', 'E', 'S', 'H' };
+//Increase when the layout of the file changes so old caches are created again
+const unsigned int CacheVersion = 2;
+//Alignment of the vertex and index data in the file
+const unsigned int CacheAlignment = 16;
+
+MeshCache::MeshCache()
+{
+	m_data = NULL;
+	m_header = NULL;
+}
+
+MeshCache::~MeshCache()
+{
+	close();
+}
+
+bool MeshCache::open(const char* objPath, float weldEpsilon, const VertexFormat& format)
+{
+	close();
+
+	QFileInfo source(objPath);
+	if (!source.exists()){
+		return false;
+	}
+
+	m_file.setFileName(cachePath(objPath));
+	if (!m_file.open(QIODevice::ReadOnly)){
+		return false;
+	}
+	long long size = m_file.size();
+	if (size < (long long)sizeof(Header)){
+		close();
+		return false;
+	}
+	m_data = m_file.map(0, size);
+	if (m_data == NULL){
+		close();
+		return false;
+	}
+	m_header = (const Header*)m_data;
+
+	//Check that the cache is complete and was created the same way
+	bool valid = memcmp(m_header->magic, CacheMagic, sizeof(CacheMagic)) == 0 &&
+		m_header->version == CacheVersion &&
+		m_header->weldEpsilon == weldEpsilon &&
+		m_header->vertexFlags == format.flags() &&
+		m_header->vertexStride == format.stride() &&
+		m_header->vertexOffset + (long long)m_header->vertexCount * m_header->vertexStride <= size &&
+		m_header->indexOffset + (long long)m_header->indexCount * sizeof(unsigned int) <= size &&
+		m_header->sourceSize == source.size();
+
+	//The obj file has been saved since the cache was created. Only use the cache if the contents are still the same
+	if (valid && m_header->sourceModified != source.lastModified().toMSecsSinceEpoch()){
+		unsigned long long hash;
+		valid = hashFile(objPath, hash) && hash == m_header->sourceHash;
+	}
+
+	if (!valid){
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MeshCache::close()
+{
+	if (m_data != NULL){
+		m_file.unmap(m_data);
+	}
+	m_file.close();
+	m_data = NULL;
+	m_header = NULL;
+}
+
+bool MeshCache::write(const char* objPath, float weldEpsilon, const VertexFormat& format, const std::vector<unsigned char>& vertices, const std::vector<unsigned int>& indices, Vector3 centerPoint, float radius)
+{
+	QFileInfo source(objPath);
+	unsigned long long hash;
+	if (!hashFile(objPath, hash)){
+		return false;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+	header.version = CacheVersion;
+	header.sourceSize = source.size();
+	header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+	header.sourceHash = hash;
+	header.weldEpsilon = weldEpsilon;
+	header.vertexFlags = format.flags();
+	header.vertexStride = format.stride();
+	header.vertexCount = vertices.size() / format.stride();
+	header.indexCount = indices.size();
+	header.vertexOffset = (sizeof(Header) + CacheAlignment - 1) / CacheAlignment * CacheAlignment;
+	header.indexOffset = header.vertexOffset + vertices.size();
+	header.centerPoint[0] = centerPoint[0];
+	header.centerPoint[1] = centerPoint[1];
+	header.centerPoint[2] = centerPoint[2];
+	header.radius = radius;
+
+	QFile file(cachePath(objPath));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+		qDebug() << "Can't write mesh cache" << file.fileName();
+		return false;
+	}
+
+	//Header, padding up to the vertices, vertices and indices
+	char padding[CacheAlignment] = {};
+	long long expectedSize = header.indexOffset + (long long)indices.size() * sizeof(unsigned int);
+	long long written = file.write((const char*)&header, sizeof(Header));
+	written += file.write(padding, header.vertexOffset - sizeof(Header));
+	if (!vertices.empty()){
+		written += file.write((const char*)&vertices[0], vertices.size());
+	}
+	if (!indices.empty()){
+		written += file.write((const char*)&indices[0], indices.size() * sizeof(unsigned int));
+	}
+	file.close();
+
+	//Don't leave a broken cache behind
+	if (written != expectedSize){
+		qDebug() << "Can't write mesh cache" << file.fileName();
+		file.remove();
+		return false;
+	}
+	return true;
+}
+
+const void* MeshCache::vertexData() const
+{
+	return m_data + m_header->vertexOffset;
+}
+
+unsigned int MeshCache::vertexCount() const
+{
+	return m_header->vertexCount;
+}
+
+const unsigned int* MeshCache::indexData() const
+{
+	return (const unsigned int*)(m_data + m_header->indexOffset);
+}
+
+unsigned int MeshCache::indexCount() const
+{
+	return m_header->indexCount;
+}
+
+Vector3 MeshCache::centerPoint() const
+{
+	return Vector3(m_header->centerPoint[0], m_header->centerPoint[1], m_header->centerPoint[2]);
+}
+
+float MeshCache::radius() const
+{
+	return m_header->radius;
+}
+
+QString MeshCache::cachePath(const char* objPath)
+{
+	return QString(objPath) + ".mesh";
+}
+
+bool MeshCache::hashFile(const char* path, unsigned long long& hash)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)){
+		return false;
+	}
+
+	//FNV-1a offset basis
+	hash = 14695981039346656037ULL;
+
+	long long size = file.size();
+	if (size > 0){
+		uchar* data = file.map(0, size);
+		if (data == NULL){
+			return false;
+		}
+		for (long long i = 0; i < size; i++){
+			hash ^= data[i];
+			//FNV-1a prime
+			hash *= 1099511628211ULL;
+		}
+		file.unmap(data);
+	}
+	return true;
+}
@@ -0,0 +1,118 @@
+#ifndef MeshCache_h__
+#define MeshCache_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+//Layout of the interleaved vertices
+#include "VertexFormat.h"
+
+//Used to memory map the cache file
+#include <QFile>
+//Used to check when the obj file was modified
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+
+#include <vector>
+
+/// <remarks>
+///Binary cache of an indexed mesh stored next to the obj file it was created from (path + ".mesh").
+///Holds interleaved vertices in the layout of a VertexFormat, the indices and the bounding sphere.
+///The cache is memory mapped so the data can be handed straight to glBufferData without parsing or indexing the obj file again.
+///A cache is only used if it was created from the same obj file. The size and modification time are checked first and the contents are hashed if the time differs
+/// </remarks>
+class MeshCache
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <returns></returns>
+	MeshCache();
+	/// <summary>Destructor. Unmaps the cache file</summary>
+	/// <returns></returns>
+	~MeshCache();
+
+	/// <summary>Maps the cache of the obj file. Returns false if there is no cache or it was created from another version of the obj file, with another weld epsilon or vertex format</summary>
+	/// <param name="objPath">Path to the obj file</param>
+	/// <param name="weldEpsilon">Weld epsilon the vertices should have been indexed with</param>
+	/// <param name="format">Layout the vertices should be stored in</param>
+	/// <returns>bool</returns>
+	bool open(const char* objPath, float weldEpsilon, const VertexFormat& format);
+	/// <summary>Unmaps the cache file. The pointers to the data are no longer valid</summary>
+	/// <returns>void</returns>
+	void close();
+
+	/// <summary>Writes a cache for the obj file. Prints a message and returns false if the file can't be written</summary>
+	/// <param name="objPath">Path to the obj file the mesh was loaded from</param>
+	/// <param name="weldEpsilon">Weld epsilon the vertices were indexed with</param>
+	/// <param name="format">Layout of the vertices</param>
+	/// <param name="vertices">Interleaved vertices packed with the format</param>
+	/// <param name="indices">Indices of the triangles</param>
+	/// <param name="centerPoint">Center point of the bounding sphere</param>
+	/// <param name="radius">Radius of the bounding sphere</param>
+	/// <returns>bool</returns>
+	static bool write(const char* objPath, float weldEpsilon, const VertexFormat& format, const std::vector<unsigned char>& vertices, const std::vector<unsigned int>& indices, Vector3 centerPoint, float radius);
+
+	/// <summary>Returns the interleaved vertices in the mapped file</summary>
+	/// <returns>const void*</returns>
+	const void* vertexData() const;
+	/// <summary>Returns amount of vertices</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int vertexCount() const;
+	/// <summary>Returns the indices in the mapped file</summary>
+	/// <returns>const unsigned int*</returns>
+	const unsigned int* indexData() const;
+	/// <summary>Returns amount of indices</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int indexCount() const;
+	/// <summary>Returns the center point of the bounding sphere</summary>
+	/// <returns>Vector3</returns>
+	Vector3 centerPoint() const;
+	/// <summary>Returns the radius of the bounding sphere</summary>
+	/// <returns>float</returns>
+	float radius() const;
+
+private:
+	/// <remarks>
+	///Start of the cache file. The vertices and indices follow at the offsets
+	/// </remarks>
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		//Obj file the cache was created from
+		long long sourceSize;
+		long long sourceModified;
+		unsigned long long sourceHash;
+		float weldEpsilon;
+		//VertexFormatFlags and size of a vertex
+		unsigned int vertexFlags;
+		unsigned int vertexStride;
+
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		//Byte offsets from the start of the file
+		unsigned int vertexOffset;
+		unsigned int indexOffset;
+
+		float centerPoint[3];
+		float radius;
+	};
+
+	/// <summary>Returns the path of the cache for an obj file</summary>
+	/// <param name="objPath">Path to the obj file</param>
+	/// <returns>QString</returns>
+	static QString cachePath(const char* objPath);
+	/// <summary>Hashes the contents of a file with 64-bit FNV-1a</summary>
+	/// <param name="path">Path to the file</param>
+	/// <param name="hash">Receives the hash</param>
+	/// <returns>False if the file can't be read</returns>
+	static bool hashFile(const char* path, unsigned long long& hash);
+
+	QFile m_file;
+	//Start of the mapped file. NULL if no cache is open
+	uchar* m_data;
+	//Header at the start of the mapped file
+	const Header* m_header;
+};
+
+#endif // MeshCache_h__
@@ -2,6 +2,8 @@
 
 Node::Node()
 {
+	m_isChildListChanged = false;
+	m_isParentChanged = true;
 }
 
 Node::~Node(void)
@@ -10,8 +12,12 @@ Node::~Node(void)
 	m_children.clear();
 }
 
-void Node::update(Matrix44& view, const Matrix44& model)
+void Node::update(Matrix44& view, const Matrix44& model, bool isParentChanged)
 {
+	//The children have the same parent model matrix as this
+	isParentChanged = isParentChanged || m_isParentChanged;
+	m_isParentChanged = false;
+
 	//Calls the childrens' update
 	if (!m_children.empty())
 	{
@@ -19,13 +25,13 @@ void Node::update(Matrix44& view, const Matrix44& model)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->update(view, model);
+				m_children[i]->update(view, model, isParentChanged);
 			}
 		}
 	}
 }
 
-void Node::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
+void Node::draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
 {
 	//Calls the childrens' draw
 	if (!m_children.empty())
@@ -34,18 +40,45 @@ void Node::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, cons
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->draw(frustumCheck, projection, view, shaderBranch, lightView, model, bvScaleFactor);
+				m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, model, bvScaleFactor);
 			}
 		}
 	}
 }
 
+void Node::getBounds(const Matrix44& model, BoundingSphere& bounds)
+{
+	//Merges the childrens' bounds
+	for (int i = 0; i < m_children.size(); i++)
+	{
+		if (m_children[i] != NULL)
+		{
+			m_children[i]->getBounds(model, bounds);
+		}
+	}
+}
+
+bool Node::boundsChanged()
+{
+	//Changed if any child's bounds changed
+	for (int i = 0; i < m_children.size(); i++)
+	{
+		if (m_children[i] != NULL && m_children[i]->boundsChanged())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 void Node::addChildNode(Node* childNode)
 {
 	//Sets the child node's parent to this and adds the child to this node's children list
 	if(childNode != NULL)
 	{
 		m_children.push_back(childNode);
+		m_isChildListChanged = true;
+		childNode->m_isParentChanged = true;
 	}
 }
 
@@ -59,6 +92,7 @@ void Node::removeChildNode(Node* childNode)
 			if (m_children[i] == childNode)
 			{
 				m_children.erase(m_children.begin() + i);
+				m_isChildListChanged = true;
 				break; //break the for loop
 			}
 		}
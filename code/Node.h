@@ -2,12 +2,16 @@
 #define Node_h__
 
 //OpenGL Functions
-#include <QOpenGLFunctions_3_3_Core>
+#include "GLStateCache.h"
 
 //Math Library
 #include "mypersonalmathlib/mypersonalmathlib.h"
 
 #include "ViewFrustumCheck.h"
+//State of the pass passed down next to the frustum
+#include "DrawContext.h"
+//Merged bounding spheres of subtrees
+#include "BoundingSphere.h"
 
 #include <vector>
 
@@ -30,10 +34,12 @@ public:
 	/// <summary>Call the childrens' update. Reimplement in subclass for dynamic binding</summary>
 	/// <param name="view">a view matrix</param>
 	/// <param name="model">a model matrix</param>
+	/// <param name="isParentChanged">True if model changed since the last update. Transforms only multiply with it again when it did</param>
 	/// <returns>void</returns>
-	virtual void update(Matrix44& view, const Matrix44& model = Matrix44());
+	virtual void update(Matrix44& view, const Matrix44& model = Matrix44(), bool isParentChanged = true);
 	/// <summary>Call the childrens' draw. Reimplement in subclass for dynamic binding</summary>
 	/// <param name="frustumCheck">Has the view frustum planes and function to check if bounding sphere is inside of the frustum</param>
+	/// <param name="drawContext">State of the pass being drawn, like the occlusion buffer and the render queue</param>
 	/// <param name="projection">a projection matrix</param>
 	/// <param name="view">a view matrix</param>
 	/// <param name="shaderBranch">Will have the ID of current shader branch. If value is -1 draw call will not draw wireframes.
@@ -42,7 +48,15 @@ public:
 	/// <param name="model">a model matrix</param>
 	/// <param name="bvScaleFactor">Scale factor used to scale the bounding sphere's radius</param>
 	/// <returns>void</returns>
-	virtual void draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);
+	virtual void draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);
+	/// <summary>Merges the world space bounding spheres of this node and its children into bounds. Reimplement in subclass for dynamic binding</summary>
+	/// <param name="model">the parent's model matrix</param>
+	/// <param name="bounds">Sphere the bounding spheres are merged into</param>
+	/// <returns>void</returns>
+	virtual void getBounds(const Matrix44& model, BoundingSphere& bounds);
+	/// <summary>Returns true if the bounding sphere of this node changed in the last update. Reimplement in subclass for dynamic binding</summary>
+	/// <returns>bool</returns>
+	virtual bool boundsChanged();
 	/// <summary>Adds a child node</summary>
 	/// <param name="childNode">A node to add as child for this</param>
 	/// <returns>void</returns>
@@ -55,5 +69,9 @@ public:
 protected:
 	//Holds children nodes
 	std::vector<Node*> m_children;
+	//Set when a child is added or removed. Tells a transform its merged bounding sphere is out of date
+	bool m_isChildListChanged;
+	//Set when this node is added to a parent. The next update treats the parent's model matrix as changed, since it is another parent's
+	bool m_isParentChanged;
 };
 #endif // Node_h__
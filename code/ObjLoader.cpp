@@ -0,0 +1,453 @@
+#include "ObjLoader.h"
+//printf
+#include <stdio.h>
+//memchr
+#include <string.h>
+//pow
+#include <math.h>
+//copy
+#include <algorithm>
+
+//Files smaller than this are not split into chunks. Parsing a small chunk is faster than handing it to another thread
+const unsigned int MinChunkSize = 256 * 1024;
+//Powers of 10 which can be represented exactly by a double
+const double ExactPowersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+//Most digits which fit in the 64-bit mantissa while parsing a number
+const int MaxMantissaDigits = 19;
+
+const unsigned int ObjLoader::NoIndex;
+
+/// <summary>Checks if the character separates the words on a line</summary>
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+/// <summary>Checks if the character is a digit</summary>
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/// <summary>Returns a pointer to the first character which doesn't separate words. Stops at the end of the line</summary>
+static inline const char* skipSpaces(const char* p, const char* end)
+{
+	while (p < end && isSpace(*p)){
+		p++;
+	}
+	return p;
+}
+
+/// <summary>Returns a pointer to the first character of the next line</summary>
+static inline const char* skipLine(const char* p, const char* end)
+{
+	const char* lineBreak = (const char*)memchr(p, '\n', end - p);
+	return lineBreak != NULL ? lineBreak + 1 : end;
+}
+
+/// <summary>Parses a float such as -1.5, 2 or 3.0e-4. The value is 0 if there is no number</summary>
+/// <returns>Pointer to the first character after the number</returns>
+static const char* parseFloat(const char* p, const char* end, float& value)
+{
+	p = skipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+
+	//The digits are gathered as an integer and the decimal point is moved with the exponent
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	for (; p < end && isDigit(*p); p++){
+		if (digits < MaxMantissaDigits){
+			mantissa = mantissa * 10 + (*p - '0');
+			//Leading zeros are not significant
+			if (mantissa != 0){
+				digits++;
+			}
+		}
+		else{
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.'){
+		for (p++; p < end && isDigit(*p); p++){
+			if (digits < MaxMantissaDigits){
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0){
+					digits++;
+				}
+				exponent--;
+			}
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')){
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')){
+			negativeExponent = *p == '-';
+			p++;
+		}
+		int writtenExponent = 0;
+		for (; p < end && isDigit(*p); p++){
+			//Anything this big is out of range for a float anyway
+			if (writtenExponent < 1000){
+				writtenExponent = writtenExponent * 10 + (*p - '0');
+			}
+		}
+		exponent += negativeExponent ? -writtenExponent : writtenExponent;
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0){
+		result /= -exponent <= 22 ? ExactPowersOf10[-exponent] : pow(10.0, -exponent);
+	}
+	else if (exponent > 0){
+		result *= exponent <= 22 ? ExactPowersOf10[exponent] : pow(10.0, exponent);
+	}
+	value = (float)(negative ? -result : result);
+
+	return p;
+}
+
+/// <summary>Parses an index of a face corner. The index is 0 if there is no number</summary>
+/// <returns>Pointer to the first character after the index</returns>
+static inline const char* parseIndex(const char* p, const char* end, int& index)
+{
+	bool negative = false;
+	if (p < end && *p == '-'){
+		negative = true;
+		p++;
+	}
+
+	index = 0;
+	for (; p < end && isDigit(*p); p++){
+		index = index * 10 + (*p - '0');
+	}
+	if (negative){
+		index = -index;
+	}
+
+	return p;
+}
+
+/// <summary>Resolves a relative index to an index starting at 1 using the amount of elements read so far</summary>
+static inline int resolveIndex(int index, unsigned int count, bool& hasRelativeIndex)
+{
+	if (index < 0){
+		hasRelativeIndex = true;
+		return (int)count + index + 1;
+	}
+	return index;
+}
+
+ObjLoader::ObjLoader()
+{
+	m_outVertices = NULL;
+	m_outUvs = NULL;
+	m_outNormals = NULL;
+}
+
+ObjLoader::~ObjLoader()
+{
+}
+
+bool ObjLoader::load(const char* path)
+{
+	m_loadTimer.start();
+
+	vertices.clear();
+	uvs.clear();
+	normals.clear();
+	vertexIndices.clear();
+	uvIndices.clear();
+	normalIndices.clear();
+
+	//Open the file in read only mode
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)){
+		printf("Impossible to open the file !\n");
+		return false;
+	}
+
+	//Map the file to memory so it can be parsed in place. Read it into a buffer if the file can't be mapped
+	unsigned int size = file.size();
+	const char* data = NULL;
+	uchar* mapped = NULL;
+	std::vector<char> buffer;
+	if (size > 0){
+		mapped = file.map(0, size);
+		if (mapped != NULL){
+			data = (const char*)mapped;
+		}
+		else{
+			buffer.resize(size);
+			size = file.read(&buffer[0], size);
+			data = &buffer[0];
+		}
+	}
+
+	//One chunk per thread as long as the chunks are big enough to be worth it
+	unsigned int chunkCount = QThreadPool::globalInstance()->maxThreadCount();
+	if (size / MinChunkSize < chunkCount){
+		chunkCount = size / MinChunkSize;
+	}
+	if (chunkCount < 1){
+		chunkCount = 1;
+	}
+	splitChunks(data, size, chunkCount);
+	parallelFor(m_chunks.size(), RangeKernel<ObjLoader>(this, &ObjLoader::parseChunks), 1);
+
+	//Relative indices refer to data read before them, which could be in another chunk. Parse the file again as a single chunk if there are any
+	if (m_chunks.size() > 1){
+		bool hasRelativeIndex = false;
+		for (unsigned int i = 0; i < m_chunks.size(); i++){
+			hasRelativeIndex = hasRelativeIndex || m_chunks[i].hasRelativeIndex;
+		}
+		if (hasRelativeIndex){
+			splitChunks(data, size, 1);
+			parseChunks(0, 1);
+		}
+	}
+
+	//The chunks are placed after each other in file order
+	unsigned int vertexCount = 0;
+	unsigned int uvCount = 0;
+	unsigned int normalCount = 0;
+	unsigned int indexCount = 0;
+	for (unsigned int i = 0; i < m_chunks.size(); i++){
+		m_chunks[i].vertexOffset = vertexCount;
+		m_chunks[i].uvOffset = uvCount;
+		m_chunks[i].normalOffset = normalCount;
+		m_chunks[i].indexOffset = indexCount;
+
+		vertexCount += m_chunks[i].vertices.size();
+		uvCount += m_chunks[i].uvs.size();
+		normalCount += m_chunks[i].normals.size();
+		indexCount += m_chunks[i].vertexIndices.size();
+	}
+	vertices.resize(vertexCount);
+	uvs.resize(uvCount);
+	normals.resize(normalCount);
+	vertexIndices.resize(indexCount);
+	uvIndices.resize(indexCount);
+	normalIndices.resize(indexCount);
+
+	parallelFor(m_chunks.size(), RangeKernel<ObjLoader>(this, &ObjLoader::mergeChunks), 1);
+
+	//Done with the file
+	if (mapped != NULL){
+		file.unmap(mapped);
+	}
+	file.close();
+
+	bool hasError = false;
+	for (unsigned int i = 0; i < m_chunks.size(); i++){
+		hasError = hasError || m_chunks[i].hasError;
+	}
+	m_chunks.clear();
+
+	if (hasError){
+		printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+		vertices.clear();
+		uvs.clear();
+		normals.clear();
+		vertexIndices.clear();
+		uvIndices.clear();
+		normalIndices.clear();
+		return false;
+	}
+
+	qDebug() << path << "loaded in" << m_loadTimer.elapsed() << "ms" << vertices.size() << "Vertices" << vertexIndices.size() / 3 << "Triangles" << chunkCount << "Chunks";
+	return true;
+}
+
+void ObjLoader::getTriangleCorners(std::vector<Vector3>& outVertices, std::vector<Vector2>& outUvs, std::vector<Vector3>& outNormals)
+{
+	outVertices.resize(vertexIndices.size());
+	outUvs.resize(vertexIndices.size());
+	outNormals.resize(vertexIndices.size());
+
+	m_outVertices = &outVertices;
+	m_outUvs = &outUvs;
+	m_outNormals = &outNormals;
+
+	parallelFor(vertexIndices.size() / 3, RangeKernel<ObjLoader>(this, &ObjLoader::writeTriangleCorners));
+
+	m_outVertices = NULL;
+	m_outUvs = NULL;
+	m_outNormals = NULL;
+}
+
+void ObjLoader::splitChunks(const char* data, unsigned int size, unsigned int chunkCount)
+{
+	m_chunks.clear();
+	m_chunks.resize(chunkCount);
+
+	const char* fileEnd = data + size;
+	const char* begin = data;
+	for (unsigned int i = 0; i < chunkCount; i++){
+		const char* end = fileEnd;
+		//Every chunk but the last ends after the first line break following its share of the file
+		if (i + 1 < chunkCount){
+			end = data + (unsigned long long)size * (i + 1) / chunkCount;
+			if (end < begin){
+				end = begin;
+			}
+			end = skipLine(end, fileEnd);
+		}
+
+		m_chunks[i].begin = begin;
+		m_chunks[i].end = end;
+		m_chunks[i].hasRelativeIndex = false;
+		m_chunks[i].hasError = false;
+		begin = end;
+	}
+}
+
+void ObjLoader::parseChunks(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++){
+		parseChunk(m_chunks[i]);
+	}
+}
+
+void ObjLoader::parseChunk(Chunk& chunk)
+{
+	//Indices of the corners of the current face. Reused for every face
+	std::vector<int> faceVertices;
+	std::vector<int> faceUvs;
+	std::vector<int> faceNormals;
+
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+	while (p < end){
+		p = skipSpaces(p, end);
+
+		//Check the first word of the line
+		if (end - p > 1 && p[0] == 'v' && isSpace(p[1])){
+			Vector3 vertex;
+			p = parseFloat(p + 1, end, vertex[0]);
+			p = parseFloat(p, end, vertex[1]);
+			p = parseFloat(p, end, vertex[2]);
+			chunk.vertices.push_back(vertex);
+		}
+		else if (end - p > 2 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])){
+			Vector2 uv;
+			p = parseFloat(p + 2, end, uv[0]);
+			p = parseFloat(p, end, uv[1]);
+			chunk.uvs.push_back(uv);
+		}
+		else if (end - p > 2 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])){
+			Vector3 normal;
+			p = parseFloat(p + 2, end, normal[0]);
+			p = parseFloat(p, end, normal[1]);
+			p = parseFloat(p, end, normal[2]);
+			chunk.normals.push_back(normal);
+		}
+		else if (end - p > 1 && p[0] == 'f' && isSpace(p[1])){
+			faceVertices.clear();
+			faceUvs.clear();
+			faceNormals.clear();
+
+			//Read corners written as v, v/vt, v//vn or v/vt/vn until the end of the line
+			p = skipSpaces(p + 1, end);
+			while (p < end && (isDigit(*p) || *p == '-')){
+				int vertexIndex = 0;
+				int uvIndex = 0;
+				int normalIndex = 0;
+
+				p = parseIndex(p, end, vertexIndex);
+				if (p < end && *p == '/'){
+					p = parseIndex(p + 1, end, uvIndex);
+					if (p < end && *p == '/'){
+						p = parseIndex(p + 1, end, normalIndex);
+					}
+				}
+
+				faceVertices.push_back(resolveIndex(vertexIndex, chunk.vertices.size(), chunk.hasRelativeIndex));
+				faceUvs.push_back(resolveIndex(uvIndex, chunk.uvs.size(), chunk.hasRelativeIndex));
+				faceNormals.push_back(resolveIndex(normalIndex, chunk.normals.size(), chunk.hasRelativeIndex));
+
+				p = skipSpaces(p, end);
+			}
+
+			//A face needs at least 3 corners and only a comment can follow the last corner
+			if (faceVertices.size() < 3 || (p < end && *p != '\n' && *p != '#')){
+				chunk.hasError = true;
+			}
+			else{
+				//Triangulate the polygon as a fan from the first corner
+				for (unsigned int i = 1; i + 1 < faceVertices.size(); i++){
+					chunk.vertexIndices.push_back(faceVertices[0]);
+					chunk.vertexIndices.push_back(faceVertices[i]);
+					chunk.vertexIndices.push_back(faceVertices[i + 1]);
+					chunk.uvIndices.push_back(faceUvs[0]);
+					chunk.uvIndices.push_back(faceUvs[i]);
+					chunk.uvIndices.push_back(faceUvs[i + 1]);
+					chunk.normalIndices.push_back(faceNormals[0]);
+					chunk.normalIndices.push_back(faceNormals[i]);
+					chunk.normalIndices.push_back(faceNormals[i + 1]);
+				}
+			}
+		}
+
+		//Move on to the next line. Anything else on the line is data we don't need
+		p = skipLine(p, end);
+	}
+}
+
+void ObjLoader::mergeChunks(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++){
+		Chunk& chunk = m_chunks[i];
+
+		std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + chunk.vertexOffset);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.uvOffset);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset);
+
+		//Indices start at 1 in obj files but in programming it's off by 1. Indices which are out of range can't be handled
+		for (unsigned int j = 0; j < chunk.vertexIndices.size(); j++){
+			int vertexIndex = chunk.vertexIndices[j];
+			int uvIndex = chunk.uvIndices[j];
+			int normalIndex = chunk.normalIndices[j];
+
+			if (vertexIndex < 1 || vertexIndex > (int)vertices.size() || uvIndex < 0 || uvIndex > (int)uvs.size() || normalIndex < 0 || normalIndex > (int)normals.size()){
+				chunk.hasError = true;
+				vertexIndex = 1;
+				uvIndex = 0;
+				normalIndex = 0;
+			}
+
+			vertexIndices[chunk.indexOffset + j] = vertexIndex - 1;
+			uvIndices[chunk.indexOffset + j] = uvIndex != 0 ? uvIndex - 1 : NoIndex;
+			normalIndices[chunk.indexOffset + j] = normalIndex != 0 ? normalIndex - 1 : NoIndex;
+		}
+	}
+}
+
+void ObjLoader::writeTriangleCorners(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++){
+		Vector3 p1 = vertices[vertexIndices[3 * i]];
+		Vector3 p2 = vertices[vertexIndices[3 * i + 1]];
+		Vector3 p3 = vertices[vertexIndices[3 * i + 2]];
+
+		//Normal of the triangle. Used by the corners which don't have a normal
+		Vector3 edge1 = p2 - p1;
+		Vector3 faceNormal = edge1.Cross(p3 - p1);
+		float length = faceNormal.Magnitude();
+		if (length > 0){
+			faceNormal /= length;
+		}
+
+		for (unsigned int j = 3 * i; j < 3 * i + 3; j++){
+			(*m_outVertices)[j] = vertices[vertexIndices[j]];
+			(*m_outUvs)[j] = uvIndices[j] != NoIndex ? uvs[uvIndices[j]] : Vector2();
+			(*m_outNormals)[j] = normalIndices[j] != NoIndex ? normals[normalIndices[j]] : faceNormal;
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#ifndef ObjLoader_h__
+#define ObjLoader_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+//Used to parse the chunks of the file on multiple threads
+#include "ParallelFor.h"
+
+//Used to memory map the file
+#include <QFile>
+//Used to time how long it takes to load a file
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <vector>
+
+/// <remarks>
+///Loads Wavefront obj files. Used by both Mesh and HalfEdgeMesh.
+///The file is memory mapped and split into chunks at line breaks. The chunks are parsed on the thread pool and merged in file order.
+///Faces can be written as v, v/vt, v//vn or v/vt/vn and can have any amount of corners. Polygons are triangulated as a fan
+/// </remarks>
+class ObjLoader
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <returns></returns>
+	ObjLoader();
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~ObjLoader();
+
+	/// <summary>Loads the obj file. Prints an error and returns false if the file can't be opened or has a face it can't handle</summary>
+	/// <param name="path">Path to the obj file</param>
+	/// <returns>bool</returns>
+	bool load(const char* path);
+	/// <summary>Creates lists with the vertex data of each triangle corner in the order the obj file specifies.
+	///Corners without a uv get a zero uv and corners without a normal get the normal of the triangle</summary>
+	/// <param name="outVertices">Receives the position of each corner</param>
+	/// <param name="outUvs">Receives the uv of each corner</param>
+	/// <param name="outNormals">Receives the normal of each corner</param>
+	/// <returns>void</returns>
+	void getTriangleCorners(std::vector<Vector3>& outVertices, std::vector<Vector2>& outUvs, std::vector<Vector3>& outNormals);
+
+	//Index used when a corner doesn't specify a uv or normal
+	static const unsigned int NoIndex = 0xFFFFFFFF;
+
+	//Vertex data in the order it's listed in the file
+	std::vector<Vector3> vertices;
+	std::vector<Vector2> uvs;
+	std::vector<Vector3> normals;
+
+	//Indices of the vertex data for each triangle corner. Three corners form a triangle. Starts at 0 unlike the obj file
+	std::vector<unsigned int> vertexIndices;
+	std::vector<unsigned int> uvIndices;
+	std::vector<unsigned int> normalIndices;
+
+private:
+	/// <remarks>
+	///Part of the file which is parsed by one thread. Holds the data found in that part until it's merged
+	/// </remarks>
+	struct Chunk
+	{
+		//Range of the file the chunk covers. Always starts at the beginning of a line
+		const char* begin;
+		const char* end;
+
+		std::vector<Vector3> vertices;
+		std::vector<Vector2> uvs;
+		std::vector<Vector3> normals;
+
+		//Indices as written in the file but relative indices have been resolved. Starts at 1 and 0 means the corner doesn't have the data
+		std::vector<int> vertexIndices;
+		std::vector<int> uvIndices;
+		std::vector<int> normalIndices;
+
+		//Where the data of the chunk is placed in the merged lists
+		unsigned int vertexOffset;
+		unsigned int uvOffset;
+		unsigned int normalOffset;
+		unsigned int indexOffset;
+
+		//Set if the chunk has a relative index. They can only be resolved while parsing if the whole file is one chunk
+		bool hasRelativeIndex;
+		//Set if the chunk has a face the loader can't handle or an index which is out of range
+		bool hasError;
+	};
+
+	/// <summary>Splits the file into chunks at line breaks. One chunk per thread as long as the chunks are big enough</summary>
+	/// <param name="data">Contents of the file</param>
+	/// <param name="size">Size of the file in bytes</param>
+	/// <param name="chunkCount">Amount of chunks to split the file into</param>
+	/// <returns>void</returns>
+	void splitChunks(const char* data, unsigned int size, unsigned int chunkCount);
+	/// <summary>Parses a range of chunks</summary>
+	/// <param name="begin">First chunk</param>
+	/// <param name="end">One past the last chunk</param>
+	/// <returns>void</returns>
+	void parseChunks(unsigned int begin, unsigned int end);
+	/// <summary>Parses the lines of a chunk and stores the data in the chunk</summary>
+	/// <param name="chunk">Chunk to parse</param>
+	/// <returns>void</returns>
+	void parseChunk(Chunk& chunk);
+	/// <summary>Copies the data of a range of chunks to the merged lists and converts the indices to start at 0</summary>
+	/// <param name="begin">First chunk</param>
+	/// <param name="end">One past the last chunk</param>
+	/// <returns>void</returns>
+	void mergeChunks(unsigned int begin, unsigned int end);
+	/// <summary>Writes the vertex data of the corners of a range of triangles to the output lists</summary>
+	/// <param name="begin">First triangle</param>
+	/// <param name="end">One past the last triangle</param>
+	/// <returns>void</returns>
+	void writeTriangleCorners(unsigned int begin, unsigned int end);
+
+	//Chunks of the file being loaded
+	std::vector<Chunk> m_chunks;
+
+	//Output lists used by getTriangleCorners while the triangles are written
+	std::vector<Vector3>* m_outVertices;
+	std::vector<Vector2>* m_outUvs;
+	std::vector<Vector3>* m_outNormals;
+
+	//Timer to check how long it takes to load a file
+	QElapsedTimer m_loadTimer;
+};
+
+#endif // ObjLoader_h__
@@ -0,0 +1,347 @@
+#include "OcclusionBuffer.h"
+//Threads for the rasterization
+#include "ParallelFor.h"
+//4 pixels at a time
+#include "mypersonalmathlib/simd4.h"
+//floor, ceil
+#include <math.h>
+//fill
+#include <algorithm>
+
+//Pixels along each side of a tile. The width and height of the buffer are multiples of it
+const unsigned int OcclusionTileSize = 8;
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+{
+	resize(width, height);
+	m_testedCount = 0;
+	m_occludedCount = 0;
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+void OcclusionBuffer::resize(unsigned int width, unsigned int height)
+{
+	m_tilesX = (width + OcclusionTileSize - 1) / OcclusionTileSize;
+	m_tilesY = (height + OcclusionTileSize - 1) / OcclusionTileSize;
+	m_width = m_tilesX * OcclusionTileSize;
+	m_height = m_tilesY * OcclusionTileSize;
+
+	//Nothing rasterized yet, everything is at the far plane
+	m_depth.assign(m_width * m_height, 1.0f);
+	m_tileMin.assign(m_tilesX * m_tilesY, 1.0f);
+	m_tileMax.assign(m_tilesX * m_tilesY, 1.0f);
+	m_triangles.clear();
+}
+
+void OcclusionBuffer::begin(const Matrix44& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	m_triangles.clear();
+	m_testedCount = 0;
+	m_occludedCount = 0;
+}
+
+void OcclusionBuffer::addOccluder(const Matrix44& model, const Vector3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	//Transform each vertex once, they are shared by several triangles
+	Matrix44 modelViewProjection = m_viewProjection * model;
+	m_clipVertices.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++){
+		Vector3 vertex = vertices[i];
+		m_clipVertices[i] = modelViewProjection * Vector4(vertex[0], vertex[1], vertex[2], 1);
+	}
+
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3){
+		addClippedTriangle(m_clipVertices[indices[i]], m_clipVertices[indices[i + 1]], m_clipVertices[indices[i + 2]]);
+	}
+}
+
+void OcclusionBuffer::rasterize()
+{
+	//Each thread gets its own tile rows. One row is 8 pixel rows of the whole width
+	parallelFor(m_tilesY, RangeKernel<OcclusionBuffer>(this, &OcclusionBuffer::rasterizeTileRows), 1);
+}
+
+bool OcclusionBuffer::isBoxVisible(const Matrix44& model, Vector3 boxMin, Vector3 boxMax)
+{
+	m_testedCount++;
+	if (m_triangles.empty()){
+		return true;
+	}
+
+	//Screen rectangle and nearest depth of the 8 corners
+	Matrix44 modelViewProjection = m_viewProjection * model;
+	float minX = (float)m_width;
+	float minY = (float)m_height;
+	float maxX = 0;
+	float maxY = 0;
+	float minDepth = 1;
+	for (int i = 0; i < 8; i++){
+		Vector4 corner((i & 1) ? boxMax[0] : boxMin[0], (i & 2) ? boxMax[1] : boxMin[1], (i & 4) ? boxMax[2] : boxMin[2], 1);
+		Vector4 clip = modelViewProjection * corner;
+
+		//The box reaches the camera, can't be behind anything
+		if (clip[3] <= 0 || clip[2] < -clip[3]){
+			return true;
+		}
+
+		float x = (clip[0] / clip[3] * 0.5f + 0.5f) * m_width;
+		float y = (clip[1] / clip[3] * 0.5f + 0.5f) * m_height;
+		float depth = clip[2] / clip[3] * 0.5f + 0.5f;
+		minX = x < minX ? x : minX;
+		maxX = x > maxX ? x : maxX;
+		minY = y < minY ? y : minY;
+		maxY = y > maxY ? y : maxY;
+		minDepth = depth < minDepth ? depth : minDepth;
+	}
+
+	//Every pixel the rectangle touches, and one more on each side so the float rounding of the corners can't make it smaller than the box
+	int x0 = (int)floor(minX) - 1;
+	int y0 = (int)floor(minY) - 1;
+	int x1 = (int)ceil(maxX);
+	int y1 = (int)ceil(maxY);
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 >= (int)m_width ? m_width - 1 : x1;
+	y1 = y1 >= (int)m_height ? m_height - 1 : y1;
+	//Outside the screen. Left to the frustum culling
+	if (x0 > x1 || y0 > y1){
+		return true;
+	}
+
+	for (int tileY = y0 / OcclusionTileSize; tileY <= y1 / (int)OcclusionTileSize; tileY++){
+		for (int tileX = x0 / OcclusionTileSize; tileX <= x1 / (int)OcclusionTileSize; tileX++){
+			unsigned int tile = tileY * m_tilesX + tileX;
+			//Everything in the tile is in front of the box
+			if (minDepth >= m_tileMax[tile]){
+				continue;
+			}
+			//The box is in front of everything in the tile
+			if (minDepth < m_tileMin[tile]){
+				return true;
+			}
+
+			//Only the pixels of the tile inside the rectangle decide
+			int startX = tileX * OcclusionTileSize > x0 ? tileX * OcclusionTileSize : x0;
+			int startY = tileY * OcclusionTileSize > y0 ? tileY * OcclusionTileSize : y0;
+			int endX = (tileX + 1) * OcclusionTileSize - 1 < x1 ? (tileX + 1) * OcclusionTileSize - 1 : x1;
+			int endY = (tileY + 1) * OcclusionTileSize - 1 < y1 ? (tileY + 1) * OcclusionTileSize - 1 : y1;
+			for (int y = startY; y <= endY; y++){
+				const float* row = &m_depth[y * m_width];
+				for (int x = startX; x <= endX; x++){
+					if (minDepth < row[x]){
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	m_occludedCount++;
+	return false;
+}
+
+unsigned int OcclusionBuffer::getWidth() const
+{
+	return m_width;
+}
+
+unsigned int OcclusionBuffer::getHeight() const
+{
+	return m_height;
+}
+
+float OcclusionBuffer::getDepth(unsigned int x, unsigned int y) const
+{
+	return m_depth[y * m_width + x];
+}
+
+unsigned int OcclusionBuffer::getTriangleCount() const
+{
+	return m_triangles.size();
+}
+
+unsigned int OcclusionBuffer::getTestedCount() const
+{
+	return m_testedCount;
+}
+
+unsigned int OcclusionBuffer::getOccludedCount() const
+{
+	return m_occludedCount;
+}
+
+void OcclusionBuffer::addClippedTriangle(Vector4 a, Vector4 b, Vector4 c)
+{
+	//Distance to the near plane, z = -w in clip space
+	float distanceA = a[2] + a[3];
+	float distanceB = b[2] + b[3];
+	float distanceC = c[2] + c[3];
+
+	if (distanceA >= 0 && distanceB >= 0 && distanceC >= 0){
+		setupTriangle(a, b, c);
+		return;
+	}
+	if (distanceA < 0 && distanceB < 0 && distanceC < 0){
+		return;
+	}
+
+	//Walk the edges and keep the corners in front of the near plane and the points where the edges cross it. Gives 3 or 4 corners
+	Vector4 corners[3] = { a, b, c };
+	float distances[3] = { distanceA, distanceB, distanceC };
+	Vector4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++){
+		int next = (i + 1) % 3;
+		if (distances[i] >= 0){
+			polygon[count++] = corners[i];
+		}
+		if ((distances[i] >= 0) != (distances[next] >= 0)){
+			float t = distances[i] / (distances[i] - distances[next]);
+			polygon[count++] = corners[i] + (corners[next] - corners[i]) * t;
+		}
+	}
+
+	for (int i = 1; i + 1 < count; i++){
+		setupTriangle(polygon[0], polygon[i], polygon[i + 1]);
+	}
+}
+
+void OcclusionBuffer::setupTriangle(Vector4 a, Vector4 b, Vector4 c)
+{
+	//Perspective division and viewport transform
+	float x[3], y[3], z[3];
+	Vector4 corners[3] = { a, b, c };
+	for (int i = 0; i < 3; i++){
+		float w = corners[i][3] > 0 ? corners[i][3] : 1e-7f;
+		x[i] = (corners[i][0] / w * 0.5f + 0.5f) * m_width;
+		y[i] = (corners[i][1] / w * 0.5f + 0.5f) * m_height;
+		z[i] = corners[i][2] / w * 0.5f + 0.5f;
+	}
+
+	//Occluders are drawn from both sides, so clockwise triangles are turned around
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0){
+		return;
+	}
+	if (area < 0){
+		float swap;
+		swap = x[1]; x[1] = x[2]; x[2] = swap;
+		swap = y[1]; y[1] = y[2]; y[2] = swap;
+		swap = z[1]; z[1] = z[2]; z[2] = swap;
+		area = -area;
+	}
+
+	//Pixels whose centers are inside the triangle. Every pixel completely inside is one of them
+	Triangle triangle;
+	float minX = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2]) : (x[1] < x[2] ? x[1] : x[2]);
+	float maxX = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2]) : (x[1] > x[2] ? x[1] : x[2]);
+	float minY = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2]) : (y[1] < y[2] ? y[1] : y[2]);
+	float maxY = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2]) : (y[1] > y[2] ? y[1] : y[2]);
+	if (maxX < 0 || maxY < 0 || minX > m_width || minY > m_height){
+		return;
+	}
+	triangle.minX = minX - 0.5f > 0 ? (int)ceil(minX - 0.5f) : 0;
+	triangle.minY = minY - 0.5f > 0 ? (int)ceil(minY - 0.5f) : 0;
+	triangle.maxX = maxX - 0.5f < m_width - 1 ? (int)floor(maxX - 0.5f) : m_width - 1;
+	triangle.maxY = maxY - 0.5f < m_height - 1 ? (int)floor(maxY - 0.5f) : m_height - 1;
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY){
+		return;
+	}
+
+	//Edge from corner i to the next one. Positive on the inside of the counter clockwise triangle.
+	//Moved inwards by half a pixel along each axis, so at a pixel center it is the value at the pixel's worst corner and only pixels completely inside pass
+	for (int i = 0; i < 3; i++){
+		int next = (i + 1) % 3;
+		triangle.edgeA[i] = y[i] - y[next];
+		triangle.edgeB[i] = x[next] - x[i];
+		triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]) - 0.5f * (fabs(triangle.edgeA[i]) + fabs(triangle.edgeB[i]));
+	}
+
+	//z/w changes linearly over the screen. Moved back by half a pixel along each axis, so at a pixel center it is the farthest depth of the triangle in that pixel
+	triangle.depthX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.depthY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	triangle.depthC = z[0] - triangle.depthX * x[0] - triangle.depthY * y[0] + 0.5f * (fabs(triangle.depthX) + fabs(triangle.depthY));
+
+	m_triangles.push_back(triangle);
+}
+
+void OcclusionBuffer::rasterizeTileRows(unsigned int begin, unsigned int end)
+{
+	int firstRow = begin * OcclusionTileSize;
+	int lastRow = end * OcclusionTileSize - 1;
+	std::fill(m_depth.begin() + firstRow * m_width, m_depth.begin() + (lastRow + 1) * m_width, 1.0f);
+
+	const Simd4::Float4 zero = Simd4::Splat(0);
+	const Simd4::Float4 pixelOffsets = Simd4::Set(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (unsigned int i = 0; i < m_triangles.size(); i++){
+		const Triangle& triangle = m_triangles[i];
+		int startY = triangle.minY > firstRow ? triangle.minY : firstRow;
+		int endY = triangle.maxY < lastRow ? triangle.maxY : lastRow;
+		if (startY > endY){
+			continue;
+		}
+
+		//4 pixels at a time. Starts at a multiple of 4 so a group never passes the end of a row
+		int startX = triangle.minX & ~3;
+		Simd4::Float4 edgeA0 = Simd4::Splat(triangle.edgeA[0]);
+		Simd4::Float4 edgeA1 = Simd4::Splat(triangle.edgeA[1]);
+		Simd4::Float4 edgeA2 = Simd4::Splat(triangle.edgeA[2]);
+		Simd4::Float4 depthX = Simd4::Splat(triangle.depthX);
+
+		for (int y = startY; y <= endY; y++){
+			float centerY = y + 0.5f;
+			Simd4::Float4 rowEdge0 = Simd4::Splat(triangle.edgeB[0] * centerY + triangle.edgeC[0]);
+			Simd4::Float4 rowEdge1 = Simd4::Splat(triangle.edgeB[1] * centerY + triangle.edgeC[1]);
+			Simd4::Float4 rowEdge2 = Simd4::Splat(triangle.edgeB[2] * centerY + triangle.edgeC[2]);
+			Simd4::Float4 rowDepth = Simd4::Splat(triangle.depthY * centerY + triangle.depthC);
+			float* row = &m_depth[y * m_width];
+
+			for (int x = startX; x <= triangle.maxX; x += 4){
+				Simd4::Float4 centerX = Simd4::Add(Simd4::Splat((float)x), pixelOffsets);
+				Simd4::Float4 edge0 = Simd4::MulAdd(edgeA0, centerX, rowEdge0);
+				Simd4::Float4 edge1 = Simd4::MulAdd(edgeA1, centerX, rowEdge1);
+				Simd4::Float4 edge2 = Simd4::MulAdd(edgeA2, centerX, rowEdge2);
+				Simd4::Float4 inside = Simd4::Min(Simd4::Min(edge0, edge1), edge2);
+
+				//Keep the nearest depth where the whole pixel is inside
+				Simd4::Float4 depth = Simd4::MulAdd(depthX, centerX, rowDepth);
+				Simd4::Float4 current = Simd4::Load(row + x);
+				Simd4::Store(row + x, Simd4::SelectGreaterEqual(inside, zero, Simd4::Min(current, depth), current));
+			}
+		}
+	}
+
+	//Nearest and farthest depth of each tile in the rows
+	for (unsigned int tileY = begin; tileY < end; tileY++){
+		for (unsigned int tileX = 0; tileX < m_tilesX; tileX++){
+			const float* tile = &m_depth[tileY * OcclusionTileSize * m_width + tileX * OcclusionTileSize];
+			Simd4::Float4 tileMin = Simd4::Load(tile);
+			Simd4::Float4 tileMax = tileMin;
+			for (unsigned int y = 0; y < OcclusionTileSize; y++){
+				for (unsigned int x = 0; x < OcclusionTileSize; x += 4){
+					Simd4::Float4 depth = Simd4::Load(tile + y * m_width + x);
+					tileMin = Simd4::Min(tileMin, depth);
+					tileMax = Simd4::Max(tileMax, depth);
+				}
+			}
+
+			float minLanes[4];
+			float maxLanes[4];
+			Simd4::Store(minLanes, tileMin);
+			Simd4::Store(maxLanes, tileMax);
+			float minDepth = minLanes[0];
+			float maxDepth = maxLanes[0];
+			for (int lane = 1; lane < 4; lane++){
+				minDepth = minLanes[lane] < minDepth ? minLanes[lane] : minDepth;
+				maxDepth = maxLanes[lane] > maxDepth ? maxLanes[lane] : maxDepth;
+			}
+			m_tileMin[tileY * m_tilesX + tileX] = minDepth;
+			m_tileMax[tileY * m_tilesX + tileX] = maxDepth;
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#ifndef OcclusionBuffer_h__
+#define OcclusionBuffer_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+#include <vector>
+
+/// <remarks>
+///Low resolution depth buffer rendered on the CPU. Big meshes marked as occluders (walls, the sun) are rasterized into it with SIMD on all threads.
+///The bounding boxes of the other objects are then tested against the nearest and farthest depth of each 8x8 tile before they are drawn.
+///Culling is conservative: an occluder only covers the pixels completely inside it, with its farthest depth in the pixel,
+///and a box is tested against every pixel its screen rectangle touches. Hidden objects can be drawn, visible ones are never culled.
+///Doesn't use openGL, so it works without a window
+/// </remarks>
+class OcclusionBuffer
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="width">Width of the buffer in pixels. Rounded up to a multiple of 8</param>
+	/// <param name="height">Height of the buffer in pixels. Rounded up to a multiple of 8</param>
+	/// <returns></returns>
+	OcclusionBuffer(unsigned int width = 256, unsigned int height = 128);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~OcclusionBuffer();
+
+	/// <summary>Changes the size of the buffer. Clears the buffer and the occluders</summary>
+	/// <param name="width">Width of the buffer in pixels. Rounded up to a multiple of 8</param>
+	/// <param name="height">Height of the buffer in pixels. Rounded up to a multiple of 8</param>
+	/// <returns>void</returns>
+	void resize(unsigned int width, unsigned int height);
+	/// <summary>Starts a new frame. Removes the occluders of the last frame and resets the counters</summary>
+	/// <param name="viewProjection">projection * view of the camera</param>
+	/// <returns>void</returns>
+	void begin(const Matrix44& viewProjection);
+	/// <summary>Adds the triangles of an occluder. Triangles crossing the near plane are clipped</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="vertices">Positions in model space</param>
+	/// <param name="vertexCount">Amount of positions</param>
+	/// <param name="indices">3 indices per triangle</param>
+	/// <param name="indexCount">Amount of indices</param>
+	/// <returns>void</returns>
+	void addOccluder(const Matrix44& model, const Vector3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	/// <summary>Rasterizes the occluders added since begin and builds the nearest and farthest depth of each tile. Uses all threads of the global thread pool</summary>
+	/// <returns>void</returns>
+	void rasterize();
+	/// <summary>Tests a bounding box against the rasterized occluders</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="boxMin">Smallest corner of the box in model space</param>
+	/// <param name="boxMax">Largest corner of the box in model space</param>
+	/// <returns>False if the whole box is behind the occluders</returns>
+	bool isBoxVisible(const Matrix44& model, Vector3 boxMin, Vector3 boxMax);
+
+	/// <summary>Returns the width of the buffer in pixels</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getWidth() const;
+	/// <summary>Returns the height of the buffer in pixels</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getHeight() const;
+	/// <summary>Returns the depth of a pixel. 0 is the near plane and 1 the far plane or no occluder. Row 0 is the bottom of the screen</summary>
+	/// <param name="x">Column of the pixel</param>
+	/// <param name="y">Row of the pixel</param>
+	/// <returns>float</returns>
+	float getDepth(unsigned int x, unsigned int y) const;
+	/// <summary>Returns the amount of occluder triangles after near plane clipping</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getTriangleCount() const;
+	/// <summary>Returns how many boxes were tested since begin</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getTestedCount() const;
+	/// <summary>Returns how many of the tested boxes were hidden</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getOccludedCount() const;
+
+private:
+	/// <remarks>
+	///Triangle in screen space set up for rasterization. Each edge function is >= 0 inside the triangle and depth is a plane over the screen
+	/// </remarks>
+	struct Triangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthX;
+		float depthY;
+		float depthC;
+		//Pixels the triangle can cover, inclusive
+		int minX;
+		int maxX;
+		int minY;
+		int maxY;
+	};
+
+	/// <summary>Clips a triangle against the near plane and adds the parts in front of it</summary>
+	/// <param name="a">First corner in clip space</param>
+	/// <param name="b">Second corner in clip space</param>
+	/// <param name="c">Third corner in clip space</param>
+	/// <returns>void</returns>
+	void addClippedTriangle(Vector4 a, Vector4 b, Vector4 c);
+	/// <summary>Projects a triangle in front of the near plane to the screen and sets up its edge functions and depth plane</summary>
+	/// <param name="a">First corner in clip space</param>
+	/// <param name="b">Second corner in clip space</param>
+	/// <param name="c">Third corner in clip space</param>
+	/// <returns>void</returns>
+	void setupTriangle(Vector4 a, Vector4 b, Vector4 c);
+	/// <summary>Clears and rasterizes all triangles into a range of tile rows, then finds the nearest and farthest depth of their tiles.
+	///Each range only writes its own rows, so ranges can run on different threads</summary>
+	/// <param name="begin">First tile row</param>
+	/// <param name="end">One past the last tile row</param>
+	/// <returns>void</returns>
+	void rasterizeTileRows(unsigned int begin, unsigned int end);
+
+	Matrix44 m_viewProjection;
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_tilesX;
+	unsigned int m_tilesY;
+	//Depth of each pixel, row by row
+	std::vector<float> m_depth;
+	//Nearest and farthest depth of each tile
+	std::vector<float> m_tileMin;
+	std::vector<float> m_tileMax;
+	//Occluder triangles of this frame
+	std::vector<Triangle> m_triangles;
+	//Occluder vertices in clip space. Kept to avoid an allocation per occluder
+	std::vector<Vector4> m_clipVertices;
+	unsigned int m_testedCount;
+	unsigned int m_occludedCount;
+};
+
+#endif // OcclusionBuffer_h__
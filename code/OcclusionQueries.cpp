@@ -0,0 +1,272 @@
+#include "OcclusionQueries.h"
+//The boxes are drawn with an ObjectBlock each
+#include "UniformBuffers.h"
+
+//Ids are the record index + 1 in the low bits and the generation of the record in the high bits
+const unsigned int RecordIndexBits = 20;
+const unsigned int RecordIndexMask = (1 << RecordIndexBits) - 1;
+//Records not used for this many frames are recycled, e.g. when a shape is deleted or the camera pass isn't drawn anymore
+const unsigned int RecordLifetime = 120;
+//Query objects are created this many at a time
+const unsigned int QueryBlockSize = 64;
+
+OcclusionQueries::OcclusionQueries(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+
+	m_boxVAO = 0;
+	m_boxVBO = 0;
+	m_boxEBO = 0;
+
+	m_frame = 0;
+	m_occludedCount = 0;
+	m_testedCount = 0;
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+	if (!m_allQueries.empty()){
+		m_glFunctions->glDeleteQueries(m_allQueries.size(), &m_allQueries[0]);
+	}
+
+	//Delete VBOs
+	m_glFunctions->glDeleteBuffers(1, &m_boxVBO);
+	m_glFunctions->glDeleteBuffers(1, &m_boxEBO);
+
+	//Delete VAO
+	m_glFunctions->glDeleteVertexArrays(1, &m_boxVAO);
+	m_glFunctions = NULL;
+}
+
+void OcclusionQueries::init(ShaderProgram* shaderProgram)
+{
+	m_shaderProgram = shaderProgram;
+
+	//Corners of a box from -1 to 1. Scaled to the bounding sphere when it is drawn
+	const float corners[] = {
+		-1, -1, -1,
+		+1, -1, -1,
+		+1, +1, -1,
+		-1, +1, -1,
+		-1, -1, +1,
+		+1, -1, +1,
+		+1, +1, +1,
+		-1, +1, +1 };
+	//Face culling is off while the boxes are drawn, so the winding doesn't matter
+	const unsigned int indices[] = {
+		0, 1, 2, 0, 2, 3,
+		4, 6, 5, 4, 7, 6,
+		0, 4, 5, 0, 5, 1,
+		3, 2, 6, 3, 6, 7,
+		0, 3, 7, 0, 7, 4,
+		1, 5, 6, 1, 6, 2 };
+
+	//////////////////////////////////////////////////////////////////////////
+	//Create VAO
+	m_glFunctions->glGenVertexArrays(1, &m_boxVAO);
+	//Bind VAO
+	m_glFunctions->glBindVertexArray(m_boxVAO);
+
+	//Vertex VBO, only positions
+	m_glFunctions->glGenBuffers(1, &m_boxVBO);
+	m_glFunctions->glBindBuffer(GL_ARRAY_BUFFER, m_boxVBO);
+	m_glFunctions->glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	m_glFunctions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	m_glFunctions->glEnableVertexAttribArray(0);
+
+	//Indices EBO
+	m_glFunctions->glGenBuffers(1, &m_boxEBO);
+	m_glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxEBO);
+	m_glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	//////////////////////////////////////////////////////////////////////////
+	//Unbind the VAO now that the VBOs have been set up
+	m_glFunctions->glBindVertexArray(0);
+}
+
+void OcclusionQueries::beginFrame()
+{
+	m_frame++;
+	m_occludedCount = 0;
+	m_testedCount = 0;
+
+	//Read the results which are available. The others are tried again next frame
+	for (int i = 0; i < m_pendingRecords.size(); i++){
+		QueryRecord& record = m_records[m_pendingRecords[i]];
+		GLuint isAvailable = GL_FALSE;
+		m_glFunctions->glGetQueryObjectuiv(record.query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+		if (!isAvailable){
+			continue;
+		}
+
+		GLuint samplesPassed = 0;
+		m_glFunctions->glGetQueryObjectuiv(record.query, GL_QUERY_RESULT, &samplesPassed);
+		record.isVisible = samplesPassed != 0;
+
+		//Return the query object to the pool
+		m_freeQueries.push_back(record.query);
+		record.query = 0;
+		m_pendingRecords[i] = m_pendingRecords.back();
+		m_pendingRecords.pop_back();
+		i--;
+	}
+
+	//Recycle the records which haven't been used for a while and have no query in flight
+	for (unsigned int i = 0; i < m_records.size(); i++){
+		QueryRecord& record = m_records[i];
+		if (record.isUsed && record.query == 0 && m_frame - record.lastUsedFrame > RecordLifetime){
+			record.isUsed = false;
+			record.generation++;
+			m_freeRecords.push_back(i);
+		}
+	}
+}
+
+bool OcclusionQueries::isVisible(unsigned int& id, const Matrix44& viewProjection, const Matrix44& model, Vector3 centerPoint, float radius)
+{
+	QueryRecord* record = findRecord(id);
+	if (record == NULL){
+		id = createRecord();
+		record = findRecord(id);
+	}
+	record->lastUsedFrame = m_frame;
+	m_testedCount++;
+
+	//Box around the bounding sphere
+	Matrix44 boxModel = model;
+	boxModel.Translate(centerPoint);
+	boxModel.Scale(radius);
+	Matrix44 boxMVP = viewProjection * boxModel;
+
+	//The box would be clipped by the near plane, and the visible parts of the object with it
+	for (int i = 0; i < 8; i++){
+		Vector4 corner((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1);
+		Vector4 clip = boxMVP * corner;
+		if (clip[3] <= 0 || clip[2] < -clip[3]){
+			record->isVisible = true;
+			return true;
+		}
+	}
+
+	//Query the box again once the last query has finished
+	if (record->query == 0 && !record->isQueued){
+		record->isQueued = true;
+		m_queuedRecords.push_back(id & RecordIndexMask);
+		m_queuedModels.push_back(boxModel);
+	}
+
+	if (!record->isVisible){
+		m_occludedCount++;
+	}
+	return record->isVisible;
+}
+
+void OcclusionQueries::issueQueries(UniformBuffers& uniforms)
+{
+	if (m_queuedRecords.empty()){
+		return;
+	}
+
+	//Upload the model matrices of all boxes at once. Box i gets object i
+	for (int i = 0; i < m_queuedModels.size(); i++){
+		uniforms.addObject(m_queuedModels[i]);
+	}
+	uniforms.flushObjects();
+
+	//Only the depth test matters. The back faces count as well, so the box is found even if its front faces are clipped
+	m_glFunctions->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	m_glFunctions->glDepthMask(GL_FALSE);
+	m_glFunctions->glDisable(GL_CULL_FACE);
+	m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	//Stencil pass variant only outputs the position
+	m_shaderProgram->useMode(StencilMode);
+	m_glFunctions->glBindVertexArray(m_boxVAO);
+
+	for (int i = 0; i < m_queuedRecords.size(); i++){
+		QueryRecord& record = m_records[m_queuedRecords[i] - 1];
+		record.isQueued = false;
+		record.query = acquireQuery();
+
+		uniforms.bindObject(i);
+		m_glFunctions->glBeginQuery(GL_ANY_SAMPLES_PASSED, record.query);
+		m_glFunctions->glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		m_glFunctions->glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		m_pendingRecords.push_back(m_queuedRecords[i] - 1);
+	}
+	m_queuedRecords.clear();
+	m_queuedModels.clear();
+
+	//Unbind the VAO and restore the default state
+	m_glFunctions->glBindVertexArray(0);
+	m_glFunctions->glEnable(GL_CULL_FACE);
+	m_glFunctions->glDepthMask(GL_TRUE);
+	m_glFunctions->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+unsigned int OcclusionQueries::getOccludedCount() const
+{
+	return m_occludedCount;
+}
+
+unsigned int OcclusionQueries::getTestedCount() const
+{
+	return m_testedCount;
+}
+
+unsigned int OcclusionQueries::getQueryObjectCount() const
+{
+	return m_allQueries.size();
+}
+
+OcclusionQueries::QueryRecord* OcclusionQueries::findRecord(unsigned int id)
+{
+	unsigned int index = id & RecordIndexMask;
+	if (index == 0 || index > m_records.size()){
+		return NULL;
+	}
+	QueryRecord& record = m_records[index - 1];
+	if (!record.isUsed || record.generation != (id >> RecordIndexBits)){
+		return NULL;
+	}
+	return &record;
+}
+
+unsigned int OcclusionQueries::createRecord()
+{
+	unsigned int index;
+	if (!m_freeRecords.empty()){
+		index = m_freeRecords.back();
+		m_freeRecords.pop_back();
+	}
+	else{
+		index = m_records.size();
+		QueryRecord record;
+		record.generation = 0;
+		m_records.push_back(record);
+	}
+
+	//New instances are visible until their first query has finished
+	QueryRecord& record = m_records[index];
+	record.query = 0;
+	record.isVisible = true;
+	record.lastUsedFrame = m_frame;
+	record.isQueued = false;
+	record.isUsed = true;
+	//The generation wraps around in the bits above the index
+	record.generation &= (1 << (32 - RecordIndexBits)) - 1;
+	return (record.generation << RecordIndexBits) | (index + 1);
+}
+
+GLuint OcclusionQueries::acquireQuery()
+{
+	if (m_freeQueries.empty()){
+		GLuint queries[QueryBlockSize];
+		m_glFunctions->glGenQueries(QueryBlockSize, queries);
+		m_freeQueries.insert(m_freeQueries.end(), queries, queries + QueryBlockSize);
+		m_allQueries.insert(m_allQueries.end(), queries, queries + QueryBlockSize);
+	}
+	GLuint query = m_freeQueries.back();
+	m_freeQueries.pop_back();
+	return query;
+}
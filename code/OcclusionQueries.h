@@ -0,0 +1,125 @@
+#ifndef OcclusionQueries_h__
+#define OcclusionQueries_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+//The boxes are drawn with the stencil pass variant of the uber-shader
+#include "ShaderProgram.h"
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+class UniformBuffers;
+
+/// <remarks>
+///Hardware occlusion queries for the meshes. A mesh asks isVisible before it is drawn and gets the latest finished query result of its box.
+///The boxes are drawn with a query each after the pass, against the finished depth buffer. The results are only read when the GPU says they are available,
+///so a mesh is drawn or skipped with a result which is at least one frame old and the CPU never waits for the GPU.
+///Each drawn instance of a mesh has its own id, since meshes are shared between transforms. Ids not used for a while are recycled
+/// </remarks>
+class OcclusionQueries
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	OcclusionQueries(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~OcclusionQueries();
+
+	/// <summary>Creates the box the queries draw. Needs a current openGL context</summary>
+	/// <param name="shaderProgram">Uber-shader used to draw the boxes with the stencil pass variant</param>
+	/// <returns>void</returns>
+	void init(ShaderProgram* shaderProgram);
+	/// <summary>Reads the results of the queries that have finished, without waiting for the others. Recycles the ids not used for a while. Call once at the start of a frame</summary>
+	/// <returns>void</returns>
+	void beginFrame();
+	/// <summary>Returns the latest query result of an instance and queues a new query of its box if none is in flight.
+	///Boxes crossing the near plane are always visible, since the camera is inside or right in front of them</summary>
+	/// <param name="id">Id of the instance. 0 or a recycled id gets a new id</param>
+	/// <param name="viewProjection">projection * view of the pass</param>
+	/// <param name="model">a model matrix</param>
+	/// <param name="centerPoint">Center of the bounding sphere in model space</param>
+	/// <param name="radius">Radius of the bounding sphere in model space. The box around the sphere is queried</param>
+	/// <returns>False if the box was hidden in the latest finished query</returns>
+	bool isVisible(unsigned int& id, const Matrix44& viewProjection, const Matrix44& model, Vector3 centerPoint, float radius);
+	/// <summary>Draws the boxes queued since the last call with a query each. Color and depth writes are off while the boxes are drawn.
+	///Call after the pass so the depth buffer is finished, with the FrameBlock of the pass still set. Leaves the uber-shader in the stencil pass variant</summary>
+	/// <param name="uniforms">Buffers the model matrices of the boxes are uploaded to</param>
+	/// <returns>void</returns>
+	void issueQueries(UniformBuffers& uniforms);
+
+	/// <summary>Returns how many instances were skipped because of the query results since beginFrame</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getOccludedCount() const;
+	/// <summary>Returns how many instances asked for their query result since beginFrame</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getTestedCount() const;
+	/// <summary>Returns the amount of query objects the pool has created</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getQueryObjectCount() const;
+
+private:
+	/// <remarks>
+	///State of one instance
+	/// </remarks>
+	struct QueryRecord
+	{
+		//Query in flight, 0 if none
+		GLuint query;
+		//Result of the latest finished query
+		bool isVisible;
+		//Incremented when the record is recycled so old ids stop matching
+		unsigned int generation;
+		//Frame isVisible was last called with this record
+		unsigned int lastUsedFrame;
+		//Set while the box is waiting for issueQueries
+		bool isQueued;
+		//Set while the record is in use
+		bool isUsed;
+	};
+
+	/// <summary>Returns the record of an id or NULL if the id is 0 or was recycled</summary>
+	/// <param name="id">Id of an instance</param>
+	/// <returns>QueryRecord*</returns>
+	QueryRecord* findRecord(unsigned int id);
+	/// <summary>Takes a free record and returns its id</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int createRecord();
+	/// <summary>Takes a query object from the pool. Creates a block of them if the pool is empty</summary>
+	/// <returns>GLuint</returns>
+	GLuint acquireQuery();
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	//Uber-shader the boxes are drawn with
+	ShaderProgram* m_shaderProgram;
+
+	//Unit box drawn by the queries
+	GLuint m_boxVAO;
+	GLuint m_boxVBO;
+	GLuint m_boxEBO;
+
+	std::vector<QueryRecord> m_records;
+	//Records which can be reused
+	std::vector<unsigned int> m_freeRecords;
+	//Query objects which aren't in flight
+	std::vector<GLuint> m_freeQueries;
+	//Every query object created, deleted by the destructor
+	std::vector<GLuint> m_allQueries;
+	//Records with a query in flight
+	std::vector<unsigned int> m_pendingRecords;
+	//Records waiting for issueQueries and the model matrix of their boxes
+	std::vector<unsigned int> m_queuedRecords;
+	std::vector<Matrix44> m_queuedModels;
+
+	unsigned int m_frame;
+	unsigned int m_occludedCount;
+	unsigned int m_testedCount;
+};
+
+#endif // OcclusionQueries_h__
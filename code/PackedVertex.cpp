@@ -9,7 +9,7 @@ PackedVertex::~PackedVertex()
 {
 }
 
-bool PackedVertex::operator<(const PackedVertex that) const
+bool PackedVertex::operator<(const PackedVertex& that) const
 {
 	return memcmp((void*)this, (void*)&that, sizeof(PackedVertex)) < 0;
 };
\ No newline at end of file
@@ -6,7 +6,7 @@
 #include <string.h>
 
 /// <remarks>
-///Stores the vertex data. PackedVertex is used as a key in a map inside indexVBO function
+///Stores the vertex data. PackedVertex is looked up in a VertexWelder inside indexVBO function
 /// </remarks>
 class PackedVertex
 {
@@ -21,7 +21,7 @@ public:
 	/// <summary>Overloaded compare operator to allow this class to be used as a key in a map.</summary>
 	/// <param name="that">Used to compare to decide the order on the map</param>
 	/// <returns>bool</returns>
-	bool operator<(const PackedVertex that) const;
+	bool operator<(const PackedVertex& that) const;
 
 	//Vertex data
 	Vector3 position;
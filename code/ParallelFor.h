@@ -0,0 +1,122 @@
+#ifndef ParallelFor_h__
+#define ParallelFor_h__
+
+//Thread pool used to run the ranges
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+
+/// <remarks>
+///Kernel which calls a member function of an object with a range [begin, end).
+///Used to run a member function of a class with parallelFor
+/// </remarks>
+template<typename T>
+class RangeKernel
+{
+public:
+	//Member function handling the elements in [begin, end)
+	typedef void (T::*Function)(unsigned int begin, unsigned int end);
+
+	/// <summary>Constructor</summary>
+	/// <param name="object">Object to call the member function on</param>
+	/// <param name="function">Member function handling a range of elements</param>
+	/// <returns></returns>
+	RangeKernel(T* object, Function function)
+	{
+		m_object = object;
+		m_function = function;
+	}
+
+	/// <summary>Calls the member function with the range</summary>
+	/// <param name="begin">First element of the range</param>
+	/// <param name="end">One past the last element of the range</param>
+	/// <returns>void</returns>
+	void operator()(unsigned int begin, unsigned int end) const
+	{
+		(m_object->*m_function)(begin, end);
+	}
+
+private:
+	T* m_object;
+	Function m_function;
+};
+
+/// <remarks>
+///Task for the thread pool which runs a kernel on one range and tells the semaphore when it's done
+/// </remarks>
+template<typename Kernel>
+class ParallelForTask : public QRunnable
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="kernel">Kernel to run</param>
+	/// <param name="begin">First element of the range</param>
+	/// <param name="end">One past the last element of the range</param>
+	/// <param name="done">Released once the range has been handled</param>
+	/// <returns></returns>
+	ParallelForTask(const Kernel* kernel, unsigned int begin, unsigned int end, QSemaphore* done)
+	{
+		m_kernel = kernel;
+		m_begin = begin;
+		m_end = end;
+		m_done = done;
+	}
+
+	/// <summary>Runs the kernel on the range</summary>
+	/// <returns>void</returns>
+	void run()
+	{
+		(*m_kernel)(m_begin, m_end);
+		m_done->release();
+	}
+
+private:
+	const Kernel* m_kernel;
+	unsigned int m_begin;
+	unsigned int m_end;
+	QSemaphore* m_done;
+};
+
+/// <summary>Splits [0, count) into one contiguous range per thread and runs kernel(begin, end) for each range on the global thread pool.
+///The calling thread handles the first range itself and the function returns when all ranges are done.
+///The kernel is shared by all threads so it must only write to the elements of its own range</summary>
+/// <param name="count">Amount of elements</param>
+/// <param name="kernel">Function object taking (unsigned int begin, unsigned int end)</param>
+/// <param name="minRangeSize">Ranges are never made smaller than this. Small counts are run on the calling thread only</param>
+/// <returns>void</returns>
+template<typename Kernel>
+void parallelFor(unsigned int count, const Kernel& kernel, unsigned int minRangeSize = 4096)
+{
+	QThreadPool* pool = QThreadPool::globalInstance();
+
+	//One range per thread as long as the ranges are big enough to be worth it
+	unsigned int rangeCount = pool->maxThreadCount();
+	if (count / minRangeSize < rangeCount){
+		rangeCount = count / minRangeSize;
+	}
+	if (rangeCount <= 1){
+		kernel(0, count);
+		return;
+	}
+
+	unsigned int rangeSize = (count + rangeCount - 1) / rangeCount;
+
+	//Hand out all but the first range to the thread pool
+	QSemaphore done(0);
+	unsigned int tasksStarted = 0;
+	for (unsigned int begin = rangeSize; begin < count; begin += rangeSize){
+		unsigned int end = begin + rangeSize < count ? begin + rangeSize : count;
+		ParallelForTask<Kernel>* task = new ParallelForTask<Kernel>(&kernel, begin, end, &done);
+		task->setAutoDelete(true);
+		pool->start(task);
+		tasksStarted++;
+	}
+
+	//Calling thread does the first range while waiting
+	kernel(0, rangeSize);
+
+	//Wait for the thread pool to finish the rest
+	done.acquire(tasksStarted);
+}
+
+#endif // ParallelFor_h__
@@ -0,0 +1,186 @@
+#include "RenderQueue.h"
+//Packets are drawn by their mesh
+#include "Mesh.h"
+//The ObjectBlocks of the packets are uploaded together
+#include "UniformBuffers.h"
+
+//For reading the bits of the depth
+#include <string.h>
+
+//Width of the fields in the sort key. Values which don't fit are masked, which only makes different states sort together
+const unsigned int KeyModeBits = 4;
+const unsigned int KeyTextureBits = 12;
+const unsigned int KeyVaoBits = 12;
+const unsigned int KeyMaterialBits = 12;
+const unsigned int KeyDepthBits = 24;
+
+RenderQueue::RenderQueue(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+	m_isFrontToBack = false;
+	resetCounters();
+}
+
+RenderQueue::~RenderQueue()
+{
+	m_glFunctions = NULL;
+}
+
+void RenderQueue::add(Mesh* mesh, const Matrix44& model, bool isWireframe, GLuint textureID, GLuint vao, unsigned int materialID, float viewDepth)
+{
+	//The bits of a positive float sort like the float. Meshes behind the camera plane get depth 0
+	unsigned int depthBits = 0;
+	if (viewDepth > 0){
+		memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+		depthBits >>= 31 - KeyDepthBits;
+	}
+
+	unsigned long long mode = isWireframe ? 1 : 0;
+	unsigned long long texture = textureID & ((1 << KeyTextureBits) - 1);
+	unsigned long long vertexArray = vao & ((1 << KeyVaoBits) - 1);
+	unsigned long long material = materialID & ((1 << KeyMaterialBits) - 1);
+	unsigned long long depth = depthBits & ((1 << KeyDepthBits) - 1);
+
+	//Solid draws come before wireframe draws. Then either the state or the depth decides
+	SortEntry entry;
+	if (m_isFrontToBack){
+		entry.key = (mode << (64 - KeyModeBits))
+			| (depth << (KeyTextureBits + KeyVaoBits + KeyMaterialBits))
+			| (texture << (KeyVaoBits + KeyMaterialBits))
+			| (vertexArray << KeyMaterialBits)
+			| material;
+	}
+	else{
+		entry.key = (mode << (64 - KeyModeBits))
+			| (texture << (KeyVaoBits + KeyMaterialBits + KeyDepthBits))
+			| (vertexArray << (KeyMaterialBits + KeyDepthBits))
+			| (material << KeyDepthBits)
+			| depth;
+	}
+	entry.packet = m_packets.size();
+	m_entries.push_back(entry);
+
+	DrawPacket packet;
+	packet.mesh = mesh;
+	packet.model = model;
+	packet.isWireframe = isWireframe;
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::submit(UniformBuffers& uniforms, int shaderMode, ShaderProgram& shaderProgram)
+{
+	if (m_entries.empty()){
+		return;
+	}
+
+	radixSort();
+
+	//Nothing is known about the state left by the code before the queue
+	RenderState state;
+	state.vao = ~0u;
+	state.textureID = ~0u;
+	state.shaderMode = -1;
+	state.stateChanges = 0;
+
+	//One upload for the whole queue. Packet i gets object i, so the ring is read in order
+	for (unsigned int i = 0; i < m_entries.size(); i++){
+		DrawPacket& packet = m_packets[m_entries[i].packet];
+		packet.mesh->addObjectBlock(uniforms, packet.model);
+	}
+	uniforms.flushObjects();
+
+	//The meshes bind their textures to unit 0
+	m_glFunctions->glActiveTexture(GL_TEXTURE0);
+	state.stateChanges++;
+
+	for (unsigned int i = 0; i < m_entries.size(); i++){
+		DrawPacket& packet = m_packets[m_entries[i].packet];
+		packet.mesh->drawPacket(uniforms, i, packet.isWireframe ? WireframeMode : shaderMode, packet.isWireframe, state);
+	}
+
+	//Leave the state like the meshes did when they were drawn one at a time
+	m_glFunctions->glBindVertexArray(0);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
+	m_glFunctions->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	if (state.shaderMode != shaderMode){
+		shaderProgram.useMode(shaderMode);
+	}
+
+	m_packetCount += m_entries.size();
+	m_stateChangeCount += state.stateChanges;
+	m_packets.clear();
+	m_entries.clear();
+}
+
+void RenderQueue::radixSort()
+{
+	unsigned int count = m_entries.size();
+	m_sortBuffer.resize(count);
+
+	//Histograms of all 8 bytes in one pass over the keys
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (unsigned int i = 0; i < count; i++){
+		unsigned long long key = m_entries[i].key;
+		for (int byte = 0; byte < 8; byte++){
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	SortEntry* source = &m_entries[0];
+	SortEntry* destination = &m_sortBuffer[0];
+	for (int byte = 0; byte < 8; byte++){
+		unsigned int* histogram = histograms[byte];
+		//All keys have the same value in this byte, e.g. the mode or unused texture bits
+		if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count){
+			continue;
+		}
+
+		//Where each value starts in the destination
+		unsigned int offset = 0;
+		for (int value = 0; value < 256; value++){
+			unsigned int valueCount = histogram[value];
+			histogram[value] = offset;
+			offset += valueCount;
+		}
+
+		//Stable, so the bytes sorted before keep their order
+		for (unsigned int i = 0; i < count; i++){
+			destination[histogram[(source[i].key >> (byte * 8)) & 0xFF]++] = source[i];
+		}
+		SortEntry* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	//An odd amount of passes left the result in the second buffer
+	if (source != &m_entries[0]){
+		m_entries.swap(m_sortBuffer);
+	}
+}
+
+void RenderQueue::setFrontToBack(bool flag)
+{
+	m_isFrontToBack = flag;
+}
+
+bool RenderQueue::isFrontToBack() const
+{
+	return m_isFrontToBack;
+}
+
+unsigned int RenderQueue::getPacketCount() const
+{
+	return m_packetCount;
+}
+
+unsigned int RenderQueue::getStateChangeCount() const
+{
+	return m_stateChangeCount;
+}
+
+void RenderQueue::resetCounters()
+{
+	m_packetCount = 0;
+	m_stateChangeCount = 0;
+}
@@ -0,0 +1,119 @@
+#ifndef RenderQueue_h__
+#define RenderQueue_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+//Packets switch between the variants of the uber-shader
+#include "ShaderProgram.h"
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+class Mesh;
+class UniformBuffers;
+
+/// <remarks>
+///GL state the last submitted packet left behind. Mesh::drawPacket only changes what differs and counts the changes
+/// </remarks>
+struct RenderState
+{
+	GLuint vao;
+	GLuint textureID;
+	int shaderMode;
+	//Amount of GL state changes and uniform uploads made by the submit
+	unsigned int stateChanges;
+};
+
+/// <remarks>
+///Collects the draws of a pass as packets instead of drawing while the scenegraph is traversed. Each packet gets a 64 bit key made of
+///shader mode, texture, VAO, material and depth. The packets are radix sorted by the key and submitted in that order,
+///so meshes sharing state are drawn after each other and binds which wouldn't change anything are skipped.
+///The queue is submitted at the end of each pass, so the pass isn't part of the key.
+///With front to back on, depth is sorted before texture, VAO and material so the nearest meshes fill the depth buffer first
+/// </remarks>
+class RenderQueue
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	RenderQueue(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~RenderQueue();
+
+	/// <summary>Adds a draw of a mesh</summary>
+	/// <param name="mesh">Mesh to draw</param>
+	/// <param name="model">a model matrix</param>
+	/// <param name="isWireframe">True if the mesh is drawn with the wireframe shader branch</param>
+	/// <param name="textureID">Texture the mesh binds</param>
+	/// <param name="vao">VAO of the mesh</param>
+	/// <param name="materialID">Small id of the mesh's material</param>
+	/// <param name="viewDepth">Distance of the mesh in front of the camera</param>
+	/// <returns>void</returns>
+	void add(Mesh* mesh, const Matrix44& model, bool isWireframe, GLuint textureID, GLuint vao, unsigned int materialID, float viewDepth);
+	/// <summary>Sorts the packets added since the last submit and draws them. The ObjectBlocks of all packets are uploaded together in the sorted order.
+	///The FrameBlock of the pass has to be set before</summary>
+	/// <param name="uniforms">Buffers the ObjectBlocks are uploaded to</param>
+	/// <param name="shaderMode">Shader branch the pass set. Restored when the submit is done</param>
+	/// <param name="shaderProgram">Uber-shader the variant of the shader branch is taken from</param>
+	/// <returns>void</returns>
+	void submit(UniformBuffers& uniforms, int shaderMode, ShaderProgram& shaderProgram);
+
+	/// <summary>Sets a flag if the packets are sorted by depth before the texture, VAO and material</summary>
+	/// <param name="flag">On or Off</param>
+	/// <returns>void</returns>
+	void setFrontToBack(bool flag);
+	/// <summary>Returns true if the packets are sorted by depth before the texture, VAO and material</summary>
+	/// <returns>bool</returns>
+	bool isFrontToBack() const;
+	/// <summary>Returns how many packets were submitted since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getPacketCount() const;
+	/// <summary>Returns how many state changes the submits made since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getStateChangeCount() const;
+	/// <summary>Sets the packet and state change counters to 0</summary>
+	/// <returns>void</returns>
+	void resetCounters();
+
+private:
+	/// <remarks>
+	///Everything needed to draw a mesh once. The key is kept apart so the sort only moves keys and indices
+	/// </remarks>
+	struct DrawPacket
+	{
+		Mesh* mesh;
+		Matrix44 model;
+		bool isWireframe;
+	};
+
+	/// <remarks>
+	///Key of a packet and where the packet is
+	/// </remarks>
+	struct SortEntry
+	{
+		unsigned long long key;
+		unsigned int packet;
+	};
+
+	/// <summary>Sorts m_entries by key. Least significant byte first, bytes that are the same in every key are skipped</summary>
+	/// <returns>void</returns>
+	void radixSort();
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<SortEntry> m_entries;
+	//Second buffer of the radix sort
+	std::vector<SortEntry> m_sortBuffer;
+
+	bool m_isFrontToBack;
+	unsigned int m_packetCount;
+	unsigned int m_stateChangeCount;
+};
+
+#endif // RenderQueue_h__
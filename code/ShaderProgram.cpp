@@ -1,8 +1,10 @@
 #include "ShaderProgram.h"
 
-ShaderProgram::ShaderProgram(QOpenGLFunctions_3_3_Core* functions)
+ShaderProgram::ShaderProgram(GLStateCache* functions)
 {
 	m_glFunctions = functions;
+	m_shaderProgram = 0;
+	m_mode = 0;
 }
 
 
@@ -10,65 +12,170 @@ ShaderProgram::~ShaderProgram()
 {
 	//Unbind the shader program before deallocating
 	m_glFunctions->glUseProgram(0);
-	m_glFunctions->glDeleteProgram(m_shaderProgram);
+	for (int i = 0; i < m_variants.size(); i++){
+		if (m_variants[i] != 0){
+			m_glFunctions->glDeleteProgram(m_variants[i]);
+		}
+	}
 	m_glFunctions = NULL;
 }
 
-void ShaderProgram::prepareShaderProgram(const char* vertex_file_path, const char* fragment_file_path)
+void ShaderProgram::prepareShaderProgram(const char* vertex_file_path, const char* fragment_file_path, int modeCount)
 {
-	// Create the shaders
-	GLuint VertexShaderID = m_glFunctions->glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = m_glFunctions->glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open())
-	{
-		std::string Line = "";
-		while (getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
+	std::string VertexShaderCode = readShaderFile(vertex_file_path);
+	std::string FragmentShaderCode = readShaderFile(fragment_file_path);
+
+	if (modeCount == 0){
+		m_variants.assign(1, linkProgram(VertexShaderCode, FragmentShaderCode, "", vertex_file_path, fragment_file_path));
+		m_mode = 0;
+	}
+	else{
+		//Mode 0 is not a branch of the shader
+		m_variants.assign(modeCount, 0);
+		for (int mode = 1; mode < modeCount; mode++){
+			char defines[32];
+			sprintf(defines, "#define MODE %d\n", mode);
+			m_variants[mode] = linkProgram(VertexShaderCode, FragmentShaderCode, defines, vertex_file_path, fragment_file_path);
+		}
+		m_mode = 1;
 	}
+	m_shaderProgram = m_variants[m_mode];
+
+	//Look up the uniforms added before in the new programs
+	m_locations.assign(m_variants.size(), std::vector<GLint>(m_uniformNames.size(), -1));
+	for (int i = 0; i < m_uniformNames.size(); i++){
+		for (int mode = 0; mode < m_variants.size(); mode++){
+			if (m_variants[mode] != 0){
+				m_locations[mode][i] = m_glFunctions->glGetUniformLocation(m_variants[mode], m_uniformNames[i].c_str());
+			}
+		}
+	}
+}
+
+void ShaderProgram::useMode(int mode)
+{
+	m_mode = mode;
+	m_shaderProgram = m_variants[mode];
+	m_glFunctions->glUseProgram(m_shaderProgram);
+}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open()){
+int ShaderProgram::getMode() const
+{
+	return m_mode;
+}
+
+GLuint ShaderProgram::getShaderProgramID()
+{
+	return m_shaderProgram;
+}
+
+void ShaderProgram::bindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	for (int i = 0; i < m_variants.size(); i++){
+		if (m_variants[i] == 0){
+			continue;
+		}
+		GLuint blockIndex = m_glFunctions->glGetUniformBlockIndex(m_variants[i], blockName);
+		if (blockIndex != GL_INVALID_INDEX){
+			m_glFunctions->glUniformBlockBinding(m_variants[i], blockIndex, bindingPoint);
+		}
+	}
+}
+
+void ShaderProgram::setSampler(const char* samplerName, GLint textureUnit)
+{
+	//Sampler uniforms are program state, so each variant has to be in use to set them
+	for (int i = 0; i < m_variants.size(); i++){
+		if (m_variants[i] == 0){
+			continue;
+		}
+		GLint location = m_glFunctions->glGetUniformLocation(m_variants[i], samplerName);
+		if (location != -1){
+			m_glFunctions->glUseProgram(m_variants[i]);
+			m_glFunctions->glUniform1i(location, textureUnit);
+		}
+	}
+	m_glFunctions->glUseProgram(m_shaderProgram);
+}
+
+int ShaderProgram::addUniform(const char* uniformName)
+{
+	for (int i = 0; i < m_uniformNames.size(); i++){
+		if (m_uniformNames[i] == uniformName){
+			return i;
+		}
+	}
+
+	m_uniformNames.push_back(uniformName);
+	for (int mode = 0; mode < m_locations.size(); mode++){
+		GLint location = -1;
+		if (m_variants[mode] != 0){
+			location = m_glFunctions->glGetUniformLocation(m_variants[mode], uniformName);
+		}
+		m_locations[mode].push_back(location);
+	}
+	return m_uniformNames.size() - 1;
+}
+
+GLint ShaderProgram::getLocation(int uniform) const
+{
+	return m_locations[m_mode][uniform];
+}
+
+std::string ShaderProgram::readShaderFile(const char* file_path)
+{
+	std::string ShaderCode;
+	std::ifstream ShaderStream(file_path, std::ios::in);
+	if (ShaderStream.is_open()){
 		std::string Line = "";
-		while (getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+		while (getline(ShaderStream, Line))
+			ShaderCode += "\n" + Line;
+		ShaderStream.close();
 	}
+	return ShaderCode;
+}
+
+GLuint ShaderProgram::compileShader(GLenum type, const std::string& code, const char* file_path)
+{
+	GLuint ShaderID = m_glFunctions->glCreateShader(type);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	m_glFunctions->glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
-	m_glFunctions->glCompileShader(VertexShaderID);
-
-	// Check Vertex Shader
-	m_glFunctions->glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	m_glFunctions->glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> VertexShaderErrorMessage(InfoLogLength);
-	m_glFunctions->glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &VertexShaderErrorMessage[0]);
-
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	m_glFunctions->glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
-	m_glFunctions->glCompileShader(FragmentShaderID);
-
-	// Check Fragment Shader
-	m_glFunctions->glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	m_glFunctions->glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> FragmentShaderErrorMessage(InfoLogLength);
-	m_glFunctions->glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &FragmentShaderErrorMessage[0]);
+	// Compile Shader
+	printf("Compiling shader : %s\n", file_path);
+	char const * SourcePointer = code.c_str();
+	m_glFunctions->glShaderSource(ShaderID, 1, &SourcePointer, NULL);
+	m_glFunctions->glCompileShader(ShaderID);
+
+	// Check Shader
+	m_glFunctions->glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+	m_glFunctions->glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	std::vector<char> ShaderErrorMessage(max(InfoLogLength, int(1)));
+	m_glFunctions->glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+	fprintf(stdout, "%s\n", &ShaderErrorMessage[0]);
+
+	return ShaderID;
+}
+
+GLuint ShaderProgram::linkProgram(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines, const char* vertex_file_path, const char* fragment_file_path)
+{
+	//The defines have to come after the #version line
+	std::string VertexShaderCode = vertexCode;
+	std::string FragmentShaderCode = fragmentCode;
+	if (!defines.empty()){
+		printf("Variant : %s", defines.c_str());
+		size_t versionEnd = VertexShaderCode.find('\n', VertexShaderCode.find("#version"));
+		VertexShaderCode.insert(versionEnd + 1, defines);
+		versionEnd = FragmentShaderCode.find('\n', FragmentShaderCode.find("#version"));
+		FragmentShaderCode.insert(versionEnd + 1, defines);
+	}
+
+	GLuint VertexShaderID = compileShader(GL_VERTEX_SHADER, VertexShaderCode, vertex_file_path);
+	GLuint FragmentShaderID = compileShader(GL_FRAGMENT_SHADER, FragmentShaderCode, fragment_file_path);
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
 
 	// Link the program
 	fprintf(stdout, "Linking program\n");
@@ -87,10 +194,5 @@ void ShaderProgram::prepareShaderProgram(const char* vertex_file_path, const cha
 	m_glFunctions->glDeleteShader(VertexShaderID);
 	m_glFunctions->glDeleteShader(FragmentShaderID);
 
-	m_shaderProgram = ProgramID;
-}
-
-GLuint ShaderProgram::getShaderProgramID()
-{
-	return m_shaderProgram;
+	return ProgramID;
 }
@@ -2,20 +2,48 @@
 #define ShaderProgram_h__
 
 //OpenGL Functions
-#include <QOpenGLFunctions_3_3_Core>
+#include "GLStateCache.h"
 
 //For reading shader files
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <algorithm> //max
+#include <vector>
 using namespace std;
 
 #include <stdlib.h>
 #include <string.h>
 
 /// <remarks>
-///Holds the compiled and linked vertex- and fragment shader
+///Branches of the uber-shader. Each one is compiled into its own program with MODE defined to its value
+/// </remarks>
+enum ShaderMode
+{
+	ShadowMapPass1Mode = 1,
+	ShadowMapPass2Mode = 2,
+	ShadowMapQuadMode = 3,
+	BlurMode = 4,
+	GeometryBufferMode = 5,
+	LightPassMode = 6,
+	AmbientQuadMode = 7,
+	GeometryBufferQuadMode = 8,
+	StencilMode = 9,
+	ForwardMode = 10,
+	SkyboxMode = 11,
+	WireframeMode = 12,
+	NoLightMode = 13,
+	CompactGeometryBufferMode = 14,
+	CompactLightPassMode = 15,
+	TiledLightPassMode = 16,
+	CompactTiledLightPassMode = 17,
+	ShaderModeCount = 18
+};
+
+/// <remarks>
+///Holds the compiled and linked vertex- and fragment shader.
+///Can compile the shaders once per mode with MODE defined, so each variant only keeps the code of its own branch.
+///Uniform locations differ between the variants, so they are looked up by a handle from addUniform
 /// </remarks>
 class ShaderProgram
 {
@@ -23,7 +51,7 @@ public:
 	/// <summary>Constructor</summary>
 	/// <param name="functions">Enables the class to call openGL functions</param>
 	/// <returns></returns>
-	ShaderProgram(QOpenGLFunctions_3_3_Core* functions);
+	ShaderProgram(GLStateCache* functions);
 	/// <summary>Destructor</summary>
 	/// <returns></returns>
 	~ShaderProgram();
@@ -31,18 +59,72 @@ public:
 	/// <summary>Compile and Link the vertex and fragment shaders</summary>
 	/// <param name="vertex_file_path">path to vertex shader</param>
 	/// <param name="fragment_file_path">path to fragment shader</param>
+	/// <param name="modeCount">If not 0, a variant is compiled for each mode from 1 to modeCount-1 with MODE defined to the mode</param>
+	/// <returns>void</returns>
+	void prepareShaderProgram(const char* vertex_file_path, const char* fragment_file_path, int modeCount = 0);
+	/// <summary>Makes the variant of a mode the program in use</summary>
+	/// <param name="mode">Mode the variant was compiled for</param>
 	/// <returns>void</returns>
-	void prepareShaderProgram(const char* vertex_file_path, const char* fragment_file_path);
-	/// <summary>Returns the ID of the shader program</summary>
+	void useMode(int mode);
+	/// <summary>Returns the mode of the variant in use</summary>
+	/// <returns>int</returns>
+	int getMode() const;
+	/// <summary>Returns the ID of the shader program in use</summary>
 	/// <returns>GLuint</returns>
 	GLuint getShaderProgramID();
+	/// <summary>Connects a uniform block of every variant to a binding point. Does nothing for variants without a block with that name</summary>
+	/// <param name="blockName">Name of the uniform block in the shaders</param>
+	/// <param name="bindingPoint">Binding point the uniform buffer is bound to</param>
+	/// <returns>void</returns>
+	void bindUniformBlock(const char* blockName, GLuint bindingPoint);
+	/// <summary>Associates a sampler of every variant to a texture unit</summary>
+	/// <param name="samplerName">Name of the sampler in the shaders</param>
+	/// <param name="textureUnit">Index of the texture unit, 0 for GL_TEXTURE0</param>
+	/// <returns>void</returns>
+	void setSampler(const char* samplerName, GLint textureUnit);
+	/// <summary>Looks up the location of a uniform in every variant. Adding the same name again returns the same handle</summary>
+	/// <param name="uniformName">Name of the uniform in the shaders</param>
+	/// <returns>Handle to pass to getLocation</returns>
+	int addUniform(const char* uniformName);
+	/// <summary>Returns the location of a uniform in the variant in use. -1 if the variant doesn't use the uniform</summary>
+	/// <param name="uniform">Handle returned by addUniform</param>
+	/// <returns>GLint</returns>
+	GLint getLocation(int uniform) const;
 
 private:
+	/// <summary>Compiles a shader and prints its log</summary>
+	/// <param name="type">GL_VERTEX_SHADER or GL_FRAGMENT_SHADER</param>
+	/// <param name="code">Source code</param>
+	/// <param name="file_path">Path of the file the code is from, printed with the log</param>
+	/// <returns>ID of the shader</returns>
+	GLuint compileShader(GLenum type, const std::string& code, const char* file_path);
+	/// <summary>Compiles and links a program with a line of defines inserted after the #version line of both shaders</summary>
+	/// <param name="vertexCode">Source code of the vertex shader</param>
+	/// <param name="fragmentCode">Source code of the fragment shader</param>
+	/// <param name="defines">Lines to insert, can be empty</param>
+	/// <param name="vertex_file_path">path to vertex shader</param>
+	/// <param name="fragment_file_path">path to fragment shader</param>
+	/// <returns>ID of the program</returns>
+	GLuint linkProgram(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines, const char* vertex_file_path, const char* fragment_file_path);
+	/// <summary>Reads a shader file</summary>
+	/// <param name="file_path">path to the shader</param>
+	/// <returns>Source code</returns>
+	std::string readShaderFile(const char* file_path);
+
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
-	//Holds the compiled and linked vertex and fragment shader from function prepareShaderProgram
+	//Program in use. Holds the compiled and linked vertex and fragment shader from function prepareShaderProgram
 	GLuint m_shaderProgram;
+	//Programs indexed by mode. Only index 0 is used if no variants were compiled
+	std::vector<GLuint> m_variants;
+	//Mode of the program in use
+	int m_mode;
+
+	//Names of the uniforms added with addUniform, the index is the handle
+	std::vector<std::string> m_uniformNames;
+	//Locations of the added uniforms, indexed by mode and then by handle
+	std::vector<std::vector<GLint> > m_locations;
 };
 
 #endif // ShaderProgram_h__
@@ -0,0 +1,378 @@
+#include "ShadowMapFilter.h"
+
+//Logs the benchmark
+#include <QDebug>
+
+//min and max
+#include <algorithm>
+//exp and ceil
+#include <math.h>
+
+//Texture unit of the shadow map sampler
+const GLint ShadowMapUnit = 1;
+//Blur radius the shader's tap arrays can hold, in texels of the filtered map
+const int MaxKernelRadius = (MaxBlurTaps - 1) * 2;
+
+//Tap of a 2x reduction. The center of a target texel is the corner the 2x2 texels under it share, so one linear fetch there averages all four
+const float ReductionOffsets[1] = { 0.0f };
+const float ReductionWeights[1] = { 1.0f };
+
+ShadowMapFilter::ShadowMapFilter(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+	m_shaderProgram = NULL;
+	m_quadVAO = 0;
+
+	m_shadowMapFBO = 0;
+	m_shadowMapTexture = 0;
+	m_depthBuffer = 0;
+	m_blurFBO = 0;
+	m_blurTexture = 0;
+	m_filteredFBO = 0;
+	m_filteredTexture = 0;
+	m_downsampledTexture = 0;
+
+	m_resolution = 1024;
+	m_kernelRadius = 11;
+	m_downsample = 1;
+	m_momentFormat = Moments32Float;
+	m_isDirty = true;
+	m_tapCount = 1;
+
+	m_timerQuery = 0;
+	m_isTimerPending = false;
+	m_filterTime = 0;
+}
+
+ShadowMapFilter::~ShadowMapFilter()
+{
+	//Delete textures and depth buffer
+	m_glFunctions->glDeleteTextures(1, &m_shadowMapTexture);
+	m_glFunctions->glDeleteTextures(1, &m_blurTexture);
+	m_glFunctions->glDeleteTextures(1, &m_downsampledTexture);
+	if (!m_reductionTextures.empty()){
+		m_glFunctions->glDeleteTextures(m_reductionTextures.size(), &m_reductionTextures[0]);
+	}
+	m_glFunctions->glDeleteRenderbuffers(1, &m_depthBuffer);
+
+	//Delete FBOs
+	m_glFunctions->glDeleteFramebuffers(1, &m_shadowMapFBO);
+	m_glFunctions->glDeleteFramebuffers(1, &m_blurFBO);
+	m_glFunctions->glDeleteFramebuffers(1, &m_filteredFBO);
+	if (!m_reductionFBOs.empty()){
+		m_glFunctions->glDeleteFramebuffers(m_reductionFBOs.size(), &m_reductionFBOs[0]);
+	}
+
+	m_glFunctions->glDeleteQueries(1, &m_timerQuery);
+	m_glFunctions = NULL;
+}
+
+void ShadowMapFilter::init(ShaderProgram* shaderProgram, GLuint quadVAO)
+{
+	m_shaderProgram = shaderProgram;
+	m_quadVAO = quadVAO;
+
+	//Get handles for shader uniforms
+	m_scaleUniform = m_shaderProgram->addUniform("ScaleU");
+	m_offsetsUniform = m_shaderProgram->addUniform("blurOffsets");
+	m_weightsUniform = m_shaderProgram->addUniform("blurWeights");
+	m_tapCountUniform = m_shaderProgram->addUniform("blurTapCount");
+	m_minVarianceUniform = m_shaderProgram->addUniform("shadowMinVariance");
+
+	//The textures are created by the first bindFramebuffer, once the scene has set the resolution and format
+	m_glFunctions->glGenFramebuffers(1, &m_shadowMapFBO);
+	m_glFunctions->glGenFramebuffers(1, &m_blurFBO);
+	m_glFunctions->glGenFramebuffers(1, &m_filteredFBO);
+	m_glFunctions->glGenRenderbuffers(1, &m_depthBuffer);
+
+	m_glFunctions->glGenQueries(1, &m_timerQuery);
+}
+
+void ShadowMapFilter::setResolution(int resolution)
+{
+	m_isDirty |= resolution != m_resolution;
+	m_resolution = resolution;
+}
+
+int ShadowMapFilter::getResolution() const
+{
+	return m_resolution;
+}
+
+void ShadowMapFilter::setKernelRadius(int radius)
+{
+	radius = std::max(0, radius);
+	m_isDirty |= radius != m_kernelRadius;
+	m_kernelRadius = radius;
+}
+
+int ShadowMapFilter::getKernelRadius() const
+{
+	return m_kernelRadius;
+}
+
+void ShadowMapFilter::setDownsample(int downsample)
+{
+	//Each reduction halves the map, so only powers of two can be reached
+	int factor = 1;
+	while (factor * 2 <= downsample){
+		factor *= 2;
+	}
+	m_isDirty |= factor != m_downsample;
+	m_downsample = factor;
+}
+
+int ShadowMapFilter::getDownsample() const
+{
+	return m_downsample;
+}
+
+void ShadowMapFilter::setMomentFormat(MomentFormat format)
+{
+	m_isDirty |= format != m_momentFormat;
+	m_momentFormat = format;
+}
+
+MomentFormat ShadowMapFilter::getMomentFormat() const
+{
+	return m_momentFormat;
+}
+
+void ShadowMapFilter::bindFramebuffer()
+{
+	if (m_isDirty){
+		allocate();
+	}
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapFBO);
+	m_glFunctions->glViewport(0, 0, m_resolution, m_resolution);
+}
+
+void ShadowMapFilter::filter()
+{
+	//The time of an earlier filter is read once the GPU has it, a new one is only started after that
+	if (m_isTimerPending){
+		GLuint isAvailable = 0;
+		m_glFunctions->glGetQueryObjectuiv(m_timerQuery, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+		if (isAvailable){
+			GLuint64 time = 0;
+			m_glFunctions->glGetQueryObjectui64v(m_timerQuery, GL_QUERY_RESULT, &time);
+			m_filterTime = time / 1000000.0f;
+			m_isTimerPending = false;
+		}
+	}
+
+	if (m_isTimerPending){
+		drawPasses();
+	}
+	else{
+		m_glFunctions->glBeginQuery(GL_TIME_ELAPSED, m_timerQuery);
+		drawPasses();
+		m_glFunctions->glEndQuery(GL_TIME_ELAPSED);
+		m_isTimerPending = true;
+	}
+}
+
+void ShadowMapFilter::bind()
+{
+	//16 bit moments lose the small variances to rounding, so they need a larger min variance against acne
+	const float minVariance[MomentFormatCount] = { 0.0000005f, 0.0001f, 0.00002f };
+	m_glFunctions->glUniform1f(m_shaderProgram->getLocation(m_minVarianceUniform), minVariance[m_momentFormat]);
+
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + ShadowMapUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_filteredTexture);
+}
+
+void ShadowMapFilter::benchmark(int iterations)
+{
+	const char* formatNames[MomentFormatCount] = { "RG32F", "RG16F", "RG16" };
+	const int downsamples[3] = { 1, 2, 4 };
+
+	MomentFormat format = m_momentFormat;
+	int downsample = m_downsample;
+
+	//A timer query of its own, so the one of filter can stay in flight
+	GLuint query;
+	m_glFunctions->glGenQueries(1, &query);
+	for (int i = 0; i < MomentFormatCount; i++){
+		for (int j = 0; j < 3; j++){
+			setMomentFormat((MomentFormat)i);
+			setDownsample(downsamples[j]);
+			if (m_isDirty){
+				allocate();
+			}
+
+			//Untimed pass, so the allocation isn't part of the time
+			drawPasses();
+
+			m_glFunctions->glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int k = 0; k < iterations; k++){
+				drawPasses();
+			}
+			m_glFunctions->glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 time = 0;
+			m_glFunctions->glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time);
+			qDebug() << "Shadow map filter" << m_resolution << formatNames[i] << "1 /" << downsamples[j] << "radius" << m_kernelRadius
+				<< ":" << time / 1000000.0 / iterations << "ms";
+		}
+	}
+	m_glFunctions->glDeleteQueries(1, &query);
+
+	setMomentFormat(format);
+	setDownsample(downsample);
+	if (m_isDirty){
+		allocate();
+	}
+}
+
+float ShadowMapFilter::getFilterTime() const
+{
+	return m_filterTime;
+}
+
+void ShadowMapFilter::allocate()
+{
+	const GLint internalFormats[MomentFormatCount] = { GL_RG32F, GL_RG16F, GL_RG16 };
+	GLint internalFormat = internalFormats[m_momentFormat];
+	int filteredSize = std::max(1, m_resolution / m_downsample);
+
+	//Delete the textures of the old settings
+	m_glFunctions->glDeleteTextures(1, &m_shadowMapTexture);
+	m_glFunctions->glDeleteTextures(1, &m_blurTexture);
+	m_glFunctions->glDeleteTextures(1, &m_downsampledTexture);
+	m_downsampledTexture = 0;
+	if (!m_reductionTextures.empty()){
+		m_glFunctions->glDeleteTextures(m_reductionTextures.size(), &m_reductionTextures[0]);
+		m_glFunctions->glDeleteFramebuffers(m_reductionFBOs.size(), &m_reductionFBOs[0]);
+	}
+
+	//One 2x reduction per factor of 2. The last one writes into the downsampled texture, the others need a texture of their own
+	int reductionCount = 0;
+	for (int factor = m_downsample; factor > 2; factor /= 2){
+		reductionCount++;
+	}
+	m_reductionTextures.assign(reductionCount, 0);
+	m_reductionFBOs.assign(reductionCount, 0);
+
+	//The textures are read with linear filtering, the taps of the blur and the reductions fetch between texels
+	std::vector<GLuint*> textures;
+	std::vector<int> sizes;
+	textures.push_back(&m_shadowMapTexture);
+	sizes.push_back(m_resolution);
+	textures.push_back(&m_blurTexture);
+	sizes.push_back(filteredSize);
+	if (m_downsample > 1){
+		textures.push_back(&m_downsampledTexture);
+		sizes.push_back(filteredSize);
+	}
+	for (int i = 0; i < reductionCount; i++){
+		textures.push_back(&m_reductionTextures[i]);
+		sizes.push_back(std::max(1, m_resolution >> (i + 1)));
+	}
+	for (unsigned int i = 0; i < textures.size(); i++){
+		m_glFunctions->glGenTextures(1, textures[i]);
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, *textures[i]);
+		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, sizes[i], sizes[i], 0, GL_RG, GL_FLOAT, 0);
+		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
+	m_filteredTexture = m_downsample > 1 ? m_downsampledTexture : m_shadowMapTexture;
+
+	m_glFunctions->glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	m_glFunctions->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_resolution, m_resolution);
+
+	//Attach textures to FBOs
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapFBO);
+	m_glFunctions->glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_shadowMapTexture, 0);
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_blurFBO);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_blurTexture, 0);
+	for (int i = 0; i < reductionCount; i++){
+		m_glFunctions->glGenFramebuffers(1, &m_reductionFBOs[i]);
+		m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_reductionFBOs[i]);
+		m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_reductionTextures[i], 0);
+	}
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_filteredFBO);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_filteredTexture, 0);
+
+	//Check if framebuffer is OK
+	GLenum fboStatus = m_glFunctions->glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+	if (fboStatus != GL_FRAMEBUFFER_COMPLETE){
+		qDebug() << "Shadow map filter FrameBuffer error:" << fboStatus;
+	}
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	//Gaussian in texels of the filtered map. A third of the radius is the standard deviation, so the blur looks the same at every downsample factor
+	float sigma = m_kernelRadius / (3.0f * m_downsample);
+	int radius = std::min(MaxKernelRadius, (int)ceil(m_kernelRadius / (float)m_downsample));
+	float gaussian[MaxKernelRadius + 1];
+	float sum = 0;
+	for (int i = 0; i <= radius; i++){
+		gaussian[i] = sigma > 0 ? exp(-(i * i) / (2 * sigma * sigma)) : 0;
+		sum += i == 0 ? gaussian[i] : 2 * gaussian[i];
+	}
+
+	//The center tap alone, then texels i and i + 1 merged into one linear fetch between them with the sum of their weights
+	m_offsets[0] = 0;
+	m_weights[0] = 1;
+	m_tapCount = 1;
+	if (radius > 0 && sum > 0){
+		m_weights[0] = gaussian[0] / sum;
+		for (int i = 1; i <= radius; i += 2){
+			float weightA = gaussian[i] / sum;
+			float weightB = i + 1 <= radius ? gaussian[i + 1] / sum : 0;
+			m_weights[m_tapCount] = weightA + weightB;
+			m_offsets[m_tapCount] = (i * weightA + (i + 1) * weightB) / (weightA + weightB);
+			m_tapCount++;
+		}
+	}
+
+	m_isDirty = false;
+}
+
+void ShadowMapFilter::drawPasses()
+{
+	m_shaderProgram->useMode(BlurMode);
+	m_glFunctions->glBindVertexArray(m_quadVAO);
+
+	//Halve the shadow map until it has the size of the filtered map
+	int filteredSize = std::max(1, m_resolution / m_downsample);
+	GLuint source = m_shadowMapTexture;
+	for (unsigned int i = 0; i < m_reductionTextures.size(); i++){
+		int size = std::max(1, m_resolution >> (i + 1));
+		m_glFunctions->glViewport(0, 0, size, size);
+		drawPass(source, m_reductionFBOs[i], 0, 0, ReductionOffsets, ReductionWeights, 1);
+		source = m_reductionTextures[i];
+	}
+	if (m_downsample > 1){
+		m_glFunctions->glViewport(0, 0, filteredSize, filteredSize);
+		drawPass(source, m_filteredFBO, 0, 0, ReductionOffsets, ReductionWeights, 1);
+	}
+
+	//Blur horizontally into the blur texture and vertically back. The quad covers every texel, so the targets aren't cleared
+	if (m_tapCount > 1){
+		m_glFunctions->glViewport(0, 0, filteredSize, filteredSize);
+		drawPass(m_filteredTexture, m_blurFBO, 1.0f / filteredSize, 0, m_offsets, m_weights, m_tapCount);
+		drawPass(m_blurTexture, m_filteredFBO, 0, 1.0f / filteredSize, m_offsets, m_weights, m_tapCount);
+	}
+
+	m_glFunctions->glBindVertexArray(0);
+}
+
+void ShadowMapFilter::drawPass(GLuint source, GLuint framebuffer, float scaleX, float scaleY, const float* offsets, const float* weights, int tapCount)
+{
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+
+	m_glFunctions->glUniform2f(m_shaderProgram->getLocation(m_scaleUniform), scaleX, scaleY);
+	m_glFunctions->glUniform1fv(m_shaderProgram->getLocation(m_offsetsUniform), tapCount, offsets);
+	m_glFunctions->glUniform1fv(m_shaderProgram->getLocation(m_weightsUniform), tapCount, weights);
+	m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_tapCountUniform), tapCount);
+
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + ShadowMapUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, source);
+
+	m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
+}
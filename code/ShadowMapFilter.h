@@ -0,0 +1,161 @@
+#ifndef ShadowMapFilter_h__
+#define ShadowMapFilter_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+//The filter passes use the blur variant of the uber-shader
+#include "ShaderProgram.h"
+
+#include <vector>
+
+//Taps per side of the blur kernel, the center tap included. Must match the size of the tap arrays in the uber-shader
+const int MaxBlurTaps = 9;
+
+//Storage of the two moments of the variance shadow map
+enum MomentFormat
+{
+	Moments32Float = 0, //GL_RG32F
+	Moments16Float = 1, //GL_RG16F, the least precise
+	Moments16Unorm = 2, //GL_RG16, depth and its square are in [0, 1]
+	MomentFormatCount = 3
+};
+
+/// <remarks>
+///The variance shadow map and the passes which filter it. The moments are blurred with one horizontal and one vertical Gaussian pass.
+///Each tap reads between two texels with linear filtering, so a kernel of radius r takes 1 + r / 2 fetches per side instead of r.
+///The map can be filtered at a lower resolution. It is then halved until it has that size, each pass averaging 2x2 texels, so every texel of the shadow map counts.
+///Resolution, kernel radius, downsample factor and moment format are set by the scene and the textures are reallocated when they change.
+///The GPU time of the passes is measured with timer queries, read frames later so the CPU never waits
+/// </remarks>
+class ShadowMapFilter
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	ShadowMapFilter(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~ShadowMapFilter();
+
+	/// <summary>Creates the framebuffers and the timer query. Needs a current openGL context</summary>
+	/// <param name="shaderProgram">Uber-shader with the blur variant</param>
+	/// <param name="quadVAO">VAO of a fullscreen quad the passes are drawn with</param>
+	/// <returns>void</returns>
+	void init(ShaderProgram* shaderProgram, GLuint quadVAO);
+
+	/// <summary>Sets the width and height of the shadow map</summary>
+	/// <param name="resolution">Size in texels</param>
+	/// <returns>void</returns>
+	void setResolution(int resolution);
+	/// <summary>Returns the width and height of the shadow map</summary>
+	/// <returns>int</returns>
+	int getResolution() const;
+	/// <summary>Sets the radius of the blur in texels of the shadow map. The Gaussian has a standard deviation of a third of it, 0 disables the blur</summary>
+	/// <param name="radius">Radius in texels, clamped to what the shader's tap arrays can hold</param>
+	/// <returns>void</returns>
+	void setKernelRadius(int radius);
+	/// <summary>Returns the radius of the blur in texels of the shadow map</summary>
+	/// <returns>int</returns>
+	int getKernelRadius() const;
+	/// <summary>Sets how many times smaller the filtered map is than the shadow map. The shadow map is halved once per factor of 2</summary>
+	/// <param name="downsample">1 filters at full resolution. Rounded down to a power of two</param>
+	/// <returns>void</returns>
+	void setDownsample(int downsample);
+	/// <summary>Returns how many times smaller the filtered map is than the shadow map</summary>
+	/// <returns>int</returns>
+	int getDownsample() const;
+	/// <summary>Sets the storage of the moments</summary>
+	/// <param name="format">Format of the shadow map and the filter textures</param>
+	/// <returns>void</returns>
+	void setMomentFormat(MomentFormat format);
+	/// <summary>Returns the storage of the moments</summary>
+	/// <returns>MomentFormat</returns>
+	MomentFormat getMomentFormat() const;
+
+	/// <summary>Binds the framebuffer of the shadow map and sets the viewport to its size. Reallocates the textures first if a setting changed</summary>
+	/// <returns>void</returns>
+	void bindFramebuffer();
+	/// <summary>Filters the moments rendered into the shadow map</summary>
+	/// <returns>void</returns>
+	void filter();
+	/// <summary>Binds the filtered map to the texture unit of the shadow map sampler and sends the min variance of its format. Call with the variant that reads it in use</summary>
+	/// <returns>void</returns>
+	void bind();
+	/// <summary>Filters the map a number of times with each downsample factor and moment format and logs the milliseconds per filter. Waits for the GPU.
+	/// Leaves the settings as they were, the shadow map has to be rendered again afterwards</summary>
+	/// <param name="iterations">Filters timed per option</param>
+	/// <returns>void</returns>
+	void benchmark(int iterations);
+
+	/// <summary>Returns the GPU time of the last timed filter in milliseconds</summary>
+	/// <returns>float</returns>
+	float getFilterTime() const;
+
+private:
+	/// <summary>Creates the textures with the current settings and attaches them to the framebuffers. Computes the blur kernel</summary>
+	/// <returns>void</returns>
+	void allocate();
+	/// <summary>Runs the 2x reductions and the blur passes</summary>
+	/// <returns>void</returns>
+	void drawPasses();
+	/// <summary>Draws one filter pass over the whole target</summary>
+	/// <param name="source">Texture read by the pass</param>
+	/// <param name="framebuffer">Framebuffer written by the pass</param>
+	/// <param name="scaleX">Step between the taps in x in texture coordinates</param>
+	/// <param name="scaleY">Step between the taps in y in texture coordinates</param>
+	/// <param name="offsets">Offset of each tap in steps</param>
+	/// <param name="weights">Weight of each tap, the taps other than the first are taken on both sides</param>
+	/// <param name="tapCount">Amount of taps per side, the center tap included</param>
+	/// <returns>void</returns>
+	void drawPass(GLuint source, GLuint framebuffer, float scaleX, float scaleY, const float* offsets, const float* weights, int tapCount);
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	//Uber-shader the filter uniforms are set on
+	ShaderProgram* m_shaderProgram;
+	//Handles for shader uniforms
+	int m_scaleUniform;
+	int m_offsetsUniform;
+	int m_weightsUniform;
+	int m_tapCountUniform;
+	int m_minVarianceUniform;
+	//Fullscreen quad
+	GLuint m_quadVAO;
+
+	//Moments rendered from the light, with a depth buffer for the pass
+	GLuint m_shadowMapFBO;
+	GLuint m_shadowMapTexture;
+	GLuint m_depthBuffer;
+	//Result of the horizontal pass
+	GLuint m_blurFBO;
+	GLuint m_blurTexture;
+	//Result of the vertical pass without a depth buffer. Writes into the shadow map texture when it isn't downsampled
+	GLuint m_filteredFBO;
+	GLuint m_filteredTexture;
+	//Lower resolution texture the filtered map is kept in when it is downsampled
+	GLuint m_downsampledTexture;
+	//Half size textures of the reductions before the last one, which writes into the downsampled texture. Each is half the size of the one before
+	std::vector<GLuint> m_reductionTextures;
+	std::vector<GLuint> m_reductionFBOs;
+
+	int m_resolution;
+	int m_kernelRadius;
+	int m_downsample;
+	MomentFormat m_momentFormat;
+	//Set when a setting changed since the textures were allocated
+	bool m_isDirty;
+
+	//Linear taps of the Gaussian for the size of the filtered map
+	float m_offsets[MaxBlurTaps];
+	float m_weights[MaxBlurTaps];
+	int m_tapCount;
+
+	//Timer query around the filter passes
+	GLuint m_timerQuery;
+	bool m_isTimerPending;
+	float m_filterTime;
+};
+
+#endif // ShadowMapFilter_h__
@@ -1,6 +1,6 @@
 #include "Texture.h"
 
-Texture::Texture(QOpenGLFunctions_3_3_Core* functions)
+Texture::Texture(GLStateCache* functions)
 {
 	m_glFunctions = functions;
 	m_textureID = NULL;
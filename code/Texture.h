@@ -4,7 +4,7 @@
 //For storing texture image
 #include <QImage>
 //OpenGL Functions
-#include <QOpenGLFunctions_3_3_Core>
+#include "GLStateCache.h"
 //For converting QImage to openGL Format
 #include <QtOpenGL/QGLWidget>
 
@@ -17,7 +17,7 @@ public:
 	/// <summary>Constructor</summary>
 	/// <param name="functions">Enables the class to call openGL functions</param>
 	/// <returns></returns>
-	Texture(QOpenGLFunctions_3_3_Core* functions);
+	Texture(GLStateCache* functions);
 	/// <summary>Destructor</summary>
 	/// <returns></returns>
 	~Texture();
@@ -41,7 +41,7 @@ public:
 
 private:
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
 	//Holds the texture that should be used by this mesh
 	GLuint m_textureID;
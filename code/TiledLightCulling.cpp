@@ -0,0 +1,213 @@
+#include "TiledLightCulling.h"
+
+//Size of the tiles in pixels
+const int TileSize = 16;
+//Texture units of the light lists. The G-Buffer uses units 2 to 5
+const GLint LightDataUnit = 6;
+const GLint TileDataUnit = 7;
+const GLint LightIndexUnit = 8;
+
+TiledLightCulling::TiledLightCulling(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+	m_shaderProgram = NULL;
+
+	m_lightDataBuffer = 0;
+	m_lightDataTexture = 0;
+	m_tileDataBuffer = 0;
+	m_tileDataTexture = 0;
+	m_lightIndexBuffer = 0;
+	m_lightIndexTexture = 0;
+
+	m_tileCountX = 0;
+	m_tileCountY = 0;
+	m_lightCount = 0;
+}
+
+TiledLightCulling::~TiledLightCulling()
+{
+	//Delete buffer textures
+	m_glFunctions->glDeleteTextures(1, &m_lightDataTexture);
+	m_glFunctions->glDeleteTextures(1, &m_tileDataTexture);
+	m_glFunctions->glDeleteTextures(1, &m_lightIndexTexture);
+
+	//Delete buffers
+	m_glFunctions->glDeleteBuffers(1, &m_lightDataBuffer);
+	m_glFunctions->glDeleteBuffers(1, &m_tileDataBuffer);
+	m_glFunctions->glDeleteBuffers(1, &m_lightIndexBuffer);
+	m_glFunctions = NULL;
+}
+
+void TiledLightCulling::init(ShaderProgram* shaderProgram)
+{
+	m_shaderProgram = shaderProgram;
+
+	//Get handles for shader uniforms
+	m_tileSizeUniform = m_shaderProgram->addUniform("tileSize");
+	m_tileCountXUniform = m_shaderProgram->addUniform("tileCountX");
+
+	//Associate texture units to the samplers of the light lists
+	m_shaderProgram->setSampler("lightDataSampler", LightDataUnit);
+	m_shaderProgram->setSampler("tileDataSampler", TileDataUnit);
+	m_shaderProgram->setSampler("lightIndexSampler", LightIndexUnit);
+
+	//A buffer texture reads the data store of its buffer, so the lists are only uploaded into the buffers afterwards
+	m_glFunctions->glGenBuffers(1, &m_lightDataBuffer);
+	m_glFunctions->glGenBuffers(1, &m_tileDataBuffer);
+	m_glFunctions->glGenBuffers(1, &m_lightIndexBuffer);
+	upload(m_lightDataBuffer, NULL, 0);
+	upload(m_tileDataBuffer, NULL, 0);
+	upload(m_lightIndexBuffer, NULL, 0);
+
+	m_glFunctions->glGenTextures(1, &m_lightDataTexture);
+	m_glFunctions->glGenTextures(1, &m_tileDataTexture);
+	m_glFunctions->glGenTextures(1, &m_lightIndexTexture);
+
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_lightDataTexture);
+	m_glFunctions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightDataBuffer);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + TileDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_tileDataTexture);
+	m_glFunctions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_tileDataBuffer);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightIndexUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_lightIndexTexture);
+	m_glFunctions->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_lightIndexBuffer);
+
+	unbind();
+}
+
+void TiledLightCulling::addLight(const Vector3& position, const Vector3& color, float intensity, float radius)
+{
+	StagedLight light;
+	light.position = position;
+	light.color = color;
+	light.intensity = intensity;
+	light.radius = radius;
+	m_stagedLights.push_back(light);
+}
+
+void TiledLightCulling::cullLights(const Matrix44& view, const Matrix44& projection, float nearPlane, int width, int height)
+{
+	m_tileCountX = (width + TileSize - 1) / TileSize;
+	m_tileCountY = (height + TileSize - 1) / TileSize;
+	int tileCount = m_tileCountX * m_tileCountY;
+
+	Matrix44 viewMatrix = view;
+	Matrix44 projectionMatrix = projection;
+
+	m_lightData.clear();
+	m_lightTiles.clear();
+	for (unsigned int i = 0; i < m_stagedLights.size(); i++){
+		StagedLight& light = m_stagedLights[i];
+		Vector4 position = viewMatrix * Vector4(light.position[0], light.position[1], light.position[2], 1);
+		float radius = light.radius;
+
+		//The whole sphere is between the near plane and the camera or behind the camera
+		if (position[2] - radius >= -nearPlane){
+			continue;
+		}
+
+		//A sphere crossing the near plane can cover any part of the screen, so it gets every tile
+		int rect[4];
+		ViewFrustumCheck::sphereScreenRect(Vector3(position[0], position[1], position[2]), radius, projectionMatrix, nearPlane, width, height, rect);
+
+		//Outside the screen
+		if (rect[0] > rect[2] || rect[1] > rect[3]){
+			continue;
+		}
+
+		//Pixels to tiles. gl_FragCoord has its origin in the lower left corner like the rectangle
+		int tiles[4] = { rect[0] / TileSize, rect[1] / TileSize, rect[2] / TileSize, rect[3] / TileSize };
+		m_lightTiles.insert(m_lightTiles.end(), tiles, tiles + 4);
+
+		//Camera space position, so the shader doesn't multiply it with the view matrix for each pixel
+		Vector3 color = light.color;
+		float data[8] = { position[0], position[1], position[2], radius, color[0], color[1], color[2], light.intensity };
+		m_lightData.insert(m_lightData.end(), data, data + 8);
+	}
+	m_lightCount = m_lightTiles.size() / 4;
+	m_stagedLights.clear();
+
+	//Count the lights of each tile
+	m_tileData.assign(tileCount * 2, 0);
+	for (unsigned int light = 0; light < m_lightCount; light++){
+		int* tiles = &m_lightTiles[light * 4];
+		for (int y = tiles[1]; y <= tiles[3]; y++){
+			for (int x = tiles[0]; x <= tiles[2]; x++){
+				m_tileData[(y * m_tileCountX + x) * 2 + 1]++;
+			}
+		}
+	}
+
+	//Where each tile's lights start in the index list. The counts are filled again while the indices are written
+	unsigned int offset = 0;
+	for (int tile = 0; tile < tileCount; tile++){
+		m_tileData[tile * 2] = offset;
+		offset += m_tileData[tile * 2 + 1];
+		m_tileData[tile * 2 + 1] = 0;
+	}
+
+	m_lightIndices.resize(offset);
+	for (unsigned int light = 0; light < m_lightCount; light++){
+		int* tiles = &m_lightTiles[light * 4];
+		for (int y = tiles[1]; y <= tiles[3]; y++){
+			for (int x = tiles[0]; x <= tiles[2]; x++){
+				GLuint* tile = &m_tileData[(y * m_tileCountX + x) * 2];
+				m_lightIndices[tile[0] + tile[1]] = light;
+				tile[1]++;
+			}
+		}
+	}
+
+	upload(m_lightDataBuffer, m_lightData.empty() ? NULL : &m_lightData[0], m_lightData.size() * sizeof(float));
+	upload(m_tileDataBuffer, m_tileData.empty() ? NULL : &m_tileData[0], m_tileData.size() * sizeof(GLuint));
+	upload(m_lightIndexBuffer, m_lightIndices.empty() ? NULL : &m_lightIndices[0], m_lightIndices.size() * sizeof(GLuint));
+}
+
+void TiledLightCulling::bind()
+{
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_lightDataTexture);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + TileDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_tileDataTexture);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightIndexUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, m_lightIndexTexture);
+
+	m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_tileSizeUniform), TileSize);
+	m_glFunctions->glUniform1i(m_shaderProgram->getLocation(m_tileCountXUniform), m_tileCountX);
+}
+
+void TiledLightCulling::unbind()
+{
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, 0);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + TileDataUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, 0);
+	m_glFunctions->glActiveTexture(GL_TEXTURE0 + LightIndexUnit);
+	m_glFunctions->glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+unsigned int TiledLightCulling::getLightCount() const
+{
+	return m_lightCount;
+}
+
+unsigned int TiledLightCulling::getTileEntryCount() const
+{
+	return m_lightIndices.size();
+}
+
+void TiledLightCulling::upload(GLuint buffer, const void* data, unsigned int size)
+{
+	//An empty list still gets a texel, so the buffer texture always has a data store
+	const GLuint empty[4] = { 0, 0, 0, 0 };
+	if (size == 0){
+		data = empty;
+		size = sizeof(empty);
+	}
+
+	//Allocating new storage each frame lets the GPU keep reading the lists of the frame before
+	m_glFunctions->glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	m_glFunctions->glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+	m_glFunctions->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
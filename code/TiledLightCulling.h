@@ -0,0 +1,116 @@
+#ifndef TiledLightCulling_h__
+#define TiledLightCulling_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+//The tile uniforms and light list samplers are set on the tiled light pass variants of the uber-shader
+#include "ShaderProgram.h"
+//The projected rectangle of each light
+#include "ViewFrustumCheck.h"
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+/// <remarks>
+///Light lists for the tiled light pass of deferred shading. The screen is split into tiles and each point light is added to the tiles its projected bounding box covers.
+///The lights, the offset and count of each tile's lights and the light index list are uploaded into buffer textures, so one fullscreen pass can shade each pixel
+///with only the lights of its tile instead of a stencil pass and a light pass per light
+/// </remarks>
+class TiledLightCulling
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	TiledLightCulling(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~TiledLightCulling();
+
+	/// <summary>Creates the buffer textures and associates them to the samplers of the uber-shader. Needs a current openGL context</summary>
+	/// <param name="shaderProgram">Uber-shader with the tiled light pass variants</param>
+	/// <returns>void</returns>
+	void init(ShaderProgram* shaderProgram);
+	/// <summary>Adds a point light to the lights of the next cullLights</summary>
+	/// <param name="position">Position in world space</param>
+	/// <param name="color">Color of the light</param>
+	/// <param name="intensity">Intensity of the light</param>
+	/// <param name="radius">Max radius of the light. Pixels further away get no light</param>
+	/// <returns>void</returns>
+	void addLight(const Vector3& position, const Vector3& color, float intensity, float radius);
+	/// <summary>Bins the lights added since the last call into the tiles of the screen and uploads the lists. Lights outside the screen or in front of the near plane are dropped</summary>
+	/// <param name="view">a view matrix</param>
+	/// <param name="projection">a projection matrix</param>
+	/// <param name="nearPlane">Distance to the near plane of the projection</param>
+	/// <param name="width">Width of the screen in pixels</param>
+	/// <param name="height">Height of the screen in pixels</param>
+	/// <returns>void</returns>
+	void cullLights(const Matrix44& view, const Matrix44& projection, float nearPlane, int width, int height);
+	/// <summary>Binds the light lists to their texture units and sends the tile size and count. Call with a tiled light pass variant in use</summary>
+	/// <returns>void</returns>
+	void bind();
+	/// <summary>Unbinds the light lists from their texture units</summary>
+	/// <returns>void</returns>
+	void unbind();
+
+	/// <summary>Returns how many lights were on the screen in the last cullLights</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getLightCount() const;
+	/// <summary>Returns the length of the light index list of the last cullLights, the sum of the lights of all tiles</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getTileEntryCount() const;
+
+private:
+	/// <remarks>
+	///A light waiting for cullLights
+	/// </remarks>
+	struct StagedLight
+	{
+		Vector3 position;
+		Vector3 color;
+		float intensity;
+		float radius;
+	};
+
+	/// <summary>Replaces the data of a buffer</summary>
+	/// <param name="buffer">Buffer behind a buffer texture</param>
+	/// <param name="data">Data to upload</param>
+	/// <param name="size">Size in bytes, can be 0</param>
+	/// <returns>void</returns>
+	void upload(GLuint buffer, const void* data, unsigned int size);
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	//Uber-shader the tile uniforms are set on
+	ShaderProgram* m_shaderProgram;
+	//Handles for shader uniforms
+	int m_tileSizeUniform;
+	int m_tileCountXUniform;
+
+	//Position in camera space and radius, then color and intensity of each light. RGBA32F
+	GLuint m_lightDataBuffer;
+	GLuint m_lightDataTexture;
+	//Offset into the light index list and count of each tile. RG32UI
+	GLuint m_tileDataBuffer;
+	GLuint m_tileDataTexture;
+	//Indices of the lights of all tiles, one tile after the other. R32UI
+	GLuint m_lightIndexBuffer;
+	GLuint m_lightIndexTexture;
+
+	std::vector<StagedLight> m_stagedLights;
+	//CPU copies of the lists of the last cullLights
+	std::vector<float> m_lightData;
+	std::vector<GLuint> m_tileData;
+	std::vector<GLuint> m_lightIndices;
+	//First and last tile in x and y covered by each light on the screen
+	std::vector<int> m_lightTiles;
+
+	int m_tileCountX;
+	int m_tileCountY;
+	unsigned int m_lightCount;
+};
+
+#endif // TiledLightCulling_h__
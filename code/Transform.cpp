@@ -1,4 +1,9 @@
 #include "Transform.h"
+//FLT_MAX
+#include <float.h>
+
+//Transforms with fewer children test them one at a time in their own draw
+const unsigned int BatchCullingMinChildren = 8;
 
 Transform::Transform()
 {
@@ -7,6 +12,10 @@ Transform::Transform()
 	m_isPlayer = false;
 	m_bvScaleFactor = 1;
 	m_isSkybox = false;
+	m_isDirty = true;
+	m_isViewDirty = true;
+	m_isBoundsChanged = true;
+	m_cachedPlane = 0;
 }
 
 Transform::~Transform(void)
@@ -15,8 +24,9 @@ Transform::~Transform(void)
 	m_children.clear();
 }
 
-void Transform::update(Matrix44& view, const Matrix44& model)
+void Transform::update(Matrix44& view, const Matrix44& model, bool isParentChanged)
 {
+	bool isModelChanged = false;
 	if (!m_isRoot){
 		/*
 		If the model matrix isn't reset and just multiplied with the parents model matrix.
@@ -25,16 +35,32 @@ void Transform::update(Matrix44& view, const Matrix44& model)
 		But the next render loop the child will have -10 and inherit additional translation from parent.
 		Instead transform matrices are implemented to hold the updated transforms. Model matrix is reset and inherits these transforms + the parent's.
 		*/
-		m_model = m_rotation  * m_lookAt * m_translation  * m_rotationAroundOwnAxis * m_scaling; //A rotation is applied first to make the object rotate around itself.
+		//The local matrix is only rebuilt when translate, rotate, scale or lookAt changed it
+		if (m_isDirty){
+			//Everything but the scaling is rotation and translation. The scaling is kept apart so the matrix doesn't need another multiplication
+			Matrix44 rigid = m_rotation * m_lookAt * m_translation * m_rotationAroundOwnAxis; //A rotation is applied first to make the object rotate around itself.
+			m_localTRS.SetRigid(rigid);
+			m_localTRS.SetScale(Vector3(m_scaling[0][0], m_scaling[1][1], m_scaling[2][2]));
+			m_localMatrix = m_localTRS.GetMatrix();
+		}
 
-		Matrix44 thisModel = m_model;
-		//Multiply the parent's model matrix with this
-		m_model = model * thisModel;
+		//Multiply the parent's model matrix with this. Skipped when neither this nor the parent has changed since the last update, or this was moved to another parent
+		if (m_isDirty || isParentChanged || m_isParentChanged){
+			m_model = model * m_localMatrix;
+			m_isViewDirty = true;
+			isModelChanged = true;
+		}
+		m_isDirty = false;
 	}
+	m_isParentChanged = false;
 	if (m_isCamera){
 		//Third person camera
-		//Invert the player's model matrix and set it as the view matrix
-		view = m_model.Inverse();
+		//Invert the player's model matrix and set it as the view matrix. All transforms are rotation, scaling and translation so the last row is always 0 0 0 1
+		if (m_isViewDirty){
+			m_view = m_model.AffineInverse();
+			m_isViewDirty = false;
+		}
+		view = m_view;
 	}
 	if (m_isSkybox){
 
@@ -48,8 +74,12 @@ void Transform::update(Matrix44& view, const Matrix44& model)
 
 		//Set the matrix with only scale and translation as skybox's model matrix
 		m_model = onlyScaleAndTranslation;
+		isModelChanged = true;
 	}
 
+	//The merged bounding sphere is only recomputed when this moved, a child was added or removed or a child's bounds changed
+	bool isBoundsDirty = isModelChanged || m_isChildListChanged;
+
 	//Calls the childrens' update
 	if (!m_children.empty())
 	{
@@ -57,28 +87,163 @@ void Transform::update(Matrix44& view, const Matrix44& model)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->update(view, m_model);
+				m_children[i]->update(view, m_model, isModelChanged);
+				if (m_children[i]->boundsChanged()){
+					isBoundsDirty = true;
+				}
 			}
 		}
 	}
+
+	//Merge the childrens' bounding spheres in world space. They are also kept one array per coordinate for the batch frustum test in draw
+	if (isBoundsDirty){
+		m_bounds.clear();
+		m_childX.resize(m_children.size());
+		m_childY.resize(m_children.size());
+		m_childZ.resize(m_children.size());
+		m_childRadius.resize(m_children.size());
+		m_childMeshCounts.resize(m_children.size());
+		for (int i = 0; i < m_children.size(); i++)
+		{
+			BoundingSphere childBounds;
+			if (m_children[i] != NULL)
+			{
+				m_children[i]->getBounds(m_model, childBounds);
+				m_bounds.merge(childBounds);
+			}
+
+			//Children without a finite sphere can't be culled. An infinite radius always intersects
+			Vector3 center = childBounds.getCenter();
+			bool isCullable = !childBounds.isEmpty() && !childBounds.isInfinite();
+			m_childX[i] = center[0];
+			m_childY[i] = center[1];
+			m_childZ[i] = center[2];
+			m_childRadius[i] = isCullable ? childBounds.getRadius() : FLT_MAX;
+			m_childMeshCounts[i] = childBounds.getMeshCount();
+		}
+	}
+	m_isBoundsChanged = isBoundsDirty;
+	m_isChildListChanged = false;
 }
 
-void Transform::draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
+void Transform::draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch, const Matrix44& lightView, const Matrix44& model, float bvScaleFactor)
 {
 	//Calculate the total scale factor inherited from parent transform and self, to later forward to children nodes
 	float updatedScaleFactor = m_bvScaleFactor * bvScaleFactor;
 
-	//Calls the childrens' update
-	if (!m_children.empty())
+	//Planes the parent is completely inside of are already cleared. Restored after the children have been drawn
+	unsigned int parentPlanes = frustumCheck.getActivePlanes();
+
+	//Test the merged bounding sphere of the subtree. Skipped if children were added or removed since the update, since the sphere is out of date
+	if (frustumCheck.isSubtreeCulling() && !m_isChildListChanged && !m_bounds.isEmpty() && !m_bounds.isInfinite()){
+		unsigned int planeMask = parentPlanes;
+		FrustumIntersection intersection = frustumCheck.sphereInFrustum(m_bounds.getCenter(), m_bounds.getRadius(), planeMask, m_cachedPlane);
+		//Reject the whole subtree
+		if (intersection == OutsideFrustum){
+			if (shaderBranch != -1){
+				frustumCheck.shapesRendered -= m_bounds.getMeshCount();
+			}
+			return;
+		}
+		//The children only test the planes the subtree intersects. None if it is completely inside
+		frustumCheck.setActivePlanes(planeMask);
+	}
+
+	//Meshes can be shared by many transforms, so the plane which rejected each child last time is kept here. Restored after the children like the planes
+	unsigned int parentCachedPlane = frustumCheck.getCachedPlane();
+	if (m_childCachedPlanes.size() != m_children.size()){
+		m_childCachedPlanes.assign(m_children.size(), 0);
+	}
+	//Same for the occlusion query id of each child
+	unsigned int parentQueryId = drawContext.queryId;
+	if (m_childQueryIds.size() != m_children.size()){
+		m_childQueryIds.assign(m_children.size(), 0);
+	}
+
+	//Drop the children rejected by the same plane as last time, test the others at once, then each visible child only tests the planes its own sphere intersects
+	if (frustumCheck.isSubtreeCulling() && !m_isChildListChanged && m_children.size() >= BatchCullingMinChildren && frustumCheck.getActivePlanes() != 0){
+		unsigned int childPlanes = frustumCheck.getActivePlanes();
+		m_batchChildren.clear();
+		m_batchX.clear();
+		m_batchY.clear();
+		m_batchZ.clear();
+		m_batchRadius.clear();
+		for (int i = 0; i < m_children.size(); i++)
+		{
+			if (m_children[i] == NULL){
+				continue;
+			}
+			if (frustumCheck.isOutsideCachedPlane(Vector3(m_childX[i], m_childY[i], m_childZ[i]), m_childRadius[i], m_childCachedPlanes[i])){
+				if (shaderBranch != -1){
+					frustumCheck.shapesRendered -= m_childMeshCounts[i];
+				}
+				continue;
+			}
+			m_batchChildren.push_back(i);
+			m_batchX.push_back(m_childX[i]);
+			m_batchY.push_back(m_childY[i]);
+			m_batchZ.push_back(m_childZ[i]);
+			m_batchRadius.push_back(m_childRadius[i]);
+		}
+		if (!m_batchChildren.empty()){
+			m_childVisible.resize((m_batchChildren.size() + 31) / 32);
+			m_childPlaneMasks.resize(m_batchChildren.size());
+			frustumCheck.spheresInFrustum(&m_batchX[0], &m_batchY[0], &m_batchZ[0], &m_batchRadius[0], m_batchChildren.size(), &m_childVisible[0], &m_childPlaneMasks[0]);
+		}
+
+		for (unsigned int j = 0; j < m_batchChildren.size(); j++)
+		{
+			unsigned int i = m_batchChildren[j];
+			if (!(m_childVisible[j / 32] & (1u << (j % 32)))){
+				//Find the plane which rejected it, so it is tested first next time
+				unsigned int planeMask = childPlanes;
+				unsigned int cachedPlane = m_childCachedPlanes[i];
+				frustumCheck.sphereInFrustum(Vector3(m_childX[i], m_childY[i], m_childZ[i]), m_childRadius[i], planeMask, cachedPlane);
+				m_childCachedPlanes[i] = cachedPlane;
+				if (shaderBranch != -1){
+					frustumCheck.shapesRendered -= m_childMeshCounts[i];
+				}
+				continue;
+			}
+			frustumCheck.setActivePlanes(m_childPlaneMasks[j]);
+			frustumCheck.setCachedPlane(m_childCachedPlanes[i]);
+			drawContext.queryId = m_childQueryIds[i];
+			m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, m_model, updatedScaleFactor);
+			m_childCachedPlanes[i] = frustumCheck.getCachedPlane();
+			m_childQueryIds[i] = drawContext.queryId;
+			frustumCheck.setActivePlanes(childPlanes);
+		}
+	}
+	//Calls the childrens' draw
+	else if (!m_children.empty())
 	{
 		for (int i = 0; i < m_children.size(); i++)
 		{
 			if (m_children[i] != NULL)
 			{
-				m_children[i]->draw(frustumCheck, projection, view, shaderBranch, lightView, m_model, updatedScaleFactor);
+				frustumCheck.setCachedPlane(m_childCachedPlanes[i]);
+				drawContext.queryId = m_childQueryIds[i];
+				m_children[i]->draw(frustumCheck, drawContext, projection, view, shaderBranch, lightView, m_model, updatedScaleFactor);
+				m_childCachedPlanes[i] = frustumCheck.getCachedPlane();
+				m_childQueryIds[i] = drawContext.queryId;
 			}
 		}
 	}
+
+	frustumCheck.setCachedPlane(parentCachedPlane);
+	drawContext.queryId = parentQueryId;
+	frustumCheck.setActivePlanes(parentPlanes);
+}
+
+void Transform::getBounds(const Matrix44& model, BoundingSphere& bounds)
+{
+	//Already merged in world space by this transform's update
+	bounds.merge(m_bounds);
+}
+
+bool Transform::boundsChanged()
+{
+	return m_isBoundsChanged;
 }
 
 Matrix44 Transform::getMatrix()
@@ -88,6 +253,7 @@ Matrix44 Transform::getMatrix()
 
 void Transform::rotate(float angle, int x, int y, int z, RotateAround space)
 {
+	m_isDirty = true;
 	if (space == Self){ //Rotates around own axis
 		m_rotationAroundOwnAxis.Rotate(angle, x, y, z);
 	}
@@ -99,6 +265,7 @@ void Transform::rotate(float angle, int x, int y, int z, RotateAround space)
 
 void Transform::rotate(float angle, Vector3 vector, RotateAround space)
 {
+	m_isDirty = true;
 	if (space == Self){ //Rotates around own axis
 		m_rotationAroundOwnAxis.Rotate(angle, vector);
 	}
@@ -110,22 +277,26 @@ void Transform::rotate(float angle, Vector3 vector, RotateAround space)
 
 void Transform::translate( float x, float y, float z )
 {
+	m_isDirty = true;
 	m_translation.Translate(x, y, z);
 }
 
 void Transform::translate( Vector3 vector )
 {
+	m_isDirty = true;
 	m_translation.Translate(vector);
 }
 
 void Transform::scale( float factor )
 {
+	m_isDirty = true;
 	m_bvScaleFactor = factor;
 	m_scaling.Scale(factor);
 }
 
 void Transform::setScale(float factor)
 {
+	m_isDirty = true;
 	m_bvScaleFactor = factor;
 	m_scaling.SetToIdentity();
 	m_scaling.Scale(factor);
@@ -133,11 +304,13 @@ void Transform::setScale(float factor)
 
 void Transform::scale( float x, float y, float z )
 {
+	m_isDirty = true;
 	m_scaling.Scale(x, y, z);
 }
 
 void Transform::scale( Vector3 vector )
 {
+	m_isDirty = true;
 	m_scaling.Scale(vector);
 }
 
@@ -159,9 +332,10 @@ void Transform::setNodeType(TransformType node)
 
 void Transform::lookAt(Vector3 eyePosition, Vector3 eyeTarget, Vector3 eyeUp)
 {
+	m_isDirty = true;
 	m_lookAt.LookAt(eyePosition, eyeTarget, eyeUp);
 
-	//Invert the lookAt matrix so it can be used to move an object
-	Matrix44 invertedLookAt = m_lookAt.Inverse();
+	//Invert the lookAt matrix so it can be used to move an object. The lookAt matrix is only rotation and translation
+	Matrix44 invertedLookAt = m_lookAt.RigidInverse();
 	m_lookAt = invertedLookAt;
 }
@@ -39,10 +39,13 @@ public:
 	/// <summary>Updates the model/view matrix and then calls its childrens' update/summary>
 	/// <param name="view">Used only if the transform instance represents a camera. The view will store the inverse of the parents model matrix</param>
 	/// <param name="model">the parent's model matrix</param>
+	/// <param name="isParentChanged">True if the parent's model matrix changed since the last update</param>
 	/// <returns>void</returns>
-	void update(Matrix44& view, const Matrix44& model = Matrix44());
-	/// <summary>Does nothing with this class. Just calls its childrens' update</summary>
-	/// <param name="frustumCheck">Is not handled in this class, just forwards it to its children</param>
+	void update(Matrix44& view, const Matrix44& model = Matrix44(), bool isParentChanged = true);
+	/// <summary>Checks the merged bounding sphere of the subtree against the view frustum. Skips the children if it's outside, otherwise calls the childrens' draw
+	///with the planes the subtree is completely inside of disabled</summary>
+	/// <param name="frustumCheck">Has the view frustum planes and function to check if bounding sphere is inside of the frustum</param>
+	/// <param name="drawContext">State of the pass being drawn. The occlusion query id of each child is kept here, like its cached plane</param>
 	/// <param name="projection">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="view">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="shaderBranch">Is not handled in this class, just forwards it to its children</param>
@@ -50,7 +53,15 @@ public:
 	/// <param name="model">Is not handled in this class, just forwards it to its children</param>
 	/// <param name="bvScaleFactor">Is not handled in this class, just forwards it to its children</param>
 	/// <returns>void</returns>
-	void draw(ViewFrustumCheck& frustumCheck, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);
+	void draw(ViewFrustumCheck& frustumCheck, DrawContext& drawContext, const Matrix44& projection, const Matrix44& view, int shaderBranch = -1, const Matrix44& lightView = Matrix44(), const Matrix44& model = Matrix44(), float bvScaleFactor = 1);
+	/// <summary>Returns the bounding sphere of this transform's subtree, merged by the last update</summary>
+	/// <param name="model">Not used. The sphere is already in world space</param>
+	/// <param name="bounds">Sphere the bounding sphere is merged into</param>
+	/// <returns>void</returns>
+	void getBounds(const Matrix44& model, BoundingSphere& bounds);
+	/// <summary>Returns true if the merged bounding sphere changed in the last update</summary>
+	/// <returns>bool</returns>
+	bool boundsChanged();
 	/// <summary>Returns the model/view matrix</summary>
 	/// <returns>Matrix4x4</returns>
 	Matrix44 getMatrix();
@@ -128,6 +139,35 @@ private:
 
 	//A Combination of Translation/Rotation matrices
 	Matrix44 m_lookAt;
+	//This transform's matrices combined into translation, rotation and scale. Gives the local matrix and its inverse without a general inverse
+	TransformTRS m_localTRS;
+	//This transform's own matrix, rebuilt only when it is dirty
+	Matrix44 m_localMatrix;
+	//Inverse of the model matrix. Only used by camera transforms
+	Matrix44 m_view;
+	//Bounding spheres of the children merged in world space. Used to cull the whole subtree at once
+	BoundingSphere m_bounds;
+	//World space bounding sphere of each child, one array per coordinate for the batch frustum test. Rebuilt with m_bounds
+	std::vector<float> m_childX;
+	std::vector<float> m_childY;
+	std::vector<float> m_childZ;
+	std::vector<float> m_childRadius;
+	std::vector<unsigned int> m_childMeshCounts;
+	//Children which passed their cached plane and go into the batch frustum test, with their bounding spheres
+	std::vector<unsigned int> m_batchChildren;
+	std::vector<float> m_batchX;
+	std::vector<float> m_batchY;
+	std::vector<float> m_batchZ;
+	std::vector<float> m_batchRadius;
+	//Result of the batch frustum test. A bit for each visible child of the batch and the planes each of them intersects
+	std::vector<unsigned int> m_childVisible;
+	std::vector<unsigned char> m_childPlaneMasks;
+	//The frustum plane which rejected the merged bounding sphere last time. Tested first in the next frame
+	unsigned int m_cachedPlane;
+	//The frustum plane which rejected each child last time. Given to the child's draw through ViewFrustumCheck
+	std::vector<unsigned char> m_childCachedPlanes;
+	//Occlusion query id of each child. Given to the child's draw through DrawContext
+	std::vector<unsigned int> m_childQueryIds;
 	//Holds the scale factor for the transform which is passed to the children
 	float m_bvScaleFactor;
 
@@ -136,6 +176,12 @@ private:
 	bool m_isCamera;
 	bool m_isPlayer;
 	bool m_isSkybox;
+	//Set by translate, rotate, scale and lookAt. The local matrix is rebuilt by the next update
+	bool m_isDirty;
+	//Set when the model matrix changed. The camera's view matrix is inverted again by the next update
+	bool m_isViewDirty;
+	//Set when the merged bounding sphere was recomputed in the last update. Tells the parent to merge again
+	bool m_isBoundsChanged;
 
 };
 #endif // Transform_h__
@@ -0,0 +1,165 @@
+#include "UniformBuffers.h"
+
+//For copying the matrices into the blocks
+#include <string.h>
+
+//Size of the ring buffer before it has to grow. Fits a few thousand objects
+const unsigned int InitialRingSize = 1 << 20;
+
+UniformBuffers::UniformBuffers(GLStateCache* functions)
+{
+	m_glFunctions = functions;
+
+	m_frameUBO = 0;
+	m_objectUBO = 0;
+	m_ringSize = InitialRingSize;
+	m_ringOffset = 0;
+	m_flushOffset = 0;
+	m_objectStride = sizeof(ObjectData);
+	m_stagedCount = 0;
+	resetCounters();
+}
+
+UniformBuffers::~UniformBuffers()
+{
+	//Delete UBOs
+	m_glFunctions->glDeleteBuffers(1, &m_frameUBO);
+	m_glFunctions->glDeleteBuffers(1, &m_objectUBO);
+	m_glFunctions = NULL;
+}
+
+void UniformBuffers::init()
+{
+	//Ranges bound with glBindBufferRange have to start at a multiple of the alignment
+	GLint alignment = 0;
+	m_glFunctions->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0){
+		m_objectStride = (sizeof(ObjectData) + alignment - 1) / alignment * alignment;
+	}
+
+	//FrameBlock
+	m_glFunctions->glGenBuffers(1, &m_frameUBO);
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+	m_glFunctions->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_STREAM_DRAW);
+	m_glFunctions->glBindBufferBase(GL_UNIFORM_BUFFER, FrameBlockBinding, m_frameUBO);
+
+	//Ring buffer of the ObjectBlocks. Bound range by range by bindObject
+	m_glFunctions->glGenBuffers(1, &m_objectUBO);
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, m_objectUBO);
+	m_glFunctions->glBufferData(GL_UNIFORM_BUFFER, m_ringSize, NULL, GL_STREAM_DRAW);
+
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers::setFrame(const Matrix44& projection, const Matrix44& view, const Matrix44& lightView, float width, float height)
+{
+	Matrix44 projectionMatrix = projection;
+	Matrix44 viewMatrix = view;
+	Matrix44 viewProjection = projection * view;
+	Matrix44 lightViewProjection = projection * lightView;
+	Matrix44 inverseProjection = projectionMatrix.Inverse();
+
+	FrameData frame;
+	memcpy(frame.view, &viewMatrix[0][0], sizeof(frame.view));
+	memcpy(frame.projection, &projectionMatrix[0][0], sizeof(frame.projection));
+	memcpy(frame.viewProjection, &viewProjection[0][0], sizeof(frame.viewProjection));
+	memcpy(frame.lightViewProjection, &lightViewProjection[0][0], sizeof(frame.lightViewProjection));
+	memcpy(frame.inverseProjection, &inverseProjection[0][0], sizeof(frame.inverseProjection));
+	frame.screenSize[0] = width;
+	frame.screenSize[1] = height;
+	frame.screenSize[2] = 0;
+	frame.screenSize[3] = 0;
+
+	//Allocating new storage each pass lets the GPU keep reading the block of the pass before
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+	m_glFunctions->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &frame, GL_STREAM_DRAW);
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+unsigned int UniformBuffers::addObject(const Matrix44& model, const Vector3& ambientMaterial, const Vector3& specularMaterial, float shininess)
+{
+	if (m_stagedObjects.size() < (m_stagedCount + 1) * m_objectStride){
+		m_stagedObjects.resize((m_stagedCount + 1) * m_objectStride * 2);
+	}
+
+	ObjectData* object = (ObjectData*)&m_stagedObjects[m_stagedCount * m_objectStride];
+	Matrix44 modelMatrix = model;
+	Vector3 ambient = ambientMaterial;
+	Vector3 specular = specularMaterial;
+	memcpy(object->model, &modelMatrix[0][0], sizeof(object->model));
+	for (int i = 0; i < 3; i++){
+		object->ambientMaterial[i] = ambient[i];
+		object->specularMaterial[i] = specular[i];
+	}
+	object->ambientMaterial[3] = 0;
+	object->specularMaterial[3] = shininess;
+
+	return m_stagedCount++;
+}
+
+void UniformBuffers::flushObjects()
+{
+	if (m_stagedCount == 0){
+		return;
+	}
+	unsigned int size = m_stagedCount * m_objectStride;
+
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, m_objectUBO);
+	//Grow the ring if the objects don't fit at all. Orphan it if they don't fit behind the last flush
+	if (size > m_ringSize){
+		while (m_ringSize < size){
+			m_ringSize *= 2;
+		}
+		m_glFunctions->glBufferData(GL_UNIFORM_BUFFER, m_ringSize, NULL, GL_STREAM_DRAW);
+		m_ringOffset = 0;
+	}
+	else if (m_ringOffset + size > m_ringSize){
+		m_glFunctions->glBufferData(GL_UNIFORM_BUFFER, m_ringSize, NULL, GL_STREAM_DRAW);
+		m_ringOffset = 0;
+	}
+
+	//The range hasn't been written since the ring was orphaned, so there is nothing to wait for
+	void* destination = m_glFunctions->glMapBufferRange(GL_UNIFORM_BUFFER, m_ringOffset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (destination != NULL){
+		memcpy(destination, &m_stagedObjects[0], size);
+		m_glFunctions->glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	else{
+		m_glFunctions->glBufferSubData(GL_UNIFORM_BUFFER, m_ringOffset, size, &m_stagedObjects[0]);
+	}
+	m_glFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_flushOffset = m_ringOffset;
+	m_ringOffset += size;
+	m_objectCount += m_stagedCount;
+	m_flushCount++;
+	m_stagedCount = 0;
+}
+
+void UniformBuffers::bindObject(unsigned int object)
+{
+	m_glFunctions->glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBlockBinding, m_objectUBO, m_flushOffset + object * m_objectStride, sizeof(ObjectData));
+}
+
+void UniformBuffers::setObject(const Matrix44& model, const Vector3& ambientMaterial, const Vector3& specularMaterial, float shininess)
+{
+	unsigned int object = addObject(model, ambientMaterial, specularMaterial, shininess);
+	flushObjects();
+	bindObject(object);
+}
+
+unsigned int UniformBuffers::getObjectCount() const
+{
+	return m_objectCount;
+}
+
+unsigned int UniformBuffers::getFlushCount() const
+{
+	return m_flushCount;
+}
+
+void UniformBuffers::resetCounters()
+{
+	m_objectCount = 0;
+	m_flushCount = 0;
+}
@@ -0,0 +1,124 @@
+#ifndef UniformBuffers_h__
+#define UniformBuffers_h__
+
+//OpenGL Functions
+#include "GLStateCache.h"
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <vector>
+
+//Binding points of the uniform blocks in the uber-shader
+const GLuint FrameBlockBinding = 0;
+const GLuint ObjectBlockBinding = 1;
+
+/// <remarks>
+///Uniform buffer objects holding the constants of the uber-shader. The FrameBlock has the matrices which are the same for every draw of a pass
+///and is uploaded once per pass. The ObjectBlock has the model matrix and material of a draw. Objects are staged on the CPU, uploaded together
+///into a ring buffer and each draw binds its range with glBindBufferRange. The shader forms mvp, depthMVP and modelView itself,
+///so a draw only multiplies and sends its model matrix
+/// </remarks>
+class UniformBuffers
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="functions">Enables the class to call openGL functions</param>
+	/// <returns></returns>
+	UniformBuffers(GLStateCache* functions);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~UniformBuffers();
+
+	/// <summary>Creates the buffers and binds them to their binding points. Needs a current openGL context</summary>
+	/// <returns>void</returns>
+	void init();
+	/// <summary>Uploads the FrameBlock. Call at the start of each pass</summary>
+	/// <param name="projection">a projection matrix</param>
+	/// <param name="view">a view matrix</param>
+	/// <param name="lightView">Light's Camera view Matrix. Only used in shadow map</param>
+	/// <param name="width">Width of the screen in pixels</param>
+	/// <param name="height">Height of the screen in pixels</param>
+	/// <returns>void</returns>
+	void setFrame(const Matrix44& projection, const Matrix44& view, const Matrix44& lightView, float width, float height);
+	/// <summary>Stages the ObjectBlock of a draw. It is uploaded by the next flushObjects</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="ambientMaterial">Material property for ambient light</param>
+	/// <param name="specularMaterial">Material property for specular light</param>
+	/// <param name="shininess">amount of shininess</param>
+	/// <returns>Index of the object to pass to bindObject after the flush</returns>
+	unsigned int addObject(const Matrix44& model, const Vector3& ambientMaterial = Vector3(), const Vector3& specularMaterial = Vector3(), float shininess = 0);
+	/// <summary>Uploads the objects staged since the last flush with one write into the ring buffer. The ring is orphaned when it is full, so the GPU can still read the old ranges</summary>
+	/// <returns>void</returns>
+	void flushObjects();
+	/// <summary>Binds the range of an object uploaded by the last flushObjects to the ObjectBlock</summary>
+	/// <param name="object">Index returned by addObject</param>
+	/// <returns>void</returns>
+	void bindObject(unsigned int object);
+	/// <summary>Stages, uploads and binds the ObjectBlock of a single draw</summary>
+	/// <param name="model">a model matrix</param>
+	/// <param name="ambientMaterial">Material property for ambient light</param>
+	/// <param name="specularMaterial">Material property for specular light</param>
+	/// <param name="shininess">amount of shininess</param>
+	/// <returns>void</returns>
+	void setObject(const Matrix44& model, const Vector3& ambientMaterial = Vector3(), const Vector3& specularMaterial = Vector3(), float shininess = 0);
+
+	/// <summary>Returns how many objects were uploaded since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getObjectCount() const;
+	/// <summary>Returns how many uploads into the ring buffer were made since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getFlushCount() const;
+	/// <summary>Sets the object and flush counters to 0</summary>
+	/// <returns>void</returns>
+	void resetCounters();
+
+private:
+	/// <remarks>
+	///FrameBlock in std140 layout. The matrices are row major like Matrix44, the block is declared row_major in the shader
+	/// </remarks>
+	struct FrameData
+	{
+		float view[16];
+		float projection[16];
+		float viewProjection[16];
+		float lightViewProjection[16];
+		float inverseProjection[16];
+		//xy is the size of the screen
+		float screenSize[4];
+	};
+
+	/// <remarks>
+	///ObjectBlock in std140 layout
+	/// </remarks>
+	struct ObjectData
+	{
+		float model[16];
+		float ambientMaterial[4];
+		//w is the shininess
+		float specularMaterial[4];
+	};
+
+	//Used to call native openGL functions
+	GLStateCache* m_glFunctions;
+
+	GLuint m_frameUBO;
+	GLuint m_objectUBO;
+	//Size of the ring buffer in bytes
+	unsigned int m_ringSize;
+	//Where the next flush writes in the ring buffer
+	unsigned int m_ringOffset;
+	//Where the last flush wrote in the ring buffer
+	unsigned int m_flushOffset;
+	//Bytes between two objects. sizeof(ObjectData) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	unsigned int m_objectStride;
+
+	//Objects added since the last flush, m_objectStride bytes each
+	std::vector<unsigned char> m_stagedObjects;
+	unsigned int m_stagedCount;
+
+	unsigned int m_objectCount;
+	unsigned int m_flushCount;
+};
+
+#endif // UniformBuffers_h__
@@ -1,12 +0,0 @@
-#include "Vertex.h"
-
-
-Vertex::Vertex()
-{
-	edge = 0;
-}
-
-
-Vertex::~Vertex()
-{
-}
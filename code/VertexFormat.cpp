@@ -0,0 +1,220 @@
+#include "VertexFormat.h"
+//memcpy
+#include <string.h>
+//floor
+#include <math.h>
+
+VertexFormat::VertexFormat(unsigned int flags)
+{
+	m_flags = flags;
+
+	//Position is always first
+	m_uvOffset = 3 * sizeof(float);
+	m_normalOffset = m_uvOffset + ((m_flags & HalfFloatUvs) ? 2 * sizeof(unsigned short) : 2 * sizeof(float));
+	m_stride = m_normalOffset + ((m_flags & PackedNormals) ? sizeof(unsigned int) : 3 * sizeof(float));
+}
+
+VertexFormat::~VertexFormat()
+{
+}
+
+unsigned int VertexFormat::flags() const
+{
+	return m_flags;
+}
+
+unsigned int VertexFormat::stride() const
+{
+	return m_stride;
+}
+
+void VertexFormat::pack(const std::vector<Vector3>& vertices, const std::vector<Vector2>& uvs, const std::vector<Vector3>& normals, std::vector<unsigned char>& out) const
+{
+	out.resize(vertices.size() * m_stride);
+
+	for (unsigned int i = 0; i < vertices.size(); i++){
+		unsigned char* vertex = &out[i * m_stride];
+
+		float position[3] = { vertices[i].GetElement(0), vertices[i].GetElement(1), vertices[i].GetElement(2) };
+		memcpy(vertex, position, sizeof(position));
+
+		if (m_flags & HalfFloatUvs){
+			unsigned short uv[2] = { floatToHalf(uvs[i].GetElement(0)), floatToHalf(uvs[i].GetElement(1)) };
+			memcpy(vertex + m_uvOffset, uv, sizeof(uv));
+		}
+		else{
+			float uv[2] = { uvs[i].GetElement(0), uvs[i].GetElement(1) };
+			memcpy(vertex + m_uvOffset, uv, sizeof(uv));
+		}
+
+		if (m_flags & PackedNormals){
+			unsigned int normal = packNormal(normals[i]);
+			memcpy(vertex + m_normalOffset, &normal, sizeof(normal));
+		}
+		else{
+			float normal[3] = { normals[i].GetElement(0), normals[i].GetElement(1), normals[i].GetElement(2) };
+			memcpy(vertex + m_normalOffset, normal, sizeof(normal));
+		}
+	}
+}
+
+void VertexFormat::unpack(const unsigned char* vertex, Vector3& position, Vector2& uv, Vector3& normal) const
+{
+	float values[3];
+	memcpy(values, vertex, sizeof(values));
+	position.Insert(values[0], values[1], values[2]);
+
+	if (m_flags & HalfFloatUvs){
+		unsigned short halfUv[2];
+		memcpy(halfUv, vertex + m_uvOffset, sizeof(halfUv));
+		uv.Insert(halfToFloat(halfUv[0]), halfToFloat(halfUv[1]));
+	}
+	else{
+		memcpy(values, vertex + m_uvOffset, 2 * sizeof(float));
+		uv.Insert(values[0], values[1]);
+	}
+
+	if (m_flags & PackedNormals){
+		unsigned int packed;
+		memcpy(&packed, vertex + m_normalOffset, sizeof(packed));
+		normal = unpackNormal(packed);
+	}
+	else{
+		memcpy(values, vertex + m_normalOffset, sizeof(values));
+		normal.Insert(values[0], values[1], values[2]);
+	}
+}
+
+void VertexFormat::setupAttributes(QOpenGLFunctions_3_3_Core* functions) const
+{
+	//Sets up which shader attribute will receive the data. How many elements will form a vertex, type etc
+	//The stride skips the other attributes of the vertex and the offset is where the attribute starts in a vertex
+	functions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, m_stride, (void*)0);
+
+	if (m_flags & HalfFloatUvs){
+		functions->glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, m_stride, (void*)(size_t)m_uvOffset);
+	}
+	else{
+		functions->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, m_stride, (void*)(size_t)m_uvOffset);
+	}
+
+	if (m_flags & PackedNormals){
+		//Normalized so the shader gets values between -1 and 1. The 2 bit w component is unused
+		functions->glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, m_stride, (void*)(size_t)m_normalOffset);
+	}
+	else{
+		functions->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, m_stride, (void*)(size_t)m_normalOffset);
+	}
+
+	//Enable the shader attributes to receive data
+	functions->glEnableVertexAttribArray(0);
+	functions->glEnableVertexAttribArray(1);
+	functions->glEnableVertexAttribArray(2);
+}
+
+unsigned short VertexFormat::floatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int floatExponent = (bits >> 23) & 0xFF;
+	unsigned int mantissa = bits & 0x7FFFFF;
+
+	//Infinity and NaN
+	if (floatExponent == 0xFF){
+		return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+	}
+
+	int exponent = (int)floatExponent - 127 + 15;
+	//Too big, becomes infinity
+	if (exponent >= 31){
+		return sign | 0x7C00;
+	}
+
+	//Too small for a normal half float. Shift the mantissa with the implicit 1 into a denormal
+	if (exponent <= 0){
+		if (exponent < -10){
+			return sign;
+		}
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int remainder = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))){
+			half++;
+		}
+		return sign | half;
+	}
+
+	//Round the 13 bits which don't fit. A carry into the exponent is still the right result
+	unsigned int half = (exponent << 10) | (mantissa >> 13);
+	unsigned int remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))){
+		half++;
+	}
+	return sign | half;
+}
+
+float VertexFormat::halfToFloat(unsigned short half)
+{
+	unsigned int sign = (half & 0x8000) << 16;
+	unsigned int exponent = (half >> 10) & 0x1F;
+	unsigned int mantissa = half & 0x3FF;
+
+	unsigned int bits;
+	if (exponent == 0x1F){
+		//Infinity and NaN
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0){
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa != 0){
+		//Denormal. Shift until the implicit 1 is found to make it a normal float
+		int floatExponent = 127 - 15 + 1;
+		while ((mantissa & 0x400) == 0){
+			mantissa <<= 1;
+			floatExponent--;
+		}
+		bits = sign | (floatExponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+	else{
+		bits = sign;
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+unsigned int VertexFormat::packNormal(Vector3 normal)
+{
+	float length = normal.Magnitude();
+	if (length > 0){
+		normal /= length;
+	}
+
+	//Signed 10 bit integers where 511 is 1.0
+	unsigned int packed = 0;
+	for (int i = 0; i < 3; i++){
+		float value = normal[i];
+		value = value < -1 ? -1 : (value > 1 ? 1 : value);
+		int quantized = (int)floor(value * 511.0f + 0.5f);
+		packed |= ((unsigned int)quantized & 0x3FF) << (10 * i);
+	}
+	return packed;
+}
+
+Vector3 VertexFormat::unpackNormal(unsigned int packed)
+{
+	Vector3 normal;
+	for (int i = 0; i < 3; i++){
+		//Sign extend the 10 bits
+		int quantized = (int)(packed << (22 - 10 * i)) >> 22;
+		float value = quantized / 511.0f;
+		normal[i] = value < -1 ? -1 : value;
+	}
+	return normal;
+}
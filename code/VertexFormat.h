@@ -0,0 +1,91 @@
+#ifndef VertexFormat_h__
+#define VertexFormat_h__
+
+//Math Library
+#include "mypersonalmathlib/mypersonalmathlib.h"
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <vector>
+
+/// <remarks>
+///Flags which decide how the attributes of a vertex are stored. Can be combined
+/// </remarks>
+enum VertexFormatFlags
+{
+	//Position, uv and normal as floats. 32 bytes per vertex
+	FullPrecisionVertex = 0,
+	//Uv as two half floats instead of two floats
+	HalfFloatUvs = 1,
+	//Normal normalized and packed into 10:10:10:2 bits instead of three floats
+	PackedNormals = 2,
+	//Both of the above. 20 bytes per vertex
+	CompactVertex = HalfFloatUvs | PackedNormals
+};
+
+/// <remarks>
+///Interleaved vertex layout. Position, uv and normal of a vertex are stored after each other so the whole vertex is fetched from one VBO.
+///The position is always three floats. The uv and normal can be stored with less precision to save memory and vertex bandwidth
+/// </remarks>
+class VertexFormat
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="flags">VertexFormatFlags combined with |</param>
+	/// <returns></returns>
+	VertexFormat(unsigned int flags = CompactVertex);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~VertexFormat();
+
+	/// <summary>Returns the flags of the format</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int flags() const;
+	/// <summary>Returns the size of a vertex in bytes</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int stride() const;
+
+	/// <summary>Interleaves the vertex data into the layout of the format</summary>
+	/// <param name="vertices">Positions</param>
+	/// <param name="uvs">Uvs. Same amount as the positions</param>
+	/// <param name="normals">Normals. Same amount as the positions</param>
+	/// <param name="out">Receives stride() bytes per vertex</param>
+	/// <returns>void</returns>
+	void pack(const std::vector<Vector3>& vertices, const std::vector<Vector2>& uvs, const std::vector<Vector3>& normals, std::vector<unsigned char>& out) const;
+	/// <summary>Reads back the data of one vertex stored in the layout of the format</summary>
+	/// <param name="vertex">Start of the vertex</param>
+	/// <param name="position">Receives the position</param>
+	/// <param name="uv">Receives the uv</param>
+	/// <param name="normal">Receives the normal</param>
+	/// <returns>void</returns>
+	void unpack(const unsigned char* vertex, Vector3& position, Vector2& uv, Vector3& normal) const;
+	/// <summary>Sets up the shader attributes for position (0), uv (1) and normal (2) for the VBO currently bound to GL_ARRAY_BUFFER and enables them</summary>
+	/// <param name="functions">Used to call openGL functions</param>
+	/// <returns>void</returns>
+	void setupAttributes(QOpenGLFunctions_3_3_Core* functions) const;
+
+	/// <summary>Converts a float to a half float. Rounds to nearest even</summary>
+	/// <param name="value">Float to convert</param>
+	/// <returns>unsigned short</returns>
+	static unsigned short floatToHalf(float value);
+	/// <summary>Converts a half float to a float</summary>
+	/// <param name="half">Half float to convert</param>
+	/// <returns>float</returns>
+	static float halfToFloat(unsigned short half);
+	/// <summary>Normalizes a normal and packs it into signed normalized 10:10:10:2 bits. Same layout as GL_INT_2_10_10_10_REV</summary>
+	/// <param name="normal">Normal to pack</param>
+	/// <returns>unsigned int</returns>
+	static unsigned int packNormal(Vector3 normal);
+	/// <summary>Unpacks a normal packed by packNormal</summary>
+	/// <param name="packed">Packed normal</param>
+	/// <returns>Vector3</returns>
+	static Vector3 unpackNormal(unsigned int packed);
+
+private:
+	unsigned int m_flags;
+	//Byte offsets of the attributes in a vertex and size of a vertex
+	unsigned int m_uvOffset;
+	unsigned int m_normalOffset;
+	unsigned int m_stride;
+};
+
+#endif // VertexFormat_h__
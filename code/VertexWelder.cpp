@@ -0,0 +1,109 @@
+#include "VertexWelder.h"
+//floor
+#include <math.h>
+//memcmp, memcpy
+#include <string.h>
+//INT_MIN, INT_MAX
+#include <limits.h>
+
+//Marks a slot which doesn't hold a key
+const unsigned int EmptySlot = 0xFFFFFFFF;
+
+VertexWelder::VertexWelder(unsigned int expectedVertexCount, float epsilon)
+{
+	m_inverseEpsilon = epsilon > 0 ? 1.0f / epsilon : 0;
+
+	//Keep the table at most half full so the probe sequences stay short
+	unsigned int slotCount = 16;
+	while (slotCount < expectedVertexCount * 2){
+		slotCount *= 2;
+	}
+	m_slots.assign(slotCount, EmptySlot);
+	m_mask = slotCount - 1;
+	m_keys.reserve(expectedVertexCount);
+}
+
+VertexWelder::~VertexWelder()
+{
+}
+
+bool VertexWelder::findOrAdd(const PackedVertex& packed, unsigned int& result)
+{
+	Key key;
+	makeKey(packed, key);
+
+	//Probe the slots after the hashed one until the key or an empty slot is found
+	unsigned int slot = hashKey(key) & m_mask;
+	while (m_slots[slot] != EmptySlot){
+		if (memcmp(&m_keys[m_slots[slot]], &key, sizeof(Key)) == 0){
+			result = m_slots[slot];
+			return true;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+
+	//Not found. Add the key to the empty slot
+	result = m_keys.size();
+	m_keys.push_back(key);
+	m_slots[slot] = result;
+
+	if (m_keys.size() * 2 > m_slots.size()){
+		grow();
+	}
+	return false;
+}
+
+unsigned int VertexWelder::vertexCount() const
+{
+	return m_keys.size();
+}
+
+void VertexWelder::makeKey(const PackedVertex& packed, Key& key) const
+{
+	//Position, uv and normal are 8 floats after each other, same as the memcmp in PackedVertex::operator<
+	memcpy(key.bits, &packed, sizeof(Key));
+
+	if (m_inverseEpsilon != 0){
+		//Round each value to the nearest cell of the grid. Cells too far out for an int are clamped to the outermost ones, since casting them is undefined
+		for (int i = 0; i < 8; i++){
+			float value;
+			memcpy(&value, &key.bits[i], sizeof(value));
+			double cell = floor((double)value * m_inverseEpsilon + 0.5);
+			cell = cell > INT_MAX ? INT_MAX : (cell >= INT_MIN ? cell : INT_MIN);
+			key.bits[i] = (unsigned int)(int)cell;
+		}
+	}
+}
+
+unsigned int VertexWelder::hashKey(const Key& key)
+{
+	//Mixes in one word at a time and finishes with the MurmurHash3 finalizer so every bit affects the slot
+	unsigned int hash = 0x9E3779B9;
+	for (int i = 0; i < 8; i++){
+		unsigned int word = key.bits[i] * 0xCC9E2D51;
+		word = (word << 15) | (word >> 17);
+		hash ^= word * 0x1B873593;
+		hash = ((hash << 13) | (hash >> 19)) * 5 + 0xE6546B64;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+void VertexWelder::grow()
+{
+	m_slots.assign(m_slots.size() * 2, EmptySlot);
+	m_mask = m_slots.size() - 1;
+
+	//The keys are unique so they only need an empty slot
+	for (unsigned int i = 0; i < m_keys.size(); i++){
+		unsigned int slot = hashKey(m_keys[i]) & m_mask;
+		while (m_slots[slot] != EmptySlot){
+			slot = (slot + 1) & m_mask;
+		}
+		m_slots[slot] = i;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef VertexWelder_h__
+#define VertexWelder_h__
+
+//Vertex data used as key
+#include "PackedVertex.h"
+
+#include <vector>
+
+/// <remarks>
+///Finds vertices with the same position, uv and normal. Used by indexVBO to generate lists of vertices with no duplicates.
+///Open addressing hash table with linear probing. The slots only hold indices and the keys are stored after each other in the order they were added.
+///With an epsilon the vertex data is quantized to a grid with that cell size before it's compared, so vertices which are almost the same are merged as well
+/// </remarks>
+class VertexWelder
+{
+public:
+	/// <summary>Constructor</summary>
+	/// <param name="expectedVertexCount">Amount of vertices which will be looked up. Used to size the table so it doesn't have to grow</param>
+	/// <param name="epsilon">Cell size used to quantize the vertex data. 0 only merges vertices which are exactly the same</param>
+	/// <returns></returns>
+	VertexWelder(unsigned int expectedVertexCount, float epsilon = 0);
+	/// <summary>Destructor</summary>
+	/// <returns></returns>
+	~VertexWelder();
+
+	/// <summary>Looks for a vertex which is the same as packed. If none is found packed is added and gets the next index</summary>
+	/// <param name="packed">Holds vertex data for one vertex</param>
+	/// <param name="result">Stores the index of the vertex found or the index of the added vertex</param>
+	/// <returns>True if the vertex was found. False if it was added</returns>
+	bool findOrAdd(const PackedVertex& packed, unsigned int& result);
+	/// <summary>Returns amount of unique vertices added</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int vertexCount() const;
+
+private:
+	/// <remarks>
+	///Bits of the vertex data compared by the welder. Holds the bits of the floats or the quantized values if an epsilon is used
+	/// </remarks>
+	struct Key
+	{
+		unsigned int bits[8];
+	};
+
+	/// <summary>Creates the key of a vertex</summary>
+	/// <param name="packed">Holds vertex data for one vertex</param>
+	/// <param name="key">Receives the key</param>
+	/// <returns>void</returns>
+	void makeKey(const PackedVertex& packed, Key& key) const;
+	/// <summary>Hashes all bits of a key</summary>
+	/// <param name="key">Key to hash</param>
+	/// <returns>unsigned int</returns>
+	static unsigned int hashKey(const Key& key);
+	/// <summary>Doubles the amount of slots and inserts the keys again</summary>
+	/// <returns>void</returns>
+	void grow();
+
+	//Keys of the unique vertices. The position in the list is the index of the vertex
+	std::vector<Key> m_keys;
+	//Index of the key stored in each slot. Amount of slots is a power of 2
+	std::vector<unsigned int> m_slots;
+	//Amount of slots - 1. Used instead of modulo to wrap the hash
+	unsigned int m_mask;
+	//1 / epsilon. 0 if the vertex data is compared exactly
+	float m_inverseEpsilon;
+};
+
+#endif // VertexWelder_h__
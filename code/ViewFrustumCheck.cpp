@@ -1,9 +1,18 @@
 #include "ViewFrustumCheck.h"
 
+//min and max
+#include <algorithm>
+//floor
+#include <math.h>
+
 
 ViewFrustumCheck::ViewFrustumCheck()
 {
 	shapesRendered = 0;
+	m_activePlanes = AllFrustumPlanes;
+	m_isSubtreeCulling = true;
+	m_cachedPlane = 0;
+	resetCounters();
 }
 
 
@@ -16,6 +25,9 @@ void ViewFrustumCheck::extractFrustum(Matrix44 view, Matrix44 projection)
 	float   viewProjectionGL[16];
 	float   magnitude;
 
+	//New planes, everything has to be tested again
+	m_activePlanes = AllFrustumPlanes;
+
 	Matrix44 viewProjection = projection*view;
 	viewProjection.ConvertToOpenGLArray(viewProjectionGL);
 
@@ -96,32 +108,185 @@ void ViewFrustumCheck::extractFrustum(Matrix44 view, Matrix44 projection)
 	m_frustum[5][1] /= magnitude;
 	m_frustum[5][2] /= magnitude;
 	m_frustum[5][3] /= magnitude;
+
+	FrustumKernels::SwizzlePlanes(m_frustum, m_swizzledPlanes);
 }
 
 bool ViewFrustumCheck::bSphereInFrustum(Vector3 centerPosition, float radius)
 {
-	int insidePlaneCounter = 0;
-	float distance;
+	unsigned int planeMask = m_activePlanes;
+	//Returns true if the bounding sphere is partially or completely inside the planes
+	return sphereInFrustum(centerPosition, radius, planeMask, m_cachedPlane) != OutsideFrustum;
+}
 
-	for (int i = 0; i < 6; i++)
+FrustumIntersection ViewFrustumCheck::sphereInFrustum(Vector3 centerPosition, float radius, unsigned int& planeMask)
+{
+	for (unsigned int i = 0; i < 6; i++)
 	{
-		//Plane equation
-		distance = m_frustum[i][0] * centerPosition[0] + m_frustum[i][1] * centerPosition[1] + m_frustum[i][2] * centerPosition[2] + m_frustum[i][3];
+		//Skip planes a parent is already completely inside of
+		if ((planeMask & (1 << i)) && isOutsidePlane(i, centerPosition, radius, planeMask)){
+			return OutsideFrustum;
+		}
+	}
+
+	if (planeMask == 0){
+		//Is completely inside all planes
+		return InsideFrustum;
+	}
+	return IntersectsFrustum;
+}
 
-		//Distance returns a negative value if the point tested is on the left of the plane
-		//Returns false if the distance is greater than the radius. Which means that the bounding sphere is fully outside
-		if (distance <= -radius){
-			return false;
+FrustumIntersection ViewFrustumCheck::sphereInFrustum(Vector3 centerPosition, float radius, unsigned int& planeMask, unsigned int& cachedPlane)
+{
+	unsigned int remainingPlanes = planeMask;
+
+	//The plane which rejected the object last time is the most likely to reject it again
+	if (remainingPlanes & (1 << cachedPlane)){
+		remainingPlanes &= ~(1 << cachedPlane);
+		if (isOutsidePlane(cachedPlane, centerPosition, radius, planeMask)){
+			m_cacheHits++;
+			return OutsideFrustum;
 		}
-		//Keep track of how many planes the bounding sphere is completely inside
-		if (distance > radius){
-			insidePlaneCounter++;
+	}
+
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		if ((remainingPlanes & (1 << i)) && isOutsidePlane(i, centerPosition, radius, planeMask)){
+			m_cacheMisses++;
+			cachedPlane = i;
+			return OutsideFrustum;
 		}
 	}
 
-	if (insidePlaneCounter == 6){
-		//Is completetly inside all planes
+	if (planeMask == 0){
+		//Is completely inside all planes
+		return InsideFrustum;
 	}
-	//Returns true if the bounding sphere is partially or completely inside the planes
+	return IntersectsFrustum;
+}
+
+bool ViewFrustumCheck::isOutsideCachedPlane(Vector3 centerPosition, float radius, unsigned int cachedPlane)
+{
+	unsigned int planeMask = m_activePlanes;
+	if ((planeMask & (1 << cachedPlane)) && isOutsidePlane(cachedPlane, centerPosition, radius, planeMask)){
+		m_cacheHits++;
+		return true;
+	}
+	return false;
+}
+
+bool ViewFrustumCheck::isOutsidePlane(unsigned int plane, Vector3& centerPosition, float radius, unsigned int& planeMask)
+{
+	m_planeTests++;
+
+	//Plane equation
+	float distance = m_frustum[plane][0] * centerPosition[0] + m_frustum[plane][1] * centerPosition[1] + m_frustum[plane][2] * centerPosition[2] + m_frustum[plane][3];
+
+	//Distance returns a negative value if the point tested is on the left of the plane
+	//Returns outside if the distance is greater than the radius. Which means that the bounding sphere is fully outside
+	if (distance <= -radius){
+		return true;
+	}
+	//Keep track of which planes the bounding sphere is completely inside
+	if (distance > radius){
+		planeMask &= ~(1 << plane);
+	}
+	return false;
+}
+
+void ViewFrustumCheck::spheresInFrustum(const float* x, const float* y, const float* z, const float* radius, unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	FrustumKernels::TestSpheres(m_swizzledPlanes, m_activePlanes, x, y, z, radius, count, visible, planeMasks);
+}
+
+void ViewFrustumCheck::boxesInFrustum(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ,
+	unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	FrustumKernels::TestBoxes(m_swizzledPlanes, m_activePlanes, minX, minY, minZ, maxX, maxY, maxZ, count, visible, planeMasks);
+}
+
+bool ViewFrustumCheck::sphereScreenRect(Vector3 center, float radius, Matrix44 projection, float nearPlane, int width, int height, int rect[4])
+{
+	rect[0] = 0;
+	rect[1] = 0;
+	rect[2] = width - 1;
+	rect[3] = height - 1;
+	if (center[2] + radius >= -nearPlane){
+		return false;
+	}
+
+	//Project the corners of the box around the sphere. All of them are in front of the near plane, so w is positive
+	float minX = 1, minY = 1, maxX = -1, maxY = -1;
+	for (int corner = 0; corner < 8; corner++){
+		Vector4 cornerPosition(
+			center[0] + ((corner & 1) ? radius : -radius),
+			center[1] + ((corner & 2) ? radius : -radius),
+			center[2] + ((corner & 4) ? radius : -radius), 1);
+		Vector4 clip = projection * cornerPosition;
+		float x = clip[0] / clip[3];
+		float y = clip[1] / clip[3];
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+	}
+
+	//Normalized device coordinates to pixels. The origin is in the lower left corner like gl_FragCoord and glScissor
+	rect[0] = std::max(0, (int)floor((minX * 0.5f + 0.5f) * width));
+	rect[1] = std::max(0, (int)floor((minY * 0.5f + 0.5f) * height));
+	rect[2] = std::min(width - 1, (int)floor((maxX * 0.5f + 0.5f) * width));
+	rect[3] = std::min(height - 1, (int)floor((maxY * 0.5f + 0.5f) * height));
 	return true;
-}
\ No newline at end of file
+}
+
+unsigned int ViewFrustumCheck::getActivePlanes() const
+{
+	return m_activePlanes;
+}
+
+void ViewFrustumCheck::setActivePlanes(unsigned int planeMask)
+{
+	m_activePlanes = planeMask;
+}
+
+unsigned int ViewFrustumCheck::getCachedPlane() const
+{
+	return m_cachedPlane;
+}
+
+void ViewFrustumCheck::setCachedPlane(unsigned int plane)
+{
+	m_cachedPlane = plane;
+}
+
+unsigned int ViewFrustumCheck::getCacheHits() const
+{
+	return m_cacheHits;
+}
+
+unsigned int ViewFrustumCheck::getCacheMisses() const
+{
+	return m_cacheMisses;
+}
+
+unsigned int ViewFrustumCheck::getPlaneTests() const
+{
+	return m_planeTests;
+}
+
+void ViewFrustumCheck::resetCounters()
+{
+	m_cacheHits = 0;
+	m_cacheMisses = 0;
+	m_planeTests = 0;
+}
+
+void ViewFrustumCheck::setSubtreeCulling(bool flag)
+{
+	m_isSubtreeCulling = flag;
+}
+
+bool ViewFrustumCheck::isSubtreeCulling() const
+{
+	return m_isSubtreeCulling;
+}
@@ -2,7 +2,20 @@
 #define ViewFrustumCheck_h__
 
 #include "mypersonalmathlib/mypersonalmathlib.h"
+#include "mypersonalmathlib/frustumkernels.h"
 
+//Bit for each of the 6 frustum planes. Planes with their bit cleared are skipped by the sphere tests
+const unsigned int AllFrustumPlanes = 0x3F;
+
+/// <remarks>
+///Result of testing a bounding sphere against the view frustum
+/// </remarks>
+enum FrustumIntersection
+{
+	OutsideFrustum,
+	IntersectsFrustum,
+	InsideFrustum
+};
 
 /// <remarks>
 ///Holds the planes of the view frustum. Has function to extract the planes and sphere to plane intersection function
@@ -27,13 +40,122 @@ public:
 	/// <param name="radius">radius of the bounding sphere</param>
 	/// <returns>bool</returns>
 	bool bSphereInFrustum(Vector3 centerPosition, float radius);
+	/// <summary>Tests a bounding sphere against the planes in planeMask. Clears the bits of the planes the sphere is completely inside of,
+	///so the spheres inside it don't have to test those planes again</summary>
+	/// <param name="centerPosition">Center position of the bounding sphere in world space</param>
+	/// <param name="radius">radius of the bounding sphere</param>
+	/// <param name="planeMask">Planes to test. Receives the planes the sphere intersects</param>
+	/// <returns>Outside, intersecting or inside the view frustum</returns>
+	FrustumIntersection sphereInFrustum(Vector3 centerPosition, float radius, unsigned int& planeMask);
+	/// <summary>Same as sphereInFrustum but tests cachedPlane first. Objects usually fail the same plane as in the last frame,
+	///so most rejected objects only test one plane</summary>
+	/// <param name="centerPosition">Center position of the bounding sphere in world space</param>
+	/// <param name="radius">radius of the bounding sphere</param>
+	/// <param name="planeMask">Planes to test. Receives the planes the sphere intersects</param>
+	/// <param name="cachedPlane">The plane which rejected the object last time. Receives the plane which rejected it this time</param>
+	/// <returns>Outside, intersecting or inside the view frustum</returns>
+	FrustumIntersection sphereInFrustum(Vector3 centerPosition, float radius, unsigned int& planeMask, unsigned int& cachedPlane);
+	/// <summary>Tests a bounding sphere against only its cached plane, if that plane is active. Lets a batch of spheres drop the ones
+	///rejected by the same plane as last time before the batch test</summary>
+	/// <param name="centerPosition">Center position of the bounding sphere in world space</param>
+	/// <param name="radius">radius of the bounding sphere</param>
+	/// <param name="cachedPlane">The plane which rejected the object last time</param>
+	/// <returns>True if the sphere is outside the cached plane</returns>
+	bool isOutsideCachedPlane(Vector3 centerPosition, float radius, unsigned int cachedPlane);
+	/// <summary>Tests many bounding spheres at once against the active planes. The spheres are given as one array per coordinate.
+	///Uses SIMD to test several spheres per instruction and gives the same result as sphereInFrustum</summary>
+	/// <param name="x">x of the centers in world space</param>
+	/// <param name="y">y of the centers in world space</param>
+	/// <param name="z">z of the centers in world space</param>
+	/// <param name="radius">radius of each sphere</param>
+	/// <param name="count">Amount of spheres</param>
+	/// <param name="visible">Bit i (visible[i / 32], bit i % 32) is set if sphere i is partially or completely inside. Needs (count + 31) / 32 words</param>
+	/// <param name="planeMasks">Can be NULL. Receives the planes each sphere intersects, 0 for spheres outside</param>
+	/// <returns>void</returns>
+	void spheresInFrustum(const float* x, const float* y, const float* z, const float* radius, unsigned int count, unsigned int* visible, unsigned char* planeMasks = NULL);
+	/// <summary>Tests many axis aligned bounding boxes at once against the active planes. Same output as spheresInFrustum</summary>
+	/// <param name="minX">Smallest x of each box in world space</param>
+	/// <param name="minY">Smallest y of each box in world space</param>
+	/// <param name="minZ">Smallest z of each box in world space</param>
+	/// <param name="maxX">Largest x of each box in world space</param>
+	/// <param name="maxY">Largest y of each box in world space</param>
+	/// <param name="maxZ">Largest z of each box in world space</param>
+	/// <param name="count">Amount of boxes</param>
+	/// <param name="visible">Bit i is set if box i is partially or completely inside. Needs (count + 31) / 32 words</param>
+	/// <param name="planeMasks">Can be NULL. Receives the planes each box intersects, 0 for boxes outside</param>
+	/// <returns>void</returns>
+	void boxesInFrustum(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ,
+		unsigned int count, unsigned int* visible, unsigned char* planeMasks = NULL);
+	/// <summary>Computes the pixels a sphere covers on the screen from the projected corners of the box around it</summary>
+	/// <param name="center">Center of the sphere in camera space</param>
+	/// <param name="radius">radius of the sphere</param>
+	/// <param name="projection">a projection matrix</param>
+	/// <param name="nearPlane">Distance to the near plane of the projection</param>
+	/// <param name="width">Width of the screen in pixels</param>
+	/// <param name="height">Height of the screen in pixels</param>
+	/// <param name="rect">Receives the first and last pixel in x and y, clamped to the screen. The first is greater than the last if the sphere is outside the screen</param>
+	/// <returns>False if the sphere crosses the near plane. It can then cover any part of the screen and rect is the whole screen</returns>
+	static bool sphereScreenRect(Vector3 center, float radius, Matrix44 projection, float nearPlane, int width, int height, int rect[4]);
+
+	/// <summary>Returns the planes bSphereInFrustum tests. A transform which is completely inside some planes clears them while its children are drawn</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getActivePlanes() const;
+	/// <summary>Sets the planes bSphereInFrustum tests</summary>
+	/// <param name="planeMask">Bit for each plane to test</param>
+	/// <returns>void</returns>
+	void setActivePlanes(unsigned int planeMask);
+	/// <summary>Returns the cached plane bSphereInFrustum tests first. Each transform sets it to the plane which rejected the child it draws last time</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getCachedPlane() const;
+	/// <summary>Sets the plane bSphereInFrustum tests first. Receives the plane which rejected the next sphere</summary>
+	/// <param name="plane">Index of the plane</param>
+	/// <returns>void</returns>
+	void setCachedPlane(unsigned int plane);
+	/// <summary>Returns how many rejected spheres were rejected by their cached plane since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getCacheHits() const;
+	/// <summary>Returns how many rejected spheres were rejected by another plane than their cached plane since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getCacheMisses() const;
+	/// <summary>Returns how many sphere to plane tests were done since the last resetCounters</summary>
+	/// <returns>unsigned int</returns>
+	unsigned int getPlaneTests() const;
+	/// <summary>Sets the cache hit, miss and plane test counters to 0</summary>
+	/// <returns>void</returns>
+	void resetCounters();
+	/// <summary>Sets a flag if transforms should cull their whole subtree with the merged bounding sphere</summary>
+	/// <param name="flag">On or Off</param>
+	/// <returns>void</returns>
+	void setSubtreeCulling(bool flag);
+	/// <summary>Returns true if transforms should cull their whole subtree with the merged bounding sphere</summary>
+	/// <returns>bool</returns>
+	bool isSubtreeCulling() const;
 
 	//Counter for amount of objects that are actually rendered
 	unsigned int shapesRendered;
 
 private:
+	/// <summary>Tests a bounding sphere against one plane. Clears the plane's bit in planeMask if the sphere is completely inside it</summary>
+	/// <param name="plane">Index of the plane</param>
+	/// <param name="centerPosition">Center position of the bounding sphere in world space</param>
+	/// <param name="radius">radius of the bounding sphere</param>
+	/// <param name="planeMask">Planes the sphere intersects</param>
+	/// <returns>True if the sphere is completely outside the plane</returns>
+	bool isOutsidePlane(unsigned int plane, Vector3& centerPosition, float radius, unsigned int& planeMask);
+
 	//Stores the frustum planes
 	float m_frustum[6][4];
+	//The planes with each value repeated for the batch tests. Swizzled once each time the planes are extracted
+	FrustumKernels::SwizzledPlanes m_swizzledPlanes;
+	//Planes tested by bSphereInFrustum
+	unsigned int m_activePlanes;
+	//Plane tested first by bSphereInFrustum
+	unsigned int m_cachedPlane;
+	//Counters to measure how many plane tests the cached planes save
+	unsigned int m_cacheHits;
+	unsigned int m_cacheMisses;
+	unsigned int m_planeTests;
+	bool m_isSubtreeCulling;
 };
 
 #endif // ViewFrustumCheck_h__
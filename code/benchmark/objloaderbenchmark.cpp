@@ -0,0 +1,174 @@
+//Compares loading the bundled obj files with the fscanf parser Mesh::loadOBJ used before ObjLoader, and checks both give the same triangle corners
+//Build with -DOBJLOADER_BENCHMARK=ON and run objloaderbenchmark [models folder], from the build folder the models are found without the argument
+
+#include "ObjLoader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//Loads of each model, the fastest is printed
+const int Runs = 5;
+
+//Models shipped in build/models
+const char* Models[] = { "apple.obj", "cube.obj", "icosphere.obj", "pointLightSphere.obj", "pyramid.obj", "room.obj", "spaceship.obj", "sphere.obj" };
+
+//Triangle corners of a loaded model
+struct Corners
+{
+	std::vector<Vector3> vertices;
+	std::vector<Vector2> uvs;
+	std::vector<Vector3> normals;
+};
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//The parser of Mesh::loadOBJ before ObjLoader, without the indexing and the upload. Only handles v/vt/vn triangles
+static bool loadWithFscanf(const char* path, Corners& corners)
+{
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+	std::vector<Vector3> temp_vertices;
+	std::vector<Vector2> temp_uvs;
+	std::vector<Vector3> temp_normals;
+
+	FILE* file = fopen(path, "r");
+	if (file == NULL){
+		return false;
+	}
+
+	while (true){
+		char lineHeader[128];
+		int res = fscanf(file, "%s", lineHeader);
+		if (res == EOF){
+			break;
+		}
+
+		if (strcmp(lineHeader, "v") == 0){
+			Vector3 vertex;
+			fscanf(file, "%f %f %f\n", &vertex[0], &vertex[1], &vertex[2]);
+			temp_vertices.push_back(vertex);
+		}
+		else if (strcmp(lineHeader, "vt") == 0){
+			Vector2 uv;
+			fscanf(file, "%f %f\n", &uv[0], &uv[1]);
+			temp_uvs.push_back(uv);
+		}
+		else if (strcmp(lineHeader, "vn") == 0){
+			Vector3 normal;
+			fscanf(file, "%f %f %f\n", &normal[0], &normal[1], &normal[2]);
+			temp_normals.push_back(normal);
+		}
+		else if (strcmp(lineHeader, "f") == 0){
+			unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
+			int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+			if (matches != 9){
+				fclose(file);
+				return false;
+			}
+			for (int i = 0; i < 3; i++){
+				vertexIndices.push_back(vertexIndex[i]);
+				uvIndices.push_back(uvIndex[i]);
+				normalIndices.push_back(normalIndex[i]);
+			}
+		}
+		else{
+			char stupidBuffer[1000];
+			fgets(stupidBuffer, 1000, file);
+		}
+	}
+	fclose(file);
+
+	for (unsigned int i = 0; i < vertexIndices.size(); i++){
+		corners.vertices.push_back(temp_vertices[vertexIndices[i] - 1]);
+		corners.uvs.push_back(temp_uvs[uvIndices[i] - 1]);
+		corners.normals.push_back(temp_normals[normalIndices[i] - 1]);
+	}
+	return true;
+}
+
+static bool loadWithObjLoader(const char* path, Corners& corners)
+{
+	ObjLoader loader;
+	if (!loader.load(path)){
+		return false;
+	}
+	loader.getTriangleCorners(corners.vertices, corners.uvs, corners.normals);
+	return true;
+}
+
+static bool isEqual(Vector3 a, Vector3 b)
+{
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+static bool isEqual(Vector2 a, Vector2 b)
+{
+	return a[0] == b[0] && a[1] == b[1];
+}
+
+static bool isEqual(const Corners& a, const Corners& b)
+{
+	if (a.vertices.size() != b.vertices.size()){
+		return false;
+	}
+	for (unsigned int i = 0; i < a.vertices.size(); i++){
+		if (!isEqual(a.vertices[i], b.vertices[i]) || !isEqual(a.uvs[i], b.uvs[i]) || !isEqual(a.normals[i], b.normals[i])){
+			return false;
+		}
+	}
+	return true;
+}
+
+//Fastest of the runs in ms, -1 if the file can't be loaded
+static double bestTime(bool (*load)(const char*, Corners&), const char* path, Corners& corners)
+{
+	double best = -1;
+	for (int run = 0; run < Runs; run++){
+		corners = Corners();
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (!load(path, corners)){
+			return -1;
+		}
+		double time = elapsedMs(start);
+		if (best < 0 || time < best){
+			best = time;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string folder = argc > 1 ? argv[1] : "models";
+
+	printf("%-22s %10s %10s %8s  %s\n", "model", "fscanf ms", "loader ms", "speedup", "corners");
+	bool isAllEqual = true;
+	for (unsigned int i = 0; i < sizeof(Models) / sizeof(Models[0]); i++){
+		std::string path = folder + "/" + Models[i];
+		Corners oldCorners, newCorners;
+		double oldTime = bestTime(loadWithFscanf, path.c_str(), oldCorners);
+		double newTime = bestTime(loadWithObjLoader, path.c_str(), newCorners);
+
+		if (newTime < 0){
+			printf("%-22s can't be loaded\n", Models[i]);
+			isAllEqual = false;
+			continue;
+		}
+		if (oldTime < 0){
+			//Faces the old parser couldn't read, only the new loader is timed
+			printf("%-22s %10s %10.3f %8s  %u\n", Models[i], "-", newTime, "-", (unsigned int)newCorners.vertices.size());
+			continue;
+		}
+
+		bool isSame = isEqual(oldCorners, newCorners);
+		isAllEqual &= isSame;
+		printf("%-22s %10.3f %10.3f %7.1fx  %u %s\n", Models[i], oldTime, newTime, oldTime / newTime,
+			(unsigned int)newCorners.vertices.size(), isSame ? "identical" : "DIFFERENT");
+	}
+	return isAllEqual ? 0 : 1;
+}
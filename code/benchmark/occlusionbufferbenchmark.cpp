@@ -0,0 +1,210 @@
+//Checks the OcclusionBuffer rasterizer against a brute force reference and times rasterizing 20k occluder triangles
+//Build with -DOCCLUSIONBUFFER_BENCHMARK=ON and run occlusionbufferbenchmark, it exits with 1 if a pixel is nearer than the reference
+
+#include "OcclusionBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+//Size of the buffer the app uses
+const unsigned int BufferWidth = 256;
+const unsigned int BufferHeight = 128;
+
+//Triangles of the reference check and of the timing
+const int CheckTriangles = 2000;
+const int TimedTriangles = 20000;
+//Frames timed, the fastest is printed
+const int Frames = 50;
+
+//Float rounding of the depth planes
+const double DepthTolerance = 1e-4;
+
+//Small LCG so every run uses the same triangles
+static float randomFloat(unsigned int& state, float min, float max)
+{
+	state = state * 1664525u + 1013904223u;
+	return min + (max - min) * ((state >> 8) / 16777216.0f);
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//Random triangles in front of a camera looking down -z. Every 50th one is big and crosses the near plane so the clipping is tested too
+static void createTriangles(int count, std::vector<Vector3>& vertices, std::vector<unsigned int>& indices)
+{
+	unsigned int state = 4711;
+	for (int i = 0; i < count; i++){
+		bool isCrossingNear = i % 50 == 0;
+		float size = isCrossingNear ? 4.0f : 1.5f;
+		Vector3 center(randomFloat(state, -20, 20), randomFloat(state, -10, 10), isCrossingNear ? -0.5f : randomFloat(state, -60, -2));
+		for (int j = 0; j < 3; j++){
+			indices.push_back(vertices.size());
+			vertices.push_back(Vector3(center[0] + randomFloat(state, -size, size), center[1] + randomFloat(state, -size, size), center[2] + randomFloat(state, -size, size)));
+		}
+	}
+}
+
+static Matrix44 createViewProjection()
+{
+	Matrix44 projection;
+	projection.Perspective(60, (float)BufferWidth / BufferHeight, 0.1f, 100);
+	Matrix44 view;
+	view.LookAt(Vector3(0, 0, 0), Vector3(0, 0, -1), Vector3(0, 1, 0));
+	return projection * view;
+}
+
+//Depth a conservative buffer may hold at each pixel: the nearest of the triangles covering the whole pixel, each with its farthest depth in the pixel.
+//Solves where the rays through the pixel corners hit each triangle in clip space, so it needs no clipping or edge functions and shares no code with the rasterizer
+static void rasterizeReference(const Matrix44& viewProjection, const std::vector<Vector3>& vertices, const std::vector<unsigned int>& indices, std::vector<double>& depth)
+{
+	//Depth where the ray through each pixel corner hits the current triangle, above 1 if it misses
+	const unsigned int cornersX = BufferWidth + 1;
+	const unsigned int cornersY = BufferHeight + 1;
+	std::vector<double> cornerDepth(cornersX * cornersY);
+
+	std::vector<Vector4> clip(vertices.size());
+	for (unsigned int i = 0; i < vertices.size(); i++){
+		Vector3 vertex = vertices[i];
+		clip[i] = viewProjection * Vector4(vertex[0], vertex[1], vertex[2], 1);
+	}
+
+	depth.assign(BufferWidth * BufferHeight, 1.0);
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3){
+		Vector4 a = clip[indices[i]];
+		Vector4 b = clip[indices[i + 1]];
+		Vector4 c = clip[indices[i + 2]];
+		double corner[4], edge1[4], edge2[4];
+		for (int j = 0; j < 4; j++){
+			corner[j] = a[j];
+			edge1[j] = (double)b[j] - a[j];
+			edge2[j] = (double)c[j] - a[j];
+		}
+
+		for (unsigned int y = 0; y < cornersY; y++){
+			double ndcY = (double)y / BufferHeight * 2 - 1;
+			for (unsigned int x = 0; x < cornersX; x++){
+				double ndcX = (double)x / BufferWidth * 2 - 1;
+				double& current = cornerDepth[y * cornersX + x];
+				current = 2;
+
+				//A point of the triangle is on the ray if x - ndcX * w = 0 and y - ndcY * w = 0
+				double f0 = corner[0] - ndcX * corner[3];
+				double f1 = edge1[0] - ndcX * edge1[3];
+				double f2 = edge2[0] - ndcX * edge2[3];
+				double g0 = corner[1] - ndcY * corner[3];
+				double g1 = edge1[1] - ndcY * edge1[3];
+				double g2 = edge2[1] - ndcY * edge2[3];
+				double determinant = f1 * g2 - f2 * g1;
+				if (determinant == 0){
+					continue;
+				}
+				double u = (-f0 * g2 + g0 * f2) / determinant;
+				double v = (-f1 * g0 + g1 * f0) / determinant;
+				if (u < 0 || v < 0 || u + v > 1){
+					continue;
+				}
+
+				//Behind the camera or the near plane
+				double z = corner[2] + u * edge1[2] + v * edge2[2];
+				double w = corner[3] + u * edge1[3] + v * edge2[3];
+				if (w <= 0 || z < -w){
+					continue;
+				}
+				current = z / w * 0.5 + 0.5;
+			}
+		}
+
+		//Only pixels whose 4 corners hit the triangle are covered by it
+		for (unsigned int y = 0; y < BufferHeight; y++){
+			for (unsigned int x = 0; x < BufferWidth; x++){
+				const double* corners = &cornerDepth[y * cornersX + x];
+				double farthest = corners[0];
+				farthest = corners[1] > farthest ? corners[1] : farthest;
+				farthest = corners[cornersX] > farthest ? corners[cornersX] : farthest;
+				farthest = corners[cornersX + 1] > farthest ? corners[cornersX + 1] : farthest;
+				double& current = depth[y * BufferWidth + x];
+				current = farthest < current ? farthest : current;
+			}
+		}
+	}
+}
+
+static bool checkAgainstReference()
+{
+	std::vector<Vector3> vertices;
+	std::vector<unsigned int> indices;
+	createTriangles(CheckTriangles, vertices, indices);
+	Matrix44 viewProjection = createViewProjection();
+
+	OcclusionBuffer buffer(BufferWidth, BufferHeight);
+	buffer.begin(viewProjection);
+	buffer.addOccluder(Matrix44(), &vertices[0], vertices.size(), &indices[0], indices.size());
+	buffer.rasterize();
+
+	std::vector<double> reference;
+	rasterizeReference(viewProjection, vertices, indices, reference);
+
+	//A nearer pixel culls objects which are visible. A farther one only lets hidden objects through, like pixels covered by two triangles of a clipped polygon but by neither alone
+	unsigned int fartherCount = 0;
+	unsigned int nearerCount = 0;
+	unsigned int coveredCount = 0;
+	for (unsigned int y = 0; y < BufferHeight; y++){
+		for (unsigned int x = 0; x < BufferWidth; x++){
+			double expected = reference[y * BufferWidth + x];
+			double actual = buffer.getDepth(x, y);
+			coveredCount += expected < 1 ? 1 : 0;
+			if (actual > expected + DepthTolerance){
+				if (fartherCount++ < 5){
+					printf("pixel %u %u: depth %f, reference %f\n", x, y, actual, expected);
+				}
+			}
+			else if (actual < expected - DepthTolerance){
+				if (nearerCount++ < 5){
+					printf("pixel %u %u: depth %f, reference %f\n", x, y, actual, expected);
+				}
+			}
+		}
+	}
+
+	printf("%d triangles, %u kept after clipping and culling, %u of %u pixels covered\n", CheckTriangles, buffer.getTriangleCount(), coveredCount, BufferWidth * BufferHeight);
+	printf("pixels farther than the reference: %u, nearer: %u  %s\n", fartherCount, nearerCount, nearerCount == 0 ? "ok" : "FAILED");
+	return nearerCount == 0;
+}
+
+static void timeRasterization()
+{
+	std::vector<Vector3> vertices;
+	std::vector<unsigned int> indices;
+	createTriangles(TimedTriangles, vertices, indices);
+	Matrix44 viewProjection = createViewProjection();
+	OcclusionBuffer buffer(BufferWidth, BufferHeight);
+
+	double bestSetup = -1;
+	double bestRasterize = -1;
+	for (int frame = 0; frame < Frames; frame++){
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		buffer.begin(viewProjection);
+		buffer.addOccluder(Matrix44(), &vertices[0], vertices.size(), &indices[0], indices.size());
+		double setup = elapsedMs(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		buffer.rasterize();
+		double rasterize = elapsedMs(start);
+
+		bestSetup = bestSetup < 0 || setup < bestSetup ? setup : bestSetup;
+		bestRasterize = bestRasterize < 0 || rasterize < bestRasterize ? rasterize : bestRasterize;
+	}
+
+	printf("%d triangles into %ux%u: setup %.3f ms, rasterize %.3f ms, total %.3f ms (fastest of %d frames)\n", TimedTriangles, BufferWidth, BufferHeight,
+		bestSetup, bestRasterize, bestSetup + bestRasterize, Frames);
+}
+
+int main()
+{
+	bool isPassed = checkAgainstReference();
+	timeRasterization();
+	return isPassed ? 0 : 1;
+}
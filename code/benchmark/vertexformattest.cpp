@@ -0,0 +1,169 @@
+//Packs vertices with every VertexFormat and checks unpack gives them back: positions exactly, half float uvs within 2^-11 and 2_10_10_10 normals within 0.5/511
+//Build with -DVERTEXFORMAT_TEST=ON and run vertexformattest, it exits with 1 if any vertex is outside the tolerance
+
+#include "VertexFormat.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+//Random vertices on top of the edge cases
+const int RandomVertices = 100000;
+
+//Half a step of the 10 bit mantissa of a half float for values below 1, scaled with the value above it
+const float UvTolerance = 1.0f / 2048.0f;
+
+//Half a step of a signed 10 bit normal component
+const float NormalTolerance = 0.5f / 511.0f;
+
+const unsigned int Formats[] = { FullPrecisionVertex, HalfFloatUvs, PackedNormals, CompactVertex };
+const char* FormatNames[] = { "FullPrecisionVertex", "HalfFloatUvs", "PackedNormals", "CompactVertex" };
+
+//Small LCG so every run tests the same vertices
+static float randomFloat(unsigned int& state, float min, float max)
+{
+	state = state * 1664525u + 1013904223u;
+	return min + (max - min) * ((state >> 8) / 16777216.0f);
+}
+
+static void addVertex(std::vector<Vector3>& vertices, std::vector<Vector2>& uvs, std::vector<Vector3>& normals, Vector3 vertex, Vector2 uv, Vector3 normal)
+{
+	vertices.push_back(vertex);
+	uvs.push_back(uv);
+	normals.push_back(normal);
+}
+
+static void createVertices(std::vector<Vector3>& vertices, std::vector<Vector2>& uvs, std::vector<Vector3>& normals)
+{
+	//Axis normals, uvs on the texture borders and a tiled uv
+	addVertex(vertices, uvs, normals, Vector3(0, 0, 0), Vector2(0, 0), Vector3(1, 0, 0));
+	addVertex(vertices, uvs, normals, Vector3(-1, 1, -1), Vector2(1, 1), Vector3(-1, 0, 0));
+	addVertex(vertices, uvs, normals, Vector3(1e-7f, -1e7f, 3.14159f), Vector2(0.5f, 1), Vector3(0, 1, 0));
+	addVertex(vertices, uvs, normals, Vector3(100.25f, -0.001f, 42), Vector2(1.0f / 3.0f, 0.999f), Vector3(0, -1, 0));
+	addVertex(vertices, uvs, normals, Vector3(5, 5, 5), Vector2(-0.75f, 0.0001f), Vector3(0, 0, 1));
+	addVertex(vertices, uvs, normals, Vector3(-5, -5, -5), Vector2(3.7f, -2.2f), Vector3(0, 0, -1));
+	addVertex(vertices, uvs, normals, Vector3(2, 3, 4), Vector2(0.001f, 0.25f), Vector3(1, 1, 1));
+	addVertex(vertices, uvs, normals, Vector3(4, 3, 2), Vector2(0.9995f, 0.0005f), Vector3(-3, 0.5f, 7));
+
+	unsigned int state = 12345;
+	for (int i = 0; i < RandomVertices; i++){
+		Vector3 vertex(randomFloat(state, -100, 100), randomFloat(state, -100, 100), randomFloat(state, -100, 100));
+		Vector2 uv(randomFloat(state, -1, 2), randomFloat(state, -1, 2));
+		Vector3 normal;
+		do{
+			normal.Insert(randomFloat(state, -1, 1), randomFloat(state, -1, 1), randomFloat(state, -1, 1));
+		} while (normal.Magnitude() < 0.01f);
+		addVertex(vertices, uvs, normals, vertex, uv, normal);
+	}
+}
+
+//Largest error of the vertex relative to the format's tolerance, above 1 it is outside
+static float uvError(float expected, float actual, bool isHalf)
+{
+	if (!isHalf){
+		return expected == actual ? 0.0f : 2.0f;
+	}
+	float scale = fabs(expected) > 1 ? fabs(expected) : 1.0f;
+	return fabs(expected - actual) / (UvTolerance * scale);
+}
+
+static float normalError(float expected, float actual, bool isPacked)
+{
+	if (!isPacked){
+		return expected == actual ? 0.0f : 2.0f;
+	}
+	//Small slack for the float rounding of the normalization
+	return fabs(expected - actual) / (NormalTolerance + 1e-6f);
+}
+
+static bool testFormat(unsigned int index, const std::vector<Vector3>& vertices, const std::vector<Vector2>& uvs, const std::vector<Vector3>& normals)
+{
+	VertexFormat format(Formats[index]);
+	bool isHalf = (format.flags() & HalfFloatUvs) != 0;
+	bool isPacked = (format.flags() & PackedNormals) != 0;
+
+	std::vector<unsigned char> packed;
+	format.pack(vertices, uvs, normals, packed);
+	if (packed.size() != vertices.size() * format.stride()){
+		printf("%-20s packed %u bytes, expected %u\n", FormatNames[index], (unsigned int)packed.size(), (unsigned int)(vertices.size() * format.stride()));
+		return false;
+	}
+
+	unsigned int failures = 0;
+	float maxUvError = 0;
+	float maxNormalError = 0;
+	for (unsigned int i = 0; i < vertices.size(); i++){
+		Vector3 position, normal;
+		Vector2 uv;
+		format.unpack(&packed[i * format.stride()], position, uv, normal);
+
+		Vector3 expectedVertex = vertices[i];
+		Vector2 expectedUv = uvs[i];
+		Vector3 expectedNormal = normals[i];
+		if (isPacked){
+			expectedNormal /= expectedNormal.Magnitude();
+		}
+
+		bool isFailed = false;
+		for (int j = 0; j < 3; j++){
+			if (position[j] != expectedVertex[j]){
+				isFailed = true;
+			}
+			float error = normalError(expectedNormal[j], normal[j], isPacked);
+			maxNormalError = error > maxNormalError ? error : maxNormalError;
+			isFailed |= error > 1;
+		}
+		for (int j = 0; j < 2; j++){
+			float error = uvError(expectedUv[j], uv[j], isHalf);
+			maxUvError = error > maxUvError ? error : maxUvError;
+			isFailed |= error > 1;
+		}
+
+		if (isFailed && failures++ < 5){
+			printf("%-20s vertex %u: position %g %g %g uv %g %g normal %g %g %g, unpacked %g %g %g uv %g %g normal %g %g %g\n", FormatNames[index], i,
+				expectedVertex[0], expectedVertex[1], expectedVertex[2], expectedUv[0], expectedUv[1], expectedNormal[0], expectedNormal[1], expectedNormal[2],
+				position[0], position[1], position[2], uv[0], uv[1], normal[0], normal[1], normal[2]);
+		}
+	}
+
+	printf("%-20s stride %2u  max uv error %.3f  max normal error %.3f of the tolerance  %s\n", FormatNames[index], format.stride(),
+		maxUvError, maxNormalError, failures == 0 ? "ok" : "FAILED");
+	return failures == 0;
+}
+
+//Every value a half float can hold has to survive the conversion both ways
+static bool testHalfFloats()
+{
+	unsigned int failures = 0;
+	for (unsigned int half = 0; half < 0x10000; half++){
+		//NaNs only have to stay NaNs
+		if ((half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0){
+			float value = VertexFormat::halfToFloat((unsigned short)half);
+			if (value == value || (VertexFormat::floatToHalf(value) & 0x3FF) == 0){
+				failures++;
+			}
+			continue;
+		}
+		if (VertexFormat::floatToHalf(VertexFormat::halfToFloat((unsigned short)half)) != half){
+			if (failures++ < 5){
+				printf("half 0x%04x becomes 0x%04x\n", half, VertexFormat::floatToHalf(VertexFormat::halfToFloat((unsigned short)half)));
+			}
+		}
+	}
+	printf("%-20s %s\n", "half float values", failures == 0 ? "ok" : "FAILED");
+	return failures == 0;
+}
+
+int main()
+{
+	std::vector<Vector3> vertices;
+	std::vector<Vector2> uvs;
+	std::vector<Vector3> normals;
+	createVertices(vertices, uvs, normals);
+
+	bool isPassed = testHalfFloats();
+	for (unsigned int i = 0; i < sizeof(Formats) / sizeof(Formats[0]); i++){
+		isPassed &= testFormat(i, vertices, uvs, normals);
+	}
+	return isPassed ? 0 : 1;
+}
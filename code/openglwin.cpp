@@ -1,5 +1,8 @@
 #include "openglwin.h"
 
+//Size of the cells the random shapes are grouped into
+const int ShapeCellSize = 20;
+
 OpenGLWin::OpenGLWin(const QGLFormat& format)
 	: QGLWidget(format)
 {
@@ -23,10 +26,16 @@ OpenGLWin::OpenGLWin(const QGLFormat& format)
 	m_frustumCheckToggle = true;
 	m_wireframeBVToggle = false;
 	m_originalMeshHEToggle = false;
+	m_occlusionCullingToggle = false;
+	m_occlusionQueryToggle = false;
+	m_compactGBufferToggle = true;
+	m_isCompactGBuffer = false;
+	m_tiledLightingToggle = true;
+	m_shadowFilterBenchmark = false;
 
 	m_isFocus = true;
 	
-	m_glFunctions = new QOpenGLFunctions_3_3_Core;
+	m_glFunctions = new GLStateCache;
 	m_isShapes = false;
 	m_isSolarSystem = false;
 	m_isSubdivision = false;
@@ -80,13 +89,6 @@ OpenGLWin::~OpenGLWin()
 
 	//FBO and their Textures
 	//////////////////////////////////////////////////////////////////////////
-	//Shadow Map
-	m_glFunctions->glDeleteTextures(1, &m_shadowMapTexture);
-	m_glFunctions->glDeleteTextures(1, &m_shadowMapBlurTexture);
-	m_glFunctions->glDeleteRenderbuffers(1, &m_shadowmapDepthBuffer);
-	m_glFunctions->glDeleteFramebuffers(1, &m_shadowMapFBO);
-	m_glFunctions->glDeleteFramebuffers(1, &m_shadowMapBlurFBO);
-
 	//Deferred Shading
 	m_glFunctions->glDeleteTextures(1, &m_deferredShadingDepthTexture);
 	m_glFunctions->glDeleteTextures(1, &m_deferredShadingFinalTexture);
@@ -111,6 +113,9 @@ OpenGLWin::~OpenGLWin()
 			delete m_transformList[i];
 		}
 	}
+	for (std::map<unsigned int, Transform*>::iterator it = m_shapeCells.begin(); it != m_shapeCells.end(); ++it){
+		delete it->second;
+	}
 	if (!m_meshList.empty()){
 		for (int i = 0; i < m_meshList.size(); i++){
 			delete m_meshList[i];
@@ -145,7 +150,11 @@ OpenGLWin::~OpenGLWin()
 	//Clear the lists
 	m_cameraList.clear();
 	m_transformList.clear();
+	m_shapeCells.clear();
+	m_shapeCellList.clear();
 	m_meshList.clear();
+	m_occluderMeshList.clear();
+	m_occluderTransformList.clear();
 	m_textureList.clear();
 	m_shaderProgramList.clear();
 	m_halfEdgeMeshList.clear();
@@ -165,6 +174,13 @@ OpenGLWin::~OpenGLWin()
 	
 	delete m_pointLight;
 
+	delete m_occlusionQueries;
+	delete m_renderQueue;
+	delete m_uniformBuffers;
+	delete m_tiledLightCulling;
+	delete m_lightVolumes;
+	delete m_shadowMapFilter;
+
 	delete m_glFunctions;
 }
 
@@ -225,36 +241,46 @@ void OpenGLWin::initializeGL()
 	//Create the shader programs
 	m_uberShaderProgram = new ShaderProgram(m_glFunctions);
 
-	//Compile and link shaders
-	m_uberShaderProgram->prepareShaderProgram("shaders/uberVertexShader.glsl", "shaders/uberFragmentShader.glsl");
+	//Compile and link shaders. One program per shader branch, each only has the code of its branch
+	m_uberShaderProgram->prepareShaderProgram("shaders/uberVertexShader.glsl", "shaders/uberFragmentShader.glsl", ShaderModeCount);
 
 	//Push to the lists to deallocate easier
 	m_shaderProgramList.push_back(m_uberShaderProgram);
 
-	//Associate shader variables to Handles
-	m_shaderModeLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "mode");
-	m_scaleUniform = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "ScaleU");
-	m_textureSamplerLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "textureSampler");
-	m_shadowMapSamplerLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "shadowMapSampler");
-	m_screenSizeLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "screenSize");
-	m_fragmentViewMatrixLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "viewMatrix");
-	m_maxLightRadiusLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "maxLightRadius");
-
+	//Associate texture unit to samplers of every variant
+	m_uberShaderProgram->setSampler("textureSampler", 0);
+	m_uberShaderProgram->setSampler("skyBoxSampler", 0);
+	m_uberShaderProgram->setSampler("shadowMapSampler", 1);
 	//G-Buffer
-	m_diffuseSamplerLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "diffuseSampler");
-	m_positionSamplerLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "positionSampler");
-	m_normalsSamplerLocation = m_glFunctions->glGetUniformLocation(m_uberShaderProgram->getShaderProgramID(), "normalsSampler");
+	m_uberShaderProgram->setSampler("diffuseSampler", 2);
+	m_uberShaderProgram->setSampler("positionSampler", 3);
+	m_uberShaderProgram->setSampler("normalsSampler", 4);
+	m_uberShaderProgram->setSampler("depthSampler", 5);
 
 	//Bind shader to use
-	m_glFunctions->glUseProgram(m_uberShaderProgram->getShaderProgramID());
-
-	//Associate texture unit to samplers
-	m_glFunctions->glUniform1i(m_textureSamplerLocation, 0);
-	m_glFunctions->glUniform1i(m_shadowMapSamplerLocation, 1);
-	//G-Buffer
-	m_glFunctions->glUniform1i(m_diffuseSamplerLocation, 2);
-	m_glFunctions->glUniform1i(m_positionSamplerLocation, 3);
-	m_glFunctions->glUniform1i(m_normalsSamplerLocation, 4);
+	m_uberShaderProgram->useMode(ForwardMode);
+
+	//Matrices and materials are sent in uniform blocks instead of one uniform at a time
+	m_uberShaderProgram->bindUniformBlock("FrameBlock", FrameBlockBinding);
+	m_uberShaderProgram->bindUniformBlock("ObjectBlock", ObjectBlockBinding);
+	m_uniformBuffers = new UniformBuffers(m_glFunctions);
+	m_uniformBuffers->init();
+	m_drawContext.uniformBuffers = m_uniformBuffers;
+
+	//Occlusion queries draw the boxes around the meshes with the uber-shader
+	m_occlusionQueries = new OcclusionQueries(m_glFunctions);
+	m_occlusionQueries->init(m_uberShaderProgram);
+
+	//Sorts the draws of each pass by state before they are submitted
+	m_renderQueue = new RenderQueue(m_glFunctions);
+
+	//Light lists of the tiled light pass are read by the uber-shader from buffer textures
+	m_tiledLightCulling = new TiledLightCulling(m_glFunctions);
+	m_tiledLightCulling->init(m_uberShaderProgram);
+	//Light volumes of the light pass, set up with the sphere mesh by the deferred shading scene
+	m_lightVolumes = new LightVolumeBatch(m_glFunctions);
+	//Shadow map and its filter passes, set up by the shadow map scene
+	m_shadowMapFilter = new ShadowMapFilter(m_glFunctions);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Textures for skybox
@@ -288,7 +314,7 @@ void OpenGLWin::initializeGL()
 	//Skybox Mesh
 	m_skyboxM = new Mesh(m_glFunctions);
 	m_skyboxM->setNodeType(SkyboxMesh);
-	m_skyboxM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+	m_skyboxM->useShaderProgram(m_uberShaderProgram);
 	m_skyboxM->useTexture(m_skyboxTexture->getTextureID());
 	m_skyboxM->loadOBJ("models/cube.obj");
 
@@ -301,7 +327,7 @@ void OpenGLWin::initializeGL()
 
 	//Sun Light
 	m_pointLight = new Light(m_glFunctions);
-	m_pointLight->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+	m_pointLight->useShaderProgram(m_uberShaderProgram);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Connect the Scenegraph
@@ -328,20 +354,23 @@ void OpenGLWin::initializeGL()
 
 		//Pyramid Mesh
 		m_pyramidM = new Mesh(m_glFunctions);
-		m_pyramidM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_pyramidM->useShaderProgram(m_uberShaderProgram);
 		m_pyramidM->useTexture(m_pyramidTexture->getTextureID());
+		m_pyramidM->setInstanced(true);
 		m_pyramidM->loadOBJ("models/pyramid.obj");
 
 		//Cube Mesh
 		m_cubeM = new Mesh(m_glFunctions);
-		m_cubeM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_cubeM->useShaderProgram(m_uberShaderProgram);
 		m_cubeM->useTexture(m_cubeTexture->getTextureID());
+		m_cubeM->setInstanced(true);
 		m_cubeM->loadOBJ("models/cube.obj");
 
 		//Sphere Mesh
 		m_sphereM = new Mesh(m_glFunctions);
-		m_sphereM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_sphereM->useShaderProgram(m_uberShaderProgram);
 		m_sphereM->useTexture(m_sphereTexture->getTextureID());
+		m_sphereM->setInstanced(true);
 		m_sphereM->loadOBJ("models/sphere.obj");
 
 		//Push to the lists to deallocate easier
@@ -410,32 +439,33 @@ void OpenGLWin::initializeGL()
 		//Meshes
 		//Sun Mesh
 		m_sunM = new Mesh(m_glFunctions);
-		m_sunM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_sunM->useShaderProgram(m_uberShaderProgram);
 		m_sunM->useTexture(m_sunTexture->getTextureID());
+		m_sunM->setOccluder(true);
 		m_sunM->loadOBJ("models/sphere.obj");
 		m_sunM->setAmbientMaterial(3.0, 3.0, 3.0);
 
 		//Planet1 Mesh
 		m_planet1M = new Mesh(m_glFunctions);
-		m_planet1M->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_planet1M->useShaderProgram(m_uberShaderProgram);
 		m_planet1M->useTexture(m_planet1Texture->getTextureID());
 		m_planet1M->loadOBJ("models/sphere.obj");
 
 		//Planet2 Mesh
 		m_planet2M = new Mesh(m_glFunctions);
-		m_planet2M->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_planet2M->useShaderProgram(m_uberShaderProgram);
 		m_planet2M->useTexture(m_planet2Texture->getTextureID());
 		m_planet2M->loadOBJ("models/sphere.obj");
 
 		//Planet3 Mesh
 		m_planet3M = new Mesh(m_glFunctions);
-		m_planet3M->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_planet3M->useShaderProgram(m_uberShaderProgram);
 		m_planet3M->useTexture(m_planet3Texture->getTextureID());
 		m_planet3M->loadOBJ("models/sphere.obj");
 
 		//Moon Mesh
 		m_moonM = new Mesh(m_glFunctions);
-		m_moonM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_moonM->useShaderProgram(m_uberShaderProgram);
 		m_moonM->useTexture(m_moonTexture->getTextureID());
 		m_moonM->loadOBJ("models/sphere.obj");
 
@@ -451,6 +481,9 @@ void OpenGLWin::initializeGL()
 		//Sun linked to Root
 		m_root->addChildNode(m_sunT);
 		m_sunT->addChildNode(m_sunM);
+		//The sun hides the planets behind it
+		m_occluderMeshList.push_back(m_sunM);
+		m_occluderTransformList.push_back(m_sunT);
 		m_shapesAddedToScene++;
 
 		//Planet1 linked to Sun
@@ -493,7 +526,7 @@ void OpenGLWin::initializeGL()
 
 		//Halfedge Mesh
 		m_subdivisionCubeM = new HalfEdgeMesh(m_glFunctions);
-		m_subdivisionCubeM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_subdivisionCubeM->useShaderProgram(m_uberShaderProgram);
 		m_subdivisionCubeM->useTexture(m_subdivisionCubeTexture->getTextureID());
 		m_subdivisionCubeM->loadOBJ("models/cube.obj");
 
@@ -531,12 +564,13 @@ void OpenGLWin::initializeGL()
 
 		//Meshes
 		m_shadowmapM = new Mesh(m_glFunctions);
-		m_shadowmapM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_shadowmapM->useShaderProgram(m_uberShaderProgram);
 		m_shadowmapM->useTexture(m_shadowmapTexture->getTextureID());
+		m_shadowmapM->setOccluder(true);
 		m_shadowmapM->loadOBJ("models/room.obj");
 
 		m_shadowMapPointLightM = new Mesh(m_glFunctions);
-		m_shadowMapPointLightM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_shadowMapPointLightM->useShaderProgram(m_uberShaderProgram);
 		m_shadowMapPointLightM->useTexture(m_shadowmapTexture->getTextureID());
 		m_shadowMapPointLightM->loadOBJ("models/pointLightSphere.obj");
 		m_shadowMapPointLightM->setAmbientMaterial(2, 2, 2);
@@ -551,8 +585,16 @@ void OpenGLWin::initializeGL()
 		m_shadowMapPointLightT->addChildNode(m_shadowMapPointLightT1);
 		m_root->addChildNode(m_shadowmapT);
 		m_shadowmapT->addChildNode(m_shadowmapM);
+		m_occluderMeshList.push_back(m_shadowmapM);
+		m_occluderTransformList.push_back(m_shadowmapT);
 		m_shapesAddedToScene++;
 
+		//Shadow map resolution and how it is filtered. 3 standard deviations of the Gaussian are 11 texels
+		m_shadowMapFilter->setResolution(1024);
+		m_shadowMapFilter->setKernelRadius(11);
+		m_shadowMapFilter->setDownsample(1);
+		m_shadowMapFilter->setMomentFormat(Moments32Float);
+
 		//Setup FBOs(render targets) for shadow map
 		initShadowMap();
 	}
@@ -577,13 +619,16 @@ void OpenGLWin::initializeGL()
 
 		//Meshes
 		m_deferredShadingM = new Mesh(m_glFunctions);
-		m_deferredShadingM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_deferredShadingM->useShaderProgram(m_uberShaderProgram);
 		m_deferredShadingM->useTexture(m_deferredShadingTexture->getTextureID());
+		m_deferredShadingM->setOccluder(true);
 		m_deferredShadingM->loadOBJ("models/room.obj");
 
 		m_dsPointLightM = new Mesh(m_glFunctions);
-		m_dsPointLightM->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+		m_dsPointLightM->useShaderProgram(m_uberShaderProgram);
 		m_dsPointLightM->loadOBJ("models/pointLightSphere.obj");
+		//The light volumes are drawn from the vertex buffers of the sphere
+		m_lightVolumes->init(m_uberShaderProgram, m_dsPointLightM);
 
 		//Push to the lists to deallocate easier
 		m_meshList.push_back(m_deferredShadingM);
@@ -597,6 +642,8 @@ void OpenGLWin::initializeGL()
 		//Attach to scenegraph
 		m_root->addChildNode(m_deferredShadingT);
 		m_deferredShadingT->addChildNode(m_deferredShadingM);
+		m_occluderMeshList.push_back(m_deferredShadingM);
+		m_occluderTransformList.push_back(m_deferredShadingT);
 		m_shapesAddedToScene = m_dsLightCounter;
 
 		//Setup FBO(render target) for deferred shading
@@ -613,6 +660,17 @@ void OpenGLWin::initializeGL()
 //Function called when the openGL widget needs to update
 void OpenGLWin::paintGL()
 {
+	//Frustum culling statistics are shown per frame
+	m_frustum.resetCounters();
+	//Set again by each pass seen from the camera. The shadow map pass is seen from the light
+	m_drawContext.occlusionBuffer = NULL;
+	//Reads the query results which finished since the last frame
+	m_occlusionQueries->beginFrame();
+	m_renderQueue->resetCounters();
+	m_uniformBuffers->resetCounters();
+	m_glFunctions->resetCounters();
+	m_lightVolumes->resetCounters();
+
 	//////////////////////////////////////////////////////////////////////////
 	//Moves the player
 	m_playerT->lookAt(m_position, m_position + m_direction, m_up);
@@ -631,8 +689,13 @@ void OpenGLWin::paintGL()
 		drawSkybox();
 	}
 	if (m_isShadowmap){
+		//Time every filter option before the shadow map of the frame is rendered, since the benchmark overwrites it
+		if (m_shadowFilterBenchmark){
+			m_shadowMapFilter->benchmark(100);
+			m_shadowFilterBenchmark = false;
+		}
 		shadowMapPass1();
-		blurShadowmap(9);
+		m_shadowMapFilter->filter();
 		shadowMapPass2();
 		drawSkybox();
 		drawShadowmapTexture();
@@ -665,32 +728,53 @@ void OpenGLWin::paintGL()
 			m_root->removeChildNode(m_dsLightTransformList[i]);
 		}
 
+		//Copy the moved and recolored lights into the light volume batch. Only the lights which changed are uploaded
+		for (int i = 0; i < m_dsLightCounter; i++){
+			Light* light = m_dsLightList[i];
+			m_lightVolumes->setLight(i, light->getLightPosition(), light->getLightColor(), light->getLightIntensity(), light->getMaxLightRadius());
+		}
+
 		//Extracting the view frustum planes
 		m_frustum.extractFrustum(m_view, m_projection);
+		rasterizeOccluders();
 
 		//Init the counter for rendred objects to the amount of objects created
 		m_frustum.shapesRendered = m_shapesAddedToScene;
 
+		//Switch the layout of the G-Buffer if it was toggled
+		if (m_isCompactGBuffer != m_compactGBufferToggle){
+			allocateGBufferTextures(m_width, m_height);
+			m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		}
+
 		//Render scene to G-Buffer
 		dsGeometryPass();
 
 		//Init the counter for rendred objects to the amount of objects created
 		m_frustum.shapesRendered = m_shapesAddedToScene;
 
-		//Enable Stencil Test for the Stencil/Light pass
-		m_glFunctions->glEnable(GL_STENCIL_TEST);
+		//Cull the lights against the frustum. Both light passes skip the culled lights
+		m_lightVolumes->cullLights(m_frustum, m_view, m_projection, m_near, m_width, m_height);
 
-		//Stencil / Light pass
-		dsStencilAndLightPass();
-		
-		m_glFunctions->glCullFace(GL_BACK);
-		m_glFunctions->glDisable(GL_STENCIL_TEST);
+		//The light passes sample the depth texture. Detach it so it isn't read while it is an attachment of the bound FBO
+		m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, 0, 0);
+
+		if (m_tiledLightingToggle){
+			//Tiled Light pass
+			dsTiledLightPass();
+		}
+		else{
+			//Light Volume pass
+			dsLightVolumePass();
+		}
 
 		//////////////////////////////////////////////////////////////////////////
 		//Blend scene with ambient light with the light meshes
 		dsDrawSceneWithAmbientLight();
 		m_glFunctions->glDisable(GL_BLEND);
 
+		//The skybox is depth tested against the scene
+		m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, m_deferredShadingDepthTexture, 0);
 		m_glFunctions->glEnable(GL_DEPTH_TEST);
 		drawSkybox();
 		m_glFunctions->glDisable(GL_DEPTH_TEST);
@@ -714,6 +798,7 @@ void OpenGLWin::paintGL()
 		m_fpsTimeWindowTitle
 		+ "   [" + QString::number(m_shapesAddedToScene) + "]" + " Objects Added"
 		+ "   [" + QString::number(m_frustum.shapesRendered) + "]" + " Objects Rendered"
+		+ "   [" + QString::number(m_occlusionQueries->getOccludedCount()) + "]" + " Query Occluded"
 		+ "   [" + QString::number(m_subdivisionCounter) + "]" + " Subdivisions";
 	setWindowTitle(windowTitle);
 
@@ -722,7 +807,18 @@ void OpenGLWin::paintGL()
 		m_fpsTimeGUI + "\n"
 		+ "[" + QString::number(m_shapesAddedToScene) + "]" + " Objects Added" + "\n"
 		+ "[" + QString::number(m_frustum.shapesRendered) + "]" + " Objects Rendered" + "\n"
-		+ "[" + QString::number(m_subdivisionCounter) + "]" + " Subdivisions" + "\n";
+		+ "[" + QString::number(m_occlusionQueries->getOccludedCount()) + "/" + QString::number(m_occlusionQueries->getTestedCount()) + "]" + " Query Occluded/Tested" + "\n"
+		+ "[" + QString::number(m_renderQueue->getPacketCount()) + "/" + QString::number(m_renderQueue->getStateChangeCount()) + "]" + " Queued Draws/State Changes" + "\n"
+		+ "[" + QString::number(m_uniformBuffers->getObjectCount()) + "/" + QString::number(m_uniformBuffers->getFlushCount()) + "]" + " Object Blocks/Uploads" + "\n"
+		+ "[" + QString::number(m_glFunctions->getIssuedCount()) + "/" + QString::number(m_glFunctions->getFilteredCount()) + "]" + " GL Calls Issued/Filtered" + "\n"
+		+ "[" + QString::number(m_tiledLightCulling->getLightCount()) + "/" + QString::number(m_tiledLightCulling->getTileEntryCount()) + "]" + " Tiled Lights/Tile Entries" + "\n"
+		+ "[" + QString::number(m_lightVolumes->getLightCount()) + "/" + QString::number(m_lightVolumes->getUploadedCount()) + "]" + " Light Volumes/Uploaded" + "\n"
+		+ "[" + QString::number(m_shadowMapFilter->getFilterTime()) + "]" + " Shadow Filter ms" + "\n"
+		+ "[" + QString::number(m_lightVolumes->getCulledCount()) + "/" + QString::number(m_lightVolumes->getScissoredCount()) + "/" + QString::number(m_lightVolumes->getFullscreenCount()) + "/" + QString::number(m_lightVolumes->getDrawCount()) + "]" + " Lights Culled/Scissored/Fullscreen/Draws" + "\n"
+		+ "[" + QString::number(m_subdivisionCounter) + "]" + " Subdivisions" + "\n"
+		+ "[" + QString::number(m_frustum.getPlaneTests()) + "]" + " Plane Tests" + "\n"
+		+ "[" + QString::number(m_frustum.getCacheHits()) + "/" + QString::number(m_frustum.getCacheMisses()) + "]" + " Plane Cache Hits/Misses" + "\n"
+		+ "[" + QString::number(m_occlusionBuffer.getOccludedCount()) + "/" + QString::number(m_occlusionBuffer.getTestedCount()) + "]" + " Occluded/Tested" + "\n";
 	emit setGUIText(windowTitle);
 	m_elapsedTimer.restart();
 }
@@ -831,6 +927,13 @@ void OpenGLWin::keyPress()
 		if (k == Qt::Key_Q && m_isShapes){
 			deleteLatestShape();
 		}
+		//Adds small lights at random places in the room
+		if (k == Qt::Key_E && m_isDeferredShading){
+			for (int i = 0; i < 10; i++){
+				addLightToDsScene((rand() % 100) / 10.0f - 5, (rand() % 70) / 10.0f - 4, -(rand() % 108) / 10.0f, 1, 1, 1, 1 + rand() % 3);
+			}
+			m_shapesAddedToScene = m_dsLightCounter;
+		}
 		if (k == Qt::Key_Up && m_isShadowmap){
 			m_shadowMapPointLightT->translate(0, (2 * m_deltaTime / 100), 0);
 		}
@@ -853,7 +956,8 @@ void OpenGLWin::deleteLatestShape()
 			qDebug() << "No shapes to remove...";
 			return;
 		}
-		m_root->removeChildNode(m_transformList[m_transformList.size() - 1]); //removes the latest transform
+		m_shapeCellList[m_shapeCellList.size() - 1]->removeChildNode(m_transformList[m_transformList.size() - 1]); //removes the latest transform from its cell
+		m_shapeCellList.pop_back();
 		
 		m_latestShapeAdded = NULL;
 		m_shapesAddedToScene--;
@@ -900,6 +1004,8 @@ void OpenGLWin::enableFrustumCulling(int toggle)
 		for (int i = 0; i < m_halfEdgeMeshList.size(); i++){
 			m_halfEdgeMeshList[i]->setFrustumCulling(false);
 		}
+		//Transforms stop culling their subtrees as well
+		m_frustum.setSubtreeCulling(false);
 		emit enableWireframeBVComboBox(0);
 		emit updateWireframeBVComboBox(0);
 	}
@@ -912,6 +1018,7 @@ void OpenGLWin::enableFrustumCulling(int toggle)
 		for (int i = 0; i < m_halfEdgeMeshList.size(); i++){
 			m_halfEdgeMeshList[i]->setFrustumCulling(true);
 		}
+		m_frustum.setSubtreeCulling(true);
 		emit enableWireframeBVComboBox(1);
 		emit updateWireframeBVComboBox(0);
 	}
@@ -1007,13 +1114,37 @@ void OpenGLWin::addRandomShapeToScene()
 		//Translate the shape
 		shapeT->translate(posX, posY, posZ);
 
-		m_root->addChildNode(shapeT);
+		//Group the shape with the shapes close to it
+		Transform* cell = getShapeCell(posX, posY, posZ);
+		cell->addChildNode(shapeT);
+		m_shapeCellList.push_back(cell);
 		m_latestShapeAdded = shapeT;
 		m_shapesAddedToScene++;
 		emit resetScaleSlider();
 	}
 }
 
+Transform* OpenGLWin::getShapeCell(int x, int y, int z)
+{
+	//Round down so negative positions get their own cells
+	int cellX = (int)floor(x / (float)ShapeCellSize);
+	int cellY = (int)floor(y / (float)ShapeCellSize);
+	int cellZ = (int)floor(z / (float)ShapeCellSize);
+	//10 bits per axis. Cells far apart can share a key, they are just grouped together
+	unsigned int key = ((cellX & 0x3FF) << 20) | ((cellY & 0x3FF) << 10) | (cellZ & 0x3FF);
+
+	std::map<unsigned int, Transform*>::iterator it = m_shapeCells.find(key);
+	if (it != m_shapeCells.end()){
+		return it->second;
+	}
+
+	//The cell doesn't move. It only gathers the shapes under one merged bounding sphere
+	Transform* cell = new Transform;
+	m_root->addChildNode(cell);
+	m_shapeCells[key] = cell;
+	return cell;
+}
+
 void OpenGLWin::setScaleLatestShape(int factor)
 {
 	if (m_latestShapeAdded != NULL){
@@ -1114,6 +1245,30 @@ void OpenGLWin::keyPressEvent( QKeyEvent* event )
 		if (event->key() == Qt::Key_4){
 			subdivideScenegraph();
 		}
+		//Occlusion Culling Toggle
+		if (event->key() == Qt::Key_6){
+			m_occlusionCullingToggle = !m_occlusionCullingToggle;
+		}
+		//Occlusion Query Toggle
+		if (event->key() == Qt::Key_7){
+			m_occlusionQueryToggle = !m_occlusionQueryToggle;
+		}
+		//Front To Back Sorting Toggle
+		if (event->key() == Qt::Key_8){
+			m_renderQueue->setFrontToBack(!m_renderQueue->isFrontToBack());
+		}
+		//Compact G-Buffer Toggle. The textures are reallocated by the next frame
+		if (event->key() == Qt::Key_9){
+			m_compactGBufferToggle = !m_compactGBufferToggle;
+		}
+		//Tiled Lighting Toggle
+		if (event->key() == Qt::Key_0){
+			m_tiledLightingToggle = !m_tiledLightingToggle;
+		}
+		//Shadow Map Filter Benchmark. Needs the openGL context, so it runs in the next frame
+		if (event->key() == Qt::Key_B && m_isShadowmap){
+			m_shadowFilterBenchmark = true;
+		}
 		//Render Original Mesh for Subdivision
 		if (event->key() == Qt::Key_5){
 			if (m_isSubdivision){
@@ -1197,71 +1352,6 @@ void OpenGLWin::saveHalfEdgeMeshToFile()
 
 void OpenGLWin::initShadowMap()
 {
-	//Framebuffer, container for textures and depth buffer. Works similar to VAO?
-	m_glFunctions->glGenFramebuffers(1, &m_shadowMapFBO);
-	m_glFunctions->glGenRenderbuffers(1, &m_shadowmapDepthBuffer);
-
-	// Bind the depth buffer
-	m_glFunctions->glBindRenderbuffer(GL_RENDERBUFFER, m_shadowmapDepthBuffer);
-	m_glFunctions->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1024, 1024);
-	//////////////////////////////////////////////////////////////////////////
-	//Render depth to texture
-	m_glFunctions->glGenTextures(1, &m_shadowMapTexture);
-	//Bind created texture to make it current
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapTexture);
-
-	//VSM
-	m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 1024, 1024, 0, GL_RGBA, GL_FLOAT, 0);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	//////////////////////////////////////////////////////////////////////////
-	//Bind FBO
-	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapFBO);
-	m_glFunctions->glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_shadowmapDepthBuffer);
-	//Attach textures to FBO
-	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_shadowMapTexture, 0);
-
-
-	//Check if framebuffer is OK
-	GLenum fboStatus = m_glFunctions->glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE){
-		qDebug() << "FrameBuffer error: " + fboStatus;
-		return;
-	}
-
-	//Unbind to render scene
-	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-
-
-	//////////////////////////////////////////////////////////////////////////
-	// Creating the blur FBO
-	m_glFunctions->glGenFramebuffers(1, &m_shadowMapBlurFBO);
-
-	m_glFunctions->glGenTextures(1, &m_shadowMapBlurTexture);
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapBlurTexture);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_glFunctions->glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 1024, 1024, 0, GL_RGBA, GL_FLOAT, 0);
-
-	//Bind FBO
-	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapBlurFBO);
-	//Attach Textures
-	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_shadowMapBlurTexture, 0);
-
-	//Check if framebuffer is OK
-	fboStatus = m_glFunctions->glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE){
-		qDebug() << "FrameBuffer error: " + fboStatus;
-		return;
-	}
-
-	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-
 	//////////////////////////////////////////////////////////////////////////
 	// Create vao/vbo for quad
 	m_glFunctions->glGenVertexArrays(1, &m_quadVAO);
@@ -1281,44 +1371,10 @@ void OpenGLWin::initShadowMap()
 	//Enable the shader attribute to receive data
 	m_glFunctions->glEnableVertexAttribArray(0);
 	m_glFunctions->glBindVertexArray(0);
-}
-
-void OpenGLWin::blurShadowmap(int pass)
-{
-	for (int i = 0; i < pass; i++){
-		m_glFunctions->glUniform1i(m_shaderModeLocation, 4); //Blur Pass 3
-		m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapBlurFBO);
-		m_glFunctions->glViewport(0, 0, 1024, 1024); //blur coeff???
-		m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		m_glFunctions->glUniform2f(m_scaleUniform, 1.0 / 1024.0, 0.0); //horizontally
-
-		//Bind shadow map to be blurred
-		m_glFunctions->glActiveTexture(GL_TEXTURE1);
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapTexture);
-
-		//blur horizontally
-		m_glFunctions->glBindVertexArray(m_quadVAO);
-		m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
-		m_glFunctions->glBindVertexArray(0);
 
-
-		//blur vertically
-		m_glFunctions->glUniform1i(m_shaderModeLocation, 4); //Blur Pass 3
-		m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapFBO);
-		m_glFunctions->glViewport(0, 0, 1024, 1024); //blur coeff???
-		m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		m_glFunctions->glUniform2f(m_scaleUniform, 0.0, 1.0 / 1024.0); //vertically
-
-		//Bind shadow map to be blurredblurred
-		m_glFunctions->glActiveTexture(GL_TEXTURE1);
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapBlurTexture);
-
-		m_glFunctions->glBindVertexArray(m_quadVAO);
-		m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
-		m_glFunctions->glBindVertexArray(0);
-	}
+	//////////////////////////////////////////////////////////////////////////
+	//Framebuffers of the shadow map and the filter passes. The textures are created with the resolution and format of the scene by the first pass
+	m_shadowMapFilter->init(m_uberShaderProgram, m_quadVAO);
 }
 
 void OpenGLWin::initDeferredShading()
@@ -1349,35 +1405,10 @@ void OpenGLWin::initDeferredShading()
 	//////////////////////////////////////////////////////////////////////////
 	//Create G-Buffer Textures
 	//////////////////////////////////////////////////////////////////////////
-	//Diffuse Texture
+	//Diffuse, Position and Normals Textures. Allocated with the layout of the toggle
 	m_glFunctions->glGenTextures(1, &m_diffuseTexture);
-	//Bind created texture to make it current
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
-	m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1024, 1024, 0, GL_RGBA, GL_FLOAT, 0);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	
-	//Position Texture
 	m_glFunctions->glGenTextures(1, &m_positionTexture);
-	//Bind created texture to make it current
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
-	m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1024, 1024, 0, GL_RGBA, GL_FLOAT, 0);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	//Normals Texture
 	m_glFunctions->glGenTextures(1, &m_normalsTexture);
-	//Bind created texture to make it current
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
-	m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1024, 1024, 0, GL_RGBA, GL_FLOAT, 0);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Bind FBO and bind the render buffer to depth attachment
@@ -1385,9 +1416,7 @@ void OpenGLWin::initDeferredShading()
 	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, m_deferredShadingDepthTexture, 0);
 	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT4, m_deferredShadingFinalTexture, 0);
 	//Attach G-Buffer textures to FBO
-	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_diffuseTexture, 0);
-	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_positionTexture, 0);
-	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, m_normalsTexture, 0);
+	allocateGBufferTextures(1024, 1024);
 
 	//Check if framebuffer is OK
 	GLenum fboStatus = m_glFunctions->glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -1439,30 +1468,60 @@ void OpenGLWin::updateDeferredShadingTextures(float width, float height)
 		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		//Diffuse Texture
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+		//G-Buffer Textures
+		allocateGBufferTextures(width, height);
+		m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	}
+}
+
+void OpenGLWin::allocateGBufferTextures(float width, float height)
+{
+	//Diffuse Texture. The compact layout has the specular intensity of the material in alpha
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+	if (m_compactGBufferToggle){
+		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	}
+	else{
 		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		//Position Texture
-		//Bind created texture to make it current
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	//Position Texture. The compact layout rebuilds the position from the depth texture, so only a 1x1 image is kept
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	if (m_compactGBufferToggle){
+		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1, 1, 0, GL_RGBA, GL_FLOAT, 0);
+	}
+	else{
 		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		//Normals Texture
-		//Bind created texture to make it current
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
+	//Normals Texture. The compact layout has the octahedral encoded normal in two 16 bit channels
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
+	if (m_compactGBufferToggle){
+		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, width, height, 0, GL_RG, GL_UNSIGNED_SHORT, 0);
+	}
+	else{
 		m_glFunctions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	}
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	m_glFunctions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	//Attach G-Buffer textures to FBO. The 1x1 position texture would shrink the render area, so it is detached in the compact layout
+	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_deferredShadingFBO);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_diffuseTexture, 0);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_compactGBufferToggle ? 0 : m_positionTexture, 0);
+	m_glFunctions->glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, m_normalsTexture, 0);
+
+	m_isCompactGBuffer = m_compactGBufferToggle;
 }
 
 void OpenGLWin::addLightToDsScene(float x, float y, float z, float r, float g, float b, float scaleFactor)
@@ -1476,7 +1535,7 @@ void OpenGLWin::addLightToDsScene(float x, float y, float z, float r, float g, f
 	Light* lightNode = new Light(m_glFunctions);
 	//Store the scale as max light radius in light node
 	lightNode->setMaxLightRadius(scaleFactor);
-	lightNode->useShaderProgram(m_uberShaderProgram->getShaderProgramID());
+	lightNode->useShaderProgram(m_uberShaderProgram);
 	lightNode->setLightColor(r, g, b);
 
 	//Attach mesh and light to light transform
@@ -1486,6 +1545,8 @@ void OpenGLWin::addLightToDsScene(float x, float y, float z, float r, float g, f
 	//Push them to their respective lists
 	m_dsLightTransformList.push_back(lightT);
 	m_dsLightList.push_back(lightNode);
+	//The world position is set once the light has been updated
+	m_lightVolumes->addLight(Vector3(x, y, z), Vector3(r, g, b), lightNode->getLightIntensity(), scaleFactor);
 	//Increase Lights counter
 	m_dsLightCounter++;
 }
@@ -1493,12 +1554,12 @@ void OpenGLWin::addLightToDsScene(float x, float y, float z, float r, float g, f
 void OpenGLWin::drawSkybox()
 {
 	//Set shader branch to skybox shader
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 11);
+	m_uberShaderProgram->useMode(SkyboxMode);
 
 	//Attach skybox mesh
 	m_skyboxT->addChildNode(m_skyboxM);
 	//Render
-	m_skyboxT->draw(m_frustum, m_projection, m_view);
+	m_skyboxT->draw(m_frustum, m_drawContext, m_projection, m_view);
 	//Deattach skybox mesh
 	m_skyboxT->removeChildNode(m_skyboxM);
 }
@@ -1506,7 +1567,7 @@ void OpenGLWin::drawSkybox()
 void OpenGLWin::dsDrawGBufferTextures()
 {
 	//Quad render of G-Buffer Textures
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 8); //Quad Pass
+	m_uberShaderProgram->useMode(GeometryBufferQuadMode); //Quad Pass
 
 	//////////////////////////////////////////////////////////////////////////
 	//Enable Scissor box to only the clear the color buffer and depth buffer for it
@@ -1530,12 +1591,20 @@ void OpenGLWin::dsDrawGBufferTextures()
 	m_glFunctions->glDisable(GL_SCISSOR_TEST);
 	m_glFunctions->glViewport(0, 0, m_width *0.15, m_height*0.20);
 
+	//The compact G-Buffer has no position texture, its depth is shown instead like the shadow map
 	m_glFunctions->glActiveTexture(GL_TEXTURE1);
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	if (m_isCompactGBuffer){
+		m_uberShaderProgram->useMode(ShadowMapQuadMode);
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_deferredShadingDepthTexture);
+	}
+	else{
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	}
 
 	m_glFunctions->glBindVertexArray(m_quadVAO);
 	m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
 	m_glFunctions->glBindVertexArray(0);
+	m_uberShaderProgram->useMode(GeometryBufferQuadMode);
 	//////////////////////////////////////////////////////////////////////////
 	//Enable Scissor box to only the clear the color buffer and depth buffer for it
 	m_glFunctions->glEnable(GL_SCISSOR_TEST);
@@ -1566,7 +1635,7 @@ void OpenGLWin::dsCopyFinalTextureToScreen()
 void OpenGLWin::dsDrawSceneWithAmbientLight()
 {
 	//Render fullscreen quad with Diffuse Texture*Ambient Light
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 7);
+	m_uberShaderProgram->useMode(AmbientQuadMode);
 
 	m_glFunctions->glBindVertexArray(m_quadVAO);
 	m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
@@ -1575,7 +1644,8 @@ void OpenGLWin::dsDrawSceneWithAmbientLight()
 
 void OpenGLWin::dsGeometryPass()
 {
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 5);
+	int geometryBufferMode = m_isCompactGBuffer ? CompactGeometryBufferMode : GeometryBufferMode;
+	m_uberShaderProgram->useMode(geometryBufferMode);
 
 	//Clear color buffer for final texture that will store the rendered light meshes 
 	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_deferredShadingFBO);
@@ -1583,8 +1653,15 @@ void OpenGLWin::dsGeometryPass()
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT);
 
 	//Supply glDrawBuffers with an array of buffers to enable MRT functionality. Change state to render to G-Buffer
-	GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	m_glFunctions->glDrawBuffers(3, DrawBuffers);
+	if (m_isCompactGBuffer){
+		//The shader writes albedo and specular to output 3 and the encoded normal to output 2. There is no position attachment
+		GLenum DrawBuffers[] = { GL_NONE, GL_NONE, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT0 };
+		m_glFunctions->glDrawBuffers(4, DrawBuffers);
+	}
+	else{
+		GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		m_glFunctions->glDrawBuffers(3, DrawBuffers);
+	}
 
 	m_glFunctions->glDepthMask(GL_TRUE);
 	m_glFunctions->glEnable(GL_DEPTH_TEST);
@@ -1592,67 +1669,172 @@ void OpenGLWin::dsGeometryPass()
 	// Clear the buffer with the current clearing color
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	//Render scene to G-Buffer
-	m_root->draw(m_frustum, m_projection, m_view);
+	setFrameUniforms();
+	beginOcclusionQueries();
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view);
+	submitRenderQueue(geometryBufferMode);
+	endOcclusionQueries();
 	m_glFunctions->glDepthMask(GL_FALSE);
 }
 
-void OpenGLWin::dsStencilAndLightPass()
+void OpenGLWin::dsLightVolumePass()
+{
+	int lightPassMode = m_isCompactGBuffer ? CompactLightPassMode : LightPassMode;
+	m_uberShaderProgram->useMode(lightPassMode);
+
+	//Render the light volumes and sample the G-Buffer for texturing
+	m_glFunctions->glDrawBuffer(GL_COLOR_ATTACHMENT4);
+	m_glFunctions->glDisable(GL_DEPTH_TEST);
+	//Only the back faces are drawn, so a volume still covers its pixels when the camera is inside of it
+	m_glFunctions->glEnable(GL_CULL_FACE);
+	m_glFunctions->glCullFace(GL_FRONT);
+
+	//The light of overlapping volumes adds up
+	m_glFunctions->glEnable(GL_BLEND);
+	m_glFunctions->glBlendEquation(GL_FUNC_ADD);
+	m_glFunctions->glBlendFunc(GL_ONE, GL_ONE);
+
+	m_glFunctions->glViewport(0, 0, m_width, m_height);
+
+	//The lights use the material of the light mesh
+	unsigned int lightMaterial = m_dsPointLightM->addObjectBlock(*m_uniformBuffers, Matrix44());
+	m_uniformBuffers->flushObjects();
+	m_uniformBuffers->bindObject(lightMaterial);
+
+	//Associate G-Buffer textures to samplers. The depth marks the pixels without geometry in both layouts
+	m_glFunctions->glActiveTexture(GL_TEXTURE2);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+	if (!m_isCompactGBuffer){
+		m_glFunctions->glActiveTexture(GL_TEXTURE3);
+		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	}
+	m_glFunctions->glActiveTexture(GL_TEXTURE4);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
+	m_glFunctions->glActiveTexture(GL_TEXTURE5);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_deferredShadingDepthTexture);
+
+	//Volumes and quads with instanced draws. The lights are per-instance attributes instead of uniforms
+	m_lightVolumes->draw();
+
+	//Don't leave the depth texture bound once it is attached again for the skybox
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
+	m_glFunctions->glCullFace(GL_BACK);
+}
+
+void OpenGLWin::dsTiledLightPass()
 {
-	//Loop Stencil pass and Light Pass for each light in scene
+	int tiledLightPassMode = m_isCompactGBuffer ? CompactTiledLightPassMode : TiledLightPassMode;
+
+	//Bin the lights inside the frustum into the screen tiles and upload the light lists
 	for (int i = 0; i < m_dsLightCounter; i++){
-		m_glFunctions->glUniform1i(m_shaderModeLocation, 9);
-		//Don't want to render to any color attachment. Only want to update stencil buffer
-		m_glFunctions->glDrawBuffer(GL_NONE);
-		m_glFunctions->glEnable(GL_DEPTH_TEST);
-		m_glFunctions->glDisable(GL_CULL_FACE);
-		m_glFunctions->glClear(GL_STENCIL_BUFFER_BIT);
-		//Set stencil pass to always pass.(Just want to do the stencil operations)
-		m_glFunctions->glStencilFunc(GL_ALWAYS, 0, 0);
-		//When depth test fails for back face, increase the stencil value
-		m_glFunctions->glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
-		//When depth test fails for front face, decrease the stencil value
-		m_glFunctions->glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
-
-		//Render light to update stencil buffer - Draw is first called from a Light node which updates shader uniforms and then the Light mesh
-		m_dsLightTransformList[i]->draw(m_frustum, m_projection, m_view);
+		if (!m_lightVolumes->isVisible(i)){
+			continue;
+		}
+		Light* light = m_dsLightList[i];
+		m_tiledLightCulling->addLight(light->getLightPosition(), light->getLightColor(), light->getLightIntensity(), light->getMaxLightRadius());
+	}
+	m_tiledLightCulling->cullLights(m_view, m_projection, m_near, m_width, m_height);
 
-		//////////////////////////////////////////////////////////////////////////
-		//Light Pass - Render sphere representing point light and sample G-Buffer for texturing
-		m_glFunctions->glUniform1i(m_shaderModeLocation, 6);
+	m_uberShaderProgram->useMode(tiledLightPassMode);
 
-		m_glFunctions->glDrawBuffer(GL_COLOR_ATTACHMENT4);
-		//Only render fragments with stencil value that is not 0. All positive stencil values are inside the light volume
-		m_glFunctions->glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
-		m_glFunctions->glDisable(GL_DEPTH_TEST);
-		m_glFunctions->glEnable(GL_CULL_FACE);
-		m_glFunctions->glCullFace(GL_FRONT);
-
-		//Send screen size to shader uniform
-		m_glFunctions->glUniform2f(m_screenSizeLocation, m_width, m_height);
-		//Send the view matrix to shader uniform so we can transform points to view space for light calculation
-		m_glFunctions->glUniformMatrix4fv(m_fragmentViewMatrixLocation, 1, GL_TRUE, &m_view[0][0]);
-		m_glFunctions->glEnable(GL_BLEND);
-		m_glFunctions->glBlendEquation(GL_FUNC_ADD);
-		m_glFunctions->glBlendFunc(GL_ONE, GL_ONE);
-
-		m_glFunctions->glViewport(0, 0, m_width, m_height);
-
-		//Associate G-Buffer textures to samplers
-		m_glFunctions->glActiveTexture(GL_TEXTURE2);
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+	//Add the light of all tiles to the final texture in one fullscreen pass
+	m_glFunctions->glDrawBuffer(GL_COLOR_ATTACHMENT4);
+	m_glFunctions->glDisable(GL_DEPTH_TEST);
+	m_glFunctions->glEnable(GL_BLEND);
+	m_glFunctions->glBlendEquation(GL_FUNC_ADD);
+	m_glFunctions->glBlendFunc(GL_ONE, GL_ONE);
+	m_glFunctions->glViewport(0, 0, m_width, m_height);
+
+	//The lights use the material of the light mesh, like the light volumes of the light pass
+	unsigned int lightMaterial = m_dsPointLightM->addObjectBlock(*m_uniformBuffers, Matrix44());
+	m_uniformBuffers->flushObjects();
+	m_uniformBuffers->bindObject(lightMaterial);
+
+	//Associate G-Buffer textures to samplers. The depth marks the pixels without geometry in both layouts
+	m_glFunctions->glActiveTexture(GL_TEXTURE2);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+	if (!m_isCompactGBuffer){
 		m_glFunctions->glActiveTexture(GL_TEXTURE3);
 		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_positionTexture);
-		m_glFunctions->glActiveTexture(GL_TEXTURE4);
-		m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
+	}
+	m_glFunctions->glActiveTexture(GL_TEXTURE4);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_normalsTexture);
+	m_glFunctions->glActiveTexture(GL_TEXTURE5);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_deferredShadingDepthTexture);
+	m_tiledLightCulling->bind();
+
+	m_glFunctions->glBindVertexArray(m_quadVAO);
+	m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
+	m_glFunctions->glBindVertexArray(0);
+
+	//Don't leave the depth texture bound once it is attached again for the skybox
+	m_tiledLightCulling->unbind();
+	m_glFunctions->glActiveTexture(GL_TEXTURE5);
+	m_glFunctions->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OpenGLWin::rasterizeOccluders()
+{
+	if (!m_occlusionCullingToggle || m_occluderMeshList.empty()){
+		m_drawContext.occlusionBuffer = NULL;
+		return;
+	}
 
-		//Render light - Draw is first called from a Light node which updates shader uniforms and then the Light mesh
-		m_dsLightTransformList[i]->draw(m_frustum, m_projection, m_view, 6);
+	m_occlusionBuffer.begin(m_projection * m_view);
+	for (int i = 0; i < m_occluderMeshList.size(); i++){
+		m_occluderMeshList[i]->addToOcclusionBuffer(m_occlusionBuffer, m_occluderTransformList[i]->getMatrix());
 	}
+	m_occlusionBuffer.rasterize();
+	m_drawContext.occlusionBuffer = &m_occlusionBuffer;
+}
+
+void OpenGLWin::beginRenderQueue()
+{
+	m_drawContext.renderQueue = m_renderQueue;
+}
+
+void OpenGLWin::submitRenderQueue(int shaderMode)
+{
+	m_drawContext.renderQueue = NULL;
+	m_renderQueue->submit(*m_uniformBuffers, shaderMode, *m_uberShaderProgram);
+}
+
+void OpenGLWin::setFrameUniforms(const Matrix44& lightView)
+{
+	m_uniformBuffers->setFrame(m_projection, m_view, lightView, m_width, m_height);
+}
+
+void OpenGLWin::drawInstancedMeshes(int shaderBranch)
+{
+	for (int i = 0; i < m_meshList.size(); i++){
+		if (m_meshList[i]->isInstanced()){
+			m_meshList[i]->drawInstances(*m_uniformBuffers, shaderBranch);
+		}
+	}
+}
+
+void OpenGLWin::beginOcclusionQueries()
+{
+	if (m_occlusionQueryToggle){
+		m_drawContext.occlusionQueries = m_occlusionQueries;
+		m_drawContext.viewProjection = m_projection * m_view;
+	}
+}
+
+void OpenGLWin::endOcclusionQueries()
+{
+	if (m_drawContext.occlusionQueries == NULL){
+		return;
+	}
+	m_drawContext.occlusionQueries = NULL;
+	//The depth buffer of the pass is finished, so the boxes are tested against everything drawn
+	m_occlusionQueries->issueQueries(*m_uniformBuffers);
 }
 
 void OpenGLWin::drawShapesScene()
 {
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 10);
+	m_uberShaderProgram->useMode(ForwardMode);
 
 	m_playerT->addChildNode(m_pointLight); //Point Light
 	m_root->update(m_view);
@@ -1660,6 +1842,7 @@ void OpenGLWin::drawShapesScene()
 
 	//Extracting the view frustum planes
 	m_frustum.extractFrustum(m_view, m_projection);
+	rasterizeOccluders();
 
 	//Init the counter for rendred objects to the amount of objects created
 	m_frustum.shapesRendered = m_shapesAddedToScene;
@@ -1668,8 +1851,15 @@ void OpenGLWin::drawShapesScene()
 	// Clear the screen
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_pointLight->draw(m_frustum, m_projection, m_view);
-	m_root->draw(m_frustum, m_projection, m_view, 10);
+	setFrameUniforms();
+	m_pointLight->draw(m_frustum, m_drawContext, m_projection, m_view);
+	beginOcclusionQueries();
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view, ForwardMode);
+	submitRenderQueue(ForwardMode);
+	//The shapes only gathered their model matrices. One draw call per shape mesh
+	drawInstancedMeshes(ForwardMode);
+	endOcclusionQueries();
 }
 
 void OpenGLWin::drawSolarSystemScene()
@@ -1693,7 +1883,7 @@ void OpenGLWin::drawSolarSystemScene()
 	m_moonT->rotate((5 * m_deltaTime / 100), 0, 1, 0);
 	m_moonT->rotate((40 * m_deltaTime / 100), 0, 1, 0, World);
 
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 10);
+	m_uberShaderProgram->useMode(ForwardMode);
 
 	//Update Scengraph
 	m_sunT->addChildNode(m_pointLight); //Sun Light
@@ -1702,6 +1892,7 @@ void OpenGLWin::drawSolarSystemScene()
 
 	//Extracting the view frustum planes
 	m_frustum.extractFrustum(m_view, m_projection);
+	rasterizeOccluders();
 
 	//Init the counter for rendred objects to the amount of objects created
 	m_frustum.shapesRendered = m_shapesAddedToScene;
@@ -1710,13 +1901,18 @@ void OpenGLWin::drawSolarSystemScene()
 	// Clear the screen
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_pointLight->draw(m_frustum, m_projection, m_view);
-	m_root->draw(m_frustum, m_projection, m_view, 10);
+	setFrameUniforms();
+	m_pointLight->draw(m_frustum, m_drawContext, m_projection, m_view);
+	beginOcclusionQueries();
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view, ForwardMode);
+	submitRenderQueue(ForwardMode);
+	endOcclusionQueries();
 }
 
 void OpenGLWin::drawSubdivisionScene()
 {
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 10);
+	m_uberShaderProgram->useMode(ForwardMode);
 
 	m_playerT->addChildNode(m_pointLight); //Point Light
 	m_root->update(m_view);
@@ -1724,6 +1920,7 @@ void OpenGLWin::drawSubdivisionScene()
 
 	//Extracting the view frustum planes
 	m_frustum.extractFrustum(m_view, m_projection);
+	rasterizeOccluders();
 
 	//Init the counter for rendred objects to the amount of objects created
 	m_frustum.shapesRendered = m_shapesAddedToScene;
@@ -1732,13 +1929,18 @@ void OpenGLWin::drawSubdivisionScene()
 	// Clear the screen
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_pointLight->draw(m_frustum, m_projection, m_view);
-	m_root->draw(m_frustum, m_projection, m_view, 10);
+	setFrameUniforms();
+	m_pointLight->draw(m_frustum, m_drawContext, m_projection, m_view);
+	beginOcclusionQueries();
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view, ForwardMode);
+	submitRenderQueue(ForwardMode);
+	endOcclusionQueries();
 }
 
 void OpenGLWin::shadowMapPass1()
 {
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 1);
+	m_uberShaderProgram->useMode(ShadowMapPass1Mode);
 
 	//Hang camera at light
 	m_playerT->removeChildNode(m_cameraList[0]);
@@ -1747,26 +1949,27 @@ void OpenGLWin::shadowMapPass1()
 	//Update model matrices of objects while finding the view matrix
 	m_root->update(lightView);
 
-	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_shadowMapFBO);
-	m_glFunctions->glViewport(0, 0, 1024, 1024);
+	m_shadowMapFilter->bindFramebuffer();
 	// Clear the buffer with the current clearing color
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_root->draw(m_frustum, m_projection, m_view, -1, lightView); //Shadow Pass 1
+	setFrameUniforms(lightView);
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view, -1, lightView); //Shadow Pass 1
+	submitRenderQueue(ShadowMapPass1Mode);
 }
 
 void OpenGLWin::shadowMapPass2()
 {
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 2); //Shadow Pass 2
+	m_uberShaderProgram->useMode(ShadowMapPass2Mode); //Shadow Pass 2
 
 	m_glFunctions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);	
 	m_glFunctions->glViewport(0, 0, m_width, m_height);
 	// Clear the screen
 	m_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	//Bind Shadowmap Texture to the texture unit the shadow sampler is associated to
-	m_glFunctions->glActiveTexture(GL_TEXTURE1);
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapTexture);
+	//Bind the filtered shadow map to the texture unit the shadow sampler is associated to
+	m_shadowMapFilter->bind();
 
 	//Hang camera on player
 	m_shadowMapPointLightT->removeChildNode(m_cameraList[0]);
@@ -1779,19 +1982,25 @@ void OpenGLWin::shadowMapPass2()
 
 	//Extracting the view frustum planes
 	m_frustum.extractFrustum(m_view, m_projection);
+	rasterizeOccluders();
 
 	//Init the counter for rendred objects to the amount of objects created
 	m_frustum.shapesRendered = m_shapesAddedToScene;
 
-	m_pointLight->draw(m_frustum, m_projection, m_view);
-	m_root->draw(m_frustum, m_projection, m_view, 2, lightView); //Shadow Pass 2
+	setFrameUniforms(lightView);
+	m_pointLight->draw(m_frustum, m_drawContext, m_projection, m_view);
+	beginOcclusionQueries();
+	beginRenderQueue();
+	m_root->draw(m_frustum, m_drawContext, m_projection, m_view, ShadowMapPass2Mode, lightView); //Shadow Pass 2
+	submitRenderQueue(ShadowMapPass2Mode);
+	endOcclusionQueries();
 
 	//////////////////////////////////////////////////////////////////////////
 	//Render a mesh where the light is
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 13);
+	m_uberShaderProgram->useMode(NoLightMode);
 
 	m_shadowMapPointLightT1->addChildNode(m_shadowMapPointLightM);
-	m_shadowMapPointLightT1->draw(m_frustum, m_projection, m_view, 13);
+	m_shadowMapPointLightT1->draw(m_frustum, m_drawContext, m_projection, m_view, NoLightMode);
 	m_shadowMapPointLightT1->removeChildNode(m_shadowMapPointLightM);
 }
 
@@ -1799,7 +2008,7 @@ void OpenGLWin::drawShadowmapTexture()
 {
 	//////////////////////////////////////////////////////////////////////////
 	//Quad render
-	m_glFunctions->glUniform1i(m_shaderModeLocation, 3); //Quad Pass
+	m_uberShaderProgram->useMode(ShadowMapQuadMode); //Quad Pass
 
 	//Enable Scissor box to only the clear the color buffer and depth buffer for it
 	m_glFunctions->glEnable(GL_SCISSOR_TEST);
@@ -1808,8 +2017,7 @@ void OpenGLWin::drawShadowmapTexture()
 	m_glFunctions->glDisable(GL_SCISSOR_TEST);
 	m_glFunctions->glViewport(0, 0, m_width *0.15, m_height*0.20);
 
-	m_glFunctions->glActiveTexture(GL_TEXTURE1);
-	m_glFunctions->glBindTexture(GL_TEXTURE_2D, m_shadowMapTexture);
+	m_shadowMapFilter->bind();
 
 	m_glFunctions->glBindVertexArray(m_quadVAO);
 	m_glFunctions->glDrawArrays(GL_TRIANGLES, 0, 6); // 2*3 indices starting at 0 -> 2 triangles
@@ -6,7 +6,7 @@
 
 //OpenGL
 #include <QtOpenGL/QGLWidget>
-#include <QOpenGLFunctions_3_3_Core>
+#include "GLStateCache.h"
 #include <QOpenGLDebugLogger>
 
 //Nodes
@@ -31,8 +31,13 @@
 
 //For time seed
 #include <ctime>
+//Cells grouping the random shapes
+#include <map>
 
 #include "ViewFrustumCheck.h"
+#include "TiledLightCulling.h"
+#include "LightVolumeBatch.h"
+#include "ShadowMapFilter.h"
 
 /// <remarks>
 ///Used by setSceneType function to set the render window to a specific scene type
@@ -169,21 +174,6 @@ private slots:
 private:
 	Ui::OpenGLWinClass ui;
 
-	//Handles for shader uniforms
-	GLuint m_shaderModeLocation; //Uniform to select a shader branch from the uber-shader
-	GLuint m_textureSamplerLocation;
-	GLuint m_shadowMapSamplerLocation;
-	GLuint m_scaleUniform;
-	GLuint m_screenSizeLocation;
-	GLuint m_fragmentViewMatrixLocation;
-	GLuint m_maxLightRadiusLocation;
-
-	//G-Buffer sampler handles
-	GLuint m_diffuseSamplerLocation;
-	GLuint m_positionSamplerLocation;
-	GLuint m_normalsSamplerLocation;
-
-
 	//FBO and its Textures for Deferred Shading
 	GLuint m_deferredShadingFBO;
 	GLuint m_deferredShadingDepthTexture; //For depth and stencil
@@ -198,23 +188,41 @@ private:
 	GLuint m_quadVAO;
 	GLuint m_quadVBO;
 
-	//Shadow map FBOs
-	GLuint m_shadowMapFBO;
-	GLuint m_shadowMapBlurFBO;
-
-	//Shadowmap Textures and depth buffer
-	GLuint m_shadowMapTexture;
-	GLuint m_shadowMapBlurTexture;
-	GLuint m_shadowmapDepthBuffer; //need to bind a buffer to the depth attachment of fbo. Or no shadows.
-
 	//Holds the 6 planes representing the view frustum. Has fuctions to extract the planes and test sphere to plane intersection
 	ViewFrustumCheck m_frustum;
+	//State of the pass being drawn, passed down the scene graph next to the frustum
+	DrawContext m_drawContext;
+	//Low resolution depth of the occluders seen from the camera. Meshes hidden behind them are not drawn
+	OcclusionBuffer m_occlusionBuffer;
+	//Meshes rasterized into the occlusion buffer and the transforms giving their model matrices
+	std::vector<Mesh*> m_occluderMeshList;
+	std::vector<Transform*> m_occluderTransformList;
+	//Hardware occlusion queries of the meshes seen from the camera. Meshes whose box was hidden in the latest finished query are not drawn
+	OcclusionQueries* m_occlusionQueries;
+	//Collects the draws of a pass and submits them sorted by state or front to back
+	RenderQueue* m_renderQueue;
+	//FrameBlock and ObjectBlock ring buffer of the uber-shader
+	UniformBuffers* m_uniformBuffers;
+	//Screen tiles with the lights of the deferred shading scene touching them, used by the tiled light pass
+	TiledLightCulling* m_tiledLightCulling;
+	//Light volumes of the deferred shading scene drawn with one instanced draw, used by the light volume pass
+	LightVolumeBatch* m_lightVolumes;
+	//Variance shadow map of the shadow map scene and the passes which blur it
+	ShadowMapFilter* m_shadowMapFilter;
 
 	//Flags to help decide arguments for Functions which toggles on/off features
 	bool m_wireframeToggle;
 	bool m_frustumCheckToggle;
 	bool m_wireframeBVToggle;
 	bool m_originalMeshHEToggle;
+	bool m_occlusionCullingToggle;
+	bool m_occlusionQueryToggle;
+	bool m_compactGBufferToggle;
+	//Layout the G-Buffer textures are allocated with. Reallocated when it differs from m_compactGBufferToggle
+	bool m_isCompactGBuffer;
+	bool m_tiledLightingToggle;
+	//Set by a key, the next frame of the shadow map scene times every filter option
+	bool m_shadowFilterBenchmark;
 
 	//Flag to keep track if the render window is in focus to prevent the input to lock and player automatically moves
 	bool m_isFocus;
@@ -249,7 +257,7 @@ private:
 
 	///////////////////////////////////
 	//Used to call native openGL functions
-	QOpenGLFunctions_3_3_Core* m_glFunctions;
+	GLStateCache* m_glFunctions;
 
 	//Stores keys pressed by user - to bypass Qt's event listeners
 	QSet<Qt::Key> m_keysPressed;
@@ -388,6 +396,10 @@ private:
 
 	//Holds the Transforms so they call be deallocated easier
 	std::vector<Transform*> m_transformList;
+	//Transforms grouping the shapes of the shapes scene by position. Culling a cell's merged bounding sphere culls all its shapes with one test
+	std::map<unsigned int, Transform*> m_shapeCells;
+	//The cell each shape in m_transformList was added to
+	std::vector<Transform*> m_shapeCellList;
 	//Holds the Meshes so they call be deallocated easier
 	std::vector<Mesh*> m_meshList;
 
@@ -457,13 +469,9 @@ private:
 	/// <summary>Renderes the skybox(Should be called last in rendering pipeline because it's relies on the Depth Test)</summary>
 	/// <returns>void</returns>
 	void drawSkybox();
-	/// <summary>Sets up FBOs for shadow map</summary>
+	/// <summary>Sets up the fullscreen quad and the render targets of the shadow map</summary>
 	/// <returns>void</returns>
 	void initShadowMap();
-	/// <summary>Blurs the shadow map(Should be called after shadow pass 1)</summary>
-	/// <param name="pass">The amount of blur iterations</param>
-	/// <returns>void</returns>
-	void blurShadowmap(int pass);
 	/// <summary>Sets up FBO for deferred shading</summary>
 	/// <returns>void</returns>
 	void initDeferredShading();
@@ -472,6 +480,12 @@ private:
 	/// <param name="height">height</param>
 	/// <returns>void</returns>
 	void updateDeferredShadingTextures(float width, float height);
+	/// <summary>Allocates the G-Buffer textures with the layout of m_compactGBufferToggle and attaches them to the deferred shading FBO, which is left bound.
+	///The full layout has RGB32F diffuse, position and normals. The compact one has RGBA8 albedo and specular, RG16 octahedral normals and no position</summary>
+	/// <param name="width">width</param>
+	/// <param name="height">height</param>
+	/// <returns>void</returns>
+	void allocateGBufferTextures(float width, float height);
 
 	/// <summary>Creates a Light and a Light Mesh for deferred shading. Mesh is scaled and the scale factor is saved in the Light as max light radius</summary>
 	/// <param name="x">Translate in X</param>
@@ -487,9 +501,12 @@ private:
 	/// <summary>Deferred Shading: Geometry Pass, Render mesh information to textures</summary>
 	/// <returns>void</returns>
 	void dsGeometryPass();
-	/// <summary>Deferred Shading: Stencil and Light pass, Renders only the pixels that should be lit. This is repeated for each light</summary>
+	/// <summary>Deferred Shading: Light Volume pass, Renders the back faces of all light volumes with one instanced draw and adds their light to the pixels they cover</summary>
+	/// <returns>void</returns>
+	void dsLightVolumePass();
+	/// <summary>Deferred Shading: Tiled Light pass, Bins the lights into screen tiles and lights every pixel with the lights of its tile in one fullscreen pass</summary>
 	/// <returns>void</returns>
-	void dsStencilAndLightPass();
+	void dsTiledLightPass();
 	/// <summary>Deferred Shading: Render scene with ambient light. It is blended with the light meshes</summary>
 	/// <returns>void</returns>
 	void dsDrawSceneWithAmbientLight();
@@ -500,6 +517,38 @@ private:
 	/// <returns>void</returns>
 	void dsDrawGBufferTextures();
 
+	/// <summary>Returns the transform of the cell a position is in. The cell is created and attached to the root if it doesn't exist</summary>
+	/// <param name="x">X position</param>
+	/// <param name="y">Y position</param>
+	/// <param name="z">Z position</param>
+	/// <returns>Transform*</returns>
+	Transform* getShapeCell(int x, int y, int z);
+
+	/// <summary>Rasterizes the occluders seen from the camera and lets the meshes test against them. Call after the frustum planes are extracted</summary>
+	/// <returns>void</returns>
+	void rasterizeOccluders();
+	/// <summary>Lets the meshes drawn until endOcclusionQueries skip their draw with the query results, if occlusion queries are toggled on</summary>
+	/// <returns>void</returns>
+	void beginOcclusionQueries();
+	/// <summary>Stops using the query results and draws the boxes queued by the meshes with a query each. Call right after the pass has been drawn</summary>
+	/// <returns>void</returns>
+	void endOcclusionQueries();
+	/// <summary>Draws the occurrences the instanced meshes gathered in the pass with one draw call per mesh. Call after the scenegraph has been drawn</summary>
+	/// <param name="shaderBranch">ID of the shader branch the pass uses</param>
+	/// <returns>void</returns>
+	void drawInstancedMeshes(int shaderBranch);
+	/// <summary>Lets the meshes drawn until submitRenderQueue add their draws to the render queue</summary>
+	/// <returns>void</returns>
+	void beginRenderQueue();
+	/// <summary>Sorts and draws the packets the meshes added since beginRenderQueue</summary>
+	/// <param name="shaderMode">Shader branch the pass uses</param>
+	/// <returns>void</returns>
+	void submitRenderQueue(int shaderMode);
+	/// <summary>Uploads the FrameBlock with the camera's projection and view matrix. Call at the start of each pass, after the scenegraph has been updated</summary>
+	/// <param name="lightView">Light's Camera view Matrix. Only used in shadow map</param>
+	/// <returns>void</returns>
+	void setFrameUniforms(const Matrix44& lightView = Matrix44());
+
 	/// <summary>Renders the shapes Scene</summary>
 	/// <returns>void</returns>
 	void drawShapesScene();
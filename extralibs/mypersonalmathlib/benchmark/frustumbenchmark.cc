@@ -0,0 +1,138 @@
+//Compares the SIMD and scalar batch frustum tests
+//Build with -DMYPERSONALMATHLIB_BENCHMARK=ON and run frustumbenchmark
+
+#include "../frustumkernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//Amount of objects and how many times the whole list is tested
+const int ObjectCount = 100000;
+const int Repetitions = 200;
+
+typedef void(*SphereFunction)(const FrustumKernels::SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+	unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+typedef void(*BoxFunction)(const FrustumKernels::SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+	const float* maxX, const float* maxY, const float* maxZ, unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+
+struct Objects
+{
+	std::vector<float> x, y, z, radius;
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+};
+
+static float randomRange(float low, float high)
+{
+	return low + rand() / (float)RAND_MAX * (high - low);
+}
+
+//Planes of a symmetric perspective frustum looking down -z, normalized and pointing inwards
+static void perspectivePlanes(float fovY, float aspect, float nearPlane, float farPlane, float planes[6][4])
+{
+	float tanY = tanf(fovY * 0.5f);
+	float tanX = tanY * aspect;
+	float lengthX = sqrtf(1 + tanX * tanX);
+	float lengthY = sqrtf(1 + tanY * tanY);
+	float values[6][4] = {
+		{ 1 / lengthX, 0, -tanX / lengthX, 0 },
+		{ -1 / lengthX, 0, -tanX / lengthX, 0 },
+		{ 0, 1 / lengthY, -tanY / lengthY, 0 },
+		{ 0, -1 / lengthY, -tanY / lengthY, 0 },
+		{ 0, 0, -1, -nearPlane },
+		{ 0, 0, 1, farPlane } };
+	for (int p = 0; p < 6; p++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			planes[p][k] = values[p][k];
+		}
+	}
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static double benchSpheres(SphereFunction test, const FrustumKernels::SwizzledPlanes& planes, const Objects& objects, std::vector<unsigned int>& visible, std::vector<unsigned char>& planeMasks)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < Repetitions; r++)
+	{
+		test(planes, FrustumKernels::AllPlanes, &objects.x[0], &objects.y[0], &objects.z[0], &objects.radius[0], ObjectCount, &visible[0], &planeMasks[0]);
+	}
+	return elapsedMs(start) / Repetitions;
+}
+
+static double benchBoxes(BoxFunction test, const FrustumKernels::SwizzledPlanes& planes, const Objects& objects, std::vector<unsigned int>& visible, std::vector<unsigned char>& planeMasks)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < Repetitions; r++)
+	{
+		test(planes, FrustumKernels::AllPlanes, &objects.minX[0], &objects.minY[0], &objects.minZ[0], &objects.maxX[0], &objects.maxY[0], &objects.maxZ[0],
+			ObjectCount, &visible[0], &planeMasks[0]);
+	}
+	return elapsedMs(start) / Repetitions;
+}
+
+static int countVisible(const std::vector<unsigned int>& visible)
+{
+	int count = 0;
+	for (int i = 0; i < ObjectCount; i++)
+	{
+		count += (visible[i / 32] >> (i % 32)) & 1;
+	}
+	return count;
+}
+
+static void report(const char* name, double scalarMs, double simdMs, int visibleCount, bool isSame)
+{
+	printf("%-8s scalar %7.3f ms  simd %7.3f ms  speedup %5.2fx  visible %6d  %s\n", name, scalarMs, simdMs, scalarMs / simdMs, visibleCount, isSame ? "same result" : "DIFFERENT RESULT");
+}
+
+int main()
+{
+	srand(1);
+	Objects objects;
+	for (int i = 0; i < ObjectCount; i++)
+	{
+		float x = randomRange(-500, 500);
+		float y = randomRange(-50, 50);
+		float z = randomRange(-500, 500);
+		float size = randomRange(0.5f, 5);
+		objects.x.push_back(x);
+		objects.y.push_back(y);
+		objects.z.push_back(z);
+		objects.radius.push_back(size * 1.7320508f);
+		objects.minX.push_back(x - size);
+		objects.minY.push_back(y - size);
+		objects.minZ.push_back(z - size);
+		objects.maxX.push_back(x + size);
+		objects.maxY.push_back(y + size);
+		objects.maxZ.push_back(z + size);
+	}
+
+	float planes[6][4];
+	perspectivePlanes(1.0471976f, 16.0f / 9.0f, 0.1f, 300, planes);
+	FrustumKernels::SwizzledPlanes swizzledPlanes;
+	FrustumKernels::SwizzlePlanes(planes, swizzledPlanes);
+
+	int words = (ObjectCount + 31) / 32;
+	std::vector<unsigned int> scalarVisible(words), simdVisible(words);
+	std::vector<unsigned char> scalarMasks(ObjectCount), simdMasks(ObjectCount);
+
+	printf("%d objects, average of %d runs, SIMD tests use %s\n", ObjectCount, Repetitions, FrustumKernels::InstructionSet());
+
+	double scalarMs = benchSpheres(FrustumKernels::TestSpheresScalar, swizzledPlanes, objects, scalarVisible, scalarMasks);
+	double simdMs = benchSpheres(FrustumKernels::TestSpheres, swizzledPlanes, objects, simdVisible, simdMasks);
+	report("Spheres", scalarMs, simdMs, countVisible(simdVisible), scalarVisible == simdVisible && scalarMasks == simdMasks);
+
+	scalarMs = benchBoxes(FrustumKernels::TestBoxesScalar, swizzledPlanes, objects, scalarVisible, scalarMasks);
+	simdMs = benchBoxes(FrustumKernels::TestBoxes, swizzledPlanes, objects, simdVisible, simdMasks);
+	report("Boxes", scalarMs, simdMs, countVisible(simdVisible), scalarVisible == simdVisible && scalarMasks == simdMasks);
+
+	return 0;
+}
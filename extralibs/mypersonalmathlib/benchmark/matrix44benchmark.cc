@@ -0,0 +1,165 @@
+//Compares the SIMD and scalar Matrix44 kernels
+//Build with -DMYPERSONALMATHLIB_BENCHMARK=ON and run matrix44benchmark
+
+#include "../matrix44kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//Amount of matrices and how many times the whole list is processed
+const int MatrixCount = 4096;
+const int Repetitions = 2000;
+//Scalar and SIMD take turns this many times and the fastest time of each is kept, so the one measured first isn't slowed down by a cold cache or clock
+const int Rounds = 5;
+
+typedef void(*MultiplyFunction)(const float a[4][4], const float b[4][4], float out[4][4]);
+typedef void(*MultiplyVectorFunction)(const float m[4][4], const float v[4], float out[4]);
+typedef bool(*AffineInverseFunction)(const float m[4][4], float out[4][4]);
+
+struct Matrix
+{
+	float m[4][4];
+};
+
+//Random affine matrix. The diagonal is larger than the rest of the row so it always has a well behaved inverse
+static void randomAffine(Matrix& matrix)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			matrix.m[i][j] = rand() / (float)RAND_MAX * 2 - 1;
+		}
+		matrix.m[i][i] += 3;
+	}
+	matrix.m[3][0] = 0;
+	matrix.m[3][1] = 0;
+	matrix.m[3][2] = 0;
+	matrix.m[3][3] = 1;
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//Multiplies each matrix with the previous result like parent*local in a scene graph
+static double benchMultiply(MultiplyFunction multiply, const std::vector<Matrix>& input, std::vector<Matrix>& output)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < Repetitions; r++)
+	{
+		output[0] = input[0];
+		for (int i = 1; i < MatrixCount; i++)
+		{
+			multiply(output[i - 1].m, input[i].m, output[i].m);
+		}
+	}
+	return elapsedMs(start);
+}
+
+static double benchMultiplyVector(MultiplyVectorFunction multiplyVector, const std::vector<Matrix>& input, std::vector<float>& output)
+{
+	float v[4] = { 1, 2, 3, 1 };
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < Repetitions; r++)
+	{
+		for (int i = 0; i < MatrixCount; i++)
+		{
+			multiplyVector(input[i].m, v, &output[4 * i]);
+		}
+	}
+	return elapsedMs(start);
+}
+
+static double benchAffineInverse(AffineInverseFunction affineInverse, const std::vector<Matrix>& input, std::vector<Matrix>& output)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < Repetitions; r++)
+	{
+		for (int i = 0; i < MatrixCount; i++)
+		{
+			affineInverse(input[i].m, output[i].m);
+		}
+	}
+	return elapsedMs(start);
+}
+
+//Largest difference relative to the size of the values
+static float maxError(const float* a, const float* b, int count)
+{
+	float error = 0;
+	for (int i = 0; i < count; i++)
+	{
+		float difference = a[i] - b[i];
+		float size = a[i] < 0 ? -a[i] : a[i];
+		difference = difference < 0 ? -difference : difference;
+		difference /= size > 1 ? size : 1;
+		error = difference > error ? difference : error;
+	}
+	return error;
+}
+
+static void keepFastest(double& best, double ms)
+{
+	best = best < 0 || ms < best ? ms : best;
+}
+
+static void report(const char* name, double scalarMs, double simdMs, float error)
+{
+	printf("%-14s scalar %8.2f ms  simd %8.2f ms  speedup %5.2fx  max error %g\n", name, scalarMs, simdMs, scalarMs / simdMs, error);
+}
+
+int main()
+{
+	srand(1);
+	std::vector<Matrix> input(MatrixCount);
+	for (int i = 0; i < MatrixCount; i++)
+	{
+		randomAffine(input[i]);
+	}
+
+	std::vector<Matrix> scalarOutput(MatrixCount);
+	std::vector<Matrix> simdOutput(MatrixCount);
+	std::vector<float> scalarVectors(4 * MatrixCount);
+	std::vector<float> simdVectors(4 * MatrixCount);
+
+	printf("%d matrices x %d repetitions, fastest of %d rounds, SIMD kernels use %s\n", MatrixCount, Repetitions, Rounds, Matrix44Kernels::InstructionSet());
+
+	//The multiply chain is only compared on the first matrices since errors grow along the chain
+	double scalarMs = -1;
+	double simdMs = -1;
+	for (int round = 0; round < Rounds; round++)
+	{
+		keepFastest(scalarMs, benchMultiply(Matrix44Kernels::MultiplyScalar, input, scalarOutput));
+		keepFastest(simdMs, benchMultiply(Matrix44Kernels::Multiply, input, simdOutput));
+	}
+	for (int i = 1; i < MatrixCount; i++)
+	{
+		Matrix44Kernels::MultiplyScalar(input[i - 1].m, input[i].m, scalarOutput[i].m);
+		Matrix44Kernels::Multiply(input[i - 1].m, input[i].m, simdOutput[i].m);
+	}
+	report("Multiply", scalarMs, simdMs, maxError(&scalarOutput[1].m[0][0], &simdOutput[1].m[0][0], 16 * (MatrixCount - 1)));
+
+	scalarMs = -1;
+	simdMs = -1;
+	for (int round = 0; round < Rounds; round++)
+	{
+		keepFastest(scalarMs, benchMultiplyVector(Matrix44Kernels::MultiplyVectorScalar, input, scalarVectors));
+		keepFastest(simdMs, benchMultiplyVector(Matrix44Kernels::MultiplyVector, input, simdVectors));
+	}
+	report("MultiplyVector", scalarMs, simdMs, maxError(&scalarVectors[0], &simdVectors[0], 4 * MatrixCount));
+
+	scalarMs = -1;
+	simdMs = -1;
+	for (int round = 0; round < Rounds; round++)
+	{
+		keepFastest(scalarMs, benchAffineInverse(Matrix44Kernels::AffineInverseScalar, input, scalarOutput));
+		keepFastest(simdMs, benchAffineInverse(Matrix44Kernels::AffineInverse, input, simdOutput));
+	}
+	report("AffineInverse", scalarMs, simdMs, maxError(&scalarOutput[0].m[0][0], &simdOutput[0].m[0][0], 16 * MatrixCount));
+
+	return 0;
+}
@@ -0,0 +1,333 @@
+#include "frustumkernels.h"
+#include "simd4.h"
+
+#include <math.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+/**
+	One object at a time. Used by the Scalar functions and for the objects left after the vector loop
+*/
+struct ScalarLanes
+{
+	typedef float Float;
+	static const unsigned int Width = 1;
+
+	static Float Load(const float* p) { return *p; }
+	static Float Zero() { return 0; }
+	static Float Add(Float a, Float b) { return a + b; }
+	static Float Sub(Float a, Float b) { return a - b; }
+	static Float Mul(Float a, Float b) { return a * b; }
+	static unsigned int LessEqual(Float a, Float b) { return a <= b; }
+	static unsigned int Greater(Float a, Float b) { return a > b; }
+};
+
+#if defined(MYPERSONALMATHLIB_SSE) || defined(MYPERSONALMATHLIB_NEON)
+//------------------------------------------------------------------------------
+/**
+	4 objects at a time with SSE or NEON
+*/
+struct Simd4Lanes
+{
+	typedef Simd4::Float4 Float;
+	static const unsigned int Width = 4;
+
+	static Float Load(const float* p) { return Simd4::Load(p); }
+	static Float Zero() { return Simd4::Splat(0); }
+	static Float Add(Float a, Float b) { return Simd4::Add(a, b); }
+	static Float Sub(Float a, Float b) { return Simd4::Sub(a, b); }
+	static Float Mul(Float a, Float b) { return Simd4::Mul(a, b); }
+	static unsigned int LessEqual(Float a, Float b) { return Simd4::LessEqual(a, b); }
+	static unsigned int Greater(Float a, Float b) { return Simd4::Greater(a, b); }
+};
+#endif
+
+#if defined(MYPERSONALMATHLIB_AVX)
+//------------------------------------------------------------------------------
+/**
+	8 objects at a time with AVX
+*/
+struct AvxLanes
+{
+	typedef __m256 Float;
+	static const unsigned int Width = 8;
+
+	static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+	static Float Zero() { return _mm256_setzero_ps(); }
+	static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static unsigned int LessEqual(Float a, Float b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+	static unsigned int Greater(Float a, Float b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+};
+#endif
+
+#if defined(MYPERSONALMATHLIB_AVX512)
+//------------------------------------------------------------------------------
+/**
+	16 objects at a time with AVX-512
+*/
+struct Avx512Lanes
+{
+	typedef __m512 Float;
+	static const unsigned int Width = 16;
+
+	static Float Load(const float* p) { return _mm512_loadu_ps(p); }
+	static Float Zero() { return _mm512_setzero_ps(); }
+	static Float Add(Float a, Float b) { return _mm512_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+	static unsigned int LessEqual(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+	static unsigned int Greater(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+};
+#endif
+
+//------------------------------------------------------------------------------
+/**
+	Writes the planes each of the Width objects intersects. Objects outside get 0, which planes they were tested against depends on the other lanes
+*/
+template <class Lanes>
+static void WritePlaneMasks(unsigned int outside, const unsigned int intersecting[6], unsigned char* planeMasks)
+{
+	for (unsigned int lane = 0; lane < Lanes::Width; lane++)
+	{
+		unsigned int mask = 0;
+		if (!(outside & (1 << lane))){
+			for (int p = 0; p < 6; p++)
+			{
+				mask |= ((intersecting[p] >> lane) & 1) << p;
+			}
+		}
+		planeMasks[lane] = (unsigned char)mask;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+	Tests Width objects with the given centers and radii along the plane normals.
+	Returns a bit for each object which isn't completely outside any plane. Writes the planes each object intersects to planeMasks
+*/
+template <class Lanes>
+static unsigned int TestBlock(const FrustumKernels::SwizzledPlanes& planes, unsigned int planeMask,
+	typename Lanes::Float x, typename Lanes::Float y, typename Lanes::Float z, typename Lanes::Float radius, unsigned char* planeMasks)
+{
+	const unsigned int allLanes = (1u << Lanes::Width) - 1;
+	typename Lanes::Float negativeRadius = Lanes::Sub(Lanes::Zero(), radius);
+
+	unsigned int outside = 0;
+	unsigned int intersecting[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int p = 0; p < 6; p++)
+	{
+		if (!(planeMask & (1 << p))){
+			continue;
+		}
+
+		//Same order of operations as the scalar test so all instruction sets give the same result
+		typename Lanes::Float distance = Lanes::Mul(Lanes::Load(planes.coefficients[p][0]), x);
+		distance = Lanes::Add(distance, Lanes::Mul(Lanes::Load(planes.coefficients[p][1]), y));
+		distance = Lanes::Add(distance, Lanes::Mul(Lanes::Load(planes.coefficients[p][2]), z));
+		distance = Lanes::Add(distance, Lanes::Load(planes.coefficients[p][3]));
+
+		outside |= Lanes::LessEqual(distance, negativeRadius);
+		intersecting[p] = allLanes & ~Lanes::Greater(distance, radius);
+
+		//No object left to test
+		if (outside == allLanes){
+			break;
+		}
+	}
+
+	if (planeMasks != NULL){
+		WritePlaneMasks<Lanes>(outside, intersecting, planeMasks);
+	}
+	return allLanes & ~outside;
+}
+
+//------------------------------------------------------------------------------
+/**
+	Tests the spheres in [begin, end) Width at a time. Returns where it stopped
+*/
+template <class Lanes>
+static unsigned int TestSpheresRange(const FrustumKernels::SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+	unsigned int begin, unsigned int end, unsigned int* visible, unsigned char* planeMasks)
+{
+	unsigned int i = begin;
+	for (; i + Lanes::Width <= end; i += Lanes::Width)
+	{
+		unsigned int bits = TestBlock<Lanes>(planes, planeMask, Lanes::Load(x + i), Lanes::Load(y + i), Lanes::Load(z + i), Lanes::Load(radius + i),
+			planeMasks != NULL ? planeMasks + i : NULL);
+		//Width divides 32 and i is a multiple of Width, so the bits never cross a word
+		visible[i / 32] |= bits << (i % 32);
+	}
+	return i;
+}
+
+//------------------------------------------------------------------------------
+/**
+	Tests the boxes in [begin, end) Width at a time as spheres along each plane normal. Returns where it stopped
+*/
+template <class Lanes>
+static unsigned int TestBoxesRange(const FrustumKernels::SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+	const float* maxX, const float* maxY, const float* maxZ, unsigned int begin, unsigned int end, unsigned int* visible, unsigned char* planeMasks)
+{
+	typedef typename Lanes::Float Float;
+	const Float zero = Lanes::Zero();
+	const float halfValue[16] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+	const Float half = Lanes::Load(halfValue);
+
+	unsigned int i = begin;
+	for (; i + Lanes::Width <= end; i += Lanes::Width)
+	{
+		Float lowX = Lanes::Load(minX + i);
+		Float lowY = Lanes::Load(minY + i);
+		Float lowZ = Lanes::Load(minZ + i);
+		Float highX = Lanes::Load(maxX + i);
+		Float highY = Lanes::Load(maxY + i);
+		Float highZ = Lanes::Load(maxZ + i);
+
+		Float centerX = Lanes::Mul(Lanes::Add(lowX, highX), half);
+		Float centerY = Lanes::Mul(Lanes::Add(lowY, highY), half);
+		Float centerZ = Lanes::Mul(Lanes::Add(lowZ, highZ), half);
+		Float extentX = Lanes::Mul(Lanes::Sub(highX, lowX), half);
+		Float extentY = Lanes::Mul(Lanes::Sub(highY, lowY), half);
+		Float extentZ = Lanes::Mul(Lanes::Sub(highZ, lowZ), half);
+
+		//The radius of a box depends on the plane, so each plane is tested on its own
+		const unsigned int allLanes = (1u << Lanes::Width) - 1;
+		unsigned int outside = 0;
+		unsigned int intersecting[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int p = 0; p < 6; p++)
+		{
+			if (!(planeMask & (1 << p))){
+				continue;
+			}
+
+			Float distance = Lanes::Mul(Lanes::Load(planes.coefficients[p][0]), centerX);
+			distance = Lanes::Add(distance, Lanes::Mul(Lanes::Load(planes.coefficients[p][1]), centerY));
+			distance = Lanes::Add(distance, Lanes::Mul(Lanes::Load(planes.coefficients[p][2]), centerZ));
+			distance = Lanes::Add(distance, Lanes::Load(planes.coefficients[p][3]));
+
+			Float radius = Lanes::Mul(Lanes::Load(planes.absolute[p][0]), extentX);
+			radius = Lanes::Add(radius, Lanes::Mul(Lanes::Load(planes.absolute[p][1]), extentY));
+			radius = Lanes::Add(radius, Lanes::Mul(Lanes::Load(planes.absolute[p][2]), extentZ));
+
+			outside |= Lanes::LessEqual(distance, Lanes::Sub(zero, radius));
+			intersecting[p] = allLanes & ~Lanes::Greater(distance, radius);
+
+			if (outside == allLanes){
+				break;
+			}
+		}
+
+		if (planeMasks != NULL){
+			WritePlaneMasks<Lanes>(outside, intersecting, planeMasks + i);
+		}
+		visible[i / 32] |= (allLanes & ~outside) << (i % 32);
+	}
+	return i;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void ClearBits(unsigned int* visible, unsigned int count)
+{
+	memset(visible, 0, ((count + 31) / 32) * sizeof(unsigned int));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void FrustumKernels::SwizzlePlanes(const float planes[6][4], SwizzledPlanes& out)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		for (int lane = 0; lane < 16; lane++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				out.coefficients[p][k][lane] = planes[p][k];
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				out.absolute[p][k][lane] = fabsf(planes[p][k]);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void FrustumKernels::TestSpheres(const SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+	unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	ClearBits(visible, count);
+	unsigned int i = 0;
+#if defined(MYPERSONALMATHLIB_AVX512)
+	i = TestSpheresRange<Avx512Lanes>(planes, planeMask, x, y, z, radius, i, count, visible, planeMasks);
+#elif defined(MYPERSONALMATHLIB_AVX)
+	i = TestSpheresRange<AvxLanes>(planes, planeMask, x, y, z, radius, i, count, visible, planeMasks);
+#endif
+#if defined(MYPERSONALMATHLIB_SSE) || defined(MYPERSONALMATHLIB_NEON)
+	i = TestSpheresRange<Simd4Lanes>(planes, planeMask, x, y, z, radius, i, count, visible, planeMasks);
+#endif
+	TestSpheresRange<ScalarLanes>(planes, planeMask, x, y, z, radius, i, count, visible, planeMasks);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void FrustumKernels::TestBoxes(const SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+	const float* maxX, const float* maxY, const float* maxZ, unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	ClearBits(visible, count);
+	unsigned int i = 0;
+#if defined(MYPERSONALMATHLIB_AVX512)
+	i = TestBoxesRange<Avx512Lanes>(planes, planeMask, minX, minY, minZ, maxX, maxY, maxZ, i, count, visible, planeMasks);
+#elif defined(MYPERSONALMATHLIB_AVX)
+	i = TestBoxesRange<AvxLanes>(planes, planeMask, minX, minY, minZ, maxX, maxY, maxZ, i, count, visible, planeMasks);
+#endif
+#if defined(MYPERSONALMATHLIB_SSE) || defined(MYPERSONALMATHLIB_NEON)
+	i = TestBoxesRange<Simd4Lanes>(planes, planeMask, minX, minY, minZ, maxX, maxY, maxZ, i, count, visible, planeMasks);
+#endif
+	TestBoxesRange<ScalarLanes>(planes, planeMask, minX, minY, minZ, maxX, maxY, maxZ, i, count, visible, planeMasks);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void FrustumKernels::TestSpheresScalar(const SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+	unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	ClearBits(visible, count);
+	TestSpheresRange<ScalarLanes>(planes, planeMask, x, y, z, radius, 0, count, visible, planeMasks);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void FrustumKernels::TestBoxesScalar(const SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+	const float* maxX, const float* maxY, const float* maxZ, unsigned int count, unsigned int* visible, unsigned char* planeMasks)
+{
+	ClearBits(visible, count);
+	TestBoxesRange<ScalarLanes>(planes, planeMask, minX, minY, minZ, maxX, maxY, maxZ, 0, count, visible, planeMasks);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+const char* FrustumKernels::InstructionSet()
+{
+#if defined(MYPERSONALMATHLIB_AVX512)
+	return "AVX-512";
+#elif defined(MYPERSONALMATHLIB_AVX)
+	return "AVX";
+#elif defined(MYPERSONALMATHLIB_SSE)
+	return "SSE";
+#elif defined(MYPERSONALMATHLIB_NEON)
+	return "NEON";
+#else
+	return "Scalar";
+#endif
+}
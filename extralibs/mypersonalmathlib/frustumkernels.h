@@ -0,0 +1,50 @@
+#ifndef frustumkernels_h__
+#define frustumkernels_h__
+
+/**
+@namespace FrustumKernels
+
+Tests many bounding spheres or boxes against the 6 planes of a view frustum at once.
+The objects are stored as separate arrays for each coordinate. The planes are swizzled once per frame
+so each plane coefficient fills a whole vector, and 16, 8 or 4 objects are tested per instruction with AVX-512, AVX or SSE/NEON.
+The Scalar functions always use plain floats and give the same results.
+A plane is a, b, c, d where a*x + b*y + c*z + d is the signed distance to the plane, positive inside the frustum.
+*/
+namespace FrustumKernels
+{
+	/// Bit for each of the 6 planes
+	const unsigned int AllPlanes = 0x3F;
+
+	/// The planes with each coefficient repeated in 16 lanes, so a vector of any width is loaded directly
+	struct SwizzledPlanes
+	{
+		//a, b, c, d of each plane
+		float coefficients[6][4][16];
+		//|a|, |b|, |c| of each plane. Used to get the radius of a box along the plane normal
+		float absolute[6][3][16];
+	};
+
+	/// Swizzles 6 planes for the batch tests. Call it once each time the planes change
+	void SwizzlePlanes(const float planes[6][4], SwizzledPlanes& out);
+
+	/// Tests count spheres against the planes in planeMask.
+	/// Bit i of visible (visible[i / 32], bit i % 32) is set if sphere i is partially or completely inside. visible needs (count + 31) / 32 words.
+	/// If planeMasks isn't NULL it receives for each sphere the planes of planeMask it intersects, so the objects inside the sphere only have to test those. It is 0 for spheres outside
+	void TestSpheres(const SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+		unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+	/// Tests count axis aligned boxes against the planes in planeMask. Same output as TestSpheres
+	void TestBoxes(const SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+
+	/// Tests count spheres one at a time
+	void TestSpheresScalar(const SwizzledPlanes& planes, unsigned int planeMask, const float* x, const float* y, const float* z, const float* radius,
+		unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+	/// Tests count axis aligned boxes one at a time
+	void TestBoxesScalar(const SwizzledPlanes& planes, unsigned int planeMask, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, unsigned int count, unsigned int* visible, unsigned char* planeMasks);
+
+	/// Returns the name of the instruction set the plain functions use
+	const char* InstructionSet();
+}
+
+#endif // frustumkernels_h__
@@ -150,30 +150,8 @@ ostream& operator<<(ostream &out, const Matrix44& m)
 */
 void Matrix44::operator*=(const Matrix44& m)
 {
-	//Temporary save the left matrix
-	Matrix44 temp = *this;
-
-	//Reset the values of the left matrix to 0
-	for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			matrix[i][j] = 0;	
-		}
-	}
-
-	//Multiplies each component of the left matrix row with each component of the right matrix column
-	//Each multiplication is added to the index of the result matrix.
-	for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			for (int k = 0; k < 4; k++)
-			{
-				matrix[i][j] = matrix[i][j] + temp[i][k] * m.GetElement(k, j);
-			}
-		}
-	}
+	//Multiplies each row of the left matrix with the right matrix. The kernel can write straight into the left matrix
+	Matrix44Kernels::Multiply(matrix, m.matrix, matrix);
 }
 
 //------------------------------------------------------------------------------
@@ -182,28 +160,7 @@ void Matrix44::operator*=(const Matrix44& m)
 Matrix44 Matrix44::operator*(const Matrix44& m)const
 {
 	Matrix44 result;
-
-	//Fill result matrix with 0
-	for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			result[i][j] = 0;	
-		}
-	}
-
-	//Multiplies each component of the left matrix row with each component of the right matrix column
-	//Each multiplication is added to the index of the result matrix.
-	for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			for (int k = 0; k < 4; k++)
-			{
-				result[i][j] = result[i][j] + matrix[i][k] * m.GetElement(k, j);
-			}
-		}
-	}	
+	Matrix44Kernels::Multiply(matrix, m.matrix, result.matrix);
 	return result;
 }
 
@@ -212,18 +169,9 @@ Matrix44 Matrix44::operator*(const Matrix44& m)const
 */
 Vector4 Matrix44::operator*(const Vector4& v)const
 {
-	//Initialized with x,y,z,w = 0
+	//Dot product of each row of the matrix with the vector
 	Vector4 result;
-
-	//Multiplies each component of the left matrix row with each component of the right vector column
-	//Each multiplication is added to the index of the result vector.
-	for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			result[i] = result[i] + matrix[i][j] * v.GetElement(j);
-		}
-	}	
+	Matrix44Kernels::MultiplyVector(matrix, v.vector, result.vector);
 	return result;
 }
 
@@ -313,12 +261,14 @@ bool Matrix44::operator!=(const Matrix44& m)const
 */
 void Matrix44::Transpose()
 {
-	Matrix44 temp = *this;
+	//Swaps the elements above the diagonal with the ones below. Plain floats, the SIMD transpose measured slower
 	for (int i = 0; i < 4; i++)
 	{
-		for (int j = 0; j < 4; j++)
+		for (int j = i + 1; j < 4; j++)
 		{
-			matrix[i][j] = temp[j][i];
+			float swap = matrix[i][j];
+			matrix[i][j] = matrix[j][i];
+			matrix[j][i] = swap;
 		}
 	}
 }
@@ -498,6 +448,41 @@ Matrix44 Matrix44::Inverse()
 	return result;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+Matrix44 Matrix44::AffineInverse() const
+{
+	Matrix44 result;
+	if (!Matrix44Kernels::AffineInverse(matrix, result.matrix))
+	{
+		cout<<"Determinant = 0, no Inverse for this matrix"<<endl;
+		return Matrix44();
+	}
+	return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+	The inverse of a rotation is its transpose. The translation is rotated back and negated
+*/
+Matrix44 Matrix44::RigidInverse() const
+{
+	Matrix44 result;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			result.matrix[i][j] = matrix[j][i];
+		}
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		result.matrix[i][3] = -(matrix[0][i]*matrix[0][3] + matrix[1][i]*matrix[1][3] + matrix[2][i]*matrix[2][3]);
+	}
+	return result;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
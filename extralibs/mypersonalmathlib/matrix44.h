@@ -4,6 +4,8 @@
 #include "vector4.h"
 #include "vector3.h"
 #include "mypersonalmathlibconstants.h"
+//SIMD versions of multiply and inverse
+#include "matrix44kernels.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -64,6 +66,10 @@ public:
 	float Determinant();
 	/// Returns the Inverse of a Matrix. Only possible if (Determinant != 0). Returns the Identity Matrix if Determinant = 0
 	Matrix44 Inverse();
+	/// Returns the Inverse of a Matrix made of rotation, scaling and translation (last row is 0 0 0 1). Faster than Inverse. Returns the Identity Matrix if Determinant = 0
+	Matrix44 AffineInverse() const;
+	/// Returns the Inverse of a Matrix made of only rotation and translation, like a lookAt matrix. The rotation is transposed, no determinant is needed
+	Matrix44 RigidInverse() const;
 
 	/// Multiply the matrix with a Rotation matrix around X axis
 	void RotateAroundX(float angle);
@@ -0,0 +1,225 @@
+#include "matrix44kernels.h"
+#include "simd4.h"
+
+using namespace Simd4;
+
+//------------------------------------------------------------------------------
+/**
+*/
+void Matrix44Kernels::Multiply(const float a[4][4], const float b[4][4], float out[4][4])
+{
+#if defined(MYPERSONALMATHLIB_AVX)
+	//Each row of b in both halves so two rows of the result are calculated at once
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)b[0]);
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)b[1]);
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)b[2]);
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)b[3]);
+
+	__m256 a01 = _mm256_loadu_ps(a[0]);
+	__m256 a23 = _mm256_loadu_ps(a[2]);
+
+	//The shuffles splat one component of each row within its half
+	__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), b2));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), b3));
+
+	__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), b2));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), b3));
+
+	_mm256_storeu_ps(out[0], r01);
+	_mm256_storeu_ps(out[2], r23);
+#else
+	//A row of the result is the rows of b weighted by the components of the same row in a
+	//All of b is loaded before anything is stored so out can be a or b
+	Float4 b0 = Load(b[0]);
+	Float4 b1 = Load(b[1]);
+	Float4 b2 = Load(b[2]);
+	Float4 b3 = Load(b[3]);
+
+	for (int i = 0; i < 4; i++)
+	{
+		Float4 row = Load(a[i]);
+		Float4 result = Mul(SplatLane<0>(row), b0);
+		result = MulAdd(SplatLane<1>(row), b1, result);
+		result = MulAdd(SplatLane<2>(row), b2, result);
+		result = MulAdd(SplatLane<3>(row), b3, result);
+		Store(out[i], result);
+	}
+#endif
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void Matrix44Kernels::MultiplyVector(const float m[4][4], const float v[4], float out[4])
+{
+	//Multiply each row with the vector, then transpose so the 4 dot products can be summed lane by lane
+	Float4 vector = Load(v);
+	Float4 r0 = Mul(Load(m[0]), vector);
+	Float4 r1 = Mul(Load(m[1]), vector);
+	Float4 r2 = Mul(Load(m[2]), vector);
+	Float4 r3 = Mul(Load(m[3]), vector);
+	Simd4::Transpose(r0, r1, r2, r3);
+	Store(out, Add(Add(r0, r1), Add(r2, r3)));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool Matrix44Kernels::AffineInverse(const float m[4][4], float out[4][4])
+{
+	//Columns of the matrix. c3 holds the translation
+	Float4 c0 = Load(m[0]);
+	Float4 c1 = Load(m[1]);
+	Float4 c2 = Load(m[2]);
+	Float4 c3 = Load(m[3]);
+	Simd4::Transpose(c0, c1, c2, c3);
+
+	//The rows of the inverse of the 3x3 part are the cross products of its columns divided by the determinant
+	Float4 r0 = Cross3(c1, c2);
+	Float4 r1 = Cross3(c2, c0);
+	Float4 r2 = Cross3(c0, c1);
+
+	float products[4];
+	Store(products, Mul(c0, r0));
+	float det = products[0] + products[1] + products[2];
+	if (det == 0)
+	{
+		return false;
+	}
+
+	Float4 invDet = Splat(1 / det);
+	r0 = Mul(r0, invDet);
+	r1 = Mul(r1, invDet);
+	r2 = Mul(r2, invDet);
+	Float4 r3 = Splat(0);
+
+	//New translation is -inverse*translation. Calculated on the columns of the inverse
+	Simd4::Transpose(r0, r1, r2, r3);
+	Float4 translation = Mul(SplatLane<0>(c3), r0);
+	translation = MulAdd(SplatLane<1>(c3), r1, translation);
+	translation = MulAdd(SplatLane<2>(c3), r2, translation);
+	translation = Sub(Splat(0), translation);
+
+	//Last column is the translation with 1 in the w lane
+	r3 = MulAdd(translation, Set(1, 1, 1, 0), Set(0, 0, 0, 1));
+	Simd4::Transpose(r0, r1, r2, r3);
+	Store(out[0], r0);
+	Store(out[1], r1);
+	Store(out[2], r2);
+	Store(out[3], r3);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void Matrix44Kernels::MultiplyScalar(const float a[4][4], const float b[4][4], float out[4][4])
+{
+	//Multiplies each component of the left matrix row with each component of the right matrix column
+	//Calculated into a temporary matrix in case out is a or b
+	float result[4][4];
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			result[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			out[i][j] = result[i][j];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void Matrix44Kernels::MultiplyVectorScalar(const float m[4][4], const float v[4], float out[4])
+{
+	float result[4];
+	for (int i = 0; i < 4; i++)
+	{
+		result[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2] + m[i][3] * v[3];
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		out[i] = result[i];
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool Matrix44Kernels::AffineInverseScalar(const float m[4][4], float out[4][4])
+{
+	//Cofactors of the 3x3 part
+	float cofactor00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	float cofactor10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	float cofactor20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+	float det = m[0][0] * cofactor00 + m[0][1] * cofactor10 + m[0][2] * cofactor20;
+	if (det == 0)
+	{
+		return false;
+	}
+	float invDet = 1 / det;
+
+	//Inverse of the 3x3 part
+	float result[4][4];
+	result[0][0] = cofactor00 * invDet;
+	result[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+	result[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+
+	result[1][0] = cofactor10 * invDet;
+	result[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+	result[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+
+	result[2][0] = cofactor20 * invDet;
+	result[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+	result[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+	//New translation is -inverse*translation
+	for (int i = 0; i < 3; i++)
+	{
+		result[i][3] = -(result[i][0] * m[0][3] + result[i][1] * m[1][3] + result[i][2] * m[2][3]);
+	}
+
+	result[3][0] = 0;
+	result[3][1] = 0;
+	result[3][2] = 0;
+	result[3][3] = 1;
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			out[i][j] = result[i][j];
+		}
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+const char* Matrix44Kernels::InstructionSet()
+{
+#if defined(MYPERSONALMATHLIB_AVX)
+	return "AVX";
+#elif defined(MYPERSONALMATHLIB_SSE)
+	return "SSE";
+#elif defined(MYPERSONALMATHLIB_NEON)
+	return "NEON";
+#else
+	return "Scalar";
+#endif
+}
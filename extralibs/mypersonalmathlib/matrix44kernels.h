@@ -0,0 +1,32 @@
+#ifndef matrix44kernels_h__
+#define matrix44kernels_h__
+
+/**
+@namespace Matrix44Kernels
+
+The 4x4 matrix math used by Matrix44. Matrices are row major float[4][4] like Matrix44 stores them.
+The plain functions use AVX, SSE or NEON when the library is compiled for it (see simd4.h).
+The Scalar functions always use plain floats and give the same results.
+The output may be the same array as one of the inputs.
+*/
+namespace Matrix44Kernels
+{
+	/// out = a*b
+	void Multiply(const float a[4][4], const float b[4][4], float out[4][4]);
+	/// out = m*v
+	void MultiplyVector(const float m[4][4], const float v[4], float out[4]);
+	/// Inverse of a matrix whose last row is 0 0 0 1. Returns false if the 3x3 part has no inverse
+	bool AffineInverse(const float m[4][4], float out[4][4]);
+
+	/// out = a*b
+	void MultiplyScalar(const float a[4][4], const float b[4][4], float out[4][4]);
+	/// out = m*v
+	void MultiplyVectorScalar(const float m[4][4], const float v[4], float out[4]);
+	/// Inverse of a matrix whose last row is 0 0 0 1. Returns false if the 3x3 part has no inverse
+	bool AffineInverseScalar(const float m[4][4], float out[4][4]);
+
+	/// Returns the name of the instruction set the plain functions use
+	const char* InstructionSet();
+}
+
+#endif // matrix44kernels_h__
@@ -6,5 +6,7 @@
 #include "vector4.h"
 #include "matrix33.h"
 #include "matrix44.h"
+#include "pointbounds.h"
+#include "transformtrs.h"
 
 #endif // mypersonalmathlib_h__
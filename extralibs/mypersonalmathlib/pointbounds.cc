@@ -0,0 +1,291 @@
+#include "pointbounds.h"
+#include "simd4.h"
+
+#include <float.h>
+#include <math.h>
+
+using namespace Simd4;
+
+//Points summed in float lanes before they are added to the double sum
+const unsigned int SumBlockSize = 1024;
+
+//------------------------------------------------------------------------------
+/**
+	Loads 4 points from separate x, y and z arrays
+*/
+struct SeparatePoints
+{
+	const float* x;
+	const float* y;
+	const float* z;
+
+	void Load4(unsigned int i, Float4& px, Float4& py, Float4& pz) const
+	{
+		px = Simd4::Load(x + i);
+		py = Simd4::Load(y + i);
+		pz = Simd4::Load(z + i);
+	}
+
+	void Get(unsigned int i, float& px, float& py, float& pz) const
+	{
+		px = x[i];
+		py = y[i];
+		pz = z[i];
+	}
+};
+
+//------------------------------------------------------------------------------
+/**
+	Loads 4 points stored as x, y, z after each other
+*/
+struct PackedPoints
+{
+	const float* xyz;
+
+	void Load4(unsigned int i, Float4& px, Float4& py, Float4& pz) const
+	{
+		LoadPoints(xyz + 3 * i, px, py, pz);
+	}
+
+	void Get(unsigned int i, float& px, float& py, float& pz) const
+	{
+		px = xyz[3 * i];
+		py = xyz[3 * i + 1];
+		pz = xyz[3 * i + 2];
+	}
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+static float horizontalMin(Float4 v)
+{
+	float lanes[4];
+	Store(lanes, v);
+	float result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+	result = lanes[2] < result ? lanes[2] : result;
+	return lanes[3] < result ? lanes[3] : result;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static float horizontalMax(Float4 v)
+{
+	float lanes[4];
+	Store(lanes, v);
+	float result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+	result = lanes[2] > result ? lanes[2] : result;
+	return lanes[3] > result ? lanes[3] : result;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static double horizontalSum(Float4 v)
+{
+	float lanes[4];
+	Store(lanes, v);
+	return (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+//------------------------------------------------------------------------------
+/**
+	Min, max and sum of the points, four at a time
+*/
+template<typename Points>
+static void addPoints(const Points& points, unsigned int count, float min[3], float max[3], double sum[3])
+{
+	Float4 minX = Splat(min[0]), minY = Splat(min[1]), minZ = Splat(min[2]);
+	Float4 maxX = Splat(max[0]), maxY = Splat(max[1]), maxZ = Splat(max[2]);
+
+	unsigned int i = 0;
+	while (i + 4 <= count)
+	{
+		//Sum a block in float lanes, then add it to the double sum
+		Float4 sumX = Splat(0), sumY = Splat(0), sumZ = Splat(0);
+		unsigned int blockEnd = i + SumBlockSize < count ? i + SumBlockSize : count;
+		for (; i + 4 <= blockEnd; i += 4)
+		{
+			Float4 px, py, pz;
+			points.Load4(i, px, py, pz);
+			minX = Min(minX, px);
+			minY = Min(minY, py);
+			minZ = Min(minZ, pz);
+			maxX = Max(maxX, px);
+			maxY = Max(maxY, py);
+			maxZ = Max(maxZ, pz);
+			sumX = Add(sumX, px);
+			sumY = Add(sumY, py);
+			sumZ = Add(sumZ, pz);
+		}
+		sum[0] += horizontalSum(sumX);
+		sum[1] += horizontalSum(sumY);
+		sum[2] += horizontalSum(sumZ);
+	}
+
+	min[0] = horizontalMin(minX);
+	min[1] = horizontalMin(minY);
+	min[2] = horizontalMin(minZ);
+	max[0] = horizontalMax(maxX);
+	max[1] = horizontalMax(maxY);
+	max[2] = horizontalMax(maxZ);
+
+	//The last points which don't fill four lanes
+	for (; i < count; i++)
+	{
+		float p[3];
+		points.Get(i, p[0], p[1], p[2]);
+		for (int j = 0; j < 3; j++)
+		{
+			min[j] = p[j] < min[j] ? p[j] : min[j];
+			max[j] = p[j] > max[j] ? p[j] : max[j];
+			sum[j] += p[j];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+	Largest squared distance from the center, four points at a time
+*/
+template<typename Points>
+static float maxDistance(const Points& points, unsigned int count, const Vector3& center)
+{
+	float cx = center.GetElement(0);
+	float cy = center.GetElement(1);
+	float cz = center.GetElement(2);
+	Float4 centerX = Splat(cx), centerY = Splat(cy), centerZ = Splat(cz);
+	Float4 maxDistanceSquared = Splat(0);
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		Float4 px, py, pz;
+		points.Load4(i, px, py, pz);
+		Float4 dx = Sub(px, centerX);
+		Float4 dy = Sub(py, centerY);
+		Float4 dz = Sub(pz, centerZ);
+		maxDistanceSquared = Max(maxDistanceSquared, MulAdd(dx, dx, MulAdd(dy, dy, Mul(dz, dz))));
+	}
+	float result = horizontalMax(maxDistanceSquared);
+
+	//The last points which don't fill four lanes
+	for (; i < count; i++)
+	{
+		float px, py, pz;
+		points.Get(i, px, py, pz);
+		float distanceSquared = (px - cx) * (px - cx) + (py - cy) * (py - cy) + (pz - cz) * (pz - cz);
+		result = distanceSquared > result ? distanceSquared : result;
+	}
+	return sqrtf(result);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PointBounds::PointBounds(void)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		min[i] = FLT_MAX;
+		max[i] = -FLT_MAX;
+		sum[i] = 0;
+	}
+	count = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PointBounds::~PointBounds(void)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void PointBounds::AddPoints(const float* x, const float* y, const float* z, unsigned int count)
+{
+	SeparatePoints points = { x, y, z };
+	addPoints(points, count, min, max, sum);
+	this->count += count;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void PointBounds::AddPackedPoints(const float* xyz, unsigned int count)
+{
+	PackedPoints points = { xyz };
+	addPoints(points, count, min, max, sum);
+	this->count += count;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void PointBounds::Merge(const PointBounds& bounds)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		min[i] = bounds.min[i] < min[i] ? bounds.min[i] : min[i];
+		max[i] = bounds.max[i] > max[i] ? bounds.max[i] : max[i];
+		sum[i] += bounds.sum[i];
+	}
+	count += bounds.count;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Vector3 PointBounds::GetMin() const
+{
+	return Vector3(min[0], min[1], min[2]);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Vector3 PointBounds::GetMax() const
+{
+	return Vector3(max[0], max[1], max[2]);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Vector3 PointBounds::GetCentroid() const
+{
+	if (count == 0)
+	{
+		return Vector3(0, 0, 0);
+	}
+	return Vector3((float)(sum[0] / count), (float)(sum[1] / count), (float)(sum[2] / count));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+unsigned int PointBounds::GetCount() const
+{
+	return count;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+float PointBounds::MaxDistance(const float* x, const float* y, const float* z, unsigned int count, const Vector3& center)
+{
+	SeparatePoints points = { x, y, z };
+	return maxDistance(points, count, center);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+float PointBounds::MaxDistancePacked(const float* xyz, unsigned int count, const Vector3& center)
+{
+	PackedPoints points = { xyz };
+	return maxDistance(points, count, center);
+}
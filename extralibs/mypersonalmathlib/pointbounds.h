@@ -0,0 +1,47 @@
+#ifndef pointbounds_h__
+#define pointbounds_h__
+
+#include "vector3.h"
+
+/**
+@class PointBounds
+
+Min, max and centroid of a set of points. Points are added a whole array at a time.
+The arrays can be split into ranges handled by different threads, each with its own PointBounds, and merged afterwards
+*/
+class PointBounds
+{
+public:
+	/// Empty bounds
+	PointBounds(void);
+	~PointBounds(void);
+
+	/// Adds count points stored as separate x, y and z arrays
+	void AddPoints(const float* x, const float* y, const float* z, unsigned int count);
+	/// Adds count points stored as x, y, z after each other, like an array of Vector3
+	void AddPackedPoints(const float* xyz, unsigned int count);
+	/// Adds the points of other bounds
+	void Merge(const PointBounds& bounds);
+
+	/// Returns the smallest x, y and z of the points
+	Vector3 GetMin() const;
+	/// Returns the largest x, y and z of the points
+	Vector3 GetMax() const;
+	/// Returns the mean of the points
+	Vector3 GetCentroid() const;
+	/// Returns amount of points added
+	unsigned int GetCount() const;
+
+	/// Returns the largest distance from center to any of count points stored as separate x, y and z arrays
+	static float MaxDistance(const float* x, const float* y, const float* z, unsigned int count, const Vector3& center);
+	/// Returns the largest distance from center to any of count points stored as x, y, z after each other
+	static float MaxDistancePacked(const float* xyz, unsigned int count, const Vector3& center);
+
+private:
+	float min[3];
+	float max[3];
+	//Summed in double so the centroid of large meshes stays accurate
+	double sum[3];
+	unsigned int count;
+};
+#endif // pointbounds_h__
@@ -0,0 +1,201 @@
+#ifndef simd4_h__
+#define simd4_h__
+
+/**
+@namespace Simd4
+
+Four float wide vector operations used by the matrix, point and frustum kernels and the occlusion buffer.
+Maps to SSE on x86, NEON on ARM and plain floats on everything else.
+Define MYPERSONALMATHLIB_NO_SIMD to always use the plain floats.
+*/
+
+#if !defined(MYPERSONALMATHLIB_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define MYPERSONALMATHLIB_SSE
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define MYPERSONALMATHLIB_AVX
+#include <immintrin.h>
+#endif
+#if defined(__AVX512F__)
+#define MYPERSONALMATHLIB_AVX512
+#endif
+#elif !defined(MYPERSONALMATHLIB_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MYPERSONALMATHLIB_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Simd4
+{
+#if defined(MYPERSONALMATHLIB_SSE)
+
+	typedef __m128 Float4;
+
+	/// Loads 4 floats. The pointer doesn't have to be aligned
+	inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+	/// Stores 4 floats. The pointer doesn't have to be aligned
+	inline void Store(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+	/// x, y, z, w
+	inline Float4 Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+	/// Same value in all 4 lanes
+	inline Float4 Splat(float x) { return _mm_set1_ps(x); }
+	/// One lane of v copied to all 4 lanes
+	template <int lane> inline Float4 SplatLane(Float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(lane, lane, lane, lane)); }
+	/// y, z, x, w
+	inline Float4 ShuffleYZX(Float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)); }
+
+	inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+	inline Float4 Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+	inline Float4 Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+	/// a*b + c
+	inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+	inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+	/// Bit i is set if lane i of a <= lane i of b
+	inline unsigned int LessEqual(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+	/// Bit i is set if lane i of a > lane i of b
+	inline unsigned int Greater(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+	/// Lane i is lane i of c if lane i of a >= lane i of b, otherwise lane i of d
+	inline Float4 SelectGreaterEqual(Float4 a, Float4 b, Float4 c, Float4 d) { Float4 mask = _mm_cmpge_ps(a, b); return _mm_or_ps(_mm_and_ps(mask, c), _mm_andnot_ps(mask, d)); }
+
+	/// Switches rows to columns of the 4 vectors
+	inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+	/// Loads 4 points stored as x, y, z after each other (12 floats) and splits them into x, y and z
+	inline void LoadPoints(const float* p, Float4& x, Float4& y, Float4& z)
+	{
+		//a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+		Float4 a = _mm_loadu_ps(p);
+		Float4 b = _mm_loadu_ps(p + 4);
+		Float4 c = _mm_loadu_ps(p + 8);
+		Float4 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+		Float4 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+		x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+#elif defined(MYPERSONALMATHLIB_NEON)
+
+	typedef float32x4_t Float4;
+
+	/// Loads 4 floats. The pointer doesn't have to be aligned
+	inline Float4 Load(const float* p) { return vld1q_f32(p); }
+	/// Stores 4 floats. The pointer doesn't have to be aligned
+	inline void Store(float* p, Float4 v) { vst1q_f32(p, v); }
+	/// x, y, z, w
+	inline Float4 Set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+	/// Same value in all 4 lanes
+	inline Float4 Splat(float x) { return vdupq_n_f32(x); }
+	/// One lane of v copied to all 4 lanes
+	template <int lane> inline Float4 SplatLane(Float4 v) { return vdupq_n_f32(vgetq_lane_f32(v, lane)); }
+	/// y, z, x and y again in the w lane
+	inline Float4 ShuffleYZX(Float4 v) { return vcombine_f32(vext_f32(vget_low_f32(v), vget_high_f32(v), 1), vget_low_f32(v)); }
+
+	inline Float4 Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+	inline Float4 Sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+	inline Float4 Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+	/// a*b + c
+	inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+	inline Float4 Min(Float4 a, Float4 b) { return vminq_f32(a, b); }
+	inline Float4 Max(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+	/// Lane i of a comparison result becomes bit i
+	inline unsigned int LaneBits(uint32x4_t lanes)
+	{
+		const uint32_t bitValues[4] = { 1, 2, 4, 8 };
+		uint32x4_t bits = vandq_u32(lanes, vld1q_u32(bitValues));
+		uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		return vget_lane_u32(vpadd_u32(sum, sum), 0);
+	}
+	/// Bit i is set if lane i of a <= lane i of b
+	inline unsigned int LessEqual(Float4 a, Float4 b) { return LaneBits(vcleq_f32(a, b)); }
+	/// Bit i is set if lane i of a > lane i of b
+	inline unsigned int Greater(Float4 a, Float4 b) { return LaneBits(vcgtq_f32(a, b)); }
+	/// Lane i is lane i of c if lane i of a >= lane i of b, otherwise lane i of d
+	inline Float4 SelectGreaterEqual(Float4 a, Float4 b, Float4 c, Float4 d) { return vbslq_f32(vcgeq_f32(a, b), c, d); }
+
+	/// Switches rows to columns of the 4 vectors
+	inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+	{
+		float32x4x2_t t01 = vtrnq_f32(r0, r1);
+		float32x4x2_t t23 = vtrnq_f32(r2, r3);
+		r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+		r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+		r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+		r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+	}
+
+	/// Loads 4 points stored as x, y, z after each other (12 floats) and splits them into x, y and z
+	inline void LoadPoints(const float* p, Float4& x, Float4& y, Float4& z)
+	{
+		float32x4x3_t points = vld3q_f32(p);
+		x = points.val[0];
+		y = points.val[1];
+		z = points.val[2];
+	}
+
+#else
+
+	struct Float4
+	{
+		float v[4];
+	};
+
+	/// Loads 4 floats
+	inline Float4 Load(const float* p) { Float4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+	/// Stores 4 floats
+	inline void Store(float* p, Float4 v) { p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+	/// x, y, z, w
+	inline Float4 Set(float x, float y, float z, float w) { Float4 r = { { x, y, z, w } }; return r; }
+	/// Same value in all 4 lanes
+	inline Float4 Splat(float x) { return Set(x, x, x, x); }
+	/// One lane of v copied to all 4 lanes
+	template <int lane> inline Float4 SplatLane(Float4 v) { return Splat(v.v[lane]); }
+	/// y, z, x, w
+	inline Float4 ShuffleYZX(Float4 v) { return Set(v.v[1], v.v[2], v.v[0], v.v[3]); }
+
+	inline Float4 Add(Float4 a, Float4 b) { return Set(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+	inline Float4 Sub(Float4 a, Float4 b) { return Set(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+	inline Float4 Mul(Float4 a, Float4 b) { return Set(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+	/// a*b + c
+	inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return Add(Mul(a, b), c); }
+	inline Float4 Min(Float4 a, Float4 b) { return Set(b.v[0] < a.v[0] ? b.v[0] : a.v[0], b.v[1] < a.v[1] ? b.v[1] : a.v[1], b.v[2] < a.v[2] ? b.v[2] : a.v[2], b.v[3] < a.v[3] ? b.v[3] : a.v[3]); }
+	inline Float4 Max(Float4 a, Float4 b) { return Set(b.v[0] > a.v[0] ? b.v[0] : a.v[0], b.v[1] > a.v[1] ? b.v[1] : a.v[1], b.v[2] > a.v[2] ? b.v[2] : a.v[2], b.v[3] > a.v[3] ? b.v[3] : a.v[3]); }
+	/// Bit i is set if lane i of a <= lane i of b
+	inline unsigned int LessEqual(Float4 a, Float4 b) { return (a.v[0] <= b.v[0]) | (a.v[1] <= b.v[1]) << 1 | (a.v[2] <= b.v[2]) << 2 | (a.v[3] <= b.v[3]) << 3; }
+	/// Bit i is set if lane i of a > lane i of b
+	inline unsigned int Greater(Float4 a, Float4 b) { return (a.v[0] > b.v[0]) | (a.v[1] > b.v[1]) << 1 | (a.v[2] > b.v[2]) << 2 | (a.v[3] > b.v[3]) << 3; }
+	/// Lane i is lane i of c if lane i of a >= lane i of b, otherwise lane i of d
+	inline Float4 SelectGreaterEqual(Float4 a, Float4 b, Float4 c, Float4 d) { return Set(a.v[0] >= b.v[0] ? c.v[0] : d.v[0], a.v[1] >= b.v[1] ? c.v[1] : d.v[1], a.v[2] >= b.v[2] ? c.v[2] : d.v[2], a.v[3] >= b.v[3] ? c.v[3] : d.v[3]); }
+
+	/// Switches rows to columns of the 4 vectors
+	inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+	{
+		Float4 c0 = Set(r0.v[0], r1.v[0], r2.v[0], r3.v[0]);
+		Float4 c1 = Set(r0.v[1], r1.v[1], r2.v[1], r3.v[1]);
+		Float4 c2 = Set(r0.v[2], r1.v[2], r2.v[2], r3.v[2]);
+		Float4 c3 = Set(r0.v[3], r1.v[3], r2.v[3], r3.v[3]);
+		r0 = c0;
+		r1 = c1;
+		r2 = c2;
+		r3 = c3;
+	}
+
+	/// Loads 4 points stored as x, y, z after each other (12 floats) and splits them into x, y and z
+	inline void LoadPoints(const float* p, Float4& x, Float4& y, Float4& z)
+	{
+		x = Set(p[0], p[3], p[6], p[9]);
+		y = Set(p[1], p[4], p[7], p[10]);
+		z = Set(p[2], p[5], p[8], p[11]);
+	}
+
+#endif
+
+	/// Cross product of the x, y, z lanes. The w lane is undefined
+	inline Float4 Cross3(Float4 a, Float4 b)
+	{
+		//a*b.yzx - a.yzx*b gives the cross product in z, x, y order
+		return ShuffleYZX(Sub(Mul(a, ShuffleYZX(b)), Mul(ShuffleYZX(a), b)));
+	}
+}
+
+#endif // simd4_h__
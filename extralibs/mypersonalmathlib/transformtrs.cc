@@ -0,0 +1,140 @@
+#include "transformtrs.h"
+
+//------------------------------------------------------------------------------
+/**
+*/
+TransformTRS::TransformTRS(void)
+{
+	SetToIdentity();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+TransformTRS::~TransformTRS(void)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void TransformTRS::SetToIdentity()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			rotation[i][j] = (i == j) ? 1.0f : 0.0f;
+		}
+		translation[i] = 0;
+		scale[i] = 1;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void TransformTRS::SetRigid(const Matrix44& m)
+{
+	SetRotation(m);
+	for (int i = 0; i < 3; i++)
+	{
+		translation[i] = m.GetElement(i, 3);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void TransformTRS::SetRotation(const Matrix44& m)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			rotation[i][j] = m.GetElement(i, j);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void TransformTRS::SetTranslation(const Vector3& v)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		translation[i] = v.GetElement(i);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void TransformTRS::SetScale(const Vector3& v)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		scale[i] = v.GetElement(i);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Vector3 TransformTRS::GetTranslation() const
+{
+	return Vector3(translation[0], translation[1], translation[2]);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Vector3 TransformTRS::GetScale() const
+{
+	return Vector3(scale[0], scale[1], scale[2]);
+}
+
+//------------------------------------------------------------------------------
+/**
+	Scaling after rotation scales the columns of the rotation
+*/
+Matrix44 TransformTRS::GetMatrix() const
+{
+	Matrix44 result;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			result[i][j] = rotation[i][j]*scale[j];
+		}
+		result[i][3] = translation[i];
+	}
+	return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+	(T*R*S)^-1 = S^-1*R^T*T^-1. The rows of the transposed rotation are divided by the scale
+*/
+Matrix44 TransformTRS::GetInverseMatrix() const
+{
+	if (scale[0] == 0 || scale[1] == 0 || scale[2] == 0)
+	{
+		cout<<"Scale = 0, no Inverse for this transform"<<endl;
+		return Matrix44();
+	}
+
+	Matrix44 result;
+
+	for (int i = 0; i < 3; i++)
+	{
+		float inverseScale = 1/scale[i];
+		for (int j = 0; j < 3; j++)
+		{
+			result[i][j] = rotation[j][i]*inverseScale;
+		}
+		result[i][3] = -(result[i][0]*translation[0] + result[i][1]*translation[1] + result[i][2]*translation[2]);
+	}
+	return result;
+}
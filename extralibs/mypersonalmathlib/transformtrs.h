@@ -0,0 +1,47 @@
+#ifndef transformtrs_h__
+#define transformtrs_h__
+
+#include "matrix44.h"
+#include "vector3.h"
+
+/**
+@class TransformTRS
+
+A transform kept as translation, rotation and scale instead of a full matrix.
+The matrix is Translation*Rotation*Scale. Both the matrix and its inverse are built directly from the parts
+*/
+class TransformTRS
+{
+public:
+	/// Identity transform
+	TransformTRS(void);
+	~TransformTRS(void);
+
+	/// Sets this transform to identity
+	void SetToIdentity();
+
+	/// Takes the rotation from the upper 3x3 and the translation from the last column of a matrix made of only rotation and translation
+	void SetRigid(const Matrix44& m);
+	/// Takes the rotation from the upper 3x3 of a rotation matrix
+	void SetRotation(const Matrix44& m);
+	/// Sets the translation
+	void SetTranslation(const Vector3& v);
+	/// Sets the scale of each axis
+	void SetScale(const Vector3& v);
+
+	/// Returns the translation
+	Vector3 GetTranslation() const;
+	/// Returns the scale of each axis
+	Vector3 GetScale() const;
+
+	/// Returns Translation*Rotation*Scale
+	Matrix44 GetMatrix() const;
+	/// Returns the inverse of GetMatrix. Returns the Identity Matrix if a scale is 0
+	Matrix44 GetInverseMatrix() const;
+
+private:
+	float rotation[3][3];
+	float translation[3];
+	float scale[3];
+};
+#endif // transformtrs_h__
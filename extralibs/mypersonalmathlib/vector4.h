@@ -68,6 +68,9 @@ public:
 	float GetElement(unsigned int index) const;
 
 private:
+	//Matrix44 hands the components straight to its SIMD kernels
+	friend class Matrix44;
+
 	float vector[4];
 };
 #endif // vector4_h__
\ No newline at end of file